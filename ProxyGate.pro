@@ -22,28 +22,53 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
-CONFIG += c++11
+CONFIG += c++14
 
 # File names:
 SOURCES += \
+        src/byte_scan.cpp \
+        src/chunked_codec.cpp \
+        src/disk_cache.cpp \
+        src/gate.cpp \
+        src/header_table.cpp \
+        src/http_cache.cpp \
         src/httpparser.cpp \
         src/main.cpp \
         src/mainwindow.cpp \
         src/message_logger.cpp \
+        src/reactor.cpp \
+        src/resolver.cpp \
+        src/ring_buffer.cpp \
+        src/rules.cpp \
+        src/slab_pool.cpp \
         src/server.cpp \
         src/socket.cpp \
         src/spider.cpp \
+        src/upstream_pool.cpp \
         src/qhexedit/qhexedit.cpp \
         src/qhexedit/commands.cpp \
         src/qhexedit/chunks.cpp
 
 HEADERS += \
+        include/byte_scan.h \
+        include/chunked_codec.h \
+        include/disk_cache.h \
+        include/gate.h \
+        include/header_table.h \
+        include/http_cache.h \
         include/httpparser.h \
         include/mainwindow.h \
         include/message_logger.h \
+        include/reactor.h \
+        include/resolver.h \
+        include/ring_buffer.h \
+        include/rules.h \
+        include/slab_pool.h \
         include/server.h \
         include/socket.h \
         include/spider.h \
+        include/token_table.h \
+        include/upstream_pool.h \
         include/qhexedit/qhexedit.h \
         include/qhexedit/commands.h \
         include/qhexedit/chunks.h
@@ -0,0 +1,14 @@
+#-------------------------------------------------
+#
+# ProxyGate benchmarks (built apart from the application, with
+# 'qmake bench/bench.pro').
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+        byte_scan \
+        loopback \
+        parser \
+        token_table
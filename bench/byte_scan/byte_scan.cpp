@@ -0,0 +1,110 @@
+// ProxyGate - ByteScan benchmark.
+
+/**
+ * @file byte_scan.cpp
+ * @brief ByteScan benchmark.
+ *
+ * This program prints the scan speed (in GB/s) of every build of the
+ * ByteScan kernels the processor can run (see kernels.h), with memchr as a
+ * reference:
+ *
+ * - find_any over data holding none of its bytes (the whole buffer is
+ *   scanned at once);
+ * - find_any walking header lines, stopping at every '\r', '\n' and ':';
+ * - find_header_end over header lines without the empty line.
+ *
+ */
+
+// Library includes:
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+// User includes:
+#include "bench/harness.h"
+#include "bench/byte_scan/kernels.h"
+
+// Macros:
+
+/**
+ * @def SCAN_SIZE
+ * @brief Size (in bytes) of the data scanned per round.
+ */
+
+#define SCAN_SIZE 1048576
+
+// Functions:
+
+/**
+ * @fn static void report(const char *kernel, const char *name, double round_ns)
+ * @brief Function to print the speed of a kernel.
+ * @param kernel Name of the build.
+ * @param name Name of the benchmark.
+ * @param round_ns Time (in nanoseconds) to scan SCAN_SIZE bytes.
+ */
+
+static void report(const char *kernel, const char *name, double round_ns) {
+  printf("%-8s %-24s %8.2f GB/s\n", kernel, name, SCAN_SIZE / round_ns);
+}
+
+/**
+ * @fn int main(int argc, char *argv[])
+ * @brief Main function.
+ * @param argc Number of arguments.
+ * @param argv Program arguments.
+ * @return Returns 0.
+ */
+
+int main(int argc, char *argv[]) {
+
+  scan_kernel kernels[KERNELS_MAX];
+  size_t count = scan_kernels(kernels);
+  std::string plain(SCAN_SIZE, 'x'), lines;
+  const char *line = "Accept-Language: pt-BR,pt;q=0.8,en-US;q=0.5,en;q=0.3\r\n";
+  volatile size_t start = 0;
+  double round_ns;
+
+  static_cast<void> (argc);
+  static_cast<void> (argv);
+
+  while(lines.size() + strlen(line) <= SCAN_SIZE)
+    lines += line;
+
+  lines.append(SCAN_SIZE - lines.size(), 'x');
+
+  // The start is read again every round, so the call is not hoisted:
+  round_ns = harness_round_ns([&]() {
+    return reinterpret_cast<size_t> (memchr(plain.data() + start, '\n', SCAN_SIZE));
+  });
+  report("libc", "memchr (no match)", round_ns);
+
+  for(size_t k = 0; k < count; k++) {
+
+    round_ns = harness_round_ns([&]() {
+      return reinterpret_cast<size_t> (kernels[k].find_any(plain.data(), SCAN_SIZE, '\r', '\n', ':'));
+    });
+    report(kernels[k].name, "find_any (no match)", round_ns);
+
+    round_ns = harness_round_ns([&]() {
+      const char *next = lines.data(), *end = next + SCAN_SIZE;
+      size_t found = 0;
+      while((next = kernels[k].find_any(next, static_cast<size_t> (end - next), '\r', '\n', ':')) != nullptr) {
+        next++;
+        found++;
+      }
+      return found;
+    });
+    report(kernels[k].name, "find_any (header lines)", round_ns);
+
+    round_ns = harness_round_ns([&]() {
+      return static_cast<size_t> (kernels[k].find_header_end(lines.data(), SCAN_SIZE));
+    });
+    report(kernels[k].name, "find_header_end", round_ns);
+
+  }
+
+  return 0;
+
+}
@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# ByteScan benchmark: scan speed of the scalar, SSE2 and AVX2 builds of the
+# kernels.
+#
+#-------------------------------------------------
+
+TARGET = byte_scan
+TEMPLATE = app
+
+CONFIG += console c++14
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ../..
+
+# File names:
+SOURCES += \
+        byte_scan.cpp \
+        kernels.cpp \
+        kernel_avx2.cpp \
+        kernel_scalar.cpp \
+        kernel_sse2.cpp
+
+HEADERS += \
+        ../harness.h \
+        kernels.h
@@ -0,0 +1,18 @@
+// ProxyGate - ByteScan kernels - AVX2 build.
+
+/**
+ * @file kernel_avx2.cpp
+ * @brief ByteScan kernels - AVX2 build.
+ *
+ * This source file builds src/byte_scan.cpp as it is built for the proxy, as
+ * the ByteScanAvx2 class (see kernels.h): it runs the AVX2 kernels on
+ * processors that have AVX2, the only ones it is listed for (see
+ * scan_kernels()).
+ *
+ */
+
+// Includes:
+#if defined(__x86_64__) || defined(__i386__)
+#define ByteScan ByteScanAvx2
+#include "src/byte_scan.cpp"
+#endif
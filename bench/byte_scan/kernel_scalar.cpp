@@ -0,0 +1,17 @@
+// ProxyGate - ByteScan kernels - Scalar build.
+
+/**
+ * @file kernel_scalar.cpp
+ * @brief ByteScan kernels - Scalar build.
+ *
+ * This source file builds src/byte_scan.cpp without vector instructions, as
+ * the ByteScanScalar class (see kernels.h).
+ *
+ */
+
+// Includes:
+#define BYTE_SCAN_NO_AVX2
+#undef __SSE2__
+
+#define ByteScan ByteScanScalar
+#include "src/byte_scan.cpp"
@@ -0,0 +1,23 @@
+// ProxyGate - ByteScan kernels - SSE2 build.
+
+/**
+ * @file kernel_sse2.cpp
+ * @brief ByteScan kernels - SSE2 build.
+ *
+ * This source file builds src/byte_scan.cpp with SSE2 (and without the AVX2
+ * kernels, whatever the processor), as the ByteScanSse2 class (see
+ * kernels.h).
+ *
+ */
+
+// Includes:
+#if defined(__x86_64__) || defined(__i386__)
+#pragma GCC target("sse2")
+#define BYTE_SCAN_NO_AVX2
+#ifndef __SSE2__
+#define __SSE2__ 1
+#endif
+
+#define ByteScan ByteScanSse2
+#include "src/byte_scan.cpp"
+#endif
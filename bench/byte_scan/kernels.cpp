@@ -0,0 +1,41 @@
+// ProxyGate - ByteScan kernels - Source code.
+
+/**
+ * @file kernels.cpp
+ * @brief ByteScan kernels - Source code.
+ *
+ * The kernels module builds src/byte_scan.cpp once per instruction set. This
+ * source file contains the function implementations for this module.
+ *
+ */
+
+// Includes:
+#include "bench/byte_scan/kernels.h"
+
+// Functions:
+
+/**
+ * @fn size_t scan_kernels(scan_kernel *kernels)
+ * @brief Function to list the builds of the kernels the processor can run.
+ * @param kernels Address to store the builds (KERNELS_MAX at most), the
+ * scalar one first.
+ * @return Returns the number of builds stored.
+ */
+
+size_t scan_kernels(scan_kernel *kernels) {
+
+  size_t count = 0;
+
+  kernels[count++] = {"scalar", ByteScanScalar::find_any, ByteScanScalar::find_header_end};
+
+#if defined(KERNELS_X86)
+  if(__builtin_cpu_supports("sse2"))
+    kernels[count++] = {"sse2", ByteScanSse2::find_any, ByteScanSse2::find_header_end};
+
+  if(__builtin_cpu_supports("avx2"))
+    kernels[count++] = {"avx2", ByteScanAvx2::find_any, ByteScanAvx2::find_header_end};
+#endif
+
+  return count;
+
+}
@@ -0,0 +1,80 @@
+// ProxyGate - ByteScan kernels - Header file.
+
+/**
+ * @file kernels.h
+ * @brief ByteScan kernels - Header file.
+ *
+ * ByteScan runs its AVX2 kernels when the processor has AVX2 and its SSE2
+ * ones otherwise. The kernels module builds src/byte_scan.cpp once per
+ * instruction set (kernel_scalar.cpp, kernel_sse2.cpp and kernel_avx2.cpp,
+ * each with the ByteScan class renamed and the scalar and SSE2 builds without
+ * the AVX2 kernels), so a single program can measure and check all of them. This header file contains a header guard, library
+ * includes, macro definitions, type definitions, the class headers of the
+ * renamed builds and the function headers for this module.
+ *
+ */
+
+// Header guard:
+#ifndef KERNELS_H
+#define KERNELS_H
+
+// Library includes:
+#include <stddef.h>
+#include <sys/types.h>
+
+// Macros:
+
+/**
+ * @def KERNELS_X86
+ * @brief Defined when the SSE2 and AVX2 builds exist (x86 processors).
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86
+#endif
+
+/**
+ * @def KERNELS_MAX
+ * @brief Number of builds of the kernels.
+ */
+
+#define KERNELS_MAX 3
+
+// Class headers:
+
+#define ByteScan ByteScanScalar
+#include "include/byte_scan.h"
+#undef ByteScan
+#undef BYTE_SCAN_H
+#undef BYTE_SCAN_AVX2
+
+#define ByteScan ByteScanSse2
+#include "include/byte_scan.h"
+#undef ByteScan
+#undef BYTE_SCAN_H
+#undef BYTE_SCAN_AVX2
+
+#define ByteScan ByteScanAvx2
+#include "include/byte_scan.h"
+#undef ByteScan
+
+// Type definitions:
+
+/**
+ * @struct scan_kernel
+ * @brief Build of the kernels the processor can run.
+ */
+
+typedef struct {
+  const char *name;   /**< Instruction set of the build. */
+  const char *(*find_any)(const char*, size_t, char, char, char);
+                      /**< ByteScan::find_any of the build. */
+  ssize_t (*find_header_end)(const char*, size_t);
+                      /**< ByteScan::find_header_end of the build. */
+} scan_kernel;
+
+// Function headers:
+
+size_t scan_kernels(scan_kernel*);
+
+#endif // KERNELS_H
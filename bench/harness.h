@@ -0,0 +1,128 @@
+// ProxyGate - Benchmark harness.
+
+/**
+ * @file harness.h
+ * @brief Benchmark harness.
+ *
+ * The harness times a round of work (a pass over a corpus or a buffer) the
+ * same way for every micro benchmark: the rounds are run in batches, doubled
+ * until a batch is long enough for the clock (which also warms the caches
+ * up), and the fastest of a few batches is kept. A benchmark only has to say
+ * what a round is and how many items (messages, bytes, lookups) it covers.
+ * The harness does not use Qt.
+ *
+ */
+
+// Header guard:
+#ifndef HARNESS_H
+#define HARNESS_H
+
+// Library includes:
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+
+// Macros:
+
+/**
+ * @def HARNESS_BATCH_NS
+ * @brief Shortest duration (in nanoseconds) of a batch of rounds.
+ */
+
+#define HARNESS_BATCH_NS 200000000ULL
+
+/**
+ * @def HARNESS_BATCHES
+ * @brief Number of batches timed (the fastest is kept).
+ */
+
+#define HARNESS_BATCHES 5
+
+// Variables:
+
+/**
+ * @var harness_sink
+ * @brief Results of the rounds, kept so the compiler does not drop them.
+ */
+
+static volatile size_t harness_sink;
+
+// Function headers:
+
+/**
+ * @fn static unsigned long long harness_now_ns()
+ * @brief Function to read the monotonic clock.
+ * @return Returns the time, in nanoseconds.
+ */
+
+static inline unsigned long long harness_now_ns() {
+
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return static_cast<unsigned long long> (now.tv_sec) * 1000000000ULL +
+         static_cast<unsigned long long> (now.tv_nsec);
+
+}
+
+/**
+ * @fn template<typename Round> unsigned long long harness_batch_ns(Round round, unsigned long long rounds)
+ * @brief Function to time a batch of rounds.
+ * @param round Callable running one round and returning a value that
+ * depends on all of its work (see harness_sink).
+ * @param rounds Number of rounds of the batch.
+ * @return Returns the time of the batch, in nanoseconds.
+ */
+
+template<typename Round>
+unsigned long long harness_batch_ns(Round round, unsigned long long rounds) {
+
+  unsigned long long start = harness_now_ns();
+
+  for(unsigned long long i = 0; i < rounds; i++)
+    harness_sink = harness_sink + round();
+
+  return harness_now_ns() - start;
+
+}
+
+/**
+ * @fn template<typename Round> double harness_round_ns(Round round)
+ * @brief Function to time a round of work.
+ * @param round Callable running one round (see harness_batch_ns).
+ * @return Returns the time of a round, in nanoseconds (fastest batch).
+ */
+
+template<typename Round>
+double harness_round_ns(Round round) {
+
+  unsigned long long rounds = 1, best, elapsed;
+
+  // Grow the batches until they are long enough for the clock:
+  while((best = harness_batch_ns(round, rounds)) < HARNESS_BATCH_NS)
+    rounds *= 2;
+
+  for(int batch = 1; batch < HARNESS_BATCHES; batch++)
+    if((elapsed = harness_batch_ns(round, rounds)) < best)
+      best = elapsed;
+
+  return static_cast<double> (best) / static_cast<double> (rounds);
+
+}
+
+/**
+ * @fn static void harness_report(const char *name, double round_ns, double items, const char *unit)
+ * @brief Function to print the result of a benchmark.
+ * @param name Name of the benchmark.
+ * @param round_ns Time of a round, in nanoseconds (see harness_round_ns).
+ * @param items Items covered by a round.
+ * @param unit Name of an item.
+ */
+
+static inline void harness_report(const char *name, double round_ns,
+                                  double items, const char *unit) {
+  printf("%-28s %10.2f ns/%s\n", name, round_ns / items, unit);
+}
+
+#endif // HARNESS_H
@@ -0,0 +1,509 @@
+// ProxyGate - Loopback load driver.
+
+/**
+ * @file loopback.cpp
+ * @brief Loopback load driver.
+ *
+ * This program measures the proxy on the loopback interface. It runs its own
+ * origin server, which answers every request with a body of a fixed size, and
+ * a number of concurrent clients, each of which sends requests for that body
+ * through the proxy over a persistent connection for a fixed time. It prints
+ * a single line with the number of clients, the requests answered per second,
+ * the data received per second and the mean latency. Given the process id of
+ * the proxy, it also prints the CPU time the proxy spent during the run, per
+ * GB relayed.
+ *
+ * The driver does not use Qt, so it does not depend on the proxy build. See
+ * run.sh for the scripted sweeps over the number of clients.
+ *
+ */
+
+// Library includes:
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+// Macros:
+
+/**
+ * @def LOOPBACK_READ_SIZE
+ * @brief Size (in bytes) of each read of the clients and the origin.
+ */
+
+#define LOOPBACK_READ_SIZE 65536
+
+/**
+ * @def LOOPBACK_DEFAULT_PROXY
+ * @brief Proxy port used when none is given (the proxy default port).
+ */
+
+#define LOOPBACK_DEFAULT_PROXY 8228
+
+// Type definitions:
+
+/**
+ * @struct loopback_config
+ * @brief Configuration of a run of the driver.
+ */
+
+typedef struct {
+  in_port_t proxy_port;   /**< Port of the proxy on the loopback address. */
+  in_port_t origin_port;  /**< Port of the origin server (0 for any). */
+  unsigned int clients;   /**< Number of concurrent clients. */
+  unsigned int seconds;   /**< Duration of the run. */
+  size_t body_size;       /**< Size (in bytes) of the answer bodies. */
+  bool direct;            /**< Clients connect to the origin, not the proxy. */
+  pid_t proxy_pid;        /**< Process id of the proxy (0 to skip its CPU
+                               time). */
+} loopback_config;
+
+/**
+ * @struct client_stats
+ * @brief Counters of one client.
+ */
+
+typedef struct {
+  unsigned long long requests;    /**< Answers received in full. */
+  unsigned long long bytes;       /**< Bytes received (headers included). */
+  unsigned long long latency_ns;  /**< Sum of the latencies of the answers. */
+  unsigned long long reconnects;  /**< Connections closed by the proxy. */
+  unsigned long long errors;      /**< Failed connections or answers. */
+} client_stats;
+
+// Functions:
+
+/**
+ * @fn static unsigned long long now_ns()
+ * @brief Function to read the monotonic clock.
+ * @return Returns the time, in nanoseconds.
+ */
+
+static unsigned long long now_ns() {
+
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return static_cast<unsigned long long> (now.tv_sec) * 1000000000ULL +
+         static_cast<unsigned long long> (now.tv_nsec);
+
+}
+
+/**
+ * @fn static double cpu_seconds(pid_t pid)
+ * @brief Function to read the CPU time used by a process.
+ * @param pid Process id.
+ * @return Returns the user and system time of the process (all its threads),
+ * in seconds, or -1 if it can not be read.
+ */
+
+static double cpu_seconds(pid_t pid) {
+
+  std::string path = "/proc/" + std::to_string(pid) + "/stat";
+  unsigned long user, system;
+  char line[1024], *fields;
+  FILE *stat;
+
+  if((stat = fopen(path.c_str(), "r")) == nullptr)
+    return -1;
+
+  fields = fgets(line, sizeof(line), stat);
+  fclose(stat);
+
+  // The fields after the command name (which may hold spaces), from the
+  // third on: utime and stime are the 14th and 15th.
+  if(fields == nullptr || (fields = strrchr(line, ')')) == nullptr ||
+     sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+            &user, &system) != 2)
+    return -1;
+
+  return static_cast<double> (user + system) / sysconf(_SC_CLK_TCK);
+
+}
+
+/**
+ * @fn static int connect_loopback(in_port_t port)
+ * @brief Function to open a connection to a loopback port.
+ * @param port Port to connect to.
+ * @return Returns the socket, or -1 if the connection failed.
+ */
+
+static int connect_loopback(in_port_t port) {
+
+  struct sockaddr_in addr;
+  int fd, one = 1;
+
+  if((fd = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+    return -1;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  if(connect(fd, reinterpret_cast<struct sockaddr*> (&addr), sizeof(addr)) == -1) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+
+}
+
+/**
+ * @fn static bool send_all(int fd, const char *data, size_t size)
+ * @brief Function to send the whole of a buffer.
+ * @param fd Socket to send through.
+ * @param data Data to be sent.
+ * @param size Size (in bytes) of the data.
+ * @return Returns false if the connection failed.
+ */
+
+static bool send_all(int fd, const char *data, size_t size) {
+
+  ssize_t sent;
+
+  while(size > 0) {
+    if((sent = send(fd, data, size, MSG_NOSIGNAL)) <= 0) {
+      if(sent == -1 && errno == EINTR)
+        continue;
+      return false;
+    }
+    data += sent;
+    size -= static_cast<size_t> (sent);
+  }
+
+  return true;
+
+}
+
+/**
+ * @fn static void serve_connection(int fd, const std::string *answer)
+ * @brief Function to answer the requests of one origin connection.
+ * @param fd Socket of the connection.
+ * @param answer Answer sent to every request.
+ *
+ * Requests are only read up to the end of their headers (the driver only
+ * sends GET requests). Pipelined requests are answered in order.
+ *
+ */
+
+static void serve_connection(int fd, const std::string *answer) {
+
+  std::string pending;
+  char buffer[LOOPBACK_READ_SIZE];
+  size_t end;
+  ssize_t received;
+
+  while((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+    pending.append(buffer, static_cast<size_t> (received));
+    while((end = pending.find("\r\n\r\n")) != std::string::npos) {
+      pending.erase(0, end + 4);
+      if(!send_all(fd, answer->data(), answer->size())) {
+        close(fd);
+        return;
+      }
+    }
+  }
+
+  close(fd);
+
+}
+
+/**
+ * @fn static int start_origin(in_port_t *port, const std::string *answer)
+ * @brief Function to start the origin server.
+ * @param port Address of the port to listen on (0 for any), which is set to
+ * the port used.
+ * @param answer Answer sent to every request.
+ * @return Returns 0 when the server is listening and -1 if an error occurs.
+ *
+ * Each connection is served by a thread of its own, detached.
+ *
+ */
+
+static int start_origin(in_port_t *port, const std::string *answer) {
+
+  struct sockaddr_in addr;
+  socklen_t size = sizeof(addr);
+  int fd, one = 1;
+
+  if((fd = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+    return -1;
+
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(*port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  if(bind(fd, reinterpret_cast<struct sockaddr*> (&addr), sizeof(addr)) == -1 ||
+     listen(fd, SOMAXCONN) == -1 ||
+     getsockname(fd, reinterpret_cast<struct sockaddr*> (&addr), &size) == -1) {
+    close(fd);
+    return -1;
+  }
+
+  *port = ntohs(addr.sin_port);
+
+  std::thread([fd, answer]() {
+    int client_fd, on = 1;
+    while((client_fd = accept(fd, nullptr, nullptr)) != -1) {
+      setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+      std::thread(serve_connection, client_fd, answer).detach();
+    }
+  }).detach();
+
+  return 0;
+
+}
+
+/**
+ * @fn static bool read_answer(int fd, std::string *pending, client_stats *stats)
+ * @brief Function to read one answer of the origin.
+ * @param fd Socket of the client connection.
+ * @param pending Data received and not used yet, kept between answers.
+ * @param stats Counters of the client.
+ * @return Returns false if the connection closed or failed before the whole
+ * answer arrived.
+ */
+
+static bool read_answer(int fd, std::string *pending, client_stats *stats) {
+
+  char buffer[LOOPBACK_READ_SIZE];
+  size_t header_end, length_at, total, left;
+  unsigned long long length;
+  ssize_t received;
+
+  // Read the headers, to learn the size of the body:
+  while((header_end = pending->find("\r\n\r\n")) == std::string::npos) {
+    if((received = recv(fd, buffer, sizeof(buffer), 0)) <= 0)
+      return false;
+    pending->append(buffer, static_cast<size_t> (received));
+    stats->bytes += static_cast<unsigned long long> (received);
+  }
+
+  if((length_at = pending->find("Content-Length: ")) == std::string::npos ||
+     length_at > header_end)
+    return false;
+
+  length = strtoull(pending->c_str() + length_at + 16, nullptr, 10);
+  total = header_end + 4 + static_cast<size_t> (length);
+
+  if(pending->size() >= total) {
+    pending->erase(0, total);
+    return true;
+  }
+
+  // The rest of the body is only counted, not kept:
+  left = total - pending->size();
+  pending->clear();
+
+  while(left > 0) {
+    if((received = recv(fd, buffer, sizeof(buffer), 0)) <= 0)
+      return false;
+    stats->bytes += static_cast<unsigned long long> (received);
+    if(static_cast<size_t> (received) <= left)
+      left -= static_cast<size_t> (received);
+    else {
+      pending->assign(buffer + left, static_cast<size_t> (received) - left);
+      left = 0;
+    }
+  }
+
+  return true;
+
+}
+
+/**
+ * @fn static void run_client(const loopback_config *config, in_port_t origin_port, unsigned long long deadline, client_stats *stats)
+ * @brief Function to send requests until the end of the run.
+ * @param config Configuration of the run.
+ * @param origin_port Port of the origin server.
+ * @param deadline Time (now_ns) the run ends.
+ * @param stats Counters of the client.
+ *
+ * A client keeps its connection while the proxy leaves it open, and opens a
+ * new one (counted as a reconnection) when the proxy closes it.
+ *
+ */
+
+static void run_client(const loopback_config *config, in_port_t origin_port,
+                       unsigned long long deadline, client_stats *stats) {
+
+  std::string authority = "127.0.0.1:" + std::to_string(origin_port);
+  std::string request = config->direct ?
+                        "GET / HTTP/1.1\r\nHost: " + authority + "\r\n\r\n" :
+                        "GET http://" + authority + "/ HTTP/1.1\r\nHost: " + authority + "\r\n\r\n";
+  std::string pending;
+  unsigned long long start;
+  int fd = -1;
+
+  while((start = now_ns()) < deadline) {
+
+    if(fd == -1 && (fd = connect_loopback(config->direct ? origin_port : config->proxy_port)) == -1) {
+      stats->errors++;
+      usleep(1000);
+      continue;
+    }
+
+    if(!send_all(fd, request.data(), request.size()) ||
+       !read_answer(fd, &pending, stats)) {
+      stats->reconnects++;
+      pending.clear();
+      close(fd);
+      fd = -1;
+      continue;
+    }
+
+    stats->requests++;
+    stats->latency_ns += now_ns() - start;
+
+  }
+
+  if(fd != -1)
+    close(fd);
+
+}
+
+/**
+ * @fn static void usage(const char *program)
+ * @brief Function to show how the driver is used.
+ * @param program Name of the program.
+ */
+
+static void usage(const char *program) {
+
+  fprintf(stderr,
+          "Usage: %s [--proxy PORT] [--origin PORT] [--clients N] [--seconds S]\n"
+          "          [--body BYTES] [--direct] [--pid PID]\n"
+          "\n"
+          "  --proxy PORT    Proxy port on 127.0.0.1 (default %d).\n"
+          "  --origin PORT   Origin server port (default: any free port).\n"
+          "  --clients N     Concurrent clients (default 1).\n"
+          "  --seconds S     Duration of the run (default 5).\n"
+          "  --body BYTES    Size of the answer bodies (default 1024).\n"
+          "  --direct        Connect to the origin, without the proxy.\n"
+          "  --pid PID       Proxy process, to report its CPU time per GB.\n",
+          program, LOOPBACK_DEFAULT_PROXY);
+
+}
+
+/**
+ * @fn int main(int argc, char *argv[])
+ * @brief Main function.
+ * @param argc Number of arguments.
+ * @param argv Program arguments.
+ * @return Returns 0 if the run completed, 1 otherwise.
+ */
+
+int main(int argc, char *argv[]) {
+
+  loopback_config config = {LOOPBACK_DEFAULT_PROXY, 0, 1, 5, 1024, false, 0};
+  std::vector<client_stats> stats;
+  std::vector<std::thread> clients;
+  client_stats total = {0, 0, 0, 0, 0};
+  std::string answer;
+  unsigned long long start, deadline, elapsed;
+  double cpu_start = -1, cpu_end = -1;
+  in_port_t origin_port;
+
+  for(int arg = 1; arg < argc; arg++) {
+    std::string option = argv[arg];
+    if(option == "--direct")
+      config.direct = true;
+    else if(arg + 1 < argc && option == "--proxy")
+      config.proxy_port = static_cast<in_port_t> (atoi(argv[++arg]));
+    else if(arg + 1 < argc && option == "--origin")
+      config.origin_port = static_cast<in_port_t> (atoi(argv[++arg]));
+    else if(arg + 1 < argc && option == "--clients")
+      config.clients = static_cast<unsigned int> (atoi(argv[++arg]));
+    else if(arg + 1 < argc && option == "--seconds")
+      config.seconds = static_cast<unsigned int> (atoi(argv[++arg]));
+    else if(arg + 1 < argc && option == "--body")
+      config.body_size = static_cast<size_t> (strtoull(argv[++arg], nullptr, 10));
+    else if(arg + 1 < argc && option == "--pid")
+      config.proxy_pid = static_cast<pid_t> (atoi(argv[++arg]));
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if(config.clients == 0 || config.seconds == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // Answers are never stored by the proxy cache, so every request reaches
+  // the origin:
+  answer = "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\n"
+           "Cache-Control: no-store\r\nContent-Length: " +
+           std::to_string(config.body_size) + "\r\n\r\n";
+  answer.append(config.body_size, 'x');
+
+  origin_port = config.origin_port;
+
+  if(start_origin(&origin_port, &answer) != 0) {
+    perror("Failed to start the origin server");
+    return 1;
+  }
+
+  stats.assign(config.clients, total);
+
+  if(config.proxy_pid > 0 && (cpu_start = cpu_seconds(config.proxy_pid)) < 0)
+    fprintf(stderr, "Failed to read the CPU time of process %d\n", config.proxy_pid);
+
+  start = now_ns();
+  deadline = start + static_cast<unsigned long long> (config.seconds) * 1000000000ULL;
+
+  for(unsigned int client = 0; client < config.clients; client++)
+    clients.emplace_back(run_client, &config, origin_port, deadline, &stats[client]);
+
+  for(std::thread &client : clients)
+    client.join();
+
+  elapsed = now_ns() - start;
+
+  if(cpu_start >= 0)
+    cpu_end = cpu_seconds(config.proxy_pid);
+
+  for(const client_stats &client : stats) {
+    total.requests += client.requests;
+    total.bytes += client.bytes;
+    total.latency_ns += client.latency_ns;
+    total.reconnects += client.reconnects;
+    total.errors += client.errors;
+  }
+
+  printf("clients=%u body=%zu requests=%llu req/s=%.0f MB/s=%.1f latency_ms=%.3f reconnects=%llu errors=%llu",
+         config.clients, config.body_size, total.requests,
+         total.requests * 1e9 / elapsed,
+         total.bytes * 1e3 / elapsed,
+         total.requests > 0 ? total.latency_ns / 1e6 / total.requests : 0.0,
+         total.reconnects, total.errors);
+
+  // CPU time of the proxy for each GB it relayed to the clients:
+  if(cpu_end >= 0 && total.bytes > 0)
+    printf(" proxy_cpu_s=%.2f cpu_s/GB=%.3f", cpu_end - cpu_start,
+           (cpu_end - cpu_start) * 1e9 / total.bytes);
+
+  printf("\n");
+
+  return total.requests > 0 ? 0 : 1;
+
+}
@@ -0,0 +1,19 @@
+#-------------------------------------------------
+#
+# Loopback load driver (see run.sh).
+#
+#-------------------------------------------------
+
+TARGET = loopback
+TEMPLATE = app
+
+CONFIG += console c++14 thread
+CONFIG -= qt app_bundle
+
+# File names:
+SOURCES += \
+        loopback.cpp
+
+DISTFILES += \
+        run.sh \
+        splice.sh
@@ -0,0 +1,58 @@
+#!/bin/bash
+# ProxyGate - Loopback load sweep.
+#
+# Starts ProxyGate on the loopback interface, with a rules file that lets
+# every exchange through the gate and without the HTTP cache, then runs the
+# loopback driver with an increasing number of concurrent clients. Each run
+# prints one line (see loopback.cpp), with the CPU time the proxy used per GB
+# relayed. The first line is the driver talking to its origin directly, as a
+# baseline.
+#
+# Usage: run.sh PROXYGATE [WORKERS]
+#
+# Environment:
+#   LOOPBACK         Driver binary (default: ./loopback).
+#   PORT             Proxy port (default: 8228).
+#   SECONDS_PER_RUN  Duration of each run (default: 5).
+#   BODY             Size of the answer bodies (default: 1024).
+#   CLIENTS          Numbers of clients (default: "1 2 4 8 16 32 64 128").
+#   PROXY_ARGS       Other proxy options (such as --pass-through).
+
+set -e
+
+if [ $# -lt 1 ]; then
+  echo "Usage: $0 PROXYGATE [WORKERS]" >&2
+  exit 1
+fi
+
+PROXYGATE=$1
+WORKERS=${2:-$(nproc)}
+LOOPBACK=${LOOPBACK:-./loopback}
+PORT=${PORT:-8228}
+SECONDS_PER_RUN=${SECONDS_PER_RUN:-5}
+BODY=${BODY:-1024}
+CLIENTS=${CLIENTS:-"1 2 4 8 16 32 64 128"}
+
+work=$(mktemp -d)
+echo "default pass" > "$work/rules"
+
+QT_QPA_PLATFORM=offscreen "$PROXYGATE" "$PORT" -w "$WORKERS" \
+  --rules "$work/rules" --cache-size 0 $PROXY_ARGS > "$work/proxy.log" 2>&1 &
+proxy=$!
+trap 'kill $proxy 2> /dev/null; rm -rf "$work"' EXIT
+
+# Wait for the workers to listen:
+for try in $(seq 50); do
+  if (exec 3<> /dev/tcp/127.0.0.1/"$PORT") 2> /dev/null; then
+    break
+  fi
+  sleep 0.1
+done
+
+echo "# ProxyGate $WORKERS workers${PROXY_ARGS:+ $PROXY_ARGS}, $BODY byte bodies, $SECONDS_PER_RUN s per run"
+"$LOOPBACK" --direct --clients 1 --seconds "$SECONDS_PER_RUN" --body "$BODY" | sed 's/^/direct /' || true
+
+for clients in $CLIENTS; do
+  "$LOOPBACK" --proxy "$PORT" --pid "$proxy" --clients "$clients" \
+    --seconds "$SECONDS_PER_RUN" --body "$BODY" || true
+done
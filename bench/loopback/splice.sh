@@ -0,0 +1,20 @@
+#!/bin/bash
+# ProxyGate - Pass-through CPU cost.
+#
+# Relays large answers through the proxy twice: first through the user space
+# ring buffers (the default mode, with the gate letting every exchange
+# through), then with --pass-through, where the bodies are spliced inside the
+# kernel. Compare the cpu_s/GB columns of both sweeps.
+#
+# Usage: splice.sh PROXYGATE [WORKERS]
+#
+# Environment: as run.sh, with BODY defaulting to 16 MB and CLIENTS to
+# "1 4 16".
+
+HERE=$(dirname "$0")
+
+export BODY=${BODY:-16777216}
+export CLIENTS=${CLIENTS:-"1 4 16"}
+
+PROXY_ARGS= "$HERE/run.sh" "$@"
+PROXY_ARGS=--pass-through "$HERE/run.sh" "$@"
@@ -0,0 +1,256 @@
+// ProxyGate - Legacy HTTP parser - Source code.
+
+/**
+ * @file legacy_parser.cpp
+ * @brief Legacy HTTP parser - Source code.
+ *
+ * The legacy parser is the parse path of HTTPParser before the hand-written
+ * scanners (commit 3a5fb0d), kept as it was apart from the logging (and the
+ * state variable of the line loop). This source file contains the class
+ * method implementations for this module.
+ *
+ */
+
+// Includes:
+#include "legacy_parser.h"
+
+/**
+ * @fn LegacyParser::LegacyParser()
+ * @brief Class constructor for the LegacyParser class.
+ */
+
+LegacyParser::LegacyParser() {
+    splitted.body = nullptr;
+    splitted.body_size = 0;
+}
+
+/**
+ * @fn LegacyHeaderBodyPair LegacyParser::splitRequest(char *request, size_t size)
+ * @brief Splits the header section from the body.
+ * @param request Raw message.
+ * @param size Size of the message.
+ * @return Returns the header section (as a QString) and the body.
+ */
+
+LegacyHeaderBodyPair LegacyParser::splitRequest(char *request, size_t size){
+    LegacyHeaderBodyPair ret;
+    unsigned int headerEnd;
+
+    ret.body = nullptr;
+    ret.body_size = 0;
+
+    for(headerEnd = 0 ; headerEnd + 3 < size ; headerEnd++ ){
+        if(request[headerEnd]   == '\r' &&
+           request[headerEnd+1] == '\n' &&
+           request[headerEnd+2] == '\r' &&
+           request[headerEnd+3] == '\n')
+        break;
+    }
+
+    ret.header = QString::fromUtf8(request, static_cast<int>(headerEnd));
+
+    if(size > headerEnd + 4){
+        ret.body = &(request[headerEnd+4]);
+        ret.body_size = size - headerEnd - 4;
+    }
+
+    return ret;
+
+}
+
+/**
+ * @fn bool LegacyParser::parseRequest(char *request, ssize_t size)
+ * @brief Parses a request or an answer.
+ * @param request Raw message.
+ * @param size Size of the message.
+ * @return Returns true if every line was parsed.
+ */
+
+bool LegacyParser::parseRequest(char *request, ssize_t size){
+    QList<QString> lines;
+    bool first = true;
+
+    // Clean up variables:
+    headers.clear();
+
+    // Split text part of body part
+    this->splitted = splitRequest(request, static_cast<size_t>(size));
+
+    // Split in \r\n
+    lines = splitted.header.split(QRegExp("\r\n"));
+
+    // Loop through lines
+    for (QString line : lines) {
+
+        // The command line is the first line to be read
+        if(first) {
+            if(!this->parseCL(line) && !this->parseAL(line))
+                return false;
+            first = false;
+        }
+
+        // The others are headers
+        else if(!this->parseHL(line))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @fn bool LegacyParser::parseCommandLine(QString line, QString *method, QString *url, QString *version)
+ * @brief Parses a command line.
+ * @param line Line to be parsed.
+ * @param method Address to store the method (or nullptr).
+ * @param url Address to store the URL (or nullptr).
+ * @param version Address to store the version (or nullptr).
+ * @return Returns true if the line is a command line.
+ */
+
+bool LegacyParser::parseCommandLine(QString line, QString *method, QString *url, QString *version){
+    int pos;
+
+    // Regular Expression for command line
+    QRegExp commandline("^(GET|HEAD|CONNECT|PUT|DELETE|POST|OPTIONS|TRACE|PATCH) ([:|\\/\\.\\\\-\\w_~/?\\#\\[\\]@!\\$\\^&'\\(\\)\\*\\+\\´,;=%{}]+) (HTTP\\/(?:\\d.\\d))$");
+
+    // Try to match
+    pos = commandline.indexIn(line);
+
+    // Should match exactly the first character
+    if(pos != 0) return false;
+
+    // Set return
+    if(method != nullptr)
+        *method = commandline.cap(1);
+
+    if(url != nullptr)
+        *url = commandline.cap(2);
+
+    if(version != nullptr)
+        *version = commandline.cap(3);
+
+    return true;
+}
+
+/**
+ * @fn bool LegacyParser::parseCL(QString line)
+ * @brief Parses the command line of the message.
+ * @param line Line to be parsed.
+ * @return Returns true if the line is a command line.
+ */
+
+bool LegacyParser::parseCL(QString line){
+    // Parse command line and set private variables
+    return parseCommandLine(line, &this->method, &this->url, &this->version);
+}
+
+/**
+ * @fn bool LegacyParser::parseAnswerLine(QString line, QString *version, QString *code, QString *description)
+ * @brief Parses an answer line.
+ * @param line Line to be parsed.
+ * @param version Address to store the version (or nullptr).
+ * @param code Address to store the status code.
+ * @param description Address to store the reason phrase.
+ * @return Returns true if the line is an answer line.
+ */
+
+bool LegacyParser::parseAnswerLine(QString line, QString *version, QString *code, QString *description){
+    int pos;
+
+    // Regular Expression for command line
+    // HTTP/1.1 403 Forbidden
+    QRegExp commandline("^(HTTP\\/(?:\\d.\\d)) (\\d{3}) (.*)$");
+
+    // Try to match
+    pos = commandline.indexIn(line);
+
+    // Should match exactly the first character
+    if(pos != 0) return false;
+
+    // Set variables
+    if(version != nullptr)
+        *version = commandline.cap(1);
+
+    if(version != nullptr)
+        *code = commandline.cap(2);
+
+    if(version != nullptr)
+        *description = commandline.cap(3);
+
+    return true;
+}
+
+/**
+ * @fn bool LegacyParser::parseAL(QString line)
+ * @brief Parses the answer line of the message.
+ * @param line Line to be parsed.
+ * @return Returns true if the line is an answer line.
+ */
+
+bool LegacyParser::parseAL(QString line){
+    // Parsers answer line and set private variables
+    return parseAnswerLine(line, &this->version, &this->code, &this->description);
+}
+
+/**
+ * @fn bool LegacyParser::parseHeaderLine(QString line, QString *name, QString *value)
+ * @brief Parses a header line.
+ * @param line Line to be parsed.
+ * @param name Address to store the header name (or nullptr).
+ * @param value Address to store the header value (or nullptr).
+ * @return Returns true if the line is a header line.
+ */
+
+bool LegacyParser::parseHeaderLine(QString line, QString *name, QString *value){
+    int pos;
+
+    // Regular Expression for Header Line
+    QRegExp headerline("^([A-Za-z-0-9]*): (.*)$");
+
+    // Try to match
+    pos = headerline.indexIn(line);
+    if(pos != 0) return false;
+
+    if(name != nullptr)
+        *name = headerline.cap(1);
+
+    if(value != nullptr)
+        *value = headerline.cap(2);
+
+    return true;
+}
+
+/**
+ * @fn bool LegacyParser::parseHL(QString line)
+ * @brief Parses a header line of the message.
+ * @param line Line to be parsed.
+ * @return Returns true if the line is a header line.
+ */
+
+bool LegacyParser::parseHL(QString line){
+    QString name, value;
+
+    // Parsers header line
+    if(!this->parseHeaderLine(line, &name, &value))
+        return false;
+
+    // Verify if hash already contains header name
+    if(this->headers.contains(name))
+        // Appends the value to QList
+        this->headers[name].append(value);
+    else
+        // Initialize a list with captured value
+        this->headers[name] = QList<QString>({value});
+
+    return true;
+}
+
+/**
+ * @fn LegacyHeaders LegacyParser::getHeaders()
+ * @brief Gets the parsed headers.
+ * @return Returns the values of each header name.
+ */
+
+LegacyHeaders LegacyParser::getHeaders(){
+    return this->headers;
+}
@@ -0,0 +1,95 @@
+// ProxyGate - Legacy HTTP parser - Header file.
+
+/**
+ * @file legacy_parser.h
+ * @brief Legacy HTTP parser - Header file.
+ *
+ * The legacy parser is the parse path of HTTPParser before the hand-written
+ * scanners (commit 3a5fb0d): the header section is copied into a QString,
+ * split into lines and every line is matched by a QRegExp built for the
+ * occasion. It is kept here, without its QObject and its logger, only to be
+ * measured against HTTPParserCore. This header file contains a header guard,
+ * library includes, type definitions and the class headers for this module.
+ *
+ */
+
+// Header guard:
+#ifndef LEGACY_PARSER_H
+#define LEGACY_PARSER_H
+
+// Library includes:
+#include <sys/types.h>
+
+// Qt includes:
+#include <QHash>
+#include <QList>
+#include <QRegExp>
+#include <QString>
+
+// Type definitions:
+
+/**
+ * @struct LegacyHeaderBodyPair
+ * @brief Header section and body of a message.
+ */
+
+typedef struct {
+    QString header; /**< Header string */
+    char *body; /**< Raw body data (inside the parsed buffer). */
+    size_t body_size; /**< Raw body data size. */
+} LegacyHeaderBodyPair;
+
+/**
+ * @typedef LegacyHeaders
+ * @brief Values of each header name.
+ */
+
+typedef QHash<QString,QList<QString>> LegacyHeaders;
+
+// Class headers:
+
+/**
+ * @class LegacyParser
+ * @brief HTTP parser matching lines with QRegExp (as before commit 3a5fb0d).
+ */
+
+class LegacyParser {
+
+    private:
+        // Private variables
+        QString method; /**< Stores HTTP method such as GET, POST, PUT, etc. */
+        QString url; /**< Stores HTTP url. */
+        QString version; /**< Stores HTTP version. */
+        QString code; /**< Stores response code. */
+        QString description; /**< Stores response description. */
+        LegacyHeaderBodyPair splitted; /**< Stores splitted pair: header,body. */
+        LegacyHeaders headers; /**< Hashmap with keys as header name and value a list of header values. */
+
+        // Private aux methods for parsing
+        LegacyHeaderBodyPair splitRequest(char *, size_t);
+        bool parseCL(QString);
+        bool parseHL(QString);
+        bool parseAL(QString);
+
+    public:
+        // Constructor
+        LegacyParser();
+
+        // Parser
+        bool parseRequest(char *, ssize_t);
+
+        // Getters
+        LegacyHeaders getHeaders();
+
+        // Parse a header line
+        bool parseHeaderLine(QString, QString *, QString *);
+
+        // Parse a command line
+        bool parseCommandLine(QString, QString *, QString *, QString *);
+
+        // Parse an answer line
+        bool parseAnswerLine(QString, QString *, QString *, QString *);
+
+};
+
+#endif // LEGACY_PARSER_H
@@ -0,0 +1,116 @@
+// ProxyGate - Parser benchmark.
+
+/**
+ * @file parser.cpp
+ * @brief Parser benchmark.
+ *
+ * This program parses a recorded corpus of request and answer headers
+ * (corpus.txt, one message per paragraph) with the legacy QRegExp parser and
+ * with HTTPParserCore, and prints the time each takes per message. Every
+ * message must be accepted by both parsers, so they do the same work.
+ *
+ */
+
+// Library includes:
+#include <stdio.h>
+
+// Qt includes:
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+
+// User includes:
+#include "bench/harness.h"
+#include "bench/parser/legacy_parser.h"
+#include "include/httpparser.h"
+
+// Functions:
+
+/**
+ * @fn static int load_corpus(const char *path, QList<QByteArray> *messages)
+ * @brief Function to read the corpus.
+ * @param path Path of the corpus file.
+ * @param messages Address to store the messages, with CRLF line endings.
+ * @return Returns 0 when the successfully executed and -1 if an error occurs.
+ */
+
+static int load_corpus(const char *path, QList<QByteArray> *messages) {
+
+  QFile file(path);
+  QList<QByteArray> paragraphs;
+
+  if(!file.open(QIODevice::ReadOnly))
+    return -1;
+
+  // The file keeps LF line endings, the messages are sent with CRLF:
+  paragraphs = file.readAll().split('\n');
+  messages->append(QByteArray());
+
+  for(int i = 0; i < paragraphs.size(); i++) {
+    if(!paragraphs[i].isEmpty())
+      messages->last() += paragraphs[i] + "\r\n";
+    else if(!messages->last().isEmpty())
+      messages->append(QByteArray());
+  }
+
+  if(messages->last().isEmpty())
+    messages->removeLast();
+
+  for(int i = 0; i < messages->size(); i++)
+    (*messages)[i] += "\r\n";
+
+  return messages->isEmpty() ? -1 : 0;
+
+}
+
+/**
+ * @fn int main(int argc, char *argv[])
+ * @brief Main function.
+ * @param argc Number of arguments.
+ * @param argv Program arguments (the path of the corpus, optional).
+ * @return Returns 0 if the benchmark ran, 1 otherwise.
+ */
+
+int main(int argc, char *argv[]) {
+
+  const char *path = argc > 1 ? argv[1] : PARSER_CORPUS;
+  QList<QByteArray> messages;
+  LegacyParser legacy;
+  HTTPParserCore core;
+  double legacy_ns, core_ns;
+
+  if(load_corpus(path, &messages) != 0) {
+    fprintf(stderr, "Failed to read the corpus %s\n", path);
+    return 1;
+  }
+
+  for(int i = 0; i < messages.size(); i++) {
+    if(!legacy.parseRequest(messages[i].data(), messages[i].size()) ||
+       !core.parseRequest(messages[i].data(), messages[i].size())) {
+      fprintf(stderr, "Message %d of the corpus is rejected by a parser\n", i + 1);
+      return 1;
+    }
+  }
+
+  legacy_ns = harness_round_ns([&]() {
+    size_t parsed = 0;
+    for(int i = 0; i < messages.size(); i++)
+      parsed += legacy.parseRequest(messages[i].data(), messages[i].size());
+    return parsed;
+  });
+
+  core_ns = harness_round_ns([&]() {
+    size_t parsed = 0;
+    for(int i = 0; i < messages.size(); i++)
+      parsed += core.parseRequest(messages[i].data(), messages[i].size());
+    return parsed;
+  });
+
+  printf("%d messages in %s\n", messages.size(), path);
+  harness_report("legacy (QRegExp)", legacy_ns, messages.size(), "message");
+  harness_report("HTTPParserCore", core_ns, messages.size(), "message");
+  printf("%-28s %10.1fx\n", "speedup", legacy_ns / core_ns);
+
+  return 0;
+
+}
@@ -0,0 +1,38 @@
+#-------------------------------------------------
+#
+# Parser benchmark: the legacy QRegExp parser against HTTPParserCore, over
+# the recorded headers of corpus.txt.
+#
+#-------------------------------------------------
+
+QT += core
+QT -= gui
+
+TARGET = parser
+TEMPLATE = app
+
+CONFIG += console c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+DEFINES += PARSER_CORPUS=\\\"$$PWD/corpus.txt\\\"
+
+# File names:
+SOURCES += \
+        parser.cpp \
+        legacy_parser.cpp \
+        ../../src/byte_scan.cpp \
+        ../../src/chunked_codec.cpp \
+        ../../src/header_table.cpp \
+        ../../src/httpparser.cpp \
+        ../../src/message_logger.cpp
+
+HEADERS += \
+        ../harness.h \
+        legacy_parser.h \
+        ../../include/httpparser.h \
+        ../../include/message_logger.h
+
+DISTFILES += \
+        corpus.txt
@@ -0,0 +1,219 @@
+// ProxyGate - TokenTable benchmark.
+
+/**
+ * @file token_table.cpp
+ * @brief TokenTable benchmark.
+ *
+ * This program classifies header names and request methods, as found in
+ * recorded traffic (with some names in another case and some that are not
+ * well known), with the perfect hashes of TokenTable and with the linear
+ * searches they replaced (a length check and a comparison per known token),
+ * and prints the time each takes per lookup.
+ *
+ */
+
+// Library includes:
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+// User includes:
+#include "bench/harness.h"
+#include "include/token_table.h"
+
+// Variables:
+
+/**
+ * @var header_names
+ * @brief Well-known header names, as in src/header_table.cpp.
+ */
+
+static constexpr const char *header_names[] = {
+  "", "Accept", "Accept-Charset", "Accept-Encoding", "Accept-Language",
+  "Accept-Ranges", "Age", "Allow", "Authorization", "Cache-Control",
+  "Connection", "Content-Disposition", "Content-Encoding", "Content-Language",
+  "Content-Length", "Content-Location", "Content-Range", "Content-Type",
+  "Cookie", "Date", "ETag", "Expect", "Expires", "Forwarded", "From", "Host",
+  "If-Match", "If-Modified-Since", "If-None-Match", "If-Range",
+  "If-Unmodified-Since", "Keep-Alive", "Last-Modified", "Link", "Location",
+  "Max-Forwards", "Origin", "Pragma", "Proxy-Authenticate",
+  "Proxy-Authorization", "Proxy-Connection", "Range", "Referer", "Retry-After",
+  "Server", "Set-Cookie", "Strict-Transport-Security", "TE", "Trailer",
+  "Transfer-Encoding", "Upgrade", "User-Agent", "Vary", "Via", "Warning",
+  "WWW-Authenticate", "X-Forwarded-For"
+};
+
+/**
+ * @var method_names
+ * @brief Request methods, as in src/httpparser.cpp.
+ */
+
+static constexpr const char *method_names[] = {
+  "", "CONNECT", "DELETE", "GET", "HEAD", "OPTIONS", "PATCH", "POST", "PUT",
+  "TRACE"
+};
+
+/**
+ * @var header_ids
+ * @brief Perfect hash of the header names (the table of HeaderTable).
+ */
+
+static constexpr TokenTable<57, 8, true> header_ids(header_names);
+
+static_assert(header_ids.perfect(), "The header names need a larger hash");
+
+/**
+ * @var method_ids
+ * @brief Perfect hash of the request methods (the table of HTTPParserCore).
+ */
+
+static constexpr TokenTable<10, 4, false> method_ids(method_names);
+
+static_assert(method_ids.perfect(), "The request methods need a larger hash");
+
+/**
+ * @var traffic_headers
+ * @brief Header names of recorded requests and answers.
+ */
+
+static const char *traffic_headers[] = {
+  "Host", "User-Agent", "Accept", "Accept-Language", "Accept-Encoding",
+  "Connection", "Upgrade-Insecure-Requests", "Referer", "Cookie",
+  "If-Modified-Since", "If-None-Match", "Cache-Control", "Date", "Server",
+  "Content-Type", "Content-Length", "Last-Modified", "ETag", "Accept-Ranges",
+  "Vary", "Age", "X-Cache", "Via", "X-Amz-Cf-Pop", "X-Amz-Cf-Id",
+  "Set-Cookie", "Expires", "P3P", "X-XSS-Protection", "X-Frame-Options",
+  "Strict-Transport-Security", "Location", "Transfer-Encoding", "Keep-Alive",
+  "content-type", "content-length", "cache-control", "x-request-id",
+  "access-control-allow-origin", "Proxy-Connection", "Authorization",
+  "Origin", "Range", "Content-Range", "Sec-Fetch-Mode", "Sec-Fetch-Site"
+};
+
+/**
+ * @var traffic_methods
+ * @brief Request methods of recorded requests.
+ */
+
+static const char *traffic_methods[] = {
+  "GET", "GET", "GET", "GET", "GET", "GET", "POST", "GET", "HEAD", "GET",
+  "CONNECT", "GET", "PUT", "GET", "DELETE", "OPTIONS", "GET", "PATCH"
+};
+
+// Functions:
+
+/**
+ * @fn static int linear_header(const char *name, int size)
+ * @brief Function to classify a header name as HeaderTable did before.
+ * @param name Header name.
+ * @param size Size of the name.
+ * @return Returns the index of the name, or 0 if it is not well known.
+ */
+
+static int linear_header(const char *name, int size) {
+
+  for(int id = 1; id < static_cast<int> (sizeof(header_names) / sizeof(header_names[0])); id++)
+    if(strlen(header_names[id]) == static_cast<size_t> (size) &&
+       strncasecmp(header_names[id], name, static_cast<size_t> (size)) == 0)
+      return id;
+
+  return 0;
+
+}
+
+/**
+ * @fn static int linear_method(const char *name, int size)
+ * @brief Function to classify a request method as HTTPParser did before.
+ * @param name Method.
+ * @param size Size of the method.
+ * @return Returns the index of the method, or 0 if it is not known.
+ */
+
+static int linear_method(const char *name, int size) {
+
+  for(int id = 1; id < static_cast<int> (sizeof(method_names) / sizeof(method_names[0])); id++)
+    if(strlen(method_names[id]) == static_cast<size_t> (size) &&
+       memcmp(method_names[id], name, static_cast<size_t> (size)) == 0)
+      return id;
+
+  return 0;
+
+}
+
+/**
+ * @fn template<typename Lookup> static double time_lookups(const char **names, int count, Lookup lookup)
+ * @brief Function to time the lookups of a list of tokens.
+ * @param names Tokens to be looked up.
+ * @param count Number of tokens.
+ * @param lookup Callable classifying a token (its first byte and size).
+ * @return Returns the time of a lookup, in nanoseconds.
+ */
+
+template<typename Lookup>
+static double time_lookups(const char **names, int count, Lookup lookup) {
+
+  int sizes[64];
+
+  for(int i = 0; i < count; i++)
+    sizes[i] = static_cast<int> (strlen(names[i]));
+
+  return harness_round_ns([&]() {
+    size_t found = 0;
+    for(int i = 0; i < count; i++)
+      found += static_cast<size_t> (lookup(names[i], sizes[i]) + 1);
+    return found;
+  }) / count;
+
+}
+
+/**
+ * @fn int main(int argc, char *argv[])
+ * @brief Main function.
+ * @param argc Number of arguments.
+ * @param argv Program arguments.
+ * @return Returns 0 if both searches agree, 1 otherwise.
+ */
+
+int main(int argc, char *argv[]) {
+
+  const int headers = sizeof(traffic_headers) / sizeof(traffic_headers[0]);
+  const int methods = sizeof(traffic_methods) / sizeof(traffic_methods[0]);
+  int size, linear;
+
+  static_cast<void> (argc);
+  static_cast<void> (argv);
+
+  // Unknown tokens are -1 for the tables and 0 for the linear searches:
+  for(int i = 0; i < headers; i++) {
+    size = static_cast<int> (strlen(traffic_headers[i]));
+    linear = linear_header(traffic_headers[i], size);
+    if(header_ids.find(traffic_headers[i], size) != (linear == 0 ? -1 : linear)) {
+      fprintf(stderr, "The searches disagree on %s\n", traffic_headers[i]);
+      return 1;
+    }
+  }
+
+  for(int i = 0; i < methods; i++) {
+    size = static_cast<int> (strlen(traffic_methods[i]));
+    linear = linear_method(traffic_methods[i], size);
+    if(method_ids.find(traffic_methods[i], size) != (linear == 0 ? -1 : linear)) {
+      fprintf(stderr, "The searches disagree on %s\n", traffic_methods[i]);
+      return 1;
+    }
+  }
+
+  harness_report("headers, linear search",
+                 time_lookups(traffic_headers, headers, linear_header), 1, "lookup");
+  harness_report("headers, TokenTable",
+                 time_lookups(traffic_headers, headers, [](const char *name, int size) {
+                   return header_ids.find(name, size);
+                 }), 1, "lookup");
+  harness_report("methods, linear search",
+                 time_lookups(traffic_methods, methods, linear_method), 1, "lookup");
+  harness_report("methods, TokenTable",
+                 time_lookups(traffic_methods, methods, [](const char *name, int size) {
+                   return method_ids.find(name, size);
+                 }), 1, "lookup");
+
+  return 0;
+
+}
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# TokenTable benchmark: the perfect hashes of the methods and header names
+# against the linear searches they replaced.
+#
+#-------------------------------------------------
+
+TARGET = token_table
+TEMPLATE = app
+
+CONFIG += console c++14
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ../..
+
+# File names:
+SOURCES += \
+        token_table.cpp
+
+HEADERS += \
+        ../harness.h \
+        ../../include/token_table.h
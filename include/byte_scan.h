@@ -0,0 +1,74 @@
+// Byte scan module - Header file.
+
+/**
+ * @file byte_scan.h
+ * @brief Byte scan module - Header file.
+ *
+ * The byte scan module contains the implementation of the kernels that look
+ * for delimiters in raw data (the end of the HTTP headers, the bytes ending a
+ * field or a line, the tags and quotes of a page) several bytes at a time.
+ * This header file contains a header guard, library includes, macro
+ * definitions and the class headers for this module.
+ *
+ */
+
+// Header guard:
+#ifndef BYTE_SCAN_H
+#define BYTE_SCAN_H
+
+// Library includes:
+#include <stddef.h>
+#include <sys/types.h>
+
+// Macros:
+
+/**
+ * @def BYTE_SCAN_AVX2
+ * @brief Defined when the AVX2 kernels are built (x86 processors, with GCC or
+ * Clang), whatever the compiler flags. They only run if the processor has
+ * AVX2, which is checked when the program starts.
+ */
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BYTE_SCAN_AVX2
+#endif
+
+// Class headers:
+
+/**
+ * @class ByteScan
+ * @brief Vectorized delimiter search.
+ *
+ * Each kernel compares 32 bytes per step with AVX2, if the processor has it,
+ * or 16 bytes with SSE2 (which every x86-64 processor has), and finishes the
+ * last bytes (or the whole search, on other processors) one byte at a time.
+ * All of them read only the bytes given.
+ *
+ */
+
+class ByteScan {
+
+  public:
+    // Methods:
+    static const char *find_any(const char*, size_t, char, char, char);
+    static ssize_t find_header_end(const char*, size_t);
+
+  private:
+#if defined(BYTE_SCAN_AVX2)
+    // Variables:
+    static const bool avx2; /**< Whether the processor has AVX2. */
+
+#endif
+    // Methods:
+#if defined(BYTE_SCAN_AVX2)
+    static bool cpu_has_avx2();
+    static const char *find_any_avx2(const char*, size_t, char, char, char);
+    static ssize_t find_header_end_avx2(const char*, size_t);
+#endif
+    static const char *find_any_bytes(const char*, const char*, char, char,
+                                      char);
+    static ssize_t find_header_end_bytes(const char*, size_t, size_t);
+
+};
+
+#endif // BYTE_SCAN_H
@@ -0,0 +1,111 @@
+// Chunked codec module - Header file.
+
+/**
+ * @file chunked_codec.h
+ * @brief Chunked codec module - Header file.
+ *
+ * The chunked codec module contains the implementation of the decoder that
+ * follows a body sent with the chunked transfer coding as it arrives (finding
+ * its end, its data and its trailer fields) and of the encoder that frames an
+ * edited body again. This header file contains a header guard, library
+ * includes, macro definitions, type definitions and the class headers for
+ * this module.
+ *
+ */
+
+// Header guard:
+#ifndef CHUNKED_CODEC_H
+#define CHUNKED_CODEC_H
+
+// Library includes:
+#include <stddef.h>
+#include <stdint.h>
+
+// Qt includes:
+#include <QByteArray>
+
+// Macros:
+
+/**
+ * @def CHUNK_SIZE_DIGITS
+ * @brief Maximum number of hexadecimal digits of a chunk size (larger sizes
+ * would not fit in 64 bits).
+ */
+
+#define CHUNK_SIZE_DIGITS 15
+
+// Type definitions:
+
+/**
+ * @enum ChunkStep
+ * @brief Part of a chunked body the decoder expects next.
+ */
+
+typedef enum {
+  CHUNK_SIZE,       /**< Hexadecimal digits of the chunk size. */
+  CHUNK_EXTENSION,  /**< Rest of the size line, after the digits. */
+  CHUNK_SIZE_LF,    /**< Line feed ending the size line. */
+  CHUNK_DATA,       /**< Data of the chunk. */
+  CHUNK_DATA_CR,    /**< Carriage return after the data. */
+  CHUNK_DATA_LF,    /**< Line feed after the data. */
+  CHUNK_TRAILER,    /**< Trailer fields, after the last chunk. */
+  CHUNK_TRAILER_LF, /**< Line feed of a line that may end the trailer. */
+  CHUNK_DONE,       /**< The whole body arrived. */
+  CHUNK_ERROR       /**< The framing is invalid. */
+} ChunkStep;
+
+/**
+ * @struct chunk_state
+ * @brief State of a chunked body decoded as it arrives.
+ *
+ * The state is kept by the owner of the body, between calls to
+ * ChunkedCodec::decode, so the framing is only looked at once however many
+ * pieces the body arrives in.
+ *
+ */
+
+typedef struct {
+  ChunkStep step;     /**< Part of the body expected next. */
+  uint64_t left;      /**< Size of the chunk being read, then the bytes of it
+                           still to come. */
+  int digits;         /**< Digits of the chunk size read so far. */
+  bool line_start;    /**< The trailer line has no bytes yet. */
+  uint64_t data_size; /**< Bytes of data decoded so far. */
+} chunk_state;
+
+// Class headers:
+
+/**
+ * @class ChunkedCodec
+ * @brief Chunked transfer coding.
+ *
+ * The decoder is a state machine fed with the bytes of the body (after the
+ * headers) as they arrive: it stops right after the last chunk and its
+ * trailer, so the end of the body is found without waiting for the
+ * connection to close. The data and the trailer fields are only copied if
+ * asked for, forwarding a body only needs its end. Size lines and trailer
+ * lines are searched with ByteScan, and the data of a chunk is skipped (or
+ * copied) at once.
+ *
+ * Lines may end with a bare line feed, as many senders do.
+ *
+ */
+
+class ChunkedCodec {
+
+  public:
+    // Methods:
+    static bool chunked(const QByteArray&);
+    static size_t decode(chunk_state*, const char*, size_t, QByteArray*,
+                         QByteArray*);
+    static QByteArray decoded(const char*, size_t, QByteArray*);
+    static QByteArray encode(const QByteArray&, const QByteArray&);
+    static void reset(chunk_state*);
+
+  private:
+    // Methods:
+    static int hex_digit(char);
+
+};
+
+#endif // CHUNKED_CODEC_H
@@ -0,0 +1,273 @@
+// Disk cache module - Header file.
+
+/**
+ * @file disk_cache.h
+ * @brief Disk cache module - Header file.
+ *
+ * The disk cache module contains the implementation of the persistent tier of
+ * the HTTP cache: answers are appended to segment files and found through an
+ * index kept in a memory-mapped hash table, so the cache survives restarts
+ * without being scanned again. This header file contains a header guard,
+ * library includes, macro definitions, type definitions and the class headers
+ * for this module.
+ *
+ */
+
+// Header guard:
+#ifndef DISK_CACHE_H
+#define DISK_CACHE_H
+
+// Library includes:
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Qt includes:
+#include <QByteArray>
+#include <QDir>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+// Macros:
+
+/**
+ * @def DISK_CACHE_SIZE
+ * @brief Default disk budget (in MB) of the cache.
+ */
+
+#define DISK_CACHE_SIZE 1024
+
+/**
+ * @def DISK_SEGMENT_SIZE
+ * @brief Largest size (in bytes) of a segment file.
+ */
+
+#define DISK_SEGMENT_SIZE 67108864
+
+/**
+ * @def DISK_SLOT_SHARE
+ * @brief Disk budget (in bytes) per slot of the index.
+ */
+
+#define DISK_SLOT_SHARE 8192
+
+/**
+ * @def DISK_QUEUE_SIZE
+ * @brief Largest size (in bytes) of the answers waiting to be written.
+ */
+
+#define DISK_QUEUE_SIZE 67108864
+
+/**
+ * @def DISK_MAGIC
+ * @brief Identifier of an index file ('PGDC').
+ */
+
+#define DISK_MAGIC 0x50474443
+
+/**
+ * @def DISK_VERSION
+ * @brief Version of the index and segment file formats.
+ */
+
+#define DISK_VERSION 1
+
+/**
+ * @def DISK_FREE
+ * @brief Hash of an index slot never used.
+ */
+
+#define DISK_FREE 0
+
+/**
+ * @def DISK_REMOVED
+ * @brief Hash of an index slot whose answer was removed.
+ */
+
+#define DISK_REMOVED 1
+
+// Type definitions:
+
+/**
+ * @struct disk_slot
+ * @brief Slot of the index, describing an answer kept in a segment.
+ *
+ * The slots are kept in the index file as they are in memory, so every field
+ * has a fixed size. The record of an answer in its segment is the key,
+ * followed by the status line and headers and then by the body.
+ *
+ */
+
+typedef struct {
+  quint64 hash;           /**< Hash of the key (DISK_FREE or DISK_REMOVED
+                               for an empty slot). */
+  quint32 segment;        /**< Number of the segment of the answer. */
+  quint32 key_size;       /**< Size (in bytes) of the key. */
+  quint64 offset;         /**< Offset of the record in the segment. */
+  quint32 head_size;      /**< Size (in bytes) of the status line and
+                               headers. */
+  quint32 body_size;      /**< Size (in bytes) of the body. */
+  qint64 response_time;   /**< Time (in seconds) the answer was received. */
+  qint64 initial_age;     /**< Age (in seconds) of the answer when it was
+                               received. */
+  qint64 lifetime;        /**< Freshness lifetime (in seconds). */
+  quint32 no_cache;       /**< Answer must be revalidated on every use. */
+  quint32 validated;      /**< Answer has an ETag or a Last-Modified date. */
+} disk_slot;
+
+/**
+ * @struct disk_header
+ * @brief Header of the index file, followed by the slots.
+ */
+
+typedef struct {
+  quint32 magic;          /**< DISK_MAGIC. */
+  quint32 version;        /**< DISK_VERSION. */
+  quint64 slot_count;     /**< Number of slots. */
+  quint64 used;           /**< Slots holding an answer. */
+  quint64 removed;        /**< Slots whose answer was removed. */
+  quint32 first_segment;  /**< Number of the oldest segment. */
+  quint32 last_segment;   /**< Number of the segment being appended to. */
+} disk_header;
+
+/**
+ * @struct disk_record
+ * @brief Answer waiting to be appended to a segment by the writer thread.
+ */
+
+typedef struct {
+  QByteArray name;  /**< Key of the answer (UTF-8). */
+  QByteArray head;  /**< Status line and headers of the answer. */
+  QByteArray body;  /**< Body of the answer. */
+  disk_slot slot;   /**< Slot of the answer, once its record is written. */
+  bool written;     /**< The record was written to its segment. */
+} disk_record;
+
+/**
+ * @struct disk_body
+ * @brief Body of a cached answer, to be sent straight from its segment.
+ */
+
+typedef struct {
+  int fd;         /**< File descriptor of the segment (or -1). */
+  off_t offset;   /**< Offset of the body in the segment. */
+  size_t size;    /**< Bytes of the body left to send. */
+} disk_body;
+
+// Class headers:
+
+class DiskWriter;
+
+/**
+ * @class DiskCache
+ * @brief Persistent tier of the HTTP cache.
+ *
+ * The DiskCache keeps answers in a directory: they are appended to segment
+ * files of up to DISK_SEGMENT_SIZE bytes, and the index (an open addressing
+ * hash table of disk_slot, keyed by URL) is a file mapped into memory. When
+ * the cache opens a directory it already used, the index is mapped as it
+ * is, so the answers are available at once however many there are.
+ *
+ * The disk budget is enforced a segment at a time: when it is exceeded (or
+ * the index is too full), the oldest segment is deleted along with the
+ * answers it holds. An answer stored again is appended again, so the stale
+ * copies are reclaimed with their segments.
+ *
+ * Answers are written by a thread of their own (see store()), so the workers
+ * never wait for the disk to keep one, and a record is synced to its segment
+ * before the index points to it.
+ *
+ * Bodies can be handed out as a file descriptor and an offset (see fetch()),
+ * so they are sent to the clients with sendfile. Every method is thread
+ * safe.
+ *
+ */
+
+class DiskCache {
+
+  public:
+    // Class methods:
+    DiskCache();
+    ~DiskCache();
+
+    // Methods:
+    bool enabled();
+    bool find(QString, disk_slot*);
+    int fetch(disk_slot*, QByteArray*, QByteArray*, disk_body*);
+    int open(QString, size_t);
+    void remove(QString);
+    void store(QString, disk_slot, QByteArray, QByteArray);
+    static int load(disk_body*, QByteArray*);
+
+  private:
+    // Variables:
+    int index_fd;           /**< File descriptor of the index file. */
+    size_t index_size;      /**< Size (in bytes) of the index file. */
+    size_t budget;          /**< Disk budget, in bytes. */
+    off_t write_offset;     /**< End of the segment being appended to. */
+    disk_header *header;    /**< Mapped index file (or nullptr). */
+    disk_slot *table;       /**< Slots of the mapped index. */
+    size_t queued;          /**< Bytes of the answers waiting to be
+                                 written. */
+    bool stopping;          /**< The writer thread must end once the queue
+                                 is empty. */
+    DiskWriter *writer;     /**< Thread writing the answers (or nullptr). */
+
+    // Classes and custom types:
+    QDir directory;                 /**< Directory of the cache files. */
+    QHash<quint32, int> segments;   /**< Open segment files, per number. */
+    QList<disk_record> queue;       /**< Answers waiting to be written. */
+    QMutex cache_mutex;             /**< Mutex to the cache. */
+    QMutex queue_mutex;             /**< Mutex to the queue. */
+    QWaitCondition queue_ready;     /**< Condition of answers to write (or
+                                         of the end of the writer). */
+
+    // Methods:
+    bool append(disk_record*);
+    bool matches(disk_slot*, QByteArray);
+    disk_slot *lookup(quint64, QByteArray);
+    int open_segment(quint32, bool);
+    int reset();
+    void drop_segment();
+    void publish(disk_record*);
+    void rehash();
+    void write_queue();
+    QString segment_name(quint32);
+    static quint64 hash(QByteArray);
+
+    friend class DiskWriter;
+
+};
+
+/**
+ * @class DiskWriter
+ * @brief Thread appending the answers kept by a DiskCache.
+ */
+
+class DiskWriter : public QThread {
+
+  public:
+    // Class methods:
+    DiskWriter(DiskCache*);
+
+  protected:
+    // Methods:
+    void run();
+
+  private:
+    // Variables:
+    DiskCache *cache;   /**< Cache whose queue is written. */
+
+};
+
+#endif // DISK_CACHE_H
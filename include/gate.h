@@ -0,0 +1,114 @@
+// Gate module - Header file.
+
+/**
+ * @file gate.h
+ * @brief Gate module - Header file.
+ *
+ * The gate module contains the implementation of the proxy gate shared by
+ * every Server worker, together with the queue of exchanges parked at it.
+ * This header file contains a header guard, library includes, type
+ * definitions and the class headers for this module.
+ *
+ */
+
+// Header guard:
+#ifndef GATE_H
+#define GATE_H
+
+// Qt includes:
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+// User includes:
+#include "include/reactor.h"
+
+// Type definitions:
+
+/**
+ * @struct gate_edit
+ * @brief Message of an exchange as the user left it at the Gate.
+ *
+ * The headers and the data are only filled in when the user edited them, so
+ * an exchange the user did not touch goes through as it was received.
+ *
+ */
+
+typedef struct {
+  QByteArray headers;     /**< Edited headers, in Latin-1 (with "\r\n" line
+                               endings). */
+  QByteArray data;        /**< Edited data. */
+  bool headers_edited;    /**< The user edited the headers. */
+  bool data_edited;       /**< The user edited the data. */
+} gate_edit;
+
+// Class headers:
+
+/**
+ * @class Gate
+ * @brief Proxy gate shared by the Server workers.
+ *
+ * The application shows a single exchange to the user at a time, but every
+ * Server worker has its own queue of exchanges waiting for the gate. The Gate
+ * class decides which worker owns the display: a worker must acquire the Gate
+ * before showing an exchange and releases it once the exchange went through.
+ *
+ * The MainWindow loads the user edits into the Gate and opens it. The worker
+ * holding the Gate then lets its exchange pass, taking the user edits with
+ * it.
+ *
+ * Every exchange waiting for the Gate is parked in it with a ticket, so the
+ * user can also let any of them through unchanged (not only the one on
+ * display). Workers attach an eventfd to the Gate and are woken through it
+ * whenever the Gate opens, is released or lets one of their exchanges
+ * through, so they never poll the Gate. Every method is thread safe.
+ *
+ */
+
+class Gate {
+
+  public:
+    // Class methods:
+    Gate();
+    ~Gate();
+
+    // Methods:
+    bool acquire(unsigned int);
+    bool let_through(quint64);
+    bool pass(unsigned int, gate_edit*, gate_edit*);
+    quint64 park(unsigned int);
+    QList<quint64> take_released(unsigned int);
+    void attach(unsigned int, int);
+    void detach(unsigned int);
+    void load_client_request(gate_edit);
+    void load_website_request(gate_edit);
+    void open();
+    void release(unsigned int);
+    void unpark(quint64);
+
+  private:
+    // Variables:
+    bool held;            /**< A worker is showing an exchange. */
+    bool opened;          /**< The user opened the gate. */
+    unsigned int holder;  /**< Worker showing an exchange. */
+    quint64 last_ticket;  /**< Last ticket given to a parked exchange. */
+
+    // Classes and custom types:
+    QMutex gate_mutex;            /**< Mutex to every Gate variable. */
+    QHash<quint64, unsigned int> parked;  /**< Worker of each parked
+                                               exchange, per ticket. */
+    QHash<unsigned int, QList<quint64> > released; /**< Tickets let through
+                                                        by the user, per
+                                                        worker. */
+    QHash<unsigned int, int> wake_fds;  /**< Eventfd of each worker. */
+    gate_edit client_edit;        /**< User edits of the client request. */
+    gate_edit website_edit;       /**< User edits of the website answer. */
+
+    // Methods:
+    void wake(unsigned int);
+
+};
+
+#endif // GATE_H
@@ -0,0 +1,199 @@
+// Header table module - Header file.
+
+/**
+ * @file header_table.h
+ * @brief Header table module - Header file.
+ *
+ * The header table module contains the implementation of the table holding
+ * the header fields of an HTTP message, in the order they were received and
+ * looked up regardless of the case of their names. This header file contains
+ * a header guard, library includes, macro definitions, type definitions and
+ * the class headers for this module.
+ *
+ */
+
+// Header guard:
+#ifndef HEADER_TABLE_H
+#define HEADER_TABLE_H
+
+// Library includes:
+#include <string.h>
+#include <strings.h>
+
+// Qt includes:
+#include <QByteArray>
+#include <QList>
+#include <QVarLengthArray>
+#include <QVector>
+
+// User includes:
+#include "include/token_table.h"
+
+// Macros:
+
+/**
+ * @def HEADER_TABLE_SIZE
+ * @brief Number of fields a table holds without allocating memory.
+ */
+
+#define HEADER_TABLE_SIZE 24
+
+/**
+ * @def HEADER_IDS
+ * @brief Number of header identifiers (HEADER_OTHER included).
+ */
+
+#define HEADER_IDS 57
+
+/**
+ * @def HEADER_HASH_BITS
+ * @brief Size (as a power of two) of the perfect hash of the well-known
+ * names.
+ */
+
+#define HEADER_HASH_BITS 8
+
+// Type definitions:
+
+/**
+ * @enum HeaderId
+ * @brief Identifier of a well-known header name.
+ *
+ * The identifiers follow the alphabetical order of the names, which are
+ * listed by HeaderTable::name().
+ *
+ */
+
+typedef enum {
+  HEADER_OTHER,                       /**< Any other name. */
+  HEADER_ACCEPT,                      /**< Accept. */
+  HEADER_ACCEPT_CHARSET,              /**< Accept-Charset. */
+  HEADER_ACCEPT_ENCODING,             /**< Accept-Encoding. */
+  HEADER_ACCEPT_LANGUAGE,             /**< Accept-Language. */
+  HEADER_ACCEPT_RANGES,               /**< Accept-Ranges. */
+  HEADER_AGE,                         /**< Age. */
+  HEADER_ALLOW,                       /**< Allow. */
+  HEADER_AUTHORIZATION,               /**< Authorization. */
+  HEADER_CACHE_CONTROL,               /**< Cache-Control. */
+  HEADER_CONNECTION,                  /**< Connection. */
+  HEADER_CONTENT_DISPOSITION,         /**< Content-Disposition. */
+  HEADER_CONTENT_ENCODING,            /**< Content-Encoding. */
+  HEADER_CONTENT_LANGUAGE,            /**< Content-Language. */
+  HEADER_CONTENT_LENGTH,              /**< Content-Length. */
+  HEADER_CONTENT_LOCATION,            /**< Content-Location. */
+  HEADER_CONTENT_RANGE,               /**< Content-Range. */
+  HEADER_CONTENT_TYPE,                /**< Content-Type. */
+  HEADER_COOKIE,                      /**< Cookie. */
+  HEADER_DATE,                        /**< Date. */
+  HEADER_ETAG,                        /**< ETag. */
+  HEADER_EXPECT,                      /**< Expect. */
+  HEADER_EXPIRES,                     /**< Expires. */
+  HEADER_FORWARDED,                   /**< Forwarded. */
+  HEADER_FROM,                        /**< From. */
+  HEADER_HOST,                        /**< Host. */
+  HEADER_IF_MATCH,                    /**< If-Match. */
+  HEADER_IF_MODIFIED_SINCE,           /**< If-Modified-Since. */
+  HEADER_IF_NONE_MATCH,               /**< If-None-Match. */
+  HEADER_IF_RANGE,                    /**< If-Range. */
+  HEADER_IF_UNMODIFIED_SINCE,         /**< If-Unmodified-Since. */
+  HEADER_KEEP_ALIVE,                  /**< Keep-Alive. */
+  HEADER_LAST_MODIFIED,               /**< Last-Modified. */
+  HEADER_LINK,                        /**< Link. */
+  HEADER_LOCATION,                    /**< Location. */
+  HEADER_MAX_FORWARDS,                /**< Max-Forwards. */
+  HEADER_ORIGIN,                      /**< Origin. */
+  HEADER_PRAGMA,                      /**< Pragma. */
+  HEADER_PROXY_AUTHENTICATE,          /**< Proxy-Authenticate. */
+  HEADER_PROXY_AUTHORIZATION,         /**< Proxy-Authorization. */
+  HEADER_PROXY_CONNECTION,            /**< Proxy-Connection. */
+  HEADER_RANGE,                       /**< Range. */
+  HEADER_REFERER,                     /**< Referer. */
+  HEADER_RETRY_AFTER,                 /**< Retry-After. */
+  HEADER_SERVER,                      /**< Server. */
+  HEADER_SET_COOKIE,                  /**< Set-Cookie. */
+  HEADER_STRICT_TRANSPORT_SECURITY,   /**< Strict-Transport-Security. */
+  HEADER_TE,                          /**< TE. */
+  HEADER_TRAILER,                     /**< Trailer. */
+  HEADER_TRANSFER_ENCODING,           /**< Transfer-Encoding. */
+  HEADER_UPGRADE,                     /**< Upgrade. */
+  HEADER_USER_AGENT,                  /**< User-Agent. */
+  HEADER_VARY,                        /**< Vary. */
+  HEADER_VIA,                         /**< Via. */
+  HEADER_WARNING,                     /**< Warning. */
+  HEADER_WWW_AUTHENTICATE,            /**< WWW-Authenticate. */
+  HEADER_X_FORWARDED_FOR              /**< X-Forwarded-For. */
+} HeaderId;
+
+/**
+ * @struct header_field
+ * @brief Header field of a message.
+ */
+
+typedef struct {
+  HeaderId id;        /**< Identifier of the name (HEADER_OTHER if it is not
+                           well-known). */
+  QByteArray name;    /**< Name, as received. */
+  QByteArray value;   /**< Value, without the whitespace around it. */
+} header_field;
+
+// Class headers:
+
+/**
+ * @class HeaderTable
+ * @brief Header fields of an HTTP message.
+ *
+ * The fields are kept in a flat array, in the order they were added, with
+ * room for HEADER_TABLE_SIZE of them before any memory is allocated. A name
+ * that appears more than once takes one field per value.
+ *
+ * Well-known names are given a HeaderId when the field is added (through a
+ * perfect hash built by the compiler, see TokenTable), so looking them up
+ * compares integers. Other names are compared ignoring their case, as
+ * HTTP names are case-insensitive. The name of a well-known header received
+ * in its usual spelling refers to the static text returned by name(), so it
+ * takes no memory of its own.
+ *
+ * Names and values are kept as the bytes received (HTTP headers are Latin-1
+ * at most), they are only turned into text when shown to the user.
+ *
+ */
+
+class HeaderTable {
+
+  public:
+    // Class methods:
+    HeaderTable();
+
+    // Methods:
+    bool contains(HeaderId) const;
+    bool contains(QByteArray) const;
+    const header_field &at(int) const;
+    int size() const;
+    QByteArray joined(HeaderId) const;
+    QByteArray joined(QByteArray) const;
+    QByteArray value(HeaderId) const;
+    QByteArray value(QByteArray) const;
+    QList<QByteArray> values(HeaderId) const;
+    QList<QByteArray> values(QByteArray) const;
+    void append(const char*, int, QByteArray);
+    void append(QByteArray, QByteArray);
+    void clear();
+    void set_value(HeaderId, QByteArray);
+    static HeaderId identify(const char*, int);
+    static HeaderId identify(QByteArray);
+    static const QByteArray &name(HeaderId);
+
+  private:
+    // Classes and custom types:
+    QVarLengthArray<header_field, HEADER_TABLE_SIZE> fields; /**< Fields, in
+                                                                  the order they
+                                                                  were added. */
+
+    // Methods:
+    int find(HeaderId, QByteArray, int) const;
+    QByteArray join(HeaderId, QByteArray) const;
+    static QVector<QByteArray> intern_names();
+
+};
+
+#endif // HEADER_TABLE_H
@@ -0,0 +1,261 @@
+// HTTP cache module - Header file.
+
+/**
+ * @file http_cache.h
+ * @brief HTTP cache module - Header file.
+ *
+ * The HTTP cache module contains the implementation of an in-memory cache of
+ * website answers shared by every Server worker, following the HTTP caching
+ * rules (RFC 9111) of a shared cache. This header file contains a header
+ * guard, library includes, macro definitions, type definitions and the class
+ * headers for this module.
+ *
+ */
+
+// Header guard:
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+
+// Library includes:
+#include <time.h>
+
+// Qt includes:
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+// User includes:
+#include "include/disk_cache.h"
+#include "include/httpparser.h"
+#include "include/reactor.h"
+
+// Macros:
+
+/**
+ * @def CACHE_SIZE
+ * @brief Default memory budget (in MB) of the cache.
+ */
+
+#define CACHE_SIZE 64
+
+/**
+ * @def CACHE_PROTECTED_SHARE
+ * @brief Share (in percent) of the budget kept by the protected segment.
+ */
+
+#define CACHE_PROTECTED_SHARE 80
+
+/**
+ * @def CACHE_OBJECT_SHARE
+ * @brief Largest answer cached, as a fraction (1/N) of the budget.
+ */
+
+#define CACHE_OBJECT_SHARE 8
+
+/**
+ * @def CACHE_HEURISTIC_SHARE
+ * @brief Share (in percent) of the time since the last modification an answer
+ * with no explicit expiration is considered fresh.
+ */
+
+#define CACHE_HEURISTIC_SHARE 10
+
+/**
+ * @def CACHE_HEURISTIC_MAX
+ * @brief Longest (in seconds) heuristic freshness lifetime.
+ */
+
+#define CACHE_HEURISTIC_MAX 86400
+
+// Type definitions:
+
+/**
+ * @enum CacheResult
+ * @brief Result of a cache lookup.
+ */
+
+typedef enum {
+  CACHE_MISS,   /**< No usable answer is cached. */
+  CACHE_HIT,    /**< A fresh answer is cached. */
+  CACHE_STALE   /**< A stale answer is cached and can be revalidated. */
+} CacheResult;
+
+/**
+ * @struct cache_entry
+ * @brief Answer kept in the cache.
+ *
+ * Entries are linked in the list of their segment, the most recently used
+ * first.
+ *
+ */
+
+typedef struct cache_entry {
+  QString key;              /**< URL of the answer. */
+  QByteArray head;          /**< Status line and headers (with the empty
+                                 line). */
+  QByteArray body;          /**< Body of the answer. */
+  QStringList vary;         /**< Request headers the answer varies on (lower
+                                 case). */
+  QStringList vary_values;  /**< Values of those headers in the request. */
+  QString etag;             /**< Entity tag of the answer (or empty). */
+  QString last_modified;    /**< Last-Modified date of the answer (or
+                                 empty). */
+  long long response_time;  /**< Time (in seconds) the answer was received. */
+  long long initial_age;    /**< Age (in seconds) of the answer when it was
+                                 received. */
+  long long lifetime;       /**< Freshness lifetime (in seconds). */
+  bool no_cache;            /**< Answer must be revalidated on every use. */
+  bool protect;             /**< Entry is in the protected segment. */
+  size_t size;              /**< Memory (in bytes) taken by the entry. */
+  struct cache_entry *prev; /**< Previous (more recent) entry. */
+  struct cache_entry *next; /**< Next (older) entry. */
+} cache_entry;
+
+/**
+ * @struct cache_waiter
+ * @brief Session waiting for the answer to an identical request in flight.
+ */
+
+typedef struct {
+  unsigned int worker;  /**< Worker of the session. */
+  void *waiter;         /**< Session (only used by its worker). */
+} cache_waiter;
+
+/**
+ * @struct cache_segment
+ * @brief Segment of the cache, a list of entries in recency order.
+ */
+
+typedef struct {
+  cache_entry *first;   /**< Most recently used entry. */
+  cache_entry *last;    /**< Least recently used entry. */
+  size_t used;          /**< Memory (in bytes) taken by the entries. */
+} cache_segment;
+
+/**
+ * @struct CacheStats
+ * @brief HTTP cache counters.
+ *
+ * The counters are updated under the cache mutex and can be read from any
+ * thread.
+ *
+ */
+
+typedef struct {
+  QAtomicInteger<quint64> hits;           /**< Answers served from the
+                                               cache. */
+  QAtomicInteger<quint64> disk_hits;      /**< Answers served from the
+                                               disk tier. */
+  QAtomicInteger<quint64> misses;         /**< Lookups sent to the
+                                               website. */
+  QAtomicInteger<quint64> revalidations;  /**< Stale answers the website
+                                               confirmed (304). */
+  QAtomicInteger<quint64> collapsed;      /**< Requests that waited for an
+                                               identical one in flight. */
+  QAtomicInteger<quint64> saved_bytes;    /**< Body bytes not fetched from
+                                               websites. */
+  QAtomicInteger<quint64> stored_bytes;   /**< Memory taken by the cached
+                                               answers. */
+} CacheStats;
+
+// Class headers:
+
+/**
+ * @class HTTPCache
+ * @brief In-memory cache of website answers shared by every thread.
+ *
+ * The HTTPCache keeps the answers to GET requests that a shared cache may
+ * store (RFC 9111): answers marked no-store or private, answers with cookies,
+ * answers varying on every header and answers to authorized requests (unless
+ * marked public) are not kept. Each answer is fresh for the lifetime given by
+ * its s-maxage, max-age or Expires headers or, failing that, for a share of
+ * the time since it was last modified. Answers varying on request headers
+ * (Vary) are kept per variant.
+ *
+ * Fresh answers are served without contacting the website. Stale answers
+ * with an ETag or a Last-Modified date are revalidated: the request is made
+ * conditional and a 304 answer refreshes the cached one.
+ *
+ * The memory taken by the cache is bounded by a budget, with a segmented LRU
+ * eviction: new answers enter a probationary segment and move to a protected
+ * segment when they are used again, so a burst of answers used only once can
+ * not flush the popular ones. Answers without Vary are also written through
+ * to an optional DiskCache (see open_disk()), which serves them after they
+ * leave memory and across restarts.
+ *
+ * Identical GET requests missing the cache at the same time are collapsed:
+ * the first one fetches the answer and the others wait for it to land (see
+ * join()), so a burst of requests for a URL reaches the website only once.
+ * Workers attach an eventfd to the cache and are woken through it when the
+ * answer their sessions wait for lands. Every method is thread safe.
+ *
+ */
+
+class HTTPCache {
+
+  public:
+    // Class methods:
+    HTTPCache(size_t);
+    ~HTTPCache();
+
+    // Methods:
+    bool enabled();
+    bool join(QString, unsigned int, void*);
+    int open_disk(QString, size_t);
+    CacheResult lookup(QString, const Headers*, QByteArray*, disk_body*, QString*,
+                       QString*);
+    CacheStats *get_stats();
+    QByteArray refresh(QString, const Headers*, QByteArray, QByteArray);
+    QList<void*> take_landed(unsigned int);
+    void attach(unsigned int, int);
+    void detach(unsigned int);
+    void invalidate(QString);
+    void land(QString);
+    void leave(QString, unsigned int, void*);
+    void store(QString, const Headers*, QByteArray);
+    static QString key(QString, QString);
+
+  private:
+    // Variables:
+    size_t budget;      /**< Memory budget, in bytes. */
+
+    // Classes and custom types:
+    QHash<QString, QList<cache_entry*>> entries;  /**< Cached variants, per
+                                                       URL. */
+    DiskCache disk;             /**< Persistent tier of the cache. */
+    QMutex cache_mutex;         /**< Mutex to the cache. */
+    cache_segment probation;    /**< Entries used once. */
+    cache_segment protection;   /**< Entries used more than once. */
+    CacheStats stats;           /**< Counters of the cache. */
+    QMutex flight_mutex;        /**< Mutex to the requests in flight. */
+    QHash<QString, QList<cache_waiter>> flights;  /**< Sessions waiting for
+                                                       each URL in flight. */
+    QHash<unsigned int, QList<void*>> landed;     /**< Sessions whose answer
+                                                       landed, per worker. */
+    QHash<unsigned int, int> wake_fds;  /**< Eventfd of each worker. */
+
+    // Methods:
+    CacheResult lookup_disk(QString, const Headers*, QHash<QString, QString>,
+                            QByteArray*, disk_body*, QString*, QString*);
+    cache_entry *find(QString, const Headers*);
+    void evict();
+    void link(cache_entry*, bool);
+    void remove(cache_entry*);
+    void touch(cache_entry*);
+    void unlink(cache_entry*);
+    void wake(unsigned int);
+    static bool fresh(QHash<QString, QString>, const Headers*, long long, long long,
+                      bool);
+    static bool vary_values(QStringList, const Headers*, QStringList*);
+    static long long parse_date(QString);
+    static QByteArray set_header(QByteArray, QString, QString);
+    static QHash<QString, QString> directives(const Headers*);
+    static Headers parse_head(QByteArray);
+
+};
+
+#endif // HTTP_CACHE_H
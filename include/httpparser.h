@@ -5,20 +5,27 @@
  * This module implements HTTP parser, it creates a data structure
  * containing a hashmap for each header, the method of request, response
  * code, url and description. This module offers access methods for
- * those fields and renders back the HTTP data as QByteArray
+ * those fields and renders back the HTTP data as QByteArray. Every field
+ * is kept as the bytes received, the parser never decodes text
  *
  */
 
 #ifndef HTTPPARSER_H
 #define HTTPPARSER_H
 
+#include <QByteArray>
 #include <QString>
 #include <QList>
 #include <iostream>
+#include <string.h>
 #include <QHash>
 #include <QObject>
 
+#include "include/byte_scan.h"
+#include "include/chunked_codec.h"
+#include "include/header_table.h"
 #include "include/message_logger.h"
+#include "include/token_table.h"
 
 /**
  * @macro HTTP_BUFFER_SIZE
@@ -26,6 +33,42 @@
  */
 #define HTTP_BUFFER_SIZE 1048576
 
+/**
+ * @macro HTTP_TOKEN
+ * @brief Character class of the bytes allowed in methods and header names
+ */
+#define HTTP_TOKEN 1
+
+/**
+ * @macro HTTP_TARGET
+ * @brief Character class of the bytes allowed in request URLs
+ */
+#define HTTP_TARGET 2
+
+/**
+ * @macro HTTP_DIGIT
+ * @brief Character class of the decimal digits
+ */
+#define HTTP_DIGIT 4
+
+/**
+ * @macro HTTP_FIELD
+ * @brief Character class of the bytes allowed in header values and reason phrases
+ */
+#define HTTP_FIELD 8
+
+/**
+ * @macro METHOD_IDS
+ * @brief Number of method identifiers (METHOD_NONE included)
+ */
+#define METHOD_IDS 10
+
+/**
+ * @macro METHOD_HASH_BITS
+ * @brief Size (as a power of two) of the perfect hash of the methods
+ */
+#define METHOD_HASH_BITS 4
+
 /**
  * @enum ParserState
  * @brief Enum that describes allowed states for Parser
@@ -35,107 +78,246 @@ typedef enum {
     HEADERLINE /**< Parse should parse a header line. */
 } ParserState;
 
+/**
+ * @enum HttpMethod
+ * @brief Enum that identifies the request methods, in alphabetical order
+ */
+typedef enum {
+    METHOD_NONE, /**< Not a request (or an unknown method). */
+    METHOD_CONNECT, /**< CONNECT. */
+    METHOD_DELETE, /**< DELETE. */
+    METHOD_GET, /**< GET. */
+    METHOD_HEAD, /**< HEAD. */
+    METHOD_OPTIONS, /**< OPTIONS. */
+    METHOD_PATCH, /**< PATCH. */
+    METHOD_POST, /**< POST. */
+    METHOD_PUT, /**< PUT. */
+    METHOD_TRACE /**< TRACE. */
+} HttpMethod;
+
+/**
+ * @enum ParserError
+ * @brief Enum that describes why the last parse failed
+ */
+typedef enum {
+    PARSER_OK, /**< The last parse succeeded. */
+    PARSER_BAD_START_LINE, /**< The first line is neither a command line nor an answer line. */
+    PARSER_BAD_HEADER_LINE, /**< A header line could not be parsed. */
+    PARSER_BAD_CONTENT_LENGTH, /**< The Content-Length header is not a size. */
+    PARSER_BAD_TRANSFER_ENCODING, /**< The request body is not framed by chunks. */
+    PARSER_BAD_CHUNK /**< The chunked framing of the body is invalid. */
+} ParserError;
+
+/**
+ * @enum ParseStatus
+ * @brief Enum that describes how much of a message fed to the Parser arrived
+ */
+typedef enum {
+    PARSE_ERROR, /**< The headers could not be parsed. */
+    PARSE_NEED_MORE, /**< The headers did not arrive yet. */
+    PARSE_HEADERS_COMPLETE, /**< The headers arrived, the body did not. */
+    PARSE_MESSAGE_COMPLETE /**< The whole message arrived. */
+} ParseStatus;
+
+/**
+ * @enum BodyFraming
+ * @brief Enum that describes how the end of a message body is found
+ */
+typedef enum {
+    FRAMING_NONE, /**< The message has no body. */
+    FRAMING_LENGTH, /**< The body size is given by Content-Length. */
+    FRAMING_CHUNKED, /**< The body is framed by chunks, up to the last one. */
+    FRAMING_CLOSE /**< The body ends when the connection is closed. */
+} BodyFraming;
+
 /**
  * @struct HeaderBodyPair
  * @brief Internal HTTP Parser struct that splits headers section from body section
+ *
+ * Neither section is copied: both point into the parsed buffer, so they are
+ * only valid as long as the buffer is.
  */
 typedef struct HeaderBodyPair {
-    QString header; /**< Header string */
-    char body[HTTP_BUFFER_SIZE+1]; /**< Raw body data. */
+    char *header; /**< Raw header data (inside the parsed buffer). */
+    int header_size; /**< Raw header data size. */
+    char *body; /**< Raw body data (inside the parsed buffer). */
     size_t body_size; /**< Raw body data size. */
 } HeaderBodyPair;
 
+/**
+ * @struct MessageState
+ * @brief State of a message parsed as it arrives, kept between calls to HTTPParser::feed
+ *
+ * The state belongs to the message, not to the parser, so a single parser
+ * can follow many messages arriving at the same time.
+ */
+typedef struct MessageState {
+    size_t scanned; /**< Bytes already searched for the end of the headers (or decoded, for a chunked body). */
+    ssize_t header_end; /**< Size of the header section (-1 until it arrives). */
+    BodyFraming framing; /**< How the end of the body is found. */
+    ssize_t length; /**< Size of the whole message (-1 if unknown). */
+    chunk_state chunks; /**< State of the chunked body (FRAMING_CHUNKED only). */
+    ParseStatus status; /**< Last status reported. */
+} MessageState;
+
 /**
  * @typedef Headers
- * @brief Hashmap that takes header name and gives a list of values
+ * @brief Header fields of a message, in the order they were received (see HeaderTable)
  */
-typedef QHash<QString,QList<QString>> Headers;
+typedef HeaderTable Headers;
 
 /**
- * @class HTTPParser
- * @brief HTTPParser class that implements parser for HTTP requests
+ * @struct TextSpan
+ * @brief Piece of a line found by the parser scanners, inside the parsed buffer
  */
-class HTTPParser : public QObject {
-    Q_OBJECT
+typedef struct TextSpan {
+    const char *data; /**< First byte of the piece. */
+    int size; /**< Piece size in bytes. */
+} TextSpan;
+
+/**
+ * @class HTTPParserCore
+ * @brief Plain HTTP parser, without a QObject or a logger
+ *
+ * The core holds the parse of one message and nothing else, so it costs a
+ * few pointers and empty byte arrays to construct and can be copied, moved
+ * or kept per connection. Failures are returned as codes: getError() tells
+ * why the last parse failed and errorMessage() describes it, for the owner
+ * to log.
+ */
+class HTTPParserCore {
 
     private:
         // Private variables
-        QString method; /**< Stores HTTP method such as GET, POST, PUT, etc. */
-        QString url; /**< Stores HTTP url. */
-        QString version; /**< Stores HTTP version. */
-        QString code; /**< Stores response code. */
-        QString description; /**< Stores response description. */
+        QByteArray method; /**< Stores HTTP method such as GET, POST, PUT, etc. */
+        HttpMethod methodId; /**< Identifier of the method (METHOD_NONE for answers). */
+        QByteArray url; /**< Stores HTTP url. */
+        QByteArray version; /**< Stores HTTP version. */
+        QByteArray code; /**< Stores response code. */
+        QByteArray description; /**< Stores response description. */
         HeaderBodyPair splitted; /**< Stores splitted pair: header,body. */
-        Headers headers; /**< Hashmap with keys as header name and value a list of header values. */
+        Headers headers; /**< Header fields, looked up regardless of the case of their names. */
 
         // Parser state
         ParserState state; /**< Current parser state. */
+        ParserError error; /**< Why the last parse failed (PARSER_OK if it did not). */
+        QByteArray errorText; /**< Line or value the last parse failed on. */
 
-        // Message logger
-        MessageLogger logger; /**< Parser logger. */
+        // Character class of every byte (HTTP_TOKEN, HTTP_TARGET, ...)
+        static const unsigned char charClass[256];
 
         // Private aux methods for parsing
         HeaderBodyPair splitRequest(char *, size_t);
-        bool parseCL(QString);
-        bool parseHL(QString);
-        bool parseAL(QString);
+        bool parseCL(const char *, const char *);
+        bool parseHL(const char *, const char *);
+        bool parseAL(const char *, const char *);
         bool parse(char *, ssize_t);
 
+        // Scanners, matching a line without allocating
+        static bool isClass(char, unsigned char);
+        static const char *findLineEnd(const char *, const char *);
+        static bool scanAnswerLine(const char *, const char *, TextSpan *, TextSpan *, TextSpan *);
+        static bool scanCommandLine(const char *, const char *, TextSpan *, TextSpan *, TextSpan *, HttpMethod *);
+        static bool scanHeader(const char *, const char *, bool);
+        static bool scanHeaderLine(const char *, const char *, TextSpan *, TextSpan *);
+        static const char *scanVersion(const char *, const char *);
+
+        // Renders the header lines
+        void appendHeaderFields(QByteArray *);
+
     public:
         // Constructor
-        HTTPParser();
-        ~HTTPParser();
+        HTTPParserCore();
 
         // Getters
-        QString getMethod();
-        QString getHost();
-        QString getURL();
-        QString getHTTPVersion();
-        QString getCode();
-        QString getDescription();
+        QByteArray getMethod();
+        HttpMethod getMethodId();
+        QByteArray getHost();
+        QByteArray getURL();
+        QByteArray getHTTPVersion();
+        QByteArray getCode();
+        QByteArray getDescription();
         char *getData();
         size_t getDataSize();
         int getHeadersSize();
-        Headers getHeaders();
+        const Headers &getHeaders();
+        QByteArray getDecodedData(QByteArray * = nullptr);
+        ParserError getError();
+        std::string errorMessage();
 
         // Parser
         bool parseRequest(char *, ssize_t);
 
-        // PrettyPrinter method
-        void prettyPrinter();
+        // Incremental parser, for messages arriving in pieces
+        ParseStatus feed(MessageState *, char *, size_t, bool, bool);
+        static void resetMessage(MessageState *);
+
+        // Finds where the headers section ends
+        ssize_t findHeaderEnd(char *, size_t);
 
-        // Converts parsed HTTP headers to QString
-        QString answerHeaderToQString();
-        QString headerFieldsToQString();
-        QString requestHeaderToQString();
+        // Converts parsed HTTP headers to QByteArray
+        QByteArray answerHeaderBuffer();
+        QByteArray headerFieldsBuffer();
+        QByteArray requestHeaderBuffer();
 
         // Converts parsed HTTP to QByteArray
         QByteArray requestBuffer();
         QByteArray answerBuffer();
 
         // Parse a header line
-        bool parseHeaderLine(QString, QString *, QString *);
+        bool parseHeaderLine(QByteArray, QByteArray *, QByteArray *);
 
         // Parse a command line
-        bool parseCommandLine(QString, QString *, QString *, QString *);
+        bool parseCommandLine(QByteArray, QByteArray *, QByteArray *, QByteArray *);
 
         // Parse an answer line
-        bool parseAnswerLine(QString, QString *, QString *, QString *);
+        bool parseAnswerLine(QByteArray, QByteArray *, QByteArray *, QByteArray *);
 
         // Verifies if a header line from REQUEST is valid
-        bool validRequestHeader(QString);
+        bool validRequestHeader(QByteArray);
 
         // Verifies if a header line from ANSWER is valid
-        bool validAnswerHeader(QString);
+        bool validAnswerHeader(QByteArray);
 
         // Updates content length based on body size
         void updateContentLength();
 
+        // Replaces a header value of a raw message, leaving the rest as it is
+        static QByteArray setHeaderValue(QByteArray, HeaderId, QByteArray);
+
         // Verifies if a header line from REQUEST is valid
-        inline bool validRequestHeaderLine(QString);
+        inline bool validRequestHeaderLine(QByteArray);
 
         // Verifies if a header line from ANSWER is valid
-        inline bool validAnswerHeaderLine(QString);
+        inline bool validAnswerHeaderLine(QByteArray);
+
+};
+
+/**
+ * @class HTTPParser
+ * @brief HTTPParser class that implements parser for HTTP requests
+ *
+ * Thin QObject adapter of HTTPParserCore, for the GUI: the parse errors are
+ * logged through the logMessage(QString) signal.
+ */
+class HTTPParser : public QObject, public HTTPParserCore {
+    Q_OBJECT
+
+    private:
+        // Message logger
+        MessageLogger logger; /**< Parser logger. */
+
+    public:
+        // Constructor
+        HTTPParser();
+        ~HTTPParser();
+
+        // Parser, logging its errors
+        bool parseRequest(char *, ssize_t);
+        ParseStatus feed(MessageState *, char *, size_t, bool, bool);
+
+        // PrettyPrinter method
+        void prettyPrinter();
 
     signals:
         void logMessage(QString);
@@ -16,14 +16,23 @@
 #define MAINWINDOW_H
 
 // Qt includes:
+#include <QCommandLineParser>
+#include <QList>
+#include <QListWidgetItem>
 #include <QMainWindow>
 #include <QObject>
+#include <QSharedPointer>
 #include <QThread>
 #include <QTextEdit>
+#include <QTimer>
 #include <QFileDialog>
 
 // User includes:
+#include "include/gate.h"
+#include "include/http_cache.h"
 #include "include/message_logger.h"
+#include "include/resolver.h"
+#include "include/rules.h"
 #include "include/server.h"
 #include "include/spider.h"
 #include "include/qhexedit/qhexedit.h"
@@ -33,6 +42,15 @@ namespace Ui {
   class MainWindow;
 }
 
+// Macros:
+
+/**
+ * @def STATS_INTERVAL
+ * @brief Interval (in ms) between updates of the worker counters display.
+ */
+
+#define STATS_INTERVAL 1000
+
 // Class headers:
 
 /**
@@ -41,7 +59,8 @@ namespace Ui {
  *
  * The MainWindow class represents the main window seem in the application. It
  * is responsible for updating displays, receiving user inputs and handling the
- * application's threads.
+ * application's threads. It starts one Server worker thread per configured
+ * worker and shows their counters in the status bar.
  *
  * When the application is closed, this class is deleted.
  *
@@ -61,12 +80,16 @@ class MainWindow : public QMainWindow {
 
   private slots:
     void on_button_gate_clicked();
+    void on_button_release_clicked();
     void on_spider_push_clicked();
     void on_dumper_push_clicked();
-    void setClientData(QString, QByteArray);
-    void setWebsiteData(QString, QByteArray);
+    void setClientData(QByteArray, QByteArray);
+    void setWebsiteData(QByteArray, QByteArray);
     void clearClientData();
     void clearWebsiteData();
+    void addParkedExchange(quint64, QString);
+    void removeParkedExchange(quint64);
+    void updateStats();
 
   signals:
     void start_spider(QString);           /**< Signals a Spider start call. */
@@ -76,8 +99,18 @@ class MainWindow : public QMainWindow {
     // Classes:
     Ui::MainWindow *ui;     /**< User interface. */
     MessageLogger logger;   /**< MessageLogger used by the MainWindow. */
-    QThread *server_t;      /**< Server thread. */
-    Server *server;         /**< Server class used in the server thread. */
+    QList<QThread*> server_threads; /**< Server worker threads. */
+    QList<Server*> servers; /**< Server classes used in the worker threads. */
+    QList<quint64> last_exchanges;  /**< Worker exchanges at the last counters
+                                         update. */
+    QSharedPointer<Gate> gate;      /**< Gate shared by the Server workers. */
+    QSharedPointer<DNSCache> dns_cache; /**< DNS cache shared by the Server
+                                             workers and the spider. */
+    QSharedPointer<RuleSet> rules;  /**< Interception rules shared by the
+                                         Server workers. */
+    QSharedPointer<HTTPCache> cache;  /**< HTTP cache shared by the Server
+                                           workers. */
+    QTimer *stats_timer;    /**< Timer to update the worker counters. */
     QHexEdit *text_client;  /**< Client data hexadecimal edit sub-window. */
     QHexEdit *text_website; /**< Website data hexadecimal edit sub-window. */
 
@@ -85,8 +118,9 @@ class MainWindow : public QMainWindow {
     SpiderDumper *spider;   /**< SpiderDumper class used in the tools thread. */
 
     // Methods:
-    in_port_t server_port();
-    void config_server_thread();
+    ServerConfig server_config();
+    gate_edit user_edit(QTextEdit*, QHexEdit*);
+    void config_server_thread(Server*, QThread*);
     void config_tools_thread();
 
 };
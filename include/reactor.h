@@ -0,0 +1,77 @@
+// Reactor module - Header file.
+
+/**
+ * @file reactor.h
+ * @brief Reactor module - Header file.
+ *
+ * The reactor module contains a small wrapper around the Linux epoll
+ * interface, used by the proxy server to wait for activity on many sockets at
+ * once, a monotonic clock used to measure timeouts and the wake up of a
+ * worker through its eventfd. This header file
+ * contains a header guard, library includes, macro definitions, the function
+ * headers and the class headers for this module.
+ *
+ */
+
+// Header guard:
+#ifndef REACTOR_H
+#define REACTOR_H
+
+// Library includes:
+#include <errno.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+// Macros:
+
+/**
+ * @def REACTOR_MAX_EVENTS
+ * @brief Maximum number of events handled in a single reactor wait call.
+ */
+
+#define REACTOR_MAX_EVENTS 256
+
+// Function headers:
+long long monotonic_ms();
+void wake_eventfd(int);
+
+// Class headers:
+
+/**
+ * @class Reactor
+ * @brief Event demultiplexer based on epoll.
+ *
+ * The Reactor class keeps an epoll instance and offers methods to arm file
+ * descriptors and to wait for them to become ready. Every file descriptor is
+ * armed in one-shot mode: once an event is reported for it, the descriptor is
+ * disabled until it is armed again. This allows the proxy server to wait on
+ * exactly one socket per connection at a time, matching the sequential nature
+ * of its finite state machine.
+ *
+ * Each armed file descriptor carries an opaque pointer, which is returned
+ * together with the events reported for it.
+ *
+ */
+
+class Reactor {
+
+  public:
+    // Class methods:
+    Reactor();
+    ~Reactor();
+
+    // Methods:
+    int init();
+    int arm(int, unsigned int, void*);
+    int remove(int);
+    int wait(struct epoll_event*, int, int);
+
+  private:
+    // Variables:
+    int epoll_fd;   /**< File descriptor of the epoll instance. */
+
+};
+
+#endif // REACTOR_H
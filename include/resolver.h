@@ -0,0 +1,272 @@
+// Resolver module - Header file.
+
+/**
+ * @file resolver.h
+ * @brief Resolver module - Header file.
+ *
+ * The resolver module contains the implementation of an asynchronous DNS
+ * resolver with a cache shared by every thread of the application. It replaces
+ * the blocking gethostbyname calls made by the proxy server and by the spider.
+ * Both IPv4 (A) and IPv6 (AAAA) addresses are resolved. This header file
+ * contains a header guard, library includes, macro definitions, type
+ * definitions and the class headers for this module.
+ *
+ */
+
+// Header guard:
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+// Library includes:
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <random>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Qt includes:
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+// User includes:
+#include "include/reactor.h"
+
+// Macros:
+
+/**
+ * @def RESOLVER_PENDING
+ * @brief Return code of a resolution that is waiting for the DNS server.
+ */
+
+#define RESOLVER_PENDING 1
+
+/**
+ * @def RESOLVER_PORT
+ * @brief Default port of the DNS server.
+ */
+
+#define RESOLVER_PORT 53
+
+/**
+ * @def RESOLVER_CONF_FILE
+ * @brief File where the default DNS server is looked up.
+ */
+
+#define RESOLVER_CONF_FILE "/etc/resolv.conf"
+
+/**
+ * @def RESOLVER_HOSTS_FILE
+ * @brief Default file with static host addresses.
+ */
+
+#define RESOLVER_HOSTS_FILE "/etc/hosts"
+
+/**
+ * @def DNS_TYPE_A
+ * @brief DNS record type of an IPv4 address.
+ */
+
+#define DNS_TYPE_A 1
+
+/**
+ * @def DNS_TYPE_AAAA
+ * @brief DNS record type of an IPv6 address.
+ */
+
+#define DNS_TYPE_AAAA 28
+
+/**
+ * @def RESOLVER_TIMEOUT
+ * @brief Time (in ms) the resolver waits for an answer before asking again.
+ */
+
+#define RESOLVER_TIMEOUT 1000
+
+/**
+ * @def RESOLVER_ATTEMPTS
+ * @brief Number of times a query is sent before the resolution fails.
+ */
+
+#define RESOLVER_ATTEMPTS 3
+
+/**
+ * @def RESOLVER_MIN_TTL
+ * @brief Minimum time (in seconds) an answer is cached.
+ *
+ * Answers with a smaller TTL (even 0) are still cached for this long, so the
+ * lookups waiting for them can read them from the cache.
+ */
+
+#define RESOLVER_MIN_TTL 1
+
+/**
+ * @def RESOLVER_MAX_TTL
+ * @brief Maximum time (in seconds) an answer is cached.
+ */
+
+#define RESOLVER_MAX_TTL 86400
+
+/**
+ * @def RESOLVER_NEGATIVE_TTL
+ * @brief Time (in seconds) a missing host is cached when the DNS server does
+ * not say for how long.
+ */
+
+#define RESOLVER_NEGATIVE_TTL 60
+
+/**
+ * @def RESOLVER_FAILURE_TTL
+ * @brief Time (in seconds) a failed resolution (timeout or server error) is
+ * cached.
+ */
+
+#define RESOLVER_FAILURE_TTL 5
+
+/**
+ * @def RESOLVER_CACHE_SIZE
+ * @brief Maximum number of entries (one per host and record type) kept in the
+ * cache.
+ */
+
+#define RESOLVER_CACHE_SIZE 4096
+
+/**
+ * @def RESOLVER_MESSAGE_SIZE
+ * @brief Maximum size of a DNS message sent over UDP.
+ */
+
+#define RESOLVER_MESSAGE_SIZE 512
+
+// Type definitions:
+
+/**
+ * @struct dns_entry
+ * @brief Result of a host resolution for one record type, as kept in the
+ * cache.
+ *
+ * A host that could not be resolved is cached as well (negative entry, with no
+ * addresses), so it is not looked up again on every request.
+ *
+ */
+
+typedef struct {
+  QList<struct sockaddr_storage> addrs; /**< Addresses of the host (port 0). */
+  long long expires;    /**< Time (monotonic_ms) the entry expires, or -1 if
+                             it never expires. */
+} dns_entry;
+
+/**
+ * @struct dns_query
+ * @brief DNS query waiting for an answer.
+ */
+
+typedef struct {
+  QString host;           /**< Name of the host asked for. */
+  quint16 type;           /**< Record type asked for (A or AAAA). */
+  quint16 id;             /**< Identifier of the last query sent. */
+  int attempts;           /**< Number of times the query was sent. */
+  long long sent;         /**< Time (monotonic_ms) the last query was sent. */
+  QList<void*> waiters;   /**< Lookups waiting for the answer. */
+} dns_query;
+
+// Class headers:
+
+/**
+ * @class DNSCache
+ * @brief Cache of resolved hosts shared by every thread.
+ *
+ * The DNSCache keeps the results of the host resolutions until their TTL
+ * expires, together with the static host addresses loaded from a hosts file
+ * (which never expire) and the address of the DNS server. Every method is
+ * thread safe.
+ *
+ */
+
+class DNSCache {
+
+  public:
+    // Class methods:
+    DNSCache();
+    ~DNSCache();
+
+    // Methods:
+    bool lookup(QString, quint16, dns_entry*);
+    int load_hosts(QString);
+    int set_server(QString);
+    struct sockaddr_in server();
+    void store(QString, quint16, dns_entry);
+    static QString key(QString, quint16);
+
+  private:
+    // Classes and custom types:
+    QHash<QString, dns_entry> entries;  /**< Cached entries, per host and
+                                             record type. */
+    QMutex cache_mutex;                 /**< Mutex to the cache. */
+    struct sockaddr_in server_addr;     /**< Address of the DNS server. */
+
+};
+
+/**
+ * @class Resolver
+ * @brief Asynchronous DNS resolver.
+ *
+ * The Resolver looks hosts up in the shared DNSCache and, when they are
+ * missing, asks the DNS server for their IPv4 and IPv6 addresses over a
+ * non-blocking UDP socket. Lookups of a host already being asked for wait for
+ * the same queries.
+ *
+ * A lookup that has to wait returns RESOLVER_PENDING and is identified by an
+ * opaque pointer (the waiter). The owner of the Resolver watches its socket,
+ * calls process() when it becomes readable and expire() from time to time;
+ * both methods report the waiters whose lookups finished, which should then
+ * look the host up again.
+ *
+ * The Resolver is not thread safe: each thread owns its own Resolver.
+ *
+ */
+
+class Resolver {
+
+  public:
+    // Class methods:
+    Resolver(QSharedPointer<DNSCache>);
+    ~Resolver();
+
+    // Methods:
+    int get_fd();
+    int init();
+    int resolve(QString, QList<struct sockaddr_storage>*, void*);
+    int resolve_wait(QString, QList<struct sockaddr_storage>*);
+    void cancel(void*);
+    void expire(QList<void*>*);
+    void process(QList<void*>*);
+
+  private:
+    // Variables:
+    int fd;   /**< File descriptor of the UDP socket. */
+
+    // Classes and custom types:
+    QSharedPointer<DNSCache> cache;     /**< Cache shared by the threads. */
+    QHash<QString, dns_query> queries;  /**< Queries waiting, per host and
+                                             record type. */
+    std::mt19937 random;                /**< Source of query identifiers. */
+
+    // Methods:
+    int send_query(dns_query*);
+    int parse_answer(unsigned char*, size_t, quint16*, QString*, quint16*,
+                     dns_entry*);
+    int read_name(unsigned char*, size_t, size_t*, QString*);
+
+};
+
+#endif // RESOLVER_H
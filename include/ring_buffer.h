@@ -0,0 +1,79 @@
+// Ring buffer module - Header file.
+
+/**
+ * @file ring_buffer.h
+ * @brief Ring buffer module - Header file.
+ *
+ * The ring buffer module contains the implementation of a fixed size ring
+ * buffer, used by the proxy server to relay data between two sockets with a
+ * bounded amount of memory, either in user space or inside the kernel (with a
+ * pipe and splice). This header file contains a header guard, library
+ * includes, macro definitions and the class headers for this module.
+ *
+ */
+
+// Header guard:
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+// Library includes:
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Macros:
+
+/**
+ * @def RING_BUFFER_SIZE
+ * @brief Default capacity (in bytes) of a ring buffer.
+ */
+
+#define RING_BUFFER_SIZE 262144
+
+// Class headers:
+
+/**
+ * @class RingBuffer
+ * @brief Fixed size ring buffer between two sockets.
+ *
+ * The RingBuffer class keeps a fixed amount of memory, filled with data read
+ * from one socket and drained by sending the data to another socket. Data
+ * wraps around the end of the memory, so each fill or drain takes at most two
+ * pieces of it, handled with a single system call.
+ *
+ * A RingBuffer can also be kept inside the kernel, as a pipe. In this mode,
+ * data is moved between the sockets and the pipe with splice, so it is never
+ * copied to user space. If the pipe can not be created, the RingBuffer falls
+ * back to user space memory.
+ *
+ */
+
+class RingBuffer {
+
+  public:
+    // Class methods:
+    RingBuffer(size_t, bool);
+    ~RingBuffer();
+
+    // Methods:
+    bool empty();
+    bool full();
+    bool in_kernel();
+    int recent(size_t, struct iovec*);
+    size_t size();
+    ssize_t drain(int);
+    ssize_t fill(int, size_t);
+
+  private:
+    // Variables:
+    char *data;         /**< Memory of the ring buffer (user space only). */
+    int pipe_fd[2];     /**< Pipe of the ring buffer (kernel only). */
+    size_t capacity;    /**< Size of the memory (or pipe), in bytes. */
+    size_t head;        /**< Position of the oldest byte stored. */
+    size_t used;        /**< Number of bytes stored. */
+
+};
+
+#endif // RING_BUFFER_H
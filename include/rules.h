@@ -0,0 +1,181 @@
+// Rules module - Header file.
+
+/**
+ * @file rules.h
+ * @brief Rules module - Header file.
+ *
+ * The rules module contains the implementation of the interception rules,
+ * which decide which exchanges stop at the gate and which ones are passed
+ * through without being shown to the user. The rules are read from a file and
+ * compiled into a matcher shared by every Server worker. This header file
+ * contains a header guard, library includes, macro definitions, type
+ * definitions and the class headers for this module.
+ *
+ */
+
+// Header guard:
+#ifndef RULES_H
+#define RULES_H
+
+// Library includes:
+#include <algorithm>
+
+// Qt includes:
+#include <QAtomicInteger>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QVarLengthArray>
+#include <QVector>
+
+// User includes:
+#include "include/httpparser.h"
+
+// Macros:
+
+/**
+ * @def RULES_CANDIDATES
+ * @brief Number of candidate rules an exchange is matched against without
+ * allocating memory.
+ */
+
+#define RULES_CANDIDATES 32
+
+// Type definitions:
+
+/**
+ * @enum RuleStage
+ * @brief Point of the exchange where the rules are matched.
+ */
+
+typedef enum {
+  RULE_REQUEST, /**< The client request was read. */
+  RULE_ANSWER   /**< The website answer was read. */
+} RuleStage;
+
+/**
+ * @struct rule_request
+ * @brief Facts of a client request the rules look at.
+ *
+ * These facts are kept by the session until the answer arrives, so the rules
+ * of the answer stage can look at the request as well.
+ *
+ */
+
+typedef struct {
+  QString host;     /**< Host of the request (lower case, without port). */
+  QString method;   /**< Method of the request. */
+  QString path;     /**< Path of the request (without the query). */
+} rule_request;
+
+/**
+ * @struct rule
+ * @brief Compiled interception rule.
+ */
+
+typedef struct {
+  bool intercept;       /**< Action of the rule: intercept or pass. */
+  bool request;         /**< Rule applies to client requests. */
+  bool answer;          /**< Rule applies to website answers. */
+  QStringList methods;  /**< Methods matched (empty for any). */
+  QString path;         /**< Path prefix or glob (empty for any). */
+  bool path_glob;       /**< Path is a glob, not a prefix. */
+  QStringList headers;  /**< Headers the message must have. */
+  QStringList types;    /**< Content types matched (lower case, a trailing
+                             '/' matches any subtype). */
+  unsigned int sample;  /**< Rule applies to 1 in sample exchanges. */
+  QAtomicInteger<quint32> *seen; /**< Exchanges the rule matched. */
+} rule;
+
+/**
+ * @struct rule_node
+ * @brief Node of the host trie.
+ *
+ * The trie is keyed by the characters of the host names read backwards, so
+ * 'www.example.com' and '*.example.com' share the path of 'moc.elpmaxe'.
+ *
+ */
+
+typedef struct {
+  QString keys;           /**< Characters leading to the children. */
+  QVector<int> children;  /**< Children, in the order of the keys. */
+  QVector<int> exact;     /**< Rules matching the host ending here. */
+  QVector<int> below;     /**< Rules matching any host below this one (the
+                               node of a '.'). */
+} rule_node;
+
+// Class headers:
+
+/**
+ * @class RuleSet
+ * @brief Compiled interception rules shared by every thread.
+ *
+ * The RuleSet reads the interception rules from a file, one rule per line:
+ *
+ *     # Comment
+ *     intercept host=*.example.com method=POST,PUT path=/api/
+ *     pass path=*.js
+ *     intercept stage=answer type=text/html sample=10
+ *     default pass
+ *
+ * Each rule is an action ('intercept' or 'pass') followed by the conditions
+ * an exchange must meet, all of them:
+ *
+ * - host: host names, or '*.domain' for any host below the domain;
+ * - method: request methods;
+ * - path: path prefix, or a glob ('*' and '?') if it has wildcards other than
+ *   a trailing '*';
+ * - header: a header the message must have (can be repeated);
+ * - type: content types of the message, where a '*' subtype matches any;
+ * - stage: 'request' or 'answer' (default: both);
+ * - sample: the rule applies to 1 in N of the exchanges it matches, the others
+ *   are matched against the next rules.
+ *
+ * Lists are separated by commas. The host, method and path conditions look at
+ * the client request, while header and type look at the message being gated
+ * (the request or the answer). The first rule that applies decides; exchanges
+ * no rule applies to are passed through, unless a 'default intercept' line is
+ * given. With no rules loaded, every exchange is intercepted.
+ *
+ * The host conditions are compiled into a trie, so only the rules that may
+ * match the host are checked. Rules are loaded before the workers start, and
+ * intercept() can then be called from any thread.
+ *
+ */
+
+class RuleSet {
+
+  public:
+    // Class methods:
+    RuleSet();
+    ~RuleSet();
+
+    // Methods:
+    bool intercept(RuleStage, rule_request*, const Headers*);
+    int load(QString, QString*);
+    static rule_request describe(QString, QString, QString);
+
+  private:
+    // Variables:
+    bool loaded;            /**< Rules were loaded. */
+    bool default_intercept; /**< Action when no rule applies. */
+
+    // Classes and custom types:
+    QVector<rule> rules;        /**< Rules, in the order of the file. */
+    QVector<rule_node> nodes;   /**< Host trie (the root is the first node). */
+    QVector<int> any_host;      /**< Rules with no host condition. */
+
+    // Methods:
+    bool applies(const rule*, RuleStage, rule_request*, const Headers*);
+    int compile(QStringList, rule*, QStringList*, QString*);
+    void add_host(QString, int);
+    void clear();
+    void match_hosts(QString, QVarLengthArray<int, RULES_CANDIDATES>*);
+    static bool find_header(const Headers*, QString, QString*);
+    static bool glob(const QChar*, const QChar*, const QChar*, const QChar*);
+
+};
+
+#endif // RULES_H
@@ -18,22 +18,39 @@
 
 // Library includes:
 #include <arpa/inet.h>
+#include <errno.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <stdexcept>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
 // Qt includes:
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QList>
 #include <QMutex>
 #include <QObject>
+#include <QSet>
+#include <QSharedPointer>
 #include <QString>
 
 // User includes:
+#include "include/gate.h"
+#include "include/http_cache.h"
 #include "include/httpparser.h"
 #include "include/message_logger.h"
+#include "include/reactor.h"
+#include "include/resolver.h"
+#include "include/ring_buffer.h"
+#include "include/rules.h"
+#include "include/slab_pool.h"
 #include "include/socket.h"
+#include "include/upstream_pool.h"
 
 // Namespace:
 using namespace std;
@@ -47,12 +64,132 @@ using namespace std;
 
 #define DEFAULT_PORT 8228
 
+/**
+ * @def DEFAULT_WORKERS
+ * @brief Default number of proxy server workers (0 means one per CPU core).
+ */
+
+#define DEFAULT_WORKERS 0
+
 /**
  * @def SERVER_BACKLOG
  * @brief Number of backlog connections accepted by the proxy server class.
  */
 
-#define SERVER_BACKLOG 3
+#define SERVER_BACKLOG 1024
+
+/**
+ * @def CLIENT_IDLE_TIME
+ * @brief Default time (in seconds) an idle client connection is kept open.
+ */
+
+#define CLIENT_IDLE_TIME 15
+
+/**
+ * @def CONNECT_TIMEOUT
+ * @brief Default time (in seconds) the proxy server waits for a website
+ * connection to be established.
+ */
+
+#define CONNECT_TIMEOUT 10
+
+/**
+ * @def CONNECT_ATTEMPT_DELAY
+ * @brief Time (in ms) a website connection attempt has before the next
+ * address of the website is tried as well.
+ *
+ * This is the Connection Attempt Delay of Happy Eyeballs (RFC 8305). Attempts
+ * are never cancelled by newer ones: the first connection established wins.
+ */
+
+#define CONNECT_ATTEMPT_DELAY 250
+
+/**
+ * @def WEBSITE_PORT
+ * @brief Port of a website whose Host header gives none (HTTP).
+ */
+
+#define WEBSITE_PORT 80
+
+/**
+ * @def TUNNEL_PORT
+ * @brief Port of a CONNECT request target that gives none (HTTPS).
+ */
+
+#define TUNNEL_PORT 443
+
+/**
+ * @def TUNNEL_IDLE_TIME
+ * @brief Default time (in seconds) a tunnel with no traffic is kept open.
+ */
+
+#define TUNNEL_IDLE_TIME 300
+
+/**
+ * @def TUNNEL_BUFFER_SIZE
+ * @brief Capacity (in bytes) of each direction of a tunnel.
+ *
+ * Matches the default pipe size, so the kernel ring buffers of a tunnel never
+ * have to be grown (which is limited per user).
+ */
+
+#define TUNNEL_BUFFER_SIZE 65536
+
+/**
+ * @def TUNNEL_REPLY
+ * @brief Answer sent to the client once the website of a tunnel is connected.
+ */
+
+#define TUNNEL_REPLY "HTTP/1.1 200 Connection Established\r\n\r\n"
+
+/**
+ * @def SESSION_SWEEP_INTERVAL
+ * @brief Minimum time (in ms) between two sweeps for idle client connections.
+ */
+
+#define SESSION_SWEEP_INTERVAL 1000
+
+/**
+ * @def PREVIEW_SIZE
+ * @brief Default number of body bytes of a website answer shown at the gate.
+ *
+ * Answers whose body is larger than the preview are relayed to the client
+ * through a RingBuffer once the headers and the preview go through the gate.
+ */
+
+#define PREVIEW_SIZE HTTP_BUFFER_SIZE
+
+/**
+ * @def PASS_THROUGH_CHUNK
+ * @brief Maximum number of bytes read at once while looking for the headers of
+ * an answer in pass-through mode.
+ *
+ * Keeps most of the body of an answer out of user space, since whatever is
+ * read with the headers is copied instead of spliced.
+ */
+
+#define PASS_THROUGH_CHUNK 16384
+
+/**
+ * @def SERVER_POLL_TIMEOUT
+ * @brief Maximum time (in ms) the proxy server waits for socket events.
+ *
+ * The server checks the proxy gate and the stop request at least once every
+ * SERVER_POLL_TIMEOUT milliseconds, even if no socket becomes ready.
+ */
+
+#define SERVER_POLL_TIMEOUT 50
+
+/**
+ * @def TASK_PENDING
+ * @brief Return code of a server task that is waiting for a socket or for the
+ * proxy gate.
+ *
+ * A task that returns TASK_PENDING keeps its session in the same state and is
+ * executed again once the socket it armed becomes ready.
+ */
+
+#define TASK_PENDING 1
 
 // Type definitions:
 
@@ -71,6 +208,19 @@ typedef enum {
   WEBSITE   /**< Connection to a website (proxy server-side). */
 } ServerConnections;
 
+/**
+ * @enum FlightRole
+ * @brief Role of a session in a collapsed request (see HTTPCache::join()).
+ */
+
+typedef enum {
+  FLIGHT_NONE,    /**< Request is not collapsed. */
+  FLIGHT_LEADER,  /**< Request fetches the answer others wait for. */
+  FLIGHT_WAITER,  /**< Request waits for an identical one in flight. */
+  FLIGHT_LANDED   /**< Request waited and is looked up again (it is not
+                       collapsed a second time). */
+} FlightRole;
+
 /**
  * @enum ServerTask
  * @brief Types of tasks performed by the proxy server.
@@ -78,36 +228,32 @@ typedef enum {
  * Enumeration of the types of tasks performed by the proxy server class. It is
  * used in the run method of the proxy server class to implement a finite state
  * machine, used to determine the method the server class should call to
- * execute the next server task.
+ * execute the next server task. Every client connection has its own instance
+ * of this finite state machine (see the session struct).
  *
  */
 
 typedef enum {
-  AWAIT_CONNECTION,     /**< Await for a client connection. */
+  AWAIT_CONNECTION,     /**< Await for a client connection (the session is
+                             finished). */
+  AWAIT_FLIGHT,         /**< Await for the answer to an identical request in
+                             flight. */
   AWAIT_GATE,           /**< Await for the proxy gate to be opened. */
   CONNECT_TO_WEBSITE,   /**< Connect to a website host given by the client. */
+  LOOKUP_CACHE,         /**< Look the client request up in the HTTP cache. */
+  OPEN_TUNNEL,          /**< Answer a CONNECT request and start its tunnel. */
   READ_FROM_CLIENT,     /**< Read data from the client. */
   READ_FROM_WEBSITE,    /**< Read data from a website. */
+  RELAY_TO_CLIENT,      /**< Relay the rest of a website answer to the
+                             client. */
+  RELAY_TUNNEL,         /**< Relay the data of a tunnel both ways. */
+  SEND_FILE_TO_CLIENT,  /**< Send the body of a cached answer kept on disk
+                             to the client. */
   SEND_TO_CLIENT,       /**< Send data to the client. */
   SEND_TO_WEBSITE,      /**< Send data to a website. */
   UPDATE_REQUESTS       /**< Update requests with the user edits. */
 } ServerTask;
 
-/**
- * @struct request
- * @brief HTTP request information obtained from a socket.
- *
- * Models the relevant data contained in a single HTTP request read from a
- * socket.
- *
- */
-
-typedef struct {
-  char content[HTTP_BUFFER_SIZE+1];   /**< Request contents. */
-  ssize_t size;                       /**< Request size (Needed for binary
-                                           data!). */
-} request;
-
 /**
  * @struct connection
  * @brief Socket connection information.
@@ -121,10 +267,145 @@ typedef struct {
   int fd;                   /**< File descriptor for the socket connection. */
   request buffer;           /**< Request struct to hold the data received from
                                  the connection. */
-  struct sockaddr_in addr;  /**< Address information of the socket
-                                 connection. */
+  MessageState message;     /**< Parse state of the message in the buffer,
+                                 kept as it arrives. */
+  struct sockaddr_storage addr; /**< Address information (IPv4 or IPv6) of
+                                     the socket connection. */
 } connection;
 
+/**
+ * @struct connect_attempt
+ * @brief Website connection being established.
+ *
+ * Models one of the connection attempts a session races against each other
+ * to reach a website with several addresses.
+ *
+ */
+
+typedef struct {
+  int fd;                       /**< File descriptor of the socket. */
+  struct sockaddr_storage addr; /**< Address being connected to. */
+} connect_attempt;
+
+/**
+ * @struct session
+ * @brief State of a single client connection handled by the proxy server.
+ *
+ * Models one instance of the proxy server finite state machine: the client
+ * connection, the website connection opened on its behalf and the task that
+ * should be executed next. All sockets in a session are non-blocking, so a
+ * session that cannot make progress waits for the reactor instead of blocking
+ * every other session.
+ *
+ */
+
+typedef struct {
+  connection client;            /**< Client connection (web browser). */
+  connection website;           /**< Website connection. */
+  ServerConnections last_read;  /**< Last connection the session read from. */
+  ServerTask next_task;         /**< Next task to be executed. */
+  size_t sent;                  /**< Bytes of the buffer being sent that were
+                                     already sent. */
+  bool head_request;            /**< Client request is a HEAD request. */
+  rule_request request;         /**< Facts of the client request the
+                                     interception rules look at. */
+  QString cache_key;            /**< URL of the request in the HTTP cache (or
+                                     empty). */
+  QByteArray stale_answer;      /**< Cached answer being revalidated by the
+                                     website (or empty). */
+  disk_body body;               /**< Body of a cached answer sent from the
+                                     disk cache (its fd is -1 otherwise). */
+  bool reused;                  /**< Website connection came from the
+                                     upstream pool. */
+  bool displayed;               /**< Exchange is displayed at the gate. */
+  long long idle_since;         /**< Time (monotonic_ms) the client connection
+                                     became idle or -1 while a request is
+                                     handled. */
+  QByteArray pipeline;          /**< Client data read after the current
+                                     request (pipelined requests). */
+  RingBuffer *ring;             /**< Ring used to relay an answer larger than
+                                     the preview (or nullptr). */
+  ssize_t relay_left;           /**< Answer bytes left to relay, or -1 if the
+                                     answer ends after its last chunk or when
+                                     the website closes the connection. */
+  QList<struct sockaddr_storage> addresses; /**< Website addresses not tried
+                                                 yet. */
+  QList<connect_attempt> attempts;  /**< Website connection attempts in
+                                         progress. */
+  long long next_attempt;       /**< Time (monotonic_ms) the next website
+                                     address is tried. */
+  long long connect_deadline;   /**< Time (monotonic_ms) the website
+                                     connection attempts give up, or -1 if
+                                     no attempt was started. */
+  bool tunnel;                  /**< Session is a CONNECT tunnel. */
+  RingBuffer *upstream;         /**< Ring used to relay the client data of a
+                                     tunnel (or nullptr). */
+  bool client_eof;              /**< Client closed its side of the tunnel. */
+  bool website_eof;             /**< Website closed its side of the tunnel. */
+  quint64 tunnel_up;            /**< Tunnel bytes sent to the website. */
+  quint64 tunnel_down;          /**< Tunnel bytes sent to the client. */
+  quint64 ticket;               /**< Ticket of the exchange parked at the
+                                     gate, or 0 if it is not parked. */
+  FlightRole flight;            /**< Role of the request in a collapsed
+                                     request. */
+} session;
+
+/**
+ * @struct ServerConfig
+ * @brief Proxy server configuration.
+ *
+ * Models the options given to the application that configure the proxy
+ * server workers.
+ *
+ */
+
+typedef struct {
+  in_port_t port_number;  /**< Port number the workers listen to. */
+  unsigned int workers;   /**< Number of workers (threads) to run. */
+  unsigned int client_idle_time;  /**< Time (in seconds) an idle client
+                                       connection is kept open. */
+  unsigned int preview_size;  /**< Body bytes of an answer shown at the
+                                   gate. */
+  bool pass_through;      /**< Skip the gate and splice the answers. */
+  unsigned int pool_idle_time;  /**< Time (in seconds) an idle website
+                                     connection is kept open. */
+  unsigned int pool_per_host;   /**< Idle connections kept per website. */
+  unsigned int connect_timeout; /**< Time (in seconds) a website connection
+                                     has to be established. */
+  unsigned int tunnel_idle_time;  /**< Time (in seconds) a tunnel with no
+                                       traffic is kept open. */
+  QString dns_server;     /**< DNS server ('address[:port]', empty for the
+                               system one). */
+  QString hosts_file;     /**< File with static host addresses. */
+  QString rules_file;     /**< File with the interception rules (empty to
+                               intercept every exchange). */
+  unsigned int cache_size;  /**< Memory budget (in MB) of the HTTP cache. */
+  QString disk_cache;     /**< Directory of the disk cache (empty to keep
+                               the cache in memory only). */
+  unsigned int disk_cache_size; /**< Disk budget (in MB) of the HTTP
+                                     cache. */
+} ServerConfig;
+
+/**
+ * @struct ServerStats
+ * @brief Proxy server worker counters.
+ *
+ * Models the counters kept by a single proxy server worker. The counters are
+ * updated by the worker thread and can be read from any other thread.
+ *
+ */
+
+typedef struct {
+  QAtomicInteger<quint64> connections;    /**< Client connections accepted. */
+  QAtomicInteger<quint64> exchanges;      /**< Answers sent to clients. */
+  QAtomicInteger<quint64> client_bytes;   /**< Bytes read from clients. */
+  QAtomicInteger<quint64> website_bytes;  /**< Bytes read from websites. */
+  QAtomicInteger<quint64> reused;         /**< Website connections reused. */
+  QAtomicInteger<quint64> tunnels;        /**< CONNECT tunnels opened. */
+  QAtomicInteger<quint64> tunnel_bytes;   /**< Bytes relayed by tunnels. */
+  QAtomicInteger<quint64> errors;         /**< Runtime errors. */
+} ServerStats;
+
 /**
  * @class Server
  * @brief Proxy server class.
@@ -136,11 +417,65 @@ typedef struct {
  *
  * The handling of client connections by the Server is implemented by a finite
  * state machine (FSM), which breaks the functionality of the Server into small
- * tasks.
+ * tasks. Each client connection has its own FSM instance (a session) and all
+ * sessions are driven by a single epoll Reactor, so a slow website only stalls
+ * the session waiting for it. Sessions waiting for the proxy gate are parked
+ * in a queue and shown to the user one at a time, while the other sessions
+ * keep flowing. The Gate wakes the Server through an eventfd (driven by the
+ * same Reactor) when it opens, when it is released by another worker or when
+ * the user lets any parked exchange through unchanged. The HTTP cache wakes it
+ * through the same eventfd when the answer to a collapsed request lands.
+ *
+ * Website hosts are resolved by an asynchronous Resolver, whose socket is
+ * driven by the same Reactor, so a session waiting for the DNS server does not
+ * block the others. The DNS cache is shared by every worker and the spider.
  *
  * The port number on which the Server listens for client requests can be
  * configured on the class constructor.
  *
+ * Several Server instances (workers) can run at once, each in its own thread
+ * with its own Server socket and Reactor. Every Server socket is bound to the
+ * same port with SO_REUSEPORT, so the kernel spreads the client connections
+ * across the workers. The workers share a single Gate.
+ *
+ * Website answers larger than the preview size are not buffered whole: their
+ * headers and the start of their body go through the gate and the rest is
+ * relayed to the client through a RingBuffer, so the memory used by a session
+ * does not depend on the size of the answer.
+ *
+ * Only the exchanges the interception rules (a RuleSet shared by the workers)
+ * choose stop at the gate, the others are sent on at once. With no rules
+ * loaded, every exchange is intercepted.
+ *
+ * In pass-through mode, exchanges skip the gate altogether and the body of
+ * every answer is moved from the website socket to the client socket inside
+ * the kernel (with splice), without being copied to user space.
+ *
+ * Client connections are persistent: once an answer is sent, the session
+ * reads the next request from the same client connection, answering
+ * pipelined requests in order. Client connections left idle for too long are
+ * closed.
+ *
+ * Answers to GET requests are kept in an HTTPCache shared by the workers.
+ * Requests are looked up in it before the website is contacted: fresh answers
+ * are served from it and stale ones are revalidated with a conditional
+ * request.
+ *
+ * Website connections whose answer leaves them reusable are kept in an
+ * UpstreamPool and used again by later requests to the same website.
+ *
+ * Websites are reached on the port given by the Host header, over IPv4 or
+ * IPv6. When a website has several addresses, the connection attempts are
+ * raced as in Happy Eyeballs (RFC 8305): a new address is tried every
+ * CONNECT_ATTEMPT_DELAY milliseconds (or as soon as an attempt fails) and the
+ * first connection established is used. Websites that can not be reached
+ * within the connect timeout fail the request.
+ *
+ * CONNECT requests open a tunnel to the website, which skips the gate: once
+ * the website is connected, the client is answered and the data is relayed
+ * both ways through a pair of kernel RingBuffers (with splice), until both
+ * sides close or the tunnel stays idle for too long.
+ *
  */
 
 // Class headers:
@@ -149,65 +484,118 @@ class Server : public QObject {
 
   public:
     // Class methods:
-    Server(in_port_t);
+    Server(ServerConfig, unsigned int, QSharedPointer<Gate>,
+           QSharedPointer<DNSCache>, QSharedPointer<RuleSet>,
+           QSharedPointer<HTTPCache>);
     ~Server();
 
     // Methods:
     int init();
-    void load_client_request(QString, QByteArray);
-    void load_website_request(QString, QByteArray);
-    void open_gate();
+    ServerStats *get_stats();
 
   public slots:
     void run();
     void stop();
 
   signals:
-    void clientData(QString, QByteArray); /**< Signals a client request. */
+    void clientData(QByteArray, QByteArray); /**< Signals a client request. */
     void error(QString err);    /**< Signals an error. */
+    void exchangeParked(quint64, QString);  /**< Signals an exchange parked
+                                                 at the gate. */
+    void exchangeUnparked(quint64); /**< Signals an exchange left the gate. */
     void finished();            /**< Signals the Server finished running. */
     void gateOpened();          /**< Signals the Server gate opened. */
     void logMessage(QString);   /**< Signals a log message. */
     void newHost(QString);      /**< Signals the connection to a new host. */
-    void websiteData(QString, QByteArray); /**< Signals a website request. */
+    void websiteData(QByteArray, QByteArray); /**< Signals a website request. */
 
   private:
     // Variables:
-    bool gate_closed;       /**< Variable to control the Server gate. */
     bool running;           /**< Variable to control the Server execution. */
+    bool pass_through;      /**< Skip the gate and splice the answers. */
+    bool gate_changed;      /**< Sessions were parked since the last gate
+                                 service. */
     int server_fd;          /**< File descriptor of the Server socket. */
+    int wake_fd;            /**< Eventfd the Gate and the HTTP cache wake
+                                 the Server with. */
+    long long client_idle_time; /**< Maximum client idle time, in ms. */
+    long long connect_timeout;  /**< Maximum website connect time, in ms. */
+    long long tunnel_idle_time; /**< Maximum tunnel idle time, in ms. */
+    long long last_sweep;   /**< Time of the last idle client sweep. */
+    ssize_t preview_size;   /**< Body bytes of an answer shown at the gate. */
     in_port_t port_number;  /**< Port number used by the Server. */
+    unsigned int worker_id; /**< Identifier of the Server worker. */
+    request *parsed_buffer; /**< Buffer whose contents the parser holds (or
+                                 nullptr). */
 
     // Classes and custom types:
-    HTTPParser parser;            /**< HTTPParser used by the Server. */
+    HTTPParserCore parser;        /**< HTTPParserCore used by the Server. */
     MessageLogger logger;         /**< MessageLogger used by the Server. */
-    QMutex gate_mutex;            /**< Mutex to the gate_closed variable. */
-    QMutex run_mutex;             /**< Mutex to the gate_closed variable. */
-    QByteArray new_client_data;   /**< New client request data. */
-    QString new_client_headers;   /**< New client request headers. */
-    QByteArray new_website_data;  /**< New website request data. */
-    QString new_website_headers;  /**< New website request headers. */
-    ServerConnections last_read;  /**< Last connection the server read from. */
-    ServerTask next_task;         /**< Next server task to be executed. */
+    QMutex run_mutex;             /**< Mutex to the running variable. */
+    QSharedPointer<Gate> gate;    /**< Gate shared by the workers. */
+    QSharedPointer<RuleSet> rules;  /**< Interception rules shared by the
+                                         workers. */
+    QSharedPointer<HTTPCache> cache;  /**< HTTP cache shared by the
+                                           workers. */
+    gate_edit client_edit;        /**< User edits of the client request. */
+    gate_edit website_edit;       /**< User edits of the website answer. */
+    QList<session*> gate_queue;   /**< Sessions waiting for the gate. */
+    QSet<session*> sessions;      /**< Sessions currently open. */
+    QSet<session*> connecting;    /**< Sessions racing website connection
+                                       attempts. */
+    Reactor reactor;              /**< Reactor driving every session. */
+    ServerStats stats;            /**< Counters of the Server worker. */
+    SlabPool slabs;               /**< Buffers of the session connections. */
+    UpstreamPool pool;            /**< Idle website connections. */
+    Resolver resolver;            /**< Resolver of website hosts. */
 
     // Methods:
-    bool is_gate_closed();
     bool is_program_running();
-    int await_connection(connection*);
-    int await_gate();
-    int connect_to_website(connection*, connection*);
-    int execute_task(ServerTask, connection*, connection*);
-    int read_from_client(connection*);
-    int read_from_website(connection*);
-    int send_to_client(connection*, connection*);
-    int send_to_website(connection*, connection*);
-    int update_requests(connection*, connection*);
+    bool persistent_connection();
+    bool rebuild_message(connection*, gate_edit*, bool, QByteArray*);
+    bool retry_website(session*);
+    bool split_host(QString, in_port_t, QString*, in_port_t*);
+    int await_connection();
+    int await_gate(session*);
+    int connect_to_website(session*);
+    int execute_task(ServerTask, session*);
+    int finish_exchange(session*, bool);
+    int lookup_cache(session*);
+    int open_tunnel(session*);
+    int pump_tunnel(RingBuffer*, connection*, connection*, bool*, quint64*);
+    int read_from_client(session*);
+    int read_from_website(session*);
+    int race_website(session*);
+    int relay_to_client(session*);
+    int relay_tunnel(session*);
+    int send_buffer(session*, connection*, request*);
+    int send_file_to_client(session*);
+    int send_to_client(session*);
+    int send_to_website(session*);
+    int update_requests(session*);
+    int wait_for(session*, connection*, unsigned int);
+    ParseStatus parse_message(connection*, bool, bool);
+    session *create_session(int, struct sockaddr_storage*);
+    void cache_answer(session*);
+    void cancel_attempts(session*);
+    void close_connection(connection*);
+    void close_session(session*);
     void config_client_addr(struct sockaddr_in*);
-    void config_website_addr(struct sockaddr_in*);
-    void handle_error(ServerTask, int, int);
-    void replace_buffer(request *, QByteArray);
-    void set_gate_closed(bool);
+    void display_exchange(session*);
+    void end_flight(session*);
+    void expire_sessions();
+    void handle_error(ServerTask, session*);
+    void next_request(session*);
+    void parse_buffer(request*);
+    void process_session(session*);
+    void relay_chunks(session*, size_t);
+    void replace_buffer(connection*, QByteArray);
+    void service_connects();
+    void service_flights(bool);
+    void service_gate(bool);
+    void service_resolver(bool);
     void set_running(bool);
+    void unpark_session(session*);
 
 };
 
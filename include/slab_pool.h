@@ -0,0 +1,112 @@
+// Slab pool module - Header file.
+
+/**
+ * @file slab_pool.h
+ * @brief Slab pool module - Header file.
+ *
+ * The slab pool module contains the implementation of a per-worker pool of
+ * I/O buffers, so each connection only holds the memory its data takes. This
+ * header file contains a header guard, library includes, macro definitions,
+ * type definitions and the class headers for this module.
+ *
+ */
+
+// Header guard:
+#ifndef SLAB_POOL_H
+#define SLAB_POOL_H
+
+// Library includes:
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+// Macros:
+
+/**
+ * @def SLAB_BLOCK_SIZE
+ * @brief Size (in bytes) of the smallest buffer.
+ */
+
+#define SLAB_BLOCK_SIZE 16384
+
+/**
+ * @def SLAB_CLASSES
+ * @brief Number of buffer sizes, each twice the previous one (the largest
+ * one, 1 MB, holds a whole HTTP_BUFFER_SIZE message).
+ */
+
+#define SLAB_CLASSES 7
+
+/**
+ * @def SLAB_MAX_KEPT
+ * @brief Memory (in bytes) of the free buffers a pool keeps for reuse.
+ */
+
+#define SLAB_MAX_KEPT 16777216
+
+// Type definitions:
+
+/**
+ * @struct request
+ * @brief HTTP request information obtained from a socket.
+ *
+ * Models the relevant data contained in a single HTTP request read from a
+ * socket. The contents are held by a buffer taken from a SlabPool, which
+ * grows as data arrives and is given back once the request is done with, so
+ * an idle connection holds no buffer at all.
+ *
+ */
+
+typedef struct {
+  char *content;      /**< Request contents (nullptr without a buffer). */
+  ssize_t size;       /**< Request size (Needed for binary data!). */
+  size_t capacity;    /**< Size of the buffer holding the contents. */
+  bool parsed;        /**< The Server parser holds the parse of these
+                           contents (cleared whenever they change). */
+} request;
+
+// Class headers:
+
+/**
+ * @class SlabPool
+ * @brief Pool of I/O buffers of a Server worker.
+ *
+ * The SlabPool hands out buffers in SLAB_CLASSES sizes, from SLAB_BLOCK_SIZE
+ * bytes up to 1 MB. A request starts with the smallest buffer and moves to
+ * the next size (twice as large) when it fills up, so a small request never
+ * takes more than 16 KB. Buffers given back are kept in a free list per size
+ * (up to SLAB_MAX_KEPT bytes) and reused before any new memory is allocated.
+ *
+ * The contents of a request stay contiguous, as the HTTPParserCore expects, at
+ * the cost of a copy each time a buffer grows.
+ *
+ * The SlabPool is not thread safe: each Server worker owns its own pool.
+ *
+ */
+
+class SlabPool {
+
+  public:
+    // Class methods:
+    SlabPool();
+    ~SlabPool();
+
+    // Methods:
+    bool grow(request*, size_t);
+    size_t room(request*, size_t);
+    void clear();
+    void release(request*);
+
+  private:
+    // Variables:
+    char *free_blocks[SLAB_CLASSES];  /**< Free buffers of each size, linked
+                                           through their first bytes. */
+    size_t kept;                      /**< Memory of the free buffers. */
+
+    // Methods:
+    void give(char*, size_t);
+    static int size_class(size_t);
+
+};
+
+#endif // SLAB_POOL_H
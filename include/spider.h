@@ -16,13 +16,18 @@
 #include <QString>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <ctype.h>
+#include <strings.h>
 #include <QObject>
 #include <QRegularExpression>
 #include <QDir>
+#include <QSharedPointer>
 
+#include "include/byte_scan.h"
 #include "include/socket.h"
 #include "include/message_logger.h"
 #include "include/httpparser.h"
+#include "include/resolver.h"
 
 /**
  * @macro SPIDER_TREE_DEPTH
@@ -30,6 +35,12 @@
  */
 #define SPIDER_TREE_DEPTH 2
 
+/**
+ * @macro SPIDER_READ_SIZE
+ * @brief Initial size of the buffer a page is read into, doubled as needed up to HTTP_BUFFER_SIZE
+ */
+#define SPIDER_READ_SIZE 65536
+
 /**
  * @class SpiderTree
  * @brief Node of tree
@@ -73,12 +84,15 @@ class SpiderDumper : public QObject {
 
     private:
     MessageLogger logger; /**< SpiderDumper logger. */
+    Resolver resolver; /**< SpiderDumper resolver (shares the proxy DNS cache). */
 
 
     int get(QString, QByteArray *, QString *);
     int con(QString, int *);
-    QStringList extract_links(QString);
-    QStringList extract_references(QString);
+    QStringList extract_links(QByteArray);
+    QStringList extract_references(QByteArray);
+    QList<TextSpan> find_references(const QByteArray &, bool);
+    static bool isAttribute(const char *, const char *, const char *);
     QString getAbsoluteLink(QString, QString);
     QString getURL(QString);
     QString getURL_relative(QString, QString);
@@ -91,7 +105,7 @@ class SpiderDumper : public QObject {
     bool sameHost(QString, QString);
     QString removeWWW(QString);
     QString removeSquare(QString);
-    QString fix_references(QString, QString);
+    QByteArray fix_references(QByteArray, QString);
     QString buildBackDir(int);
     QString getFileName(QString);
     QString getFolderName(QString);
@@ -100,7 +114,7 @@ class SpiderDumper : public QObject {
 
 
     public:
-        SpiderDumper();
+        SpiderDumper(QSharedPointer<DNSCache>);
 
     public slots:
         void spider(QString);
@@ -0,0 +1,213 @@
+// Token table module - Header file.
+
+/**
+ * @file token_table.h
+ * @brief Token table module - Header file.
+ *
+ * The token table module contains the implementation of the perfect hash
+ * tables that classify the fixed sets of HTTP tokens (request methods and
+ * well-known header names), built while the program is compiled. This header
+ * file contains a header guard, library includes, macro definitions and the
+ * class template for this module (with its methods, as they are used at
+ * compile time).
+ *
+ */
+
+// Header guard:
+#ifndef TOKEN_TABLE_H
+#define TOKEN_TABLE_H
+
+// Library includes:
+#include <stdint.h>
+
+// Macros:
+
+/**
+ * @def TOKEN_SEED
+ * @brief First multiplier tried by the hash (2^32 divided by the golden
+ * ratio, made odd).
+ */
+
+#define TOKEN_SEED 0x9E3779B1u
+
+/**
+ * @def TOKEN_SEED_TRIES
+ * @brief Number of multipliers tried before a table is given up on.
+ */
+
+#define TOKEN_SEED_TRIES 65536
+
+// Class headers:
+
+/**
+ * @class TokenTable
+ * @brief Perfect hash of a fixed set of tokens.
+ *
+ * A token is hashed from its size and its first, middle and last bytes (case
+ * folded through a lookup table), multiplied by a seed and cut down to BITS
+ * bits. The constructor tries seeds until no two tokens share a slot, so a
+ * table declared constexpr is searched by the compiler and the program only
+ * holds the result: classifying a token takes one hash, one slot and one
+ * comparison with the only token it can be.
+ *
+ * Tokens are found by their index in the list given (empty tokens are left
+ * out, to stand for "none of them"). Whether the search found a seed is
+ * checked with perfect(), meant for a static_assert next to the table.
+ *
+ */
+
+template<int N, int BITS, bool CASELESS>
+class TokenTable {
+
+  static_assert(N < 128, "Slots hold token indexes as signed chars");
+
+  public:
+    // Class methods:
+    constexpr explicit TokenTable(const char *const (&)[N]);
+
+    // Methods:
+    constexpr bool perfect() const;
+    constexpr int find(const char*, int) const;
+
+  private:
+    // Variables:
+    const char *const *tokens;      /**< Tokens, in the order given. */
+    int sizes[N];                   /**< Size of each token. */
+    unsigned char folds[256];       /**< Lower case of every byte. */
+    signed char buckets[1 << BITS]; /**< Index of the token in each slot (-1
+                                         if the slot is empty). */
+    uint32_t seed;                  /**< Multiplier that spreads the tokens. */
+    bool found;                     /**< A seed without collisions was found. */
+
+    // Methods:
+    constexpr bool place();
+    constexpr int slot(const char*, int) const;
+
+};
+
+// Class methods:
+
+/**
+ * @fn TokenTable::TokenTable(const char *const (&list)[N])
+ * @brief Class constructor for the TokenTable class.
+ * @param list Tokens, of static storage (the table refers to them).
+ *
+ * This constructor builds the folding table, then tries up to
+ * TOKEN_SEED_TRIES odd seeds from TOKEN_SEED on.
+ *
+ */
+
+template<int N, int BITS, bool CASELESS>
+constexpr TokenTable<N, BITS, CASELESS>::TokenTable(const char *const (&list)[N])
+  : tokens(list), sizes(), folds(), buckets(), seed(TOKEN_SEED), found(false) {
+
+  for(int byte = 0; byte < 256; byte++)
+    folds[byte] = static_cast<unsigned char> (byte >= 'A' && byte <= 'Z' ? byte + 'a' - 'A' : byte);
+
+  for(int index = 0; index < N; index++)
+    while(list[index][sizes[index]] != '\0')
+      sizes[index]++;
+
+  for(int tries = 0; tries < TOKEN_SEED_TRIES && !found; tries++, seed += 2)
+    found = place();
+
+  seed -= 2;
+
+}
+
+// Public methods:
+
+/**
+ * @fn bool TokenTable::perfect() const
+ * @brief Method to check the table.
+ * @return Returns true if a seed was found and every token is found at its
+ * own index.
+ */
+
+template<int N, int BITS, bool CASELESS>
+constexpr bool TokenTable<N, BITS, CASELESS>::perfect() const {
+
+  if(!found)
+    return false;
+
+  for(int index = 0; index < N; index++)
+    if(sizes[index] != 0 && find(tokens[index], sizes[index]) != index)
+      return false;
+
+  return true;
+
+}
+
+/**
+ * @fn int TokenTable::find(const char *token, int size) const
+ * @brief Method to classify a token.
+ * @param token First byte of the token.
+ * @param size Size of the token.
+ * @return Returns the index of the token in the list (-1 if it is not there).
+ */
+
+template<int N, int BITS, bool CASELESS>
+constexpr int TokenTable<N, BITS, CASELESS>::find(const char *token, int size) const {
+
+  int index = size > 0 ? buckets[slot(token, size)] : -1;
+
+  if(index < 0 || sizes[index] != size)
+    return -1;
+
+  for(int byte = 0; byte < size; byte++)
+    if(CASELESS ? folds[static_cast<unsigned char> (token[byte])] != folds[static_cast<unsigned char> (tokens[index][byte])]
+                : token[byte] != tokens[index][byte])
+      return -1;
+
+  return index;
+
+}
+
+// Private methods:
+
+/**
+ * @fn bool TokenTable::place()
+ * @brief Method to place the tokens with the current seed.
+ * @return Returns false if two tokens fall in the same slot.
+ */
+
+template<int N, int BITS, bool CASELESS>
+constexpr bool TokenTable<N, BITS, CASELESS>::place() {
+
+  for(int index = 0; index < (1 << BITS); index++)
+    buckets[index] = -1;
+
+  for(int index = 0; index < N; index++) {
+    if(sizes[index] == 0)
+      continue;
+    int target = slot(tokens[index], sizes[index]);
+    if(buckets[target] != -1)
+      return false;
+    buckets[target] = static_cast<signed char> (index);
+  }
+
+  return true;
+
+}
+
+/**
+ * @fn int TokenTable::slot(const char *token, int size) const
+ * @brief Method to hash a token.
+ * @param token First byte of the token.
+ * @param size Size of the token (at least 1).
+ * @return Returns the slot of the token.
+ */
+
+template<int N, int BITS, bool CASELESS>
+constexpr int TokenTable<N, BITS, CASELESS>::slot(const char *token, int size) const {
+
+  uint32_t key = folds[static_cast<unsigned char> (token[0])] |
+                 static_cast<uint32_t> (folds[static_cast<unsigned char> (token[size - 1])]) << 8 |
+                 static_cast<uint32_t> (folds[static_cast<unsigned char> (token[size / 2])]) << 16 |
+                 static_cast<uint32_t> (size) << 24;
+
+  return static_cast<int> ((key * seed) >> (32 - BITS));
+
+}
+
+#endif // TOKEN_TABLE_H
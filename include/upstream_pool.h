@@ -0,0 +1,110 @@
+// Upstream pool module - Header file.
+
+/**
+ * @file upstream_pool.h
+ * @brief Upstream pool module - Header file.
+ *
+ * The upstream pool module contains the implementation of a pool of idle
+ * website connections, kept open so later requests to the same website can
+ * skip the connection handshake. This header file contains a header guard,
+ * library includes, macro definitions, type definitions and the class headers
+ * for this module.
+ *
+ */
+
+// Header guard:
+#ifndef UPSTREAM_POOL_H
+#define UPSTREAM_POOL_H
+
+// Library includes:
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Qt includes:
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// User includes:
+#include "include/reactor.h"
+
+// Macros:
+
+/**
+ * @def POOL_MAX_IDLE_TIME
+ * @brief Default time (in seconds) an idle website connection is kept open.
+ */
+
+#define POOL_MAX_IDLE_TIME 30
+
+/**
+ * @def POOL_MAX_PER_HOST
+ * @brief Default number of idle connections kept open for each website.
+ */
+
+#define POOL_MAX_PER_HOST 8
+
+/**
+ * @def POOL_SWEEP_INTERVAL
+ * @brief Minimum time (in ms) between two sweeps for expired connections.
+ */
+
+#define POOL_SWEEP_INTERVAL 1000
+
+// Type definitions:
+
+/**
+ * @struct idle_connection
+ * @brief Website connection waiting in the upstream pool.
+ */
+
+typedef struct {
+  int fd;             /**< File descriptor for the socket connection. */
+  long long since;    /**< Time (monotonic_ms) the connection became idle. */
+} idle_connection;
+
+// Class headers:
+
+/**
+ * @class UpstreamPool
+ * @brief Pool of idle website connections.
+ *
+ * The UpstreamPool keeps the website connections whose last answer left them
+ * reusable, indexed by the website address and port ('address:port'). A
+ * connection is handed out again only if it is still open and has no pending
+ * data, and is closed once it stays idle for longer than the maximum idle
+ * time. The number of idle connections kept for a single website is limited.
+ *
+ * The UpstreamPool is not thread safe: each Server worker owns its own pool.
+ *
+ */
+
+class UpstreamPool {
+
+  public:
+    // Class methods:
+    UpstreamPool(unsigned int, unsigned int);
+    ~UpstreamPool();
+
+    // Methods:
+    int acquire(QString);
+    void clear();
+    void expire();
+    void release(QString, int);
+    QString key(struct sockaddr_storage*);
+
+  private:
+    // Variables:
+    long long last_sweep;         /**< Time of the last expiration sweep. */
+    long long max_idle_time;      /**< Maximum idle time, in ms. */
+    int max_per_host;             /**< Maximum idle connections per website. */
+
+    // Classes and custom types:
+    QHash<QString, QList<idle_connection>> idle; /**< Idle connections, per
+                                                      website. */
+
+};
+
+#endif // UPSTREAM_POOL_H
@@ -0,0 +1,264 @@
+// Byte scan module - Source code.
+
+/**
+ * @file byte_scan.cpp
+ * @brief Byte scan module - Source code.
+ *
+ * The byte scan module contains the implementation of the kernels that look
+ * for delimiters in raw data (the end of the HTTP headers, the bytes ending a
+ * field or a line, the tags and quotes of a page) several bytes at a time.
+ * This source file contains the class method implementations for this module.
+ *
+ */
+
+// Includes:
+#include "include/byte_scan.h"
+
+#if defined(BYTE_SCAN_AVX2)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Variables:
+
+#if defined(BYTE_SCAN_AVX2)
+/**
+ * @var ByteScan::avx2
+ * @brief Whether the processor has AVX2, checked once when the program
+ * starts (searches made by other static initializers before that use SSE2).
+ */
+
+const bool ByteScan::avx2 = ByteScan::cpu_has_avx2();
+#endif
+
+// Public methods:
+
+/**
+ * @fn const char *ByteScan::find_any(const char *data, size_t size, char first, char second, char third)
+ * @brief Method to find the first of up to three bytes.
+ * @param data Data to be searched.
+ * @param size Size (in bytes) of the data.
+ * @param first Byte to look for.
+ * @param second Byte to look for (the same as first to look for fewer).
+ * @param third Byte to look for (the same as first to look for fewer).
+ * @return Returns the address of the first byte found, or nullptr if the data
+ * has none of them.
+ *
+ * Used with {'\r', '\n', ':'} to find the end of a field or a line, and with
+ * {'<', '"', '\''} to walk the tags and attribute values of a page.
+ *
+ */
+
+const char *ByteScan::find_any(const char *data, size_t size, char first,
+                               char second, char third) {
+
+  const char *end = data + size;
+
+#if defined(BYTE_SCAN_AVX2) && !defined(BYTE_SCAN_NO_AVX2)
+  if(avx2)
+    return find_any_avx2(data, size, first, second, third);
+#endif
+
+#if defined(__SSE2__)
+  const __m128i a = _mm_set1_epi8(first), b = _mm_set1_epi8(second),
+                c = _mm_set1_epi8(third);
+  __m128i block;
+  unsigned int mask;
+
+  for(; end - data >= 16; data += 16) {
+    block = _mm_loadu_si128(reinterpret_cast<const __m128i*> (data));
+    mask = static_cast<unsigned int> (_mm_movemask_epi8(
+             _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, a),
+                                       _mm_cmpeq_epi8(block, b)),
+                          _mm_cmpeq_epi8(block, c))));
+    if(mask != 0)
+      return data + __builtin_ctz(mask);
+  }
+#endif
+
+  return find_any_bytes(data, end, first, second, third);
+
+}
+
+/**
+ * @fn ssize_t ByteScan::find_header_end(const char *data, size_t size)
+ * @brief Method to find the empty line ending the headers of a message.
+ * @param data Data received so far.
+ * @param size Size (in bytes) of the data.
+ * @return Returns the size of the headers, including the "\r\n\r\n" that ends
+ * them, or -1 if the data does not hold it.
+ *
+ * Each step compares four shifted loads with the four bytes of "\r\n\r\n",
+ * so every position of the block is checked at once.
+ *
+ */
+
+ssize_t ByteScan::find_header_end(const char *data, size_t size) {
+
+  size_t index = 0;
+
+#if defined(BYTE_SCAN_AVX2) && !defined(BYTE_SCAN_NO_AVX2)
+  if(avx2)
+    return find_header_end_avx2(data, size);
+#endif
+
+#if defined(__SSE2__)
+  const __m128i cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+  __m128i found;
+  unsigned int mask;
+
+  for(; index + 19 <= size; index += 16) {
+    found = _mm_and_si128(
+              _mm_and_si128(
+                _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*> (data + index)), cr),
+                _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*> (data + index + 1)), lf)),
+              _mm_and_si128(
+                _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*> (data + index + 2)), cr),
+                _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*> (data + index + 3)), lf)));
+    mask = static_cast<unsigned int> (_mm_movemask_epi8(found));
+    if(mask != 0)
+      return static_cast<ssize_t> (index + __builtin_ctz(mask) + 4);
+  }
+#endif
+
+  return find_header_end_bytes(data, size, index);
+
+}
+
+// Private methods:
+
+#if defined(BYTE_SCAN_AVX2)
+/**
+ * @fn bool ByteScan::cpu_has_avx2()
+ * @brief Method to check whether the processor has AVX2.
+ * @return Returns true if the AVX2 kernels can run.
+ */
+
+bool ByteScan::cpu_has_avx2() {
+
+  __builtin_cpu_init();
+
+  return __builtin_cpu_supports("avx2");
+
+}
+
+/**
+ * @fn const char *ByteScan::find_any_avx2(const char *data, size_t size, char first, char second, char third)
+ * @brief Method to find the first of up to three bytes, 32 bytes at a time.
+ * @param data Data to be searched.
+ * @param size Size (in bytes) of the data.
+ * @param first Byte to look for.
+ * @param second Byte to look for.
+ * @param third Byte to look for.
+ * @return Returns the address of the first byte found, or nullptr.
+ *
+ * Built for AVX2 whatever the compiler flags, so it must only be called if
+ * the processor has it.
+ *
+ */
+
+__attribute__((target("avx2")))
+const char *ByteScan::find_any_avx2(const char *data, size_t size, char first,
+                                    char second, char third) {
+
+  const char *end = data + size;
+  const __m256i a = _mm256_set1_epi8(first), b = _mm256_set1_epi8(second),
+                c = _mm256_set1_epi8(third);
+  __m256i block;
+  unsigned int mask;
+
+  for(; end - data >= 32; data += 32) {
+    block = _mm256_loadu_si256(reinterpret_cast<const __m256i*> (data));
+    mask = static_cast<unsigned int> (_mm256_movemask_epi8(
+             _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, a),
+                                             _mm256_cmpeq_epi8(block, b)),
+                             _mm256_cmpeq_epi8(block, c))));
+    if(mask != 0)
+      return data + __builtin_ctz(mask);
+  }
+
+  return find_any_bytes(data, end, first, second, third);
+
+}
+
+/**
+ * @fn ssize_t ByteScan::find_header_end_avx2(const char *data, size_t size)
+ * @brief Method to find "\r\n\r\n", 32 positions at a time.
+ * @param data Data received so far.
+ * @param size Size (in bytes) of the data.
+ * @return Returns the size of the headers (see find_header_end) or -1.
+ *
+ * Built for AVX2 whatever the compiler flags, so it must only be called if
+ * the processor has it.
+ *
+ */
+
+__attribute__((target("avx2")))
+ssize_t ByteScan::find_header_end_avx2(const char *data, size_t size) {
+
+  size_t index = 0;
+  const __m256i cr = _mm256_set1_epi8('\r'), lf = _mm256_set1_epi8('\n');
+  __m256i found;
+  unsigned int mask;
+
+  for(; index + 35 <= size; index += 32) {
+    found = _mm256_and_si256(
+              _mm256_and_si256(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*> (data + index)), cr),
+                _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*> (data + index + 1)), lf)),
+              _mm256_and_si256(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*> (data + index + 2)), cr),
+                _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*> (data + index + 3)), lf)));
+    mask = static_cast<unsigned int> (_mm256_movemask_epi8(found));
+    if(mask != 0)
+      return static_cast<ssize_t> (index + __builtin_ctz(mask) + 4);
+  }
+
+  return find_header_end_bytes(data, size, index);
+
+}
+#endif
+
+/**
+ * @fn const char *ByteScan::find_any_bytes(const char *data, const char *end, char first, char second, char third)
+ * @brief Method to find the first of up to three bytes, one byte at a time.
+ * @param data First byte to be searched.
+ * @param end End of the data.
+ * @param first Byte to look for.
+ * @param second Byte to look for.
+ * @param third Byte to look for.
+ * @return Returns the address of the first byte found, or nullptr.
+ */
+
+const char *ByteScan::find_any_bytes(const char *data, const char *end,
+                                     char first, char second, char third) {
+
+  for(; data < end; data++)
+    if(*data == first || *data == second || *data == third)
+      return data;
+
+  return nullptr;
+
+}
+
+/**
+ * @fn ssize_t ByteScan::find_header_end_bytes(const char *data, size_t size, size_t index)
+ * @brief Method to find "\r\n\r\n", one byte at a time.
+ * @param data Data received so far.
+ * @param size Size (in bytes) of the data.
+ * @param index Position the search starts at.
+ * @return Returns the size of the headers (see find_header_end) or -1.
+ */
+
+ssize_t ByteScan::find_header_end_bytes(const char *data, size_t size,
+                                        size_t index) {
+
+  for(; index + 3 < size; index++)
+    if(data[index] == '\r' && data[index + 1] == '\n' &&
+       data[index + 2] == '\r' && data[index + 3] == '\n')
+      return static_cast<ssize_t> (index + 4);
+
+  return -1;
+
+}
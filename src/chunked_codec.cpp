@@ -0,0 +1,255 @@
+// Chunked codec module - Source code.
+
+/**
+ * @file chunked_codec.cpp
+ * @brief Chunked codec module - Source code.
+ *
+ * The chunked codec module contains the implementation of the decoder that
+ * follows a body sent with the chunked transfer coding as it arrives (finding
+ * its end, its data and its trailer fields) and of the encoder that frames an
+ * edited body again. This source file contains the class method
+ * implementations for this module.
+ *
+ */
+
+// Includes:
+#include "include/chunked_codec.h"
+#include "include/byte_scan.h"
+
+// Public methods:
+
+/**
+ * @fn bool ChunkedCodec::chunked(const QByteArray &codings)
+ * @brief Method to check if a message body is framed by chunks.
+ * @param codings Transfer-Encoding values of the message, joined by commas.
+ * @return Returns true if the last coding applied is chunked.
+ *
+ * Only the last coding frames the body, the others (if any) are left for the
+ * receiver of the message to undo.
+ *
+ */
+
+bool ChunkedCodec::chunked(const QByteArray &codings) {
+
+  return codings.mid(codings.lastIndexOf(',') + 1).trimmed().toLower() == "chunked";
+
+}
+
+/**
+ * @fn size_t ChunkedCodec::decode(chunk_state *state, const char *data, size_t size, QByteArray *body, QByteArray *trailer)
+ * @brief Method to decode the next piece of a chunked body.
+ * @param state State of the body, kept between calls (see reset).
+ * @param data Bytes of the body that arrived since the last call.
+ * @param size Size (in bytes) of the data.
+ * @param body Address to append the data of the chunks to (nullptr to skip
+ * it).
+ * @param trailer Address to append the trailer fields to, as received
+ * (nullptr to skip them).
+ * @return Returns the number of bytes used, which is less than size only if
+ * the body ended (state->step is CHUNK_DONE) or is invalid (CHUNK_ERROR)
+ * before the end of the data.
+ */
+
+size_t ChunkedCodec::decode(chunk_state *state, const char *data, size_t size,
+                            QByteArray *body, QByteArray *trailer) {
+
+  const char *next = data, *end = data + size, *line_end;
+  size_t taken;
+  int digit;
+
+  while(next < end && state->step != CHUNK_DONE && state->step != CHUNK_ERROR) {
+
+    switch(state->step) {
+
+      case CHUNK_SIZE:
+        if((digit = hex_digit(*next)) != -1) {
+          if(++state->digits > CHUNK_SIZE_DIGITS) {
+            state->step = CHUNK_ERROR;
+            break;
+          }
+          state->left = state->left << 4 | static_cast<uint64_t> (digit);
+          next++;
+        }
+        else if(state->digits == 0)
+          state->step = CHUNK_ERROR;
+        else if(*next == '\r' || *next == '\n' || *next == ';' || *next == ' ' || *next == '\t')
+          state->step = CHUNK_EXTENSION;
+        else
+          state->step = CHUNK_ERROR;
+        break;
+
+      // Extensions are not used, the line is only searched for its end:
+      case CHUNK_EXTENSION:
+        if((line_end = ByteScan::find_any(next, static_cast<size_t> (end - next), '\r', '\n', '\n')) == nullptr) {
+          next = end;
+          break;
+        }
+        next = line_end;
+        state->step = CHUNK_SIZE_LF;
+        if(*next == '\r')
+          next++;
+        break;
+
+      case CHUNK_SIZE_LF:
+        if(*next++ != '\n')
+          state->step = CHUNK_ERROR;
+        else if(state->left == 0) {
+          state->step = CHUNK_TRAILER;
+          state->line_start = true;
+        }
+        else
+          state->step = CHUNK_DATA;
+        break;
+
+      case CHUNK_DATA:
+        taken = static_cast<size_t> (end - next);
+        if(taken > state->left)
+          taken = static_cast<size_t> (state->left);
+        if(body != nullptr)
+          body->append(next, static_cast<int> (taken));
+        next += taken;
+        state->left -= taken;
+        state->data_size += taken;
+        if(state->left == 0)
+          state->step = CHUNK_DATA_CR;
+        break;
+
+      case CHUNK_DATA_CR:
+        if(*next == '\r')
+          next++;
+        state->step = CHUNK_DATA_LF;
+        break;
+
+      case CHUNK_DATA_LF:
+        if(*next++ != '\n')
+          state->step = CHUNK_ERROR;
+        else {
+          state->step = CHUNK_SIZE;
+          state->digits = 0;
+        }
+        break;
+
+      // An empty line ends the trailer, other lines are trailer fields:
+      case CHUNK_TRAILER:
+        if(state->line_start && (*next == '\r' || *next == '\n')) {
+          state->step = CHUNK_TRAILER_LF;
+          if(*next == '\r')
+            next++;
+          break;
+        }
+        line_end = ByteScan::find_any(next, static_cast<size_t> (end - next), '\n', '\n', '\n');
+        taken = static_cast<size_t> ((line_end == nullptr ? end : line_end + 1) - next);
+        if(trailer != nullptr)
+          trailer->append(next, static_cast<int> (taken));
+        next += taken;
+        state->line_start = line_end != nullptr;
+        break;
+
+      case CHUNK_TRAILER_LF:
+        state->step = *next++ == '\n' ? CHUNK_DONE : CHUNK_ERROR;
+        break;
+
+      default:
+        break;
+
+    }
+
+  }
+
+  return static_cast<size_t> (next - data);
+
+}
+
+/**
+ * @fn QByteArray ChunkedCodec::decoded(const char *data, size_t size, QByteArray *trailer)
+ * @brief Method to decode a chunked body at once.
+ * @param data Bytes of the body received.
+ * @param size Size (in bytes) of the data.
+ * @param trailer Address to store the trailer fields (nullptr to skip them).
+ * @return Returns the data of the chunks received (up to the framing error,
+ * if the body is invalid).
+ */
+
+QByteArray ChunkedCodec::decoded(const char *data, size_t size,
+                                 QByteArray *trailer) {
+
+  chunk_state state;
+  QByteArray body;
+
+  reset(&state);
+  body.reserve(static_cast<int> (size));
+
+  if(trailer != nullptr)
+    trailer->clear();
+
+  decode(&state, data, size, &body, trailer);
+
+  return body;
+
+}
+
+/**
+ * @fn QByteArray ChunkedCodec::encode(const QByteArray &body, const QByteArray &trailer)
+ * @brief Method to frame a body with the chunked transfer coding.
+ * @param body Data of the body.
+ * @param trailer Trailer fields, as received (each line with its line
+ * ending).
+ * @return Returns the body as a single chunk, followed by the last chunk and
+ * the trailer.
+ */
+
+QByteArray ChunkedCodec::encode(const QByteArray &body,
+                                const QByteArray &trailer) {
+
+  QByteArray framed;
+
+  framed.reserve(body.size() + trailer.size() + 32);
+
+  if(!body.isEmpty())
+    framed += QByteArray::number(body.size(), 16) + "\r\n" + body + "\r\n";
+
+  framed += "0\r\n" + trailer + "\r\n";
+
+  return framed;
+
+}
+
+/**
+ * @fn void ChunkedCodec::reset(chunk_state *state)
+ * @brief Method to prepare the state of a body that did not arrive yet.
+ * @param state State of the body.
+ */
+
+void ChunkedCodec::reset(chunk_state *state) {
+
+  state->step = CHUNK_SIZE;
+  state->left = 0;
+  state->digits = 0;
+  state->line_start = true;
+  state->data_size = 0;
+
+}
+
+// Private methods:
+
+/**
+ * @fn int ChunkedCodec::hex_digit(char byte)
+ * @brief Method to read a hexadecimal digit.
+ * @param byte Byte to be read.
+ * @return Returns the value of the digit, or -1 if the byte is not one.
+ */
+
+int ChunkedCodec::hex_digit(char byte) {
+
+  if(byte >= '0' && byte <= '9')
+    return byte - '0';
+
+  if(byte >= 'a' && byte <= 'f')
+    return byte - 'a' + 10;
+
+  if(byte >= 'A' && byte <= 'F')
+    return byte - 'A' + 10;
+
+  return -1;
+
+}
@@ -0,0 +1,728 @@
+// Disk cache module - Source code.
+
+/**
+ * @file disk_cache.cpp
+ * @brief Disk cache module - Source code.
+ *
+ * The disk cache module contains the implementation of the persistent tier of
+ * the HTTP cache: answers are appended to segment files and found through an
+ * index kept in a memory-mapped hash table, so the cache survives restarts
+ * without being scanned again. This source file contains the class method
+ * implementations for this module.
+ *
+ */
+
+// Includes:
+#include "include/disk_cache.h"
+
+// Class methods:
+
+/**
+ * @fn DiskCache::DiskCache()
+ * @brief Class constructor for the DiskCache class.
+ *
+ * This constructor creates a disabled DiskCache. Call open() to use a
+ * directory.
+ *
+ */
+
+DiskCache::DiskCache() : index_fd(-1),
+                         index_size(0),
+                         budget(0),
+                         write_offset(0),
+                         header(nullptr),
+                         table(nullptr),
+                         queued(0),
+                         stopping(false),
+                         writer(nullptr) {
+
+}
+
+/**
+ * @fn DiskCache::~DiskCache()
+ * @brief Class destructor for the DiskCache class.
+ *
+ * This destructor waits for the answers still queued to be written, flushes
+ * the index to its file and closes every file of the cache, which stays in
+ * the directory for the next run.
+ *
+ */
+
+DiskCache::~DiskCache() {
+
+  if(writer != nullptr) {
+    queue_mutex.lock();
+    stopping = true;
+    queue_ready.wakeOne();
+    queue_mutex.unlock();
+    writer->wait();
+    delete writer;
+  }
+
+  if(header != nullptr) {
+    msync(header, index_size, MS_SYNC);
+    munmap(header, index_size);
+  }
+
+  if(index_fd != -1)
+    close(index_fd);
+
+  for(int fd : segments)
+    close(fd);
+
+}
+
+// Public methods:
+
+/**
+ * @fn bool DiskCache::enabled()
+ * @brief Method to check if the cache has a directory.
+ * @return Returns true if open() succeeded.
+ */
+
+bool DiskCache::enabled() {
+  return header != nullptr;
+}
+
+/**
+ * @fn bool DiskCache::find(QString key, disk_slot *slot)
+ * @brief Method to look an answer up in the index.
+ * @param key URL of the answer.
+ * @param slot Address to store a copy of the slot of the answer.
+ * @return Returns true if the answer is cached.
+ *
+ * The copy stays valid after the answer is replaced or removed, as long as
+ * its segment is not deleted (fetch() then fails).
+ *
+ */
+
+bool DiskCache::find(QString key, disk_slot *slot) {
+
+  QByteArray name = key.toUtf8();
+  disk_slot *found;
+
+  if(!enabled())
+    return false;
+
+  cache_mutex.lock();
+
+  if((found = lookup(hash(name), name)) != nullptr)
+    *slot = *found;
+
+  cache_mutex.unlock();
+
+  return found != nullptr;
+
+}
+
+/**
+ * @fn int DiskCache::fetch(disk_slot *slot, QByteArray *head, QByteArray *body, disk_body *file)
+ * @brief Method to read a cached answer from its segment.
+ * @param slot Slot of the answer (see find()).
+ * @param head Address to store the status line and headers.
+ * @param body Address to store the body (or nullptr).
+ * @param file Address to store the body as a file (or nullptr).
+ * @return Returns 0 when the successfully executed and -1 if an error occurs.
+ *
+ * When file is given, the body is not read: file gets a file descriptor of
+ * its own (which the caller must close), positioned by the offset, so the
+ * body can still be sent after its segment is deleted.
+ *
+ */
+
+int DiskCache::fetch(disk_slot *slot, QByteArray *head, QByteArray *body,
+                     disk_body *file) {
+
+  off_t offset = static_cast<off_t> (slot->offset + slot->key_size);
+  int fd, return_code = -1;
+
+  cache_mutex.lock();
+
+  if((fd = segments.value(slot->segment, -1)) != -1) {
+
+    head->resize(static_cast<int> (slot->head_size));
+
+    if(pread(fd, head->data(), slot->head_size, offset) == static_cast<ssize_t> (slot->head_size)) {
+
+      offset += slot->head_size;
+      return_code = 0;
+
+      if(file != nullptr) {
+        file->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        file->offset = offset;
+        file->size = slot->body_size;
+        return_code = file->fd == -1 ? -1 : 0;
+      }
+
+      else if(body != nullptr) {
+        body->resize(static_cast<int> (slot->body_size));
+        if(pread(fd, body->data(), slot->body_size, offset) != static_cast<ssize_t> (slot->body_size))
+          return_code = -1;
+      }
+
+    }
+
+  }
+
+  cache_mutex.unlock();
+
+  return return_code;
+
+}
+
+/**
+ * @fn int DiskCache::open(QString path, size_t budget)
+ * @brief Method to start using a cache directory.
+ * @param path Directory of the cache (created if missing).
+ * @param budget Disk budget, in bytes.
+ * @return Returns 0 when the successfully executed and -1 if an error occurs.
+ *
+ * An index left by a previous run is mapped and used as it is: the segments
+ * are only opened, never read. An index of another format or for a
+ * different budget is discarded, along with the segments.
+ *
+ * The segment being appended to is never deleted, so a budget smaller than
+ * DISK_SEGMENT_SIZE is raised to it.
+ *
+ * This method should be called before the cache is shared.
+ *
+ */
+
+int DiskCache::open(QString path, size_t budget) {
+
+  quint64 count;
+  struct stat info;
+  void *mapped;
+
+  this->budget = budget < DISK_SEGMENT_SIZE ? DISK_SEGMENT_SIZE : budget;
+  count = this->budget / DISK_SLOT_SHARE < 1024 ? 1024 : this->budget / DISK_SLOT_SHARE;
+  directory = QDir(path);
+  index_size = sizeof(disk_header) + count * sizeof(disk_slot);
+
+  if(!directory.mkpath("."))
+    return -1;
+
+  if((index_fd = ::open(directory.filePath("index").toLocal8Bit().constData(),
+                        O_RDWR | O_CREAT | O_CLOEXEC, 0644)) == -1)
+    return -1;
+
+  if(fstat(index_fd, &info) != 0)
+    return -1;
+
+  // An index of another size is recreated (with zeroes):
+  if(static_cast<size_t> (info.st_size) != index_size &&
+     (ftruncate(index_fd, 0) != 0 || ftruncate(index_fd, static_cast<off_t> (index_size)) != 0))
+    return -1;
+
+  mapped = mmap(nullptr, index_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                index_fd, 0);
+
+  if(mapped == MAP_FAILED)
+    return -1;
+
+  header = static_cast<disk_header*> (mapped);
+  table = reinterpret_cast<disk_slot*> (header + 1);
+
+  // The answers stored from now on are written by the writer thread:
+  writer = new DiskWriter(this);
+  writer->start();
+
+  if(header->magic != DISK_MAGIC || header->version != DISK_VERSION ||
+     header->slot_count != count)
+    return reset();
+
+  // Warm start: segments missing on disk just make their answers misses:
+  for(quint32 number = header->first_segment; number < header->last_segment; number++)
+    open_segment(number, false);
+
+  if(open_segment(header->last_segment, true) == -1 ||
+     fstat(segments.value(header->last_segment), &info) != 0)
+    return reset();
+
+  write_offset = info.st_size;
+
+  return 0;
+
+}
+
+/**
+ * @fn void DiskCache::remove(QString key)
+ * @brief Method to remove an answer from the index.
+ * @param key URL of the answer.
+ *
+ * The answer itself is reclaimed when its segment is deleted.
+ *
+ */
+
+void DiskCache::remove(QString key) {
+
+  QByteArray name = key.toUtf8();
+  disk_slot *found;
+
+  if(!enabled())
+    return;
+
+  cache_mutex.lock();
+
+  if((found = lookup(hash(name), name)) != nullptr) {
+    found->hash = DISK_REMOVED;
+    header->used--;
+    header->removed++;
+  }
+
+  cache_mutex.unlock();
+
+}
+
+/**
+ * @fn void DiskCache::store(QString key, disk_slot meta, QByteArray head, QByteArray body)
+ * @brief Method to keep an answer.
+ * @param key URL of the answer.
+ * @param meta Freshness information of the answer (the other fields are
+ * filled by the writer thread).
+ * @param head Status line and headers of the answer.
+ * @param body Body of the answer.
+ *
+ * The answer is only queued: the writer thread appends it to the last
+ * segment and syncs it before the index points to it (see write_queue()), so
+ * find() misses it until then. Answers are dropped while DISK_QUEUE_SIZE
+ * bytes are waiting, when the disk can not keep up.
+ *
+ */
+
+void DiskCache::store(QString key, disk_slot meta, QByteArray head,
+                      QByteArray body) {
+
+  disk_record record;
+  size_t size;
+
+  record.name = key.toUtf8();
+  size = static_cast<size_t> (record.name.size() + head.size() + body.size());
+
+  if(!enabled() || size > DISK_SEGMENT_SIZE)
+    return;
+
+  record.head = head;
+  record.body = body;
+  record.slot = meta;
+  record.written = false;
+
+  queue_mutex.lock();
+
+  if(queued + size <= DISK_QUEUE_SIZE) {
+    queue.append(record);
+    queued += size;
+    queue_ready.wakeOne();
+  }
+
+  queue_mutex.unlock();
+
+}
+
+/**
+ * @fn int DiskCache::load(disk_body *file, QByteArray *body)
+ * @brief Method to read a body handed out as a file.
+ * @param file Body given by fetch() (its file descriptor is closed).
+ * @param body Address to store the body.
+ * @return Returns 0 when the successfully executed and -1 if an error occurs.
+ */
+
+int DiskCache::load(disk_body *file, QByteArray *body) {
+
+  ssize_t length;
+
+  body->resize(static_cast<int> (file->size));
+  length = pread(file->fd, body->data(), file->size, file->offset);
+
+  close(file->fd);
+  file->fd = -1;
+
+  return length == static_cast<ssize_t> (file->size) ? 0 : -1;
+
+}
+
+// Private methods:
+
+/**
+ * @fn bool DiskCache::append(disk_record *record)
+ * @brief Method to write a queued answer to the last segment.
+ * @param record Answer to be written (its slot gets the segment and the
+ * offset of the record).
+ * @return Returns true if the record was written.
+ *
+ * The space of the record is taken under the cache mutex, but the record is
+ * written without it, so lookups go on meanwhile. Only the writer thread
+ * appends to segments or deletes them, so the segment stays open. The oldest
+ * segments are deleted to stay within the budget and to keep the index at
+ * most 3/4 full.
+ *
+ */
+
+bool DiskCache::append(disk_record *record) {
+
+  off_t size = record->name.size() + record->head.size() + record->body.size();
+  off_t offset;
+  struct iovec parts[3];
+  int fd;
+
+  cache_mutex.lock();
+
+  // Start a new segment when the last one is full:
+  if(write_offset + size > DISK_SEGMENT_SIZE &&
+     open_segment(header->last_segment + 1, true) != -1) {
+    header->last_segment++;
+    write_offset = 0;
+  }
+
+  while(header->first_segment < header->last_segment &&
+        (static_cast<size_t> (header->last_segment - header->first_segment) + 1) * DISK_SEGMENT_SIZE > budget)
+    drop_segment();
+
+  while(header->first_segment < header->last_segment &&
+        (header->used + 1) * 4 > header->slot_count * 3)
+    drop_segment();
+
+  if((header->used + header->removed + 1) * 4 > header->slot_count * 3)
+    rehash();
+
+  fd = segments.value(header->last_segment, -1);
+
+  if((header->used + 1) * 4 > header->slot_count * 3 || fd == -1 ||
+     write_offset + size > DISK_SEGMENT_SIZE) {
+    cache_mutex.unlock();
+    return false;
+  }
+
+  offset = write_offset;
+  write_offset += size;
+  record->slot.segment = header->last_segment;
+  record->slot.offset = static_cast<quint64> (offset);
+
+  cache_mutex.unlock();
+
+  parts[0].iov_base = record->name.data();
+  parts[0].iov_len = static_cast<size_t> (record->name.size());
+  parts[1].iov_base = record->head.data();
+  parts[1].iov_len = static_cast<size_t> (record->head.size());
+  parts[2].iov_base = record->body.data();
+  parts[2].iov_len = static_cast<size_t> (record->body.size());
+
+  return pwritev(fd, parts, 3, offset) == size;
+
+}
+
+/**
+ * @fn bool DiskCache::matches(disk_slot *slot, QByteArray name)
+ * @brief Method to check the key of a slot whose hash matches.
+ * @param slot Slot to be checked.
+ * @param name Key looked up (UTF-8).
+ * @return Returns true if the record of the slot has the key.
+ */
+
+bool DiskCache::matches(disk_slot *slot, QByteArray name) {
+
+  QByteArray stored(name.size(), '\0');
+  int fd = segments.value(slot->segment, -1);
+
+  return fd != -1 && slot->key_size == static_cast<quint32> (name.size()) &&
+         pread(fd, stored.data(), slot->key_size, static_cast<off_t> (slot->offset)) == name.size() &&
+         stored == name;
+
+}
+
+/**
+ * @fn disk_slot *DiskCache::lookup(quint64 name_hash, QByteArray name)
+ * @brief Method to find the slot of a key.
+ * @param name_hash Hash of the key.
+ * @param name Key (UTF-8).
+ * @return Returns the slot or nullptr if the key is not in the index.
+ *
+ * The cache mutex must be locked by the caller.
+ *
+ */
+
+disk_slot *DiskCache::lookup(quint64 name_hash, QByteArray name) {
+
+  quint64 index = name_hash % header->slot_count;
+
+  for(quint64 i = 0; i < header->slot_count && table[index].hash != DISK_FREE; i++) {
+    if(table[index].hash == name_hash && matches(&(table[index]), name))
+      return &(table[index]);
+    index = (index + 1) % header->slot_count;
+  }
+
+  return nullptr;
+
+}
+
+/**
+ * @fn int DiskCache::open_segment(quint32 number, bool create)
+ * @brief Method to open a segment file.
+ * @param number Number of the segment.
+ * @param create True to create the segment if it is missing.
+ * @return Returns the file descriptor of the segment and -1 if an error
+ * occurs.
+ */
+
+int DiskCache::open_segment(quint32 number, bool create) {
+
+  int fd = ::open(directory.filePath(segment_name(number)).toLocal8Bit().constData(),
+                  O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0), 0644);
+
+  if(fd != -1)
+    segments.insert(number, fd);
+
+  return fd;
+
+}
+
+/**
+ * @fn int DiskCache::reset()
+ * @brief Method to empty the cache.
+ * @return Returns 0 when the successfully executed and -1 if an error occurs.
+ *
+ * Every segment is deleted and the index is cleared, with a single empty
+ * segment to append to.
+ *
+ */
+
+int DiskCache::reset() {
+
+  QStringList names = directory.entryList(QStringList() << "segment.*", QDir::Files);
+
+  for(int fd : segments)
+    close(fd);
+
+  segments.clear();
+
+  for(int i = 0; i < names.size(); i++)
+    directory.remove(names[i]);
+
+  memset(header, 0, index_size);
+  header->magic = DISK_MAGIC;
+  header->version = DISK_VERSION;
+  header->slot_count = (index_size - sizeof(disk_header)) / sizeof(disk_slot);
+  write_offset = 0;
+
+  return open_segment(0, true) == -1 ? -1 : 0;
+
+}
+
+/**
+ * @fn void DiskCache::drop_segment()
+ * @brief Method to delete the oldest segment and the answers it holds.
+ *
+ * The cache mutex must be locked by the caller.
+ *
+ */
+
+void DiskCache::drop_segment() {
+
+  quint32 number = header->first_segment;
+
+  for(quint64 i = 0; i < header->slot_count; i++) {
+    if(table[i].hash > DISK_REMOVED && table[i].segment == number) {
+      table[i].hash = DISK_REMOVED;
+      header->used--;
+      header->removed++;
+    }
+  }
+
+  if(segments.contains(number))
+    close(segments.take(number));
+
+  directory.remove(segment_name(number));
+  header->first_segment++;
+
+}
+
+/**
+ * @fn void DiskCache::publish(disk_record *record)
+ * @brief Method to point the index to a written answer.
+ * @param record Answer written to its segment (see append()).
+ *
+ * The slot of the key is replaced, or the first empty one is taken. The
+ * answer is skipped if its segment was deleted meanwhile or if the index is
+ * full. The cache mutex must be locked by the caller.
+ *
+ */
+
+void DiskCache::publish(disk_record *record) {
+
+  quint64 name_hash = hash(record->name), index;
+  disk_slot *slot;
+
+  if(record->slot.segment < header->first_segment)
+    return;
+
+  // Replace the slot of the key, or take the first empty one:
+  if((slot = lookup(name_hash, record->name)) == nullptr) {
+
+    if((header->used + 1) * 4 > header->slot_count * 3)
+      return;
+
+    for(index = name_hash % header->slot_count; table[index].hash > DISK_REMOVED;
+        index = (index + 1) % header->slot_count);
+
+    slot = &(table[index]);
+
+    if(slot->hash == DISK_REMOVED)
+      header->removed--;
+
+    header->used++;
+
+  }
+
+  *slot = record->slot;
+  slot->hash = name_hash;
+  slot->key_size = static_cast<quint32> (record->name.size());
+  slot->head_size = static_cast<quint32> (record->head.size());
+  slot->body_size = static_cast<quint32> (record->body.size());
+
+}
+
+/**
+ * @fn void DiskCache::rehash()
+ * @brief Method to clear the removed slots from the index.
+ *
+ * Removed slots keep the probe sequences going, so they pile up as answers
+ * are removed. The index is rebuilt with the slots in use only. The cache
+ * mutex must be locked by the caller.
+ *
+ */
+
+void DiskCache::rehash() {
+
+  QVector<disk_slot> kept;
+  quint64 index;
+
+  for(quint64 i = 0; i < header->slot_count; i++)
+    if(table[i].hash > DISK_REMOVED)
+      kept.append(table[i]);
+
+  memset(table, 0, header->slot_count * sizeof(disk_slot));
+
+  for(int i = 0; i < kept.size(); i++) {
+    for(index = kept[i].hash % header->slot_count; table[index].hash != DISK_FREE;
+        index = (index + 1) % header->slot_count);
+    table[index] = kept[i];
+  }
+
+  header->used = static_cast<quint64> (kept.size());
+  header->removed = 0;
+
+}
+
+/**
+ * @fn void DiskCache::write_queue()
+ * @brief Method run by the writer thread to write the queued answers.
+ *
+ * The answers queued meanwhile are written together, then each segment
+ * written is synced (fdatasync) before the index points to them, so the
+ * index never points to data that did not reach the disk (answers of a
+ * segment that failed to sync are not kept). The method returns when the
+ * cache is destroyed, once the queue is empty.
+ *
+ */
+
+void DiskCache::write_queue() {
+
+  QList<disk_record> records;
+  QList<quint32> written, failed;
+  int fd;
+
+  while(true) {
+
+    queue_mutex.lock();
+
+    while(queue.isEmpty() && !stopping)
+      queue_ready.wait(&queue_mutex);
+
+    records = queue;
+    queue.clear();
+    queued = 0;
+
+    queue_mutex.unlock();
+
+    if(records.isEmpty())
+      return;
+
+    for(int i = 0; i < records.size(); i++) {
+      records[i].written = append(&(records[i]));
+      if(records[i].written && !written.contains(records[i].slot.segment))
+        written.append(records[i].slot.segment);
+    }
+
+    // Segments deleted meanwhile are skipped, their answers are not kept:
+    for(int i = 0; i < written.size(); i++)
+      if(written[i] >= header->first_segment &&
+         ((fd = segments.value(written[i], -1)) == -1 || fdatasync(fd) != 0))
+        failed.append(written[i]);
+
+    cache_mutex.lock();
+
+    for(int i = 0; i < records.size(); i++)
+      if(records[i].written && !failed.contains(records[i].slot.segment))
+        publish(&(records[i]));
+
+    cache_mutex.unlock();
+
+    records.clear();
+    written.clear();
+    failed.clear();
+
+  }
+
+}
+
+/**
+ * @fn QString DiskCache::segment_name(quint32 number)
+ * @brief Method to get the file name of a segment.
+ * @param number Number of the segment.
+ * @return Returns the name of the segment file.
+ */
+
+QString DiskCache::segment_name(quint32 number) {
+  return "segment." + QString::number(number);
+}
+
+/**
+ * @fn quint64 DiskCache::hash(QByteArray name)
+ * @brief Method to hash a key (64 bit FNV-1a).
+ * @param name Key (UTF-8).
+ * @return Returns the hash, never DISK_FREE or DISK_REMOVED.
+ */
+
+quint64 DiskCache::hash(QByteArray name) {
+
+  quint64 value = 14695981039346656037ULL;
+
+  for(int i = 0; i < name.size(); i++) {
+    value ^= static_cast<unsigned char> (name[i]);
+    value *= 1099511628211ULL;
+  }
+
+  return value > DISK_REMOVED ? value : value + 2;
+
+}
+
+// DiskWriter class methods:
+
+/**
+ * @fn DiskWriter::DiskWriter(DiskCache *cache)
+ * @brief Class constructor for the DiskWriter class.
+ * @param cache Cache whose queued answers are written.
+ */
+
+DiskWriter::DiskWriter(DiskCache *cache) : cache(cache) {
+
+}
+
+/**
+ * @fn void DiskWriter::run()
+ * @brief Method to write the answers of the cache until it is destroyed.
+ */
+
+void DiskWriter::run() {
+  cache->write_queue();
+}
@@ -0,0 +1,352 @@
+// Gate module - Source code.
+
+/**
+ * @file gate.cpp
+ * @brief Gate module - Source code.
+ *
+ * The gate module contains the implementation of the proxy gate shared by
+ * every Server worker, together with the queue of exchanges parked at it.
+ * This source file contains the class method implementations for this
+ * module.
+ *
+ */
+
+// Includes:
+#include "include/gate.h"
+
+// Class methods:
+
+/**
+ * @fn Gate::Gate()
+ * @brief Class constructor for the Gate class.
+ *
+ * This constructor creates a new instance of the Gate class. The gate starts
+ * closed and free.
+ *
+ */
+
+Gate::Gate() : held(false), opened(false), holder(0), last_ticket(0) {
+  client_edit.headers_edited = client_edit.data_edited = false;
+  website_edit.headers_edited = website_edit.data_edited = false;
+}
+
+/**
+ * @fn Gate::~Gate()
+ * @brief Class destructor for the Gate class.
+ *
+ * This destructor destroys an instance of the Gate class. It is currently
+ * empty!
+ *
+ */
+
+Gate::~Gate() {
+
+}
+
+// Public methods:
+
+/**
+ * @fn bool Gate::acquire(unsigned int worker)
+ * @brief Method used by a worker to own the display of exchanges.
+ * @param worker Identifier of the worker.
+ * @return Returns true if the worker holds the Gate and false if another
+ * worker is holding it.
+ *
+ * Acquiring a Gate already held by the same worker succeeds.
+ *
+ */
+
+bool Gate::acquire(unsigned int worker) {
+
+  bool acquired;
+
+  gate_mutex.lock();
+
+  if(!held) {
+    held = true;
+    holder = worker;
+  }
+
+  acquired = holder == worker;
+
+  gate_mutex.unlock();
+
+  return acquired;
+
+}
+
+/**
+ * @fn bool Gate::let_through(quint64 ticket)
+ * @brief Method used by the user to let a parked exchange through unchanged.
+ * @param ticket Ticket of the exchange.
+ * @return Returns true if the exchange was still parked.
+ *
+ * The exchange is unparked and its worker is woken, so it can resume the
+ * exchange without any user edits.
+ *
+ */
+
+bool Gate::let_through(quint64 ticket) {
+
+  QHash<quint64, unsigned int>::iterator entry;
+  bool found;
+
+  gate_mutex.lock();
+
+  entry = parked.find(ticket);
+  found = entry != parked.end();
+
+  if(found) {
+    released[entry.value()].append(ticket);
+    wake(entry.value());
+    parked.erase(entry);
+  }
+
+  gate_mutex.unlock();
+
+  return found;
+
+}
+
+/**
+ * @fn bool Gate::pass(unsigned int worker, gate_edit *client, gate_edit *website)
+ * @brief Method used by a worker to let its exchange through the Gate.
+ * @param worker Identifier of the worker.
+ * @param client Address to store the user edits of the client request.
+ * @param website Address to store the user edits of the website answer.
+ * @return Returns true if the user opened the Gate for this worker.
+ *
+ * If the user opened the Gate and the worker holds it, the user edits are
+ * copied to the given addresses and the Gate is closed again. The worker
+ * still holds the Gate and should release it once its exchange went through.
+ *
+ */
+
+bool Gate::pass(unsigned int worker, gate_edit *client, gate_edit *website) {
+
+  bool passed;
+
+  gate_mutex.lock();
+
+  passed = opened && held && holder == worker;
+
+  if(passed) {
+    *client = client_edit;
+    *website = website_edit;
+    opened = false;
+  }
+
+  gate_mutex.unlock();
+
+  return passed;
+
+}
+
+/**
+ * @fn quint64 Gate::park(unsigned int worker)
+ * @brief Method used by a worker to park an exchange at the Gate.
+ * @param worker Identifier of the worker.
+ * @return Returns the ticket of the exchange (never 0).
+ */
+
+quint64 Gate::park(unsigned int worker) {
+
+  quint64 ticket;
+
+  gate_mutex.lock();
+  ticket = ++last_ticket;
+  parked.insert(ticket, worker);
+  gate_mutex.unlock();
+
+  return ticket;
+
+}
+
+/**
+ * @fn QList<quint64> Gate::take_released(unsigned int worker)
+ * @brief Method used by a worker to find the exchanges let through by the
+ * user.
+ * @param worker Identifier of the worker.
+ * @return Returns the tickets of the exchanges let through since the last
+ * call.
+ */
+
+QList<quint64> Gate::take_released(unsigned int worker) {
+
+  QList<quint64> tickets;
+
+  gate_mutex.lock();
+  tickets = released.take(worker);
+  gate_mutex.unlock();
+
+  return tickets;
+
+}
+
+/**
+ * @fn void Gate::attach(unsigned int worker, int fd)
+ * @brief Method used by a worker to be woken by the Gate.
+ * @param worker Identifier of the worker.
+ * @param fd Eventfd of the worker.
+ *
+ * The Gate adds 1 to the eventfd whenever the worker should look at the Gate
+ * again.
+ *
+ */
+
+void Gate::attach(unsigned int worker, int fd) {
+  gate_mutex.lock();
+  wake_fds.insert(worker, fd);
+  gate_mutex.unlock();
+}
+
+/**
+ * @fn void Gate::detach(unsigned int worker)
+ * @brief Method used by a worker to stop being woken by the Gate.
+ * @param worker Identifier of the worker.
+ *
+ * The exchanges the worker parked are dropped as well.
+ *
+ */
+
+void Gate::detach(unsigned int worker) {
+
+  QHash<quint64, unsigned int>::iterator entry;
+
+  gate_mutex.lock();
+
+  wake_fds.remove(worker);
+  released.remove(worker);
+
+  for(entry = parked.begin(); entry != parked.end();) {
+    if(entry.value() == worker)
+      entry = parked.erase(entry);
+    else
+      ++entry;
+  }
+
+  gate_mutex.unlock();
+
+}
+
+/**
+ * @fn void Gate::load_client_request(gate_edit edit)
+ * @brief Method to load an updated client request into the Gate.
+ * @param edit User edits of the client request.
+ *
+ * This method is used to update the client request to reflect the changes
+ * made by an user. It is called from the MainWindow class after an user edits
+ * the client request.
+ *
+ */
+
+void Gate::load_client_request(gate_edit edit) {
+  gate_mutex.lock();
+  client_edit = edit;
+  client_edit.headers.replace('\n', "\r\n");   // Adjust line endings.
+  gate_mutex.unlock();
+}
+
+/**
+ * @fn void Gate::load_website_request(gate_edit edit)
+ * @brief Method to load an updated website request into the Gate.
+ * @param edit User edits of the website answer.
+ *
+ * This method is used to update the website request to reflect the changes
+ * made by an user. It is called from the MainWindow class after an user edits
+ * the website request.
+ *
+ */
+
+void Gate::load_website_request(gate_edit edit) {
+  gate_mutex.lock();
+  website_edit = edit;
+  website_edit.headers.replace('\n', "\r\n");   // Adjust line endings.
+  gate_mutex.unlock();
+}
+
+/**
+ * @fn void Gate::open()
+ * @brief Method to open the Gate.
+ *
+ * This method opens the Gate, allowing the exchange on display to be sent to
+ * a website or the client, and wakes the worker holding it. Opening the Gate
+ * while no exchange is on display has no effect.
+ *
+ */
+
+void Gate::open() {
+
+  gate_mutex.lock();
+
+  opened = held;
+
+  if(opened)
+    wake(holder);
+
+  gate_mutex.unlock();
+
+}
+
+/**
+ * @fn void Gate::release(unsigned int worker)
+ * @brief Method used by a worker to stop owning the display of exchanges.
+ * @param worker Identifier of the worker.
+ *
+ * Releasing a Gate held by another worker has no effect. The other workers
+ * are woken, so the next one with a parked exchange can acquire the Gate.
+ *
+ */
+
+void Gate::release(unsigned int worker) {
+
+  gate_mutex.lock();
+
+  if(held && holder == worker) {
+
+    held = false;
+    opened = false;
+
+    for(unsigned int other : wake_fds.keys())
+      if(other != worker)
+        wake(other);
+
+  }
+
+  gate_mutex.unlock();
+
+}
+
+/**
+ * @fn void Gate::unpark(quint64 ticket)
+ * @brief Method used by a worker to remove an exchange from the Gate.
+ * @param ticket Ticket of the exchange.
+ *
+ * A worker unparks an exchange once it goes through the Gate (or is closed).
+ * Unparking an exchange the user let through has no effect.
+ *
+ */
+
+void Gate::unpark(quint64 ticket) {
+  gate_mutex.lock();
+  parked.remove(ticket);
+  gate_mutex.unlock();
+}
+
+// Private methods:
+
+/**
+ * @fn void Gate::wake(unsigned int worker)
+ * @brief Method to wake a worker through its eventfd (see wake_eventfd).
+ * @param worker Identifier of the worker.
+ *
+ * Warning: The gate_mutex must be locked by the caller!
+ *
+ */
+
+void Gate::wake(unsigned int worker) {
+
+  if(wake_fds.contains(worker))
+    wake_eventfd(wake_fds.value(worker));
+
+}
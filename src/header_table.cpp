@@ -0,0 +1,384 @@
+// Header table module - Source code.
+
+/**
+ * @file header_table.cpp
+ * @brief Header table module - Source code.
+ *
+ * The header table module contains the implementation of the table holding
+ * the header fields of an HTTP message, in the order they were received and
+ * looked up regardless of the case of their names. This source file contains
+ * the class method implementations for this module.
+ *
+ */
+
+// Includes:
+#include "include/header_table.h"
+
+// Variables:
+
+/**
+ * @var known_names
+ * @brief Well-known header names, per HeaderId.
+ */
+
+static constexpr const char *known_names[HEADER_IDS] = {
+  "", "Accept", "Accept-Charset", "Accept-Encoding", "Accept-Language",
+  "Accept-Ranges", "Age", "Allow", "Authorization", "Cache-Control",
+  "Connection", "Content-Disposition", "Content-Encoding", "Content-Language",
+  "Content-Length", "Content-Location", "Content-Range", "Content-Type",
+  "Cookie", "Date", "ETag", "Expect", "Expires", "Forwarded", "From", "Host",
+  "If-Match", "If-Modified-Since", "If-None-Match", "If-Range",
+  "If-Unmodified-Since", "Keep-Alive", "Last-Modified", "Link", "Location",
+  "Max-Forwards", "Origin", "Pragma", "Proxy-Authenticate",
+  "Proxy-Authorization", "Proxy-Connection", "Range", "Referer", "Retry-After",
+  "Server", "Set-Cookie", "Strict-Transport-Security", "TE", "Trailer",
+  "Transfer-Encoding", "Upgrade", "User-Agent", "Vary", "Via", "Warning",
+  "WWW-Authenticate", "X-Forwarded-For"
+};
+
+/**
+ * @var known_ids
+ * @brief Perfect hash of the well-known header names, built by the compiler.
+ */
+
+static constexpr TokenTable<HEADER_IDS, HEADER_HASH_BITS, true> known_ids(known_names);
+
+static_assert(known_ids.perfect(), "The well-known header names need a larger hash");
+
+// Class methods:
+
+/**
+ * @fn HeaderTable::HeaderTable()
+ * @brief Class constructor for the HeaderTable class.
+ */
+
+HeaderTable::HeaderTable() {
+
+}
+
+// Public methods:
+
+/**
+ * @fn bool HeaderTable::contains(HeaderId id)
+ * @brief Method to check whether the message has a well-known header.
+ * @param id Identifier of the header.
+ * @return Returns true if the message has the header.
+ */
+
+bool HeaderTable::contains(HeaderId id) const {
+  return find(id, QByteArray(), 0) != -1;
+}
+
+/**
+ * @fn bool HeaderTable::contains(QByteArray name)
+ * @brief Method to check whether the message has a header.
+ * @param name Name of the header (in any case).
+ * @return Returns true if the message has the header.
+ */
+
+bool HeaderTable::contains(QByteArray name) const {
+  return find(identify(name), name, 0) != -1;
+}
+
+/**
+ * @fn const header_field &HeaderTable::at(int index)
+ * @brief Method to get a field of the table.
+ * @param index Position of the field, in the order the fields were added.
+ * @return Returns the field.
+ */
+
+const header_field &HeaderTable::at(int index) const {
+  return fields.at(index);
+}
+
+/**
+ * @fn int HeaderTable::size()
+ * @brief Method to get the number of fields in the table.
+ * @return Returns the number of fields.
+ */
+
+int HeaderTable::size() const {
+  return fields.size();
+}
+
+/**
+ * @fn QByteArray HeaderTable::joined(HeaderId id)
+ * @brief Method to get the combined value of a well-known header.
+ * @param id Identifier of the header.
+ * @return Returns every value of the header, joined by commas (empty if the
+ * message does not have the header).
+ */
+
+QByteArray HeaderTable::joined(HeaderId id) const {
+  return join(id, QByteArray());
+}
+
+/**
+ * @fn QByteArray HeaderTable::joined(QByteArray name)
+ * @brief Method to get the combined value of a header.
+ * @param name Name of the header (in any case).
+ * @return Returns every value of the header, joined by commas (empty if the
+ * message does not have the header).
+ */
+
+QByteArray HeaderTable::joined(QByteArray name) const {
+  return join(identify(name), name);
+}
+
+/**
+ * @fn QByteArray HeaderTable::value(HeaderId id)
+ * @brief Method to get the first value of a well-known header.
+ * @param id Identifier of the header.
+ * @return Returns the value (empty if the message does not have the header).
+ */
+
+QByteArray HeaderTable::value(HeaderId id) const {
+
+  int index = find(id, QByteArray(), 0);
+
+  return index == -1 ? QByteArray() : fields.at(index).value;
+
+}
+
+/**
+ * @fn QByteArray HeaderTable::value(QByteArray name)
+ * @brief Method to get the first value of a header.
+ * @param name Name of the header (in any case).
+ * @return Returns the value (empty if the message does not have the header).
+ */
+
+QByteArray HeaderTable::value(QByteArray name) const {
+
+  int index = find(identify(name), name, 0);
+
+  return index == -1 ? QByteArray() : fields.at(index).value;
+
+}
+
+/**
+ * @fn QList<QByteArray> HeaderTable::values(HeaderId id)
+ * @brief Method to get every value of a well-known header.
+ * @param id Identifier of the header.
+ * @return Returns the values, in the order they were added.
+ */
+
+QList<QByteArray> HeaderTable::values(HeaderId id) const {
+
+  QList<QByteArray> found;
+
+  for(int index = find(id, QByteArray(), 0); index != -1; index = find(id, QByteArray(), index + 1))
+    found.append(fields.at(index).value);
+
+  return found;
+
+}
+
+/**
+ * @fn QList<QByteArray> HeaderTable::values(QByteArray name)
+ * @brief Method to get every value of a header.
+ * @param name Name of the header (in any case).
+ * @return Returns the values, in the order they were added.
+ */
+
+QList<QByteArray> HeaderTable::values(QByteArray name) const {
+
+  HeaderId id = identify(name);
+  QList<QByteArray> found;
+
+  for(int index = find(id, name, 0); index != -1; index = find(id, name, index + 1))
+    found.append(fields.at(index).value);
+
+  return found;
+
+}
+
+/**
+ * @fn void HeaderTable::append(const char *name, int size, QByteArray value)
+ * @brief Method to add a field whose name is still in the received message.
+ * @param name First byte of the name.
+ * @param size Size (in bytes) of the name.
+ * @param value Value of the field.
+ *
+ * Only a name that is not a well-known one in its usual spelling is copied.
+ *
+ */
+
+void HeaderTable::append(const char *name, int size, QByteArray value) {
+
+  header_field field;
+
+  field.id = identify(name, size);
+
+  if(field.id != HEADER_OTHER && memcmp(known_names[field.id], name, static_cast<size_t> (size)) == 0)
+    field.name = this->name(field.id);
+  else
+    field.name = QByteArray(name, size);
+
+  field.value = value;
+  fields.append(field);
+
+}
+
+/**
+ * @fn void HeaderTable::append(QByteArray name, QByteArray value)
+ * @brief Method to add a field.
+ * @param name Name of the field.
+ * @param value Value of the field.
+ */
+
+void HeaderTable::append(QByteArray name, QByteArray value) {
+
+  header_field field;
+
+  field.id = identify(name);
+  field.name = field.id != HEADER_OTHER && name == this->name(field.id) ? this->name(field.id) : name;
+  field.value = value;
+  fields.append(field);
+
+}
+
+/**
+ * @fn void HeaderTable::clear()
+ * @brief Method to remove every field of the table.
+ */
+
+void HeaderTable::clear() {
+  fields.clear();
+}
+
+/**
+ * @fn void HeaderTable::set_value(HeaderId id, QByteArray value)
+ * @brief Method to replace the value of a well-known header.
+ * @param id Identifier of the header.
+ * @param value New value.
+ *
+ * Only the first value of the header is replaced. A header the message does
+ * not have is added, with its usual spelling.
+ *
+ */
+
+void HeaderTable::set_value(HeaderId id, QByteArray value) {
+
+  int index = find(id, QByteArray(), 0);
+
+  if(index == -1)
+    append(name(id), value);
+  else
+    fields[index].value = value;
+
+}
+
+/**
+ * @fn HeaderId HeaderTable::identify(const char *name, int size)
+ * @brief Method to find the identifier of a header name.
+ * @param name First byte of the name.
+ * @param size Size (in bytes) of the name.
+ * @return Returns the identifier (HEADER_OTHER if the name is not a
+ * well-known one).
+ */
+
+HeaderId HeaderTable::identify(const char *name, int size) {
+
+  int id = known_ids.find(name, size);
+
+  return id == -1 ? HEADER_OTHER : static_cast<HeaderId> (id);
+
+}
+
+/**
+ * @fn HeaderId HeaderTable::identify(QByteArray name)
+ * @brief Method to find the identifier of a header name.
+ * @param name Name of the header (in any case).
+ * @return Returns the identifier (HEADER_OTHER if the name is not a
+ * well-known one).
+ */
+
+HeaderId HeaderTable::identify(QByteArray name) {
+  return identify(name.constData(), name.size());
+}
+
+/**
+ * @fn const QByteArray &HeaderTable::name(HeaderId id)
+ * @brief Method to get the usual spelling of a well-known header name.
+ * @param id Identifier of the header.
+ * @return Returns the name (empty for HEADER_OTHER), shared by every table
+ * without being copied.
+ */
+
+const QByteArray &HeaderTable::name(HeaderId id) {
+
+  // Built on the first call (which is thread safe):
+  static const QVector<QByteArray> names = intern_names();
+
+  return names[id];
+
+}
+
+// Private methods:
+
+/**
+ * @fn QByteArray HeaderTable::join(HeaderId id, QByteArray name)
+ * @brief Method to join every value of a header.
+ * @param id Identifier of the header (HEADER_OTHER to compare the names).
+ * @param name Name of the header, compared when it is not a well-known one.
+ * @return Returns the values, joined by commas.
+ */
+
+QByteArray HeaderTable::join(HeaderId id, QByteArray name) const {
+
+  QByteArray all;
+  int index = find(id, name, 0);
+
+  while(index != -1) {
+    all += fields.at(index).value;
+    if((index = find(id, name, index + 1)) != -1)
+      all += ", ";
+  }
+
+  return all;
+
+}
+
+/**
+ * @fn int HeaderTable::find(HeaderId id, QByteArray name, int from)
+ * @brief Method to find a field of a header.
+ * @param id Identifier of the header (HEADER_OTHER to compare the names).
+ * @param name Name of the header, compared when it is not a well-known one.
+ * @param from Position where the search starts.
+ * @return Returns the position of the field, or -1 if there is none.
+ */
+
+int HeaderTable::find(HeaderId id, QByteArray name, int from) const {
+
+  for(int index = from; index < fields.size(); index++) {
+
+    if(fields.at(index).id != id)
+      continue;
+
+    if(id != HEADER_OTHER || (fields.at(index).name.size() == name.size() &&
+                              strncasecmp(fields.at(index).name.constData(), name.constData(),
+                                          static_cast<size_t> (name.size())) == 0))
+      return index;
+
+  }
+
+  return -1;
+
+}
+
+/**
+ * @fn QVector<QByteArray> HeaderTable::intern_names()
+ * @brief Method to wrap the well-known header names into QByteArrays.
+ * @return Returns the names, per HeaderId (referring to known_names).
+ */
+
+QVector<QByteArray> HeaderTable::intern_names() {
+
+  QVector<QByteArray> names;
+
+  for(int id = 0; id < HEADER_IDS; id++)
+    names.append(QByteArray::fromRawData(known_names[id], static_cast<int> (strlen(known_names[id]))));
+
+  return names;
+
+}
@@ -0,0 +1,934 @@
+// HTTP cache module - Source code.
+
+/**
+ * @file http_cache.cpp
+ * @brief HTTP cache module - Source code.
+ *
+ * The HTTP cache module contains the implementation of an in-memory cache of
+ * website answers shared by every Server worker, following the HTTP caching
+ * rules (RFC 9111) of a shared cache. This source file contains the class
+ * method implementations for this module.
+ *
+ */
+
+// Includes:
+#include "include/http_cache.h"
+
+// Class methods:
+
+/**
+ * @fn HTTPCache::HTTPCache(size_t budget)
+ * @brief Class constructor for the HTTPCache class.
+ * @param budget Memory budget of the cache, in bytes (0 disables the cache).
+ */
+
+HTTPCache::HTTPCache(size_t budget) : budget(budget) {
+  probation.first = probation.last = nullptr;
+  probation.used = 0;
+  protection.first = protection.last = nullptr;
+  protection.used = 0;
+}
+
+/**
+ * @fn HTTPCache::~HTTPCache()
+ * @brief Class destructor for the HTTPCache class.
+ *
+ * This destructor frees every cached answer.
+ *
+ */
+
+HTTPCache::~HTTPCache() {
+
+  for(QList<cache_entry*> &variants : entries)
+    for(cache_entry *entry : variants)
+      delete entry;
+
+}
+
+// Public methods:
+
+/**
+ * @fn bool HTTPCache::enabled()
+ * @brief Method to check if the cache keeps any answer.
+ * @return Returns true if the cache has a memory budget or a disk tier.
+ */
+
+bool HTTPCache::enabled() {
+  return budget > 0 || disk.enabled();
+}
+
+/**
+ * @fn bool HTTPCache::join(QString key, unsigned int worker, void *waiter)
+ * @brief Method to collapse a request missing the cache into an identical
+ * one in flight.
+ * @param key URL of the request (see key()).
+ * @param worker Identifier of the worker of the session.
+ * @param waiter Session of the request.
+ * @return Returns true if the session must wait for the answer to land and
+ * false if it leads a new flight (it must fetch the answer and call land()).
+ *
+ * Once the answer lands, take_landed() hands the session back to its worker,
+ * which looks the request up again.
+ *
+ */
+
+bool HTTPCache::join(QString key, unsigned int worker, void *waiter) {
+
+  QHash<QString, QList<cache_waiter>>::iterator flight;
+  cache_waiter joined = {worker, waiter};
+
+  flight_mutex.lock();
+
+  if((flight = flights.find(key)) == flights.end()) {
+    flights.insert(key, QList<cache_waiter>());
+    flight_mutex.unlock();
+    return false;
+  }
+
+  flight.value().append(joined);
+  flight_mutex.unlock();
+
+  stats.collapsed.fetchAndAddRelaxed(1);
+
+  return true;
+
+}
+
+/**
+ * @fn int HTTPCache::open_disk(QString path, size_t budget)
+ * @brief Method to add a persistent tier to the cache.
+ * @param path Directory of the disk cache.
+ * @param budget Disk budget, in bytes.
+ * @return Returns 0 when the successfully executed and -1 if an error occurs.
+ *
+ * This method should be called before the cache is shared.
+ *
+ */
+
+int HTTPCache::open_disk(QString path, size_t budget) {
+  return disk.open(path, budget);
+}
+
+/**
+ * @fn CacheResult HTTPCache::lookup(QString key, const Headers *request, QByteArray *answer, disk_body *body, QString *etag, QString *last_modified)
+ * @brief Method to look the answer to a request up in the cache.
+ * @param key URL of the request (see key()).
+ * @param request Headers of the request.
+ * @param answer Address to store the cached answer.
+ * @param body Address to store the body of a hit kept on disk (its file
+ * descriptor is -1 otherwise).
+ * @param etag Address to store the entity tag of a stale answer.
+ * @param last_modified Address to store the Last-Modified date of a stale
+ * answer.
+ * @return Returns CACHE_HIT if the answer is fresh, CACHE_STALE if it has to
+ * be revalidated and CACHE_MISS if there is no usable answer.
+ *
+ * The answer of a hit carries its current Age. The no-cache, max-age and
+ * min-fresh directives of the request (and a 'Pragma: no-cache' header) are
+ * honored; stale answers are never served, so max-stale is ignored.
+ *
+ * Answers missing from memory are looked up on disk. The answer of a disk
+ * hit is just the status line and headers: its body is left in its segment
+ * for sendfile (see DiskCache::fetch()).
+ *
+ */
+
+CacheResult HTTPCache::lookup(QString key, const Headers *request,
+                              QByteArray *answer, disk_body *body,
+                              QString *etag, QString *last_modified) {
+
+  QHash<QString, QString> wanted = directives(request);
+  cache_entry *entry;
+  long long age;
+
+  body->fd = -1;
+
+  if(wanted.contains("no-store")) {
+    stats.misses.fetchAndAddRelaxed(1);
+    return CACHE_MISS;
+  }
+
+  cache_mutex.lock();
+
+  if((entry = find(key, request)) == nullptr) {
+    cache_mutex.unlock();
+    return lookup_disk(key, request, wanted, answer, body, etag,
+                       last_modified);
+  }
+
+  age = entry->initial_age + time(nullptr) - entry->response_time;
+
+  if(fresh(wanted, request, age, entry->lifetime, entry->no_cache)) {
+    touch(entry);
+    *answer = set_header(entry->head, "Age", QString::number(age)) + entry->body;
+    stats.hits.fetchAndAddRelaxed(1);
+    stats.saved_bytes.fetchAndAddRelaxed(static_cast<quint64> (entry->body.size()));
+    cache_mutex.unlock();
+    return CACHE_HIT;
+  }
+
+  stats.misses.fetchAndAddRelaxed(1);
+
+  // Without a validator, the website has to send the answer again:
+  if(entry->etag.isEmpty() && entry->last_modified.isEmpty()) {
+    cache_mutex.unlock();
+    return CACHE_MISS;
+  }
+
+  *answer = entry->head + entry->body;
+  *etag = entry->etag;
+  *last_modified = entry->last_modified;
+
+  cache_mutex.unlock();
+
+  return CACHE_STALE;
+
+}
+
+/**
+ * @fn CacheStats *HTTPCache::get_stats()
+ * @brief Method to access the counters of the cache.
+ * @return Returns the address of the cache counters.
+ */
+
+CacheStats *HTTPCache::get_stats() {
+  return &stats;
+}
+
+/**
+ * @fn QByteArray HTTPCache::refresh(QString key, const Headers *request, QByteArray stale, QByteArray validation)
+ * @brief Method to refresh a stale answer the website confirmed.
+ * @param key URL of the request (see key()).
+ * @param request Headers of the request.
+ * @param stale Stale answer returned by lookup().
+ * @param validation Not Modified (304) answer of the website.
+ * @return Returns the refreshed answer, to be sent to the client.
+ *
+ * The headers of the 304 answer replace the ones of the stale answer (except
+ * for the framing and hop-by-hop headers), and the refreshed answer is stored
+ * again.
+ *
+ */
+
+QByteArray HTTPCache::refresh(QString key, const Headers *request, QByteArray stale,
+                              QByteArray validation) {
+
+  QStringList kept = QStringList() << "content-length" << "transfer-encoding"
+                                   << "connection" << "keep-alive"
+                                   << "set-cookie";
+  Headers validated = parse_head(validation);
+  int split = stale.indexOf("\r\n\r\n") + 4;
+  QByteArray head = set_header(stale.left(split), "Age", "0");
+  QByteArray body = stale.mid(split);
+  QString name;
+
+  // A header given more than once is set once, with all of its values:
+  for(int i = 0; i < validated.size(); i++) {
+    name = QString::fromLatin1(validated.at(i).name);
+    if(!kept.contains(name.toLower())) {
+      head = set_header(head, name, QString::fromLatin1(validated.joined(name.toLatin1())));
+      kept << name.toLower();
+    }
+  }
+
+  stats.revalidations.fetchAndAddRelaxed(1);
+  stats.saved_bytes.fetchAndAddRelaxed(static_cast<quint64> (body.size()));
+
+  store(key, request, head + body);
+
+  return head + body;
+
+}
+
+/**
+ * @fn QList<void*> HTTPCache::take_landed(unsigned int worker)
+ * @brief Method used by a worker to take its sessions whose answer landed.
+ * @param worker Identifier of the worker.
+ * @return Returns the sessions that waited for a flight that landed since
+ * the last call.
+ */
+
+QList<void*> HTTPCache::take_landed(unsigned int worker) {
+
+  QList<void*> waiters;
+
+  flight_mutex.lock();
+  waiters = landed.take(worker);
+  flight_mutex.unlock();
+
+  return waiters;
+
+}
+
+/**
+ * @fn void HTTPCache::attach(unsigned int worker, int fd)
+ * @brief Method used by a worker to be woken when an answer lands.
+ * @param worker Identifier of the worker.
+ * @param fd Eventfd of the worker.
+ */
+
+void HTTPCache::attach(unsigned int worker, int fd) {
+  flight_mutex.lock();
+  wake_fds.insert(worker, fd);
+  flight_mutex.unlock();
+}
+
+/**
+ * @fn void HTTPCache::detach(unsigned int worker)
+ * @brief Method used by a worker to stop being woken by the cache.
+ * @param worker Identifier of the worker.
+ *
+ * The sessions of the worker waiting for a flight are dropped as well.
+ *
+ */
+
+void HTTPCache::detach(unsigned int worker) {
+
+  flight_mutex.lock();
+
+  wake_fds.remove(worker);
+  landed.remove(worker);
+
+  for(QList<cache_waiter> &waiters : flights)
+    for(int i = waiters.size() - 1; i >= 0; i--)
+      if(waiters[i].worker == worker)
+        waiters.removeAt(i);
+
+  flight_mutex.unlock();
+
+}
+
+/**
+ * @fn void HTTPCache::invalidate(QString key)
+ * @brief Method to drop every cached variant of a URL.
+ * @param key URL of the answers (see key()).
+ *
+ * This method is called when an unsafe request (like POST) succeeds, since
+ * it may have changed the resource (RFC 9111, section 4.4).
+ *
+ */
+
+void HTTPCache::invalidate(QString key) {
+
+  cache_mutex.lock();
+
+  for(cache_entry *entry : entries.take(key)) {
+    unlink(entry);
+    delete entry;
+  }
+
+  cache_mutex.unlock();
+
+  disk.remove(key);
+
+}
+
+/**
+ * @fn void HTTPCache::land(QString key)
+ * @brief Method used by the session leading a flight once it has an answer.
+ * @param key URL of the flight.
+ *
+ * This method is called once the answer was stored, or when it turns out it
+ * will not be (the answer can not be cached or the request failed). The
+ * workers of the waiting sessions are woken, so they look the request up
+ * again.
+ *
+ */
+
+void HTTPCache::land(QString key) {
+
+  flight_mutex.lock();
+
+  for(cache_waiter joined : flights.take(key)) {
+    landed[joined.worker].append(joined.waiter);
+    wake(joined.worker);
+  }
+
+  flight_mutex.unlock();
+
+}
+
+/**
+ * @fn void HTTPCache::leave(QString key, unsigned int worker, void *waiter)
+ * @brief Method used by a worker to drop a session waiting for a flight.
+ * @param key URL of the flight.
+ * @param worker Identifier of the worker.
+ * @param waiter Session being closed.
+ */
+
+void HTTPCache::leave(QString key, unsigned int worker, void *waiter) {
+
+  QHash<QString, QList<cache_waiter>>::iterator flight;
+
+  flight_mutex.lock();
+
+  if((flight = flights.find(key)) != flights.end())
+    for(int i = flight.value().size() - 1; i >= 0; i--)
+      if(flight.value()[i].worker == worker && flight.value()[i].waiter == waiter)
+        flight.value().removeAt(i);
+
+  if(landed.contains(worker))
+    landed[worker].removeAll(waiter);
+
+  flight_mutex.unlock();
+
+}
+
+/**
+ * @fn void HTTPCache::store(QString key, const Headers *request, QByteArray answer)
+ * @brief Method to keep the answer to a GET request.
+ * @param key URL of the request (see key()).
+ * @param request Headers of the request.
+ * @param answer Whole answer (headers and body).
+ *
+ * Answers a shared cache may not keep, or that could never be used again
+ * (no freshness lifetime and no validator), are ignored. Only the status
+ * codes cacheable by default are kept. The cached variant with the same
+ * Vary values, if any, is replaced.
+ *
+ */
+
+void HTTPCache::store(QString key, const Headers *request, QByteArray answer) {
+
+  QStringList cacheable = QStringList() << "200" << "203" << "204" << "300"
+                                        << "301" << "308" << "404" << "405"
+                                        << "410" << "414" << "501";
+  int split = answer.indexOf("\r\n\r\n") + 4;
+  QByteArray head = answer.left(split);
+  Headers headers = parse_head(head);
+  QHash<QString, QString> wanted = directives(request);
+  QHash<QString, QString> given = directives(&headers);
+  QString code = QString::fromLatin1(head.left(head.indexOf("\r\n"))).section(' ', 1, 1);
+  QStringList vary, values;
+  cache_entry *entry, *old;
+  disk_slot slot;
+  long long now = time(nullptr), date, expires, modified, lifetime = 0;
+
+  if(!enabled() || split < 4 || !cacheable.contains(code))
+    return;
+
+  // A shared cache can not keep these answers:
+  if(wanted.contains("no-store") || given.contains("no-store") ||
+     given.contains("private") || !headers.joined(HEADER_SET_COOKIE).isEmpty())
+    return;
+
+  if(!request->joined(HEADER_AUTHORIZATION).isEmpty() && !given.contains("public") &&
+     !given.contains("s-maxage") && !given.contains("must-revalidate"))
+    return;
+
+  vary = QString::fromLatin1(headers.joined(HEADER_VARY)).toLower().split(',');
+
+  for(int i = 0; i < vary.size(); i++)
+    vary[i] = vary[i].trimmed();
+
+  vary.removeAll("");
+
+  if(!vary_values(vary, request, &values))
+    return;
+
+  // Freshness lifetime (RFC 9111, section 4.2.1):
+  if((date = parse_date(QString::fromLatin1(headers.joined(HEADER_DATE)))) == -1)
+    date = now;
+
+  if(given.contains("s-maxage"))
+    lifetime = given["s-maxage"].toLongLong();
+
+  else if(given.contains("max-age"))
+    lifetime = given["max-age"].toLongLong();
+
+  else if(!headers.joined(HEADER_EXPIRES).isEmpty())
+    lifetime = (expires = parse_date(QString::fromLatin1(headers.joined(HEADER_EXPIRES)))) == -1 ? 0 : expires - date;
+
+  else if((modified = parse_date(QString::fromLatin1(headers.joined(HEADER_LAST_MODIFIED)))) != -1 && modified < date)
+    lifetime = qMin((date - modified) * CACHE_HEURISTIC_SHARE / 100,
+                    static_cast<long long> (CACHE_HEURISTIC_MAX));
+
+  entry = new cache_entry;
+  entry->key = key;
+  entry->head = head;
+  entry->body = answer.mid(split);
+  entry->vary = vary;
+  entry->vary_values = values;
+  entry->etag = QString::fromLatin1(headers.joined(HEADER_ETAG));
+  entry->last_modified = QString::fromLatin1(headers.joined(HEADER_LAST_MODIFIED));
+  entry->response_time = now;
+  entry->initial_age = qMax(qMax(now - date, 0LL), headers.joined(HEADER_AGE).toLongLong());
+  entry->lifetime = qMax(lifetime, 0LL);
+  entry->no_cache = given.contains("no-cache");
+  entry->size = sizeof(cache_entry) + static_cast<size_t> (answer.size() + key.size() * 2);
+
+  if(entry->lifetime == 0 && entry->etag.isEmpty() && entry->last_modified.isEmpty()) {
+    delete entry;
+    return;
+  }
+
+  // The disk tier keys answers by URL only, so variants stay in memory:
+  if(disk.enabled() && vary.isEmpty()) {
+    slot = {};
+    slot.response_time = entry->response_time;
+    slot.initial_age = entry->initial_age;
+    slot.lifetime = entry->lifetime;
+    slot.no_cache = entry->no_cache ? 1 : 0;
+    slot.validated = entry->etag.isEmpty() && entry->last_modified.isEmpty() ? 0 : 1;
+    disk.store(key, slot, head, entry->body);
+  }
+
+  if(static_cast<size_t> (answer.size()) > budget / CACHE_OBJECT_SHARE) {
+    delete entry;
+    return;
+  }
+
+  cache_mutex.lock();
+
+  if((old = find(key, request)) != nullptr)
+    remove(old);
+
+  entries[key].append(entry);
+  link(entry, false);
+  evict();
+
+  cache_mutex.unlock();
+
+}
+
+/**
+ * @fn QString HTTPCache::key(QString url, QString host)
+ * @brief Method to find the cache key of a request.
+ * @param url URL of the request (absolute or just the path).
+ * @param host Value of the Host header.
+ * @return Returns the absolute URL of the request, with the scheme and host
+ * in lower case.
+ */
+
+QString HTTPCache::key(QString url, QString host) {
+
+  int start;
+
+  if(url.startsWith('/'))
+    return "http://" + host.toLower() + url;
+
+  if((start = url.indexOf('/', url.indexOf("://") + 3)) == -1)
+    return url.toLower() + "/";
+
+  return url.left(start).toLower() + url.mid(start);
+
+}
+
+// Private methods:
+
+/**
+ * @fn CacheResult HTTPCache::lookup_disk(QString key, const Headers *request, QHash<QString, QString> wanted, QByteArray *answer, disk_body *body, QString *etag, QString *last_modified)
+ * @brief Method to look the answer to a request up in the disk tier.
+ * @param key URL of the request.
+ * @param request Headers of the request.
+ * @param wanted Cache-Control directives of the request.
+ * @param answer Address to store the status line and headers of a hit, or
+ * the whole stale answer.
+ * @param body Address to store the body of a hit.
+ * @param etag Address to store the entity tag of a stale answer.
+ * @param last_modified Address to store the Last-Modified date of a stale
+ * answer.
+ * @return Returns the result of the lookup, as lookup().
+ */
+
+CacheResult HTTPCache::lookup_disk(QString key, const Headers *request,
+                                   QHash<QString, QString> wanted,
+                                   QByteArray *answer, disk_body *body,
+                                   QString *etag, QString *last_modified) {
+
+  QByteArray head, rest;
+  Headers headers;
+  disk_slot slot;
+  long long age;
+
+  if(!disk.find(key, &slot)) {
+    stats.misses.fetchAndAddRelaxed(1);
+    return CACHE_MISS;
+  }
+
+  age = slot.initial_age + time(nullptr) - slot.response_time;
+
+  if(fresh(wanted, request, age, slot.lifetime, slot.no_cache != 0) &&
+     disk.fetch(&slot, &head, nullptr, body) == 0) {
+    *answer = set_header(head, "Age", QString::number(age));
+    stats.hits.fetchAndAddRelaxed(1);
+    stats.disk_hits.fetchAndAddRelaxed(1);
+    stats.saved_bytes.fetchAndAddRelaxed(slot.body_size);
+    return CACHE_HIT;
+  }
+
+  stats.misses.fetchAndAddRelaxed(1);
+
+  if(slot.validated == 0 || disk.fetch(&slot, &head, &rest, nullptr) != 0)
+    return CACHE_MISS;
+
+  headers = parse_head(head);
+  *answer = head + rest;
+  *etag = QString::fromLatin1(headers.joined(HEADER_ETAG));
+  *last_modified = QString::fromLatin1(headers.joined(HEADER_LAST_MODIFIED));
+
+  return CACHE_STALE;
+
+}
+
+/**
+ * @fn cache_entry *HTTPCache::find(QString key, const Headers *request)
+ * @brief Method to find the cached variant matching a request.
+ * @param key URL of the request.
+ * @param request Headers of the request.
+ * @return Returns the cached variant or nullptr if there is none.
+ *
+ * The cache mutex must be locked by the caller.
+ *
+ */
+
+cache_entry *HTTPCache::find(QString key, const Headers *request) {
+
+  QHash<QString, QList<cache_entry*>>::iterator variants = entries.find(key);
+  QStringList values;
+
+  if(variants == entries.end())
+    return nullptr;
+
+  for(cache_entry *entry : variants.value()) {
+    values.clear();
+    if(vary_values(entry->vary, request, &values) && values == entry->vary_values)
+      return entry;
+  }
+
+  return nullptr;
+
+}
+
+/**
+ * @fn void HTTPCache::evict()
+ * @brief Method to drop the least recently used entries over the budget.
+ *
+ * Entries are dropped from the probationary segment first. The cache mutex
+ * must be locked by the caller.
+ *
+ */
+
+void HTTPCache::evict() {
+
+  while(probation.used + protection.used > budget)
+    remove(probation.last != nullptr ? probation.last : protection.last);
+
+}
+
+/**
+ * @fn void HTTPCache::link(cache_entry *entry, bool protect)
+ * @brief Method to add an entry to the front of a segment.
+ * @param entry Entry to be added.
+ * @param protect True for the protected segment, false for the probationary
+ * one.
+ */
+
+void HTTPCache::link(cache_entry *entry, bool protect) {
+
+  cache_segment *segment = protect ? &protection : &probation;
+
+  entry->protect = protect;
+  entry->prev = nullptr;
+  entry->next = segment->first;
+
+  if(segment->first != nullptr)
+    segment->first->prev = entry;
+  else
+    segment->last = entry;
+
+  segment->first = entry;
+  segment->used += entry->size;
+  stats.stored_bytes.fetchAndAddRelaxed(entry->size);
+
+}
+
+/**
+ * @fn void HTTPCache::remove(cache_entry *entry)
+ * @brief Method to drop an entry from the cache.
+ * @param entry Entry to be dropped.
+ */
+
+void HTTPCache::remove(cache_entry *entry) {
+
+  QHash<QString, QList<cache_entry*>>::iterator variants = entries.find(entry->key);
+
+  variants.value().removeOne(entry);
+
+  if(variants.value().isEmpty())
+    entries.erase(variants);
+
+  unlink(entry);
+  delete entry;
+
+}
+
+/**
+ * @fn void HTTPCache::touch(cache_entry *entry)
+ * @brief Method to mark an entry as used.
+ * @param entry Entry used.
+ *
+ * The entry moves to the front of the protected segment. Entries that no
+ * longer fit in the protected share of the budget go back to the front of the
+ * probationary segment.
+ *
+ */
+
+void HTTPCache::touch(cache_entry *entry) {
+
+  cache_entry *demoted;
+
+  unlink(entry);
+  link(entry, true);
+
+  while(protection.used > budget / 100 * CACHE_PROTECTED_SHARE &&
+        protection.last != entry) {
+    demoted = protection.last;
+    unlink(demoted);
+    link(demoted, false);
+  }
+
+}
+
+/**
+ * @fn void HTTPCache::unlink(cache_entry *entry)
+ * @brief Method to take an entry out of its segment.
+ * @param entry Entry to be taken out.
+ */
+
+void HTTPCache::unlink(cache_entry *entry) {
+
+  cache_segment *segment = entry->protect ? &protection : &probation;
+
+  if(entry->prev != nullptr)
+    entry->prev->next = entry->next;
+  else
+    segment->first = entry->next;
+
+  if(entry->next != nullptr)
+    entry->next->prev = entry->prev;
+  else
+    segment->last = entry->prev;
+
+  segment->used -= entry->size;
+  stats.stored_bytes.fetchAndSubRelaxed(entry->size);
+
+}
+
+/**
+ * @fn void HTTPCache::wake(unsigned int worker)
+ * @brief Method to wake a worker through its eventfd (see wake_eventfd).
+ * @param worker Identifier of the worker.
+ *
+ * Warning: The flight_mutex must be locked by the caller!
+ *
+ */
+
+void HTTPCache::wake(unsigned int worker) {
+
+  if(wake_fds.contains(worker))
+    wake_eventfd(wake_fds.value(worker));
+
+}
+
+/**
+ * @fn bool HTTPCache::fresh(QHash<QString, QString> wanted, const Headers *request, long long age, long long lifetime, bool no_cache)
+ * @brief Method to check if a cached answer can be served without
+ * revalidation.
+ * @param wanted Cache-Control directives of the request.
+ * @param request Headers of the request.
+ * @param age Current age (in seconds) of the answer.
+ * @param lifetime Freshness lifetime (in seconds) of the answer.
+ * @param no_cache True if the answer must be revalidated on every use.
+ * @return Returns true if the answer is fresh enough for the request.
+ */
+
+bool HTTPCache::fresh(QHash<QString, QString> wanted, const Headers *request,
+                      long long age, long long lifetime, bool no_cache) {
+
+  if(no_cache || age >= lifetime || wanted.contains("no-cache"))
+    return false;
+
+  if(wanted.isEmpty() && request->joined(HEADER_PRAGMA).contains("no-cache"))
+    return false;
+
+  if(wanted.contains("max-age") && age > wanted["max-age"].toLongLong())
+    return false;
+
+  return !wanted.contains("min-fresh") || lifetime - age >= wanted["min-fresh"].toLongLong();
+
+}
+
+/**
+ * @fn bool HTTPCache::vary_values(QStringList names, const Headers *request, QStringList *values)
+ * @brief Method to gather the values of the headers an answer varies on.
+ * @param names Names of the headers (lower case).
+ * @param request Headers of the request.
+ * @param values Address to append the values.
+ * @return Returns false if the answer varies on every header ('*').
+ */
+
+bool HTTPCache::vary_values(QStringList names, const Headers *request,
+                            QStringList *values) {
+
+  for(int i = 0; i < names.size(); i++) {
+    if(names[i] == "*")
+      return false;
+    values->append(QString::fromLatin1(request->joined(names[i].toLatin1()).simplified()));
+  }
+
+  return true;
+
+}
+
+/**
+ * @fn long long HTTPCache::parse_date(QString value)
+ * @brief Method to parse an HTTP date.
+ * @param value Date, in any of the formats of RFC 9110 (section 5.6.7).
+ * @return Returns the date (in seconds since the epoch) or -1 if it is
+ * invalid.
+ *
+ * The names of the months are always in English, so the C library (which
+ * follows the locale) is not used.
+ *
+ */
+
+long long HTTPCache::parse_date(QString value) {
+
+  QString months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  QStringList fields = value.replace('-', " ").simplified().split(' ');
+  QStringList clock;
+  QString day, month, year;
+  struct tm date = {};
+  int index;
+
+  // 'Sun, 06 Nov 1994 08:49:37 GMT' or 'Sunday, 06-Nov-94 08:49:37 GMT':
+  if(fields.size() == 6 && fields[0].endsWith(',')) {
+    day = fields[1];
+    month = fields[2];
+    year = fields[3];
+    clock = fields[4].split(':');
+  }
+
+  // 'Sun Nov  6 08:49:37 1994':
+  else if(fields.size() == 5) {
+    month = fields[1];
+    day = fields[2];
+    clock = fields[3].split(':');
+    year = fields[4];
+  }
+
+  else
+    return -1;
+
+  if(month.size() != 3 || (index = months.indexOf(month)) % 3 != 0 ||
+     clock.size() != 3)
+    return -1;
+
+  date.tm_mday = day.toInt();
+  date.tm_mon = index / 3;
+  date.tm_year = year.toInt();
+  date.tm_hour = clock[0].toInt();
+  date.tm_min = clock[1].toInt();
+  date.tm_sec = clock[2].toInt();
+
+  // Two digit years (RFC 850):
+  if(date.tm_year < 70)
+    date.tm_year += 2000;
+  else if(date.tm_year < 100)
+    date.tm_year += 1900;
+
+  date.tm_year -= 1900;
+
+  return date.tm_mday > 0 ? static_cast<long long> (timegm(&date)) : -1;
+
+}
+
+/**
+ * @fn QByteArray HTTPCache::set_header(QByteArray head, QString name, QString value)
+ * @brief Method to set a header of an answer.
+ * @param head Status line and headers of the answer (with the empty line).
+ * @param name Name of the header.
+ * @param value New value of the header.
+ * @return Returns the updated status line and headers.
+ *
+ * Every line of the header is replaced by a single line, at the end.
+ *
+ */
+
+QByteArray HTTPCache::set_header(QByteArray head, QString name, QString value) {
+
+  QByteArray updated, line;
+  int start = 0, end, colon;
+
+  while((end = head.indexOf("\r\n", start)) > start) {
+
+    line = head.mid(start, end - start);
+    colon = line.indexOf(':');
+
+    if(start == 0 || colon <= 0 ||
+       QString::fromLatin1(line.left(colon)).trimmed().compare(name, Qt::CaseInsensitive) != 0)
+      updated += line + "\r\n";
+
+    start = end + 2;
+
+  }
+
+  return updated + name.toLatin1() + ": " + value.toLatin1() + "\r\n\r\n";
+
+}
+
+/**
+ * @fn QHash<QString, QString> HTTPCache::directives(const Headers *headers)
+ * @brief Method to parse the Cache-Control directives of a message.
+ * @param headers Headers of the message.
+ * @return Returns the value of each directive (empty if it has none), per
+ * name (lower case).
+ */
+
+QHash<QString, QString> HTTPCache::directives(const Headers *headers) {
+
+  QHash<QString, QString> found;
+  QStringList items = QString::fromLatin1(headers->joined(HEADER_CACHE_CONTROL)).split(',');
+  QString name, value;
+
+  for(int i = 0; i < items.size(); i++) {
+
+    name = items[i].section('=', 0, 0).trimmed().toLower();
+    value = items[i].section('=', 1).trimmed();
+
+    if(value.startsWith('"') && value.endsWith('"'))
+      value = value.mid(1, value.size() - 2);
+
+    if(!name.isEmpty())
+      found.insert(name, value);
+
+  }
+
+  return found;
+
+}
+
+/**
+ * @fn Headers HTTPCache::parse_head(QByteArray head)
+ * @brief Method to parse the headers of a cached answer.
+ * @param head Status line and headers of the answer.
+ * @return Returns the headers of the answer.
+ */
+
+Headers HTTPCache::parse_head(QByteArray head) {
+
+  Headers headers;
+  QList<QByteArray> lines = head.split('\n');
+  QByteArray line;
+  int colon;
+
+  for(int i = 1; i < lines.size(); i++) {
+    line = lines[i].trimmed();
+    if((colon = line.indexOf(':')) > 0)
+      headers.append(line.left(colon).trimmed(), line.mid(colon + 1).trimmed());
+  }
+
+  return headers;
+
+}
@@ -6,51 +6,99 @@
  */
 
 
+#include <limits.h>
+
 #include "include/httpparser.h"
 
 /**
- * @fn HTTPParser::HTTPParser()
- * @brief HTTPParser constructor
- *
- * Creates HTTP parser object setting initial state to COMMANDLINE and
- * connecting its logger to mainwindow
- *
+ * @var methodNames
+ * @brief Request methods, per HttpMethod
  */
-HTTPParser::HTTPParser() : state(COMMANDLINE), logger("HTTPParser"){
-  // Connect message logger:
-  connect(&logger, SIGNAL (sendMessage(QString)), this, SIGNAL (logMessage(QString)));
-}
+static constexpr const char *methodNames[METHOD_IDS] = {
+    "", "CONNECT", "DELETE", "GET", "HEAD", "OPTIONS", "PATCH", "POST", "PUT", "TRACE"
+};
 
-HTTPParser::~HTTPParser() {
+/**
+ * @var methodIds
+ * @brief Perfect hash of the request methods (case-sensitive), built by the compiler
+ */
+static constexpr TokenTable<METHOD_IDS, METHOD_HASH_BITS, false> methodIds(methodNames);
+
+static_assert(methodIds.perfect(), "The request methods need a larger hash");
 
+/**
+ * @var const unsigned char HTTPParserCore::charClass[256]
+ * @brief Character class of every byte, as a set of HTTP_TOKEN, HTTP_TARGET,
+ * HTTP_DIGIT and HTTP_FIELD flags
+ *
+ * Tokens are the RFC 9110 tchar, URLs take the characters allowed by the old
+ * command line expression and field values take every visible character,
+ * space, horizontal tab and obs-text (bytes above 0x7F).
+ */
+const unsigned char HTTPParserCore::charClass[256] = {
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 8, 0, 0, 0, 0, 0, 0,
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     8,11, 8,11,11,11,11,11,10,10,11,11,10,11,11,10,
+    15,15,15,15,15,15,15,15,15,15,10,10, 8,10, 8,10,
+    10,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
+    11,11,11,11,11,11,11,11,11,11,11,10,10,10,11,11,
+     9,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
+    11,11,11,11,11,11,11,11,11,11,11,10,11,10,11, 0,
+    10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,
+    10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,
+    10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,
+    10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,
+    10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,
+    10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,
+    10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,
+    10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10
+};
+
+/**
+ * @fn HTTPParserCore::HTTPParserCore()
+ * @brief HTTPParserCore constructor
+ *
+ * Creates an empty parser, setting initial state to COMMANDLINE. Nothing is
+ * allocated until a message is parsed.
+ *
+ */
+HTTPParserCore::HTTPParserCore() : methodId(METHOD_NONE), state(COMMANDLINE), error(PARSER_OK){
+  splitted.header = nullptr;
+  splitted.header_size = 0;
+  splitted.body = nullptr;
+  splitted.body_size = 0;
 }
 
 /**
- * @fn HeaderBodyPair HTTPParser::splitRequest(char *request, size_t size)
+ * @fn HeaderBodyPair HTTPParserCore::splitRequest(char *request, size_t size)
  * @brief Splits header section from body section given an array of chars and its size
  * @param request Array of chars to be splitted
  * @param size Size of array of chars
- * @return Returns HeaderBodyPair struct with each field sets *
+ * @return Returns HeaderBodyPair struct with each field sets
+ *
+ * Only the header section is scanned (a vector at a time, by ByteScan), both
+ * sections are returned as pointers into the array, so nothing is copied.
  */
-HeaderBodyPair HTTPParser::splitRequest(char *request, size_t size){
+HeaderBodyPair HTTPParserCore::splitRequest(char *request, size_t size){
     HeaderBodyPair ret;
-    unsigned int headerEnd;
+    ssize_t found = ByteScan::find_header_end(request, size);
+    size_t headerEnd;
 
+    ret.body = nullptr;
     ret.body_size = 0;
 
-    for(headerEnd = 0 ; headerEnd + 3 < size ; headerEnd++ ){
-        if(request[headerEnd]   == '\r' &&
-           request[headerEnd+1] == '\n' &&
-           request[headerEnd+2] == '\r' &&
-           request[headerEnd+3] == '\n')
-        break;
-    }
+    // Without the empty line, everything but its last three bytes is header
+    if(found != -1)
+        headerEnd = static_cast<size_t>(found) - 4;
+    else
+        headerEnd = size > 3 ? size - 3 : 0;
 
-    ret.header = QString::fromStdString(std::string(request, headerEnd));
+    ret.header = request;
+    ret.header_size = static_cast<int>(headerEnd);
 
     if(size > headerEnd + 4){
+        ret.body = &(request[headerEnd+4]);
         ret.body_size = size - headerEnd - 4;
-        memcpy(&(ret.body), &(request[headerEnd+4]), ret.body_size);
     }
 
     return ret;
@@ -58,17 +106,22 @@ HeaderBodyPair HTTPParser::splitRequest(char *request, size_t size){
 }
 
 /**
- * @fn bool HTTPParser::parse(char *request, ssize_t size)
+ * @fn bool HTTPParserCore::parse(char *request, ssize_t size)
  * @brief Private method that receives a request and parses it
  * @param request Array of chars to be parsed
  * @param size Size of array of chars
  * @return Returns true if no error occoured and false if not
+ *
+ * The header section is walked a line at a time, each line being matched by
+ * the scanners in place: only the parsed fields are copied out of the buffer.
  */
-bool HTTPParser::parse(char *request, ssize_t size){
-    QList<QString> lines;
+bool HTTPParserCore::parse(char *request, ssize_t size){
+    const char *line, *lineEnd, *headerEnd;
 
     // Clean up variables:
     headers.clear();
+    methodId = METHOD_NONE;
+    error = PARSER_OK;
 
     // Set initial state
     state = COMMANDLINE;
@@ -76,11 +129,12 @@ bool HTTPParser::parse(char *request, ssize_t size){
     // Split text part of body part
     this->splitted = splitRequest(request, static_cast<size_t>(size));
 
-    // Split in \r\n
-    lines = splitted.header.split(QRegExp("\r\n"));
+    line = splitted.header;
+    headerEnd = splitted.header + splitted.header_size;
 
-    // Loop through lines
-    for (QString line : lines) {
+    // Loop through lines, split in \r\n
+    do {
+        lineEnd = findLineEnd(line, headerEnd);
 
         // Take an action depending on state
         switch (state) {
@@ -88,8 +142,9 @@ bool HTTPParser::parse(char *request, ssize_t size){
             // CommandLine state is the first line to be read
             case COMMANDLINE:
                 // ParseCommandLine method modifies class attributes
-                if(!this->parseCL(line) && !this->parseAL(line)){
-                   logger.error("Could not parse COMMAND LINE: \"" + line.toStdString() + "\"");
+                if(!this->parseCL(line, lineEnd) && !this->parseAL(line, lineEnd)){
+                   error = PARSER_BAD_START_LINE;
+                   errorText = QByteArray(line, static_cast<int>(lineEnd - line));
                    return false;
                 }
 
@@ -100,93 +155,252 @@ bool HTTPParser::parse(char *request, ssize_t size){
             // HeaderLine state is to interpret line as a header
             case HEADERLINE:
                 // ParseHeaderLine modifies class attributes
-                if(!this->parseHL(line)){
-                    logger.error("Could not parse HEADER LINE: \"" + line.toStdString() + "\"");
+                if(!this->parseHL(line, lineEnd)){
+                    error = PARSER_BAD_HEADER_LINE;
+                    errorText = QByteArray(line, static_cast<int>(lineEnd - line));
                     return false;
                 }
             break;
         }
+
+        // Skip the \r\n
+        line = lineEnd + 2;
+    } while(lineEnd < headerEnd);
+
+    return true;
+}
+
+/**
+ * @fn bool HTTPParserCore::isClass(char c, unsigned char flags)
+ * @brief Verifies if a byte belongs to a character class
+ * @param c The byte
+ * @param flags The character class (HTTP_TOKEN, HTTP_TARGET, ...)
+ * @return Returns true if it belongs, false if not
+ */
+bool HTTPParserCore::isClass(char c, unsigned char flags){
+    return (charClass[static_cast<unsigned char>(c)] & flags) != 0;
+}
+
+/**
+ * @fn const char *HTTPParserCore::findLineEnd(const char *begin, const char *end)
+ * @brief Finds the end of a line
+ * @param begin First byte of the line
+ * @param end End of the text holding the line
+ * @return Returns the \r of the \r\n ending the line, or end if there is none
+ */
+const char *HTTPParserCore::findLineEnd(const char *begin, const char *end){
+    const char *cr = begin;
+
+    while(cr < end && (cr = static_cast<const char *>(memchr(cr, '\r', static_cast<size_t>(end - cr)))) != nullptr){
+        if(cr + 1 < end && cr[1] == '\n')
+            return cr;
+        cr++;
     }
 
-    logger.info("Successfully parsed HTTP request");
+    return end;
+}
+
+/**
+ * @fn const char *HTTPParserCore::scanVersion(const char *begin, const char *end)
+ * @brief Matches an HTTP version ("HTTP/" followed by digit.digit)
+ * @param begin First byte of the version
+ * @param end End of the line
+ * @return Returns the byte after the version, or nullptr if not matched
+ */
+const char *HTTPParserCore::scanVersion(const char *begin, const char *end){
+    if(end - begin < 8 || memcmp(begin, "HTTP/", 5) != 0 ||
+       !isClass(begin[5], HTTP_DIGIT) || begin[6] != '.' ||
+       !isClass(begin[7], HTTP_DIGIT))
+        return nullptr;
+
+    return begin + 8;
+}
+
+/**
+ * @fn bool HTTPParserCore::scanCommandLine(const char *begin, const char *end, TextSpan *method, TextSpan *url, TextSpan *version, HttpMethod *id)
+ * @brief Matches a command line: method, URL and version split by single spaces
+ * @param begin First byte of the line
+ * @param end End of the line
+ * @return Returns true if matched
+ * @return method, url, version and the method identifier by reference
+ */
+bool HTTPParserCore::scanCommandLine(const char *begin, const char *end, TextSpan *method, TextSpan *url, TextSpan *version, HttpMethod *id){
+    const char *p = begin;
+    int known;
+
+    // The method is a token, one of the known methods
+    while(p < end && isClass(*p, HTTP_TOKEN))
+        p++;
+    method->data = begin;
+    method->size = static_cast<int>(p - begin);
+
+    if((known = methodIds.find(begin, method->size)) == -1 || p == end || *p != ' ')
+        return false;
+
+    *id = static_cast<HttpMethod>(known);
+
+    // The URL has at least one character
+    url->data = ++p;
+    while(p < end && isClass(*p, HTTP_TARGET))
+        p++;
+    url->size = static_cast<int>(p - url->data);
+
+    if(url->size == 0 || p == end || *p != ' ')
+        return false;
+
+    // The version ends the line
+    version->data = ++p;
+    version->size = 8;
+    p = scanVersion(p, end);
+
+    return p == end;
+}
+
+/**
+ * @fn bool HTTPParserCore::scanAnswerLine(const char *begin, const char *end, TextSpan *version, TextSpan *code, TextSpan *description)
+ * @brief Matches an answer line: version, three digit code and description
+ * @param begin First byte of the line
+ * @param end End of the line
+ * @return Returns true if matched
+ * @return version, code and description by reference
+ */
+bool HTTPParserCore::scanAnswerLine(const char *begin, const char *end, TextSpan *version, TextSpan *code, TextSpan *description){
+    const char *p;
+
+    // HTTP/1.1 403 Forbidden
+    p = scanVersion(begin, end);
+    if(p == nullptr || end - p < 4 || p[0] != ' ' ||
+       !isClass(p[1], HTTP_DIGIT) || !isClass(p[2], HTTP_DIGIT) || !isClass(p[3], HTTP_DIGIT))
+        return false;
+
+    version->data = begin;
+    version->size = 8;
+    code->data = p + 1;
+    code->size = 3;
+    p += 4;
+
+    // The description may be missing, space included
+    if(p < end && *p++ != ' ')
+        return false;
+
+    description->data = p;
+    while(p < end && isClass(*p, HTTP_FIELD))
+        p++;
+    description->size = static_cast<int>(p - description->data);
+
+    return p == end;
+}
+
+/**
+ * @fn bool HTTPParserCore::scanHeaderLine(const char *begin, const char *end, TextSpan *name, TextSpan *value)
+ * @brief Matches a header line: a token name, a colon and the value
+ * @param begin First byte of the line
+ * @param end End of the line
+ * @return Returns true if matched
+ * @return name and value by reference, without the whitespace around the value
+ */
+bool HTTPParserCore::scanHeaderLine(const char *begin, const char *end, TextSpan *name, TextSpan *value){
+    const char *p = begin;
+
+    while(p < end && isClass(*p, HTTP_TOKEN))
+        p++;
+    name->data = begin;
+    name->size = static_cast<int>(p - begin);
+
+    if(name->size == 0 || p == end || *p != ':')
+        return false;
+
+    // Skip the whitespace before the value
+    p++;
+    while(p < end && (*p == ' ' || *p == '\t'))
+        p++;
+
+    value->data = p;
+    while(p < end && isClass(*p, HTTP_FIELD))
+        p++;
+
+    if(p != end)
+        return false;
+
+    // Trim the whitespace after the value
+    while(p > value->data && (p[-1] == ' ' || p[-1] == '\t'))
+        p--;
+    value->size = static_cast<int>(p - value->data);
+
+    return true;
+}
+
+/**
+ * @fn bool HTTPParserCore::scanHeader(const char *begin, const char *end, bool answer)
+ * @brief Matches a header section, without the empty line ending it
+ * @param begin First byte of the section
+ * @param end End of the section
+ * @param answer If the first line is an answer line (or a command line)
+ * @return Returns true if matched
+ */
+bool HTTPParserCore::scanHeader(const char *begin, const char *end, bool answer){
+    TextSpan first, second, third;
+    HttpMethod id;
+    const char *lineEnd;
+
+    // The first line should be an answer or a command line:
+    lineEnd = findLineEnd(begin, end);
+    if(answer ? !scanAnswerLine(begin, lineEnd, &first, &second, &third)
+              : !scanCommandLine(begin, lineEnd, &first, &second, &third, &id))
+        return false;
+
+    // The rest of the lines should be header lines:
+    while(lineEnd < end){
+        begin = lineEnd + 2;
+        lineEnd = findLineEnd(begin, end);
+        if(!scanHeaderLine(begin, lineEnd, &first, &second))
+            return false;
+    }
 
     return true;
 }
 
 /**
- * @fn bool HTTPParser::validAnswerHeader(QString header)
+ * @fn bool HTTPParserCore::validAnswerHeader(QByteArray header)
  * @brief Verifies if an answer header string is valid
- * @param header QString containing the header
+ * @param header QByteArray containing the header
  * @return Returns true if valid, false if not
  *
  * A valid header is a header that ends with "\r\n\r\n", first
  * line is an answer line and the other lines are header lines
  */
-bool HTTPParser::validAnswerHeader(QString header){
-
-  QList<QString> lines;
+bool HTTPParserCore::validAnswerHeader(QByteArray header){
 
   // Check to see if the header end is correct:
   if(!header.endsWith("\r\n\r\n"))
     return false;
 
-  // Remove the header end:
-  header.remove(header.size()-4, 4);
-
-  // Split the remaining lines:
-  lines = header.split(QRegExp("\r\n"));
-
-  // The first line should be an answer line:
-  if(!parseAnswerLine(lines.at(0), nullptr, nullptr, nullptr))
-    return false;
-
-  // The rest of the lines should be header lines:
-  for(QString header_line : lines.mid(1))
-    if(!parseHeaderLine(header_line, nullptr, nullptr))
-      return false;
-
-  return true;
+  // Scan the lines, without the header end:
+  return scanHeader(header.constData(), header.constData() + header.size() - 4, true);
 
 }
 
 /**
- * @fn bool HTTPParser::validRequestHeader(QString header)
+ * @fn bool HTTPParserCore::validRequestHeader(QByteArray header)
  * @brief Verifies if an request header string is valid
- * @param header QString containing the header
+ * @param header QByteArray containing the header
  * @return Returns true if valid, false if not
  *
  * A valid header is a header that ends with "\r\n\r\n", first
  * line is an request line and the other lines are header lines
  */
-bool HTTPParser::validRequestHeader(QString header) {
-
-    QList<QString> lines;
+bool HTTPParserCore::validRequestHeader(QByteArray header) {
 
     // Check to see if the header end is correct:
     if(!header.endsWith("\r\n\r\n"))
       return false;
 
-    // Remove the header end:
-    header.remove(header.size()-4, 4);
-
-    // Split the remaining lines:
-    lines = header.split(QRegExp("\r\n"));
-
-    // The first line should be a commmand line:
-    if(!parseCommandLine(lines.at(0), nullptr, nullptr, nullptr))
-      return false;
-
-    // The rest of the lines should be header lines:
-    for(QString header_line : lines.mid(1)) {
-      if(!parseHeaderLine(header_line, nullptr, nullptr))
-        return false;
-    }
-
-    return true;
+    // Scan the lines, without the header end:
+    return scanHeader(header.constData(), header.constData() + header.size() - 4, false);
 }
 
 /**
- * @fn bool HTTPParser::parseCommandLine(QString line, QString *method, QString *url, QString *version)
+ * @fn bool HTTPParserCore::parseCommandLine(QByteArray line, QByteArray *method, QByteArray *url, QByteArray *version)
  * @brief Given a line try to parse a command line
  * @param line The line to be parsed
  * @return Returns true if parsed ok
@@ -194,44 +408,49 @@ bool HTTPParser::validRequestHeader(QString header) {
  * @return url by reference
  * @return version by reference
  */
-bool HTTPParser::parseCommandLine(QString line, QString *method, QString *url, QString *version){
-    int pos;
-
-    // Regular Expression for command line
-    QRegExp commandline("^(GET|HEAD|CONNECT|PUT|DELETE|POST|OPTIONS|TRACE|PATCH) ([:|\\/\\.\\\\-\\w_~/?\\#\\[\\]@!\\$\\^&'\\(\\)\\*\\+\\´,;=%{}]+) (HTTP\\/(?:\\d.\\d))$");
-
-    // Try to match
-    pos = commandline.indexIn(line);
+bool HTTPParserCore::parseCommandLine(QByteArray line, QByteArray *method, QByteArray *url, QByteArray *version){
+    TextSpan methodSpan, urlSpan, versionSpan;
+    HttpMethod id;
 
-    // Should match exactly the first character
-    if(pos != 0) return false;
+    if(!scanCommandLine(line.constData(), line.constData() + line.size(), &methodSpan, &urlSpan, &versionSpan, &id))
+        return false;
 
     // Set return
     if(method != nullptr)
-        *method = commandline.cap(1);
+        *method = QByteArray(methodSpan.data, methodSpan.size);
 
     if(url != nullptr)
-        *url = commandline.cap(2);
+        *url = QByteArray(urlSpan.data, urlSpan.size);
 
     if(version != nullptr)
-        *version = commandline.cap(3);
+        *version = QByteArray(versionSpan.data, versionSpan.size);
 
     return true;
 }
 
 /**
- * @fn bool HTTPParser::parseCL(QString line)
+ * @fn bool HTTPParserCore::parseCL(const char *begin, const char *end)
  * @brief This method parsers first line of a HTTP request, it alters private members of class
- * @param line The line to be parsed
+ * @param begin First byte of the line to be parsed
+ * @param end End of the line to be parsed
  * @return Returns false if could not match with expected expression
  */
-bool HTTPParser::parseCL(QString line){
-    // Parse command line and set private variables
-    return parseCommandLine(line, &this->method, &this->url, &this->version);
+bool HTTPParserCore::parseCL(const char *begin, const char *end){
+    TextSpan methodSpan, urlSpan, versionSpan;
+
+    if(!scanCommandLine(begin, end, &methodSpan, &urlSpan, &versionSpan, &this->methodId))
+        return false;
+
+    // Set private variables
+    this->method = QByteArray(methodSpan.data, methodSpan.size);
+    this->url = QByteArray(urlSpan.data, urlSpan.size);
+    this->version = QByteArray(versionSpan.data, versionSpan.size);
+
+    return true;
 }
 
 /**
- * @fn bool HTTPParser::parseAnswerLine(QString line, QString *version, QString *code, QString *description)
+ * @fn bool HTTPParserCore::parseAnswerLine(QByteArray line, QByteArray *version, QByteArray *code, QByteArray *description)
  * @brief Given a line try to parse a answer line
  * @param line The line to be parsed
  * @return Returns true if parsed ok
@@ -239,304 +458,596 @@ bool HTTPParser::parseCL(QString line){
  * @return code by reference
  * @return description by reference
  */
-bool HTTPParser::parseAnswerLine(QString line, QString *version, QString *code, QString *description){
-    int pos;
-
-    // Regular Expression for command line
-    // HTTP/1.1 403 Forbidden
-    QRegExp commandline("^(HTTP\\/(?:\\d.\\d)) (\\d{3}) (.*)$");
-
-    // Try to match
-    pos = commandline.indexIn(line);
+bool HTTPParserCore::parseAnswerLine(QByteArray line, QByteArray *version, QByteArray *code, QByteArray *description){
+    TextSpan versionSpan, codeSpan, descriptionSpan;
 
-    // Should match exactly the first character
-    if(pos != 0) return false;
+    if(!scanAnswerLine(line.constData(), line.constData() + line.size(), &versionSpan, &codeSpan, &descriptionSpan))
+        return false;
 
     // Set variables
     if(version != nullptr)
-        *version = commandline.cap(1);
+        *version = QByteArray(versionSpan.data, versionSpan.size);
 
-    if(version != nullptr)
-        *code = commandline.cap(2);
+    if(code != nullptr)
+        *code = QByteArray(codeSpan.data, codeSpan.size);
 
-    if(version != nullptr)
-        *description = commandline.cap(3);
+    if(description != nullptr)
+        *description = QByteArray(descriptionSpan.data, descriptionSpan.size);
 
     return true;
 }
 
 /**
- * @fn bool HTTPParser::parseAL(QString line)
+ * @fn bool HTTPParserCore::parseAL(const char *begin, const char *end)
  * @brief This method parsers first line of a HTTP request, it alters private members of class
- * @param line The line to be parsed
+ * @param begin First byte of the line to be parsed
+ * @param end End of the line to be parsed
  * @return Returns false if could not match with expected expression, true if could
  */
-bool HTTPParser::parseAL(QString line){
-    // Parsers answer line and set private variables
-    return parseAnswerLine(line, &this->version, &this->code, &this->description);
+bool HTTPParserCore::parseAL(const char *begin, const char *end){
+    TextSpan versionSpan, codeSpan, descriptionSpan;
+
+    if(!scanAnswerLine(begin, end, &versionSpan, &codeSpan, &descriptionSpan))
+        return false;
+
+    // Set private variables
+    this->version = QByteArray(versionSpan.data, versionSpan.size);
+    this->code = QByteArray(codeSpan.data, codeSpan.size);
+    this->description = QByteArray(descriptionSpan.data, descriptionSpan.size);
+
+    return true;
 }
 
 /**
- * @fn bool HTTPParser::parseHeaderLine(QString line, QString *name, QString *value)
+ * @fn bool HTTPParserCore::parseHeaderLine(QByteArray line, QByteArray *name, QByteArray *value)
  * @brief This method parsers a header line of a HTTP request
  * @param line The line to be parsed
  * @return Returns false if could not match with expected expression
  * @return name key of header line by reference
  * @return value of header line by reference
  */
-bool HTTPParser::parseHeaderLine(QString line, QString *name, QString *value){
-    int pos;
+bool HTTPParserCore::parseHeaderLine(QByteArray line, QByteArray *name, QByteArray *value){
+    TextSpan nameSpan, valueSpan;
 
-    // Regular Expression for Header Line
-    QRegExp headerline("^([A-Za-z-0-9]*): (.*)$");
-
-    // Try to match
-    pos = headerline.indexIn(line);
-    if(pos != 0) return false;
+    if(!scanHeaderLine(line.constData(), line.constData() + line.size(), &nameSpan, &valueSpan))
+        return false;
 
     if(name != nullptr)
-        *name = headerline.cap(1);
+        *name = QByteArray(nameSpan.data, nameSpan.size);
 
     if(value != nullptr)
-        *value = headerline.cap(2);
+        *value = QByteArray(valueSpan.data, valueSpan.size);
 
     return true;
 }
 
 /**
- * @fn bool HTTPParser::parseHL(QString line)
+ * @fn bool HTTPParserCore::parseHL(const char *begin, const char *end)
  * @brief This method parsers a header line of a HTTP request, it alters private members of class
- * @param line The line to be parsed
+ * @param begin First byte of the line to be parsed
+ * @param end End of the line to be parsed
  * @return Returns false if could not match with expected expression
  */
-bool HTTPParser::parseHL(QString line){
-    QString name, value;
+bool HTTPParserCore::parseHL(const char *begin, const char *end){
+    TextSpan nameSpan, valueSpan;
 
-    // Parsers header line
-    if(!this->parseHeaderLine(line, &name, &value))
+    // Scans header line
+    if(!scanHeaderLine(begin, end, &nameSpan, &valueSpan))
         return false;
 
-    // Verify if hash already contains header name
-    if(this->headers.contains(name))
-        // Appends the value to QList
-        // Used QList rather than simple a QString because the same header name
-        // can appear multiple times with different values
-        this->headers[name].append(value);
-    else
-        // Initialize a list with captured value
-        this->headers[name] = QList<QString>({value});
+    // The same header name can appear multiple times with different values,
+    // each one takes a field (a well-known name is not copied)
+    this->headers.append(nameSpan.data, nameSpan.size, QByteArray(valueSpan.data, valueSpan.size));
 
     return true;
 }
 
 /**
- * @fn QString HTTPParser::getMethod()
+ * @fn QByteArray HTTPParserCore::getMethod()
  * @brief Getter for http method
- * @return Returns QString containing method
+ * @return Returns QByteArray containing method
  */
-QString HTTPParser::getMethod(){
+QByteArray HTTPParserCore::getMethod(){
     return this->method;
 }
 
 /**
- * @fn QString HTTPParser::getHost()
+ * @fn HttpMethod HTTPParserCore::getMethodId()
+ * @brief Getter for http method identifier
+ * @return Returns the identifier of the method (METHOD_NONE for answers)
+ */
+HttpMethod HTTPParserCore::getMethodId(){
+    return this->methodId;
+}
+
+/**
+ * @fn QByteArray HTTPParserCore::getHost()
  * @brief Getter for http host
- * @return Returns QString containing host
+ * @return Returns QByteArray containing host
  */
-QString HTTPParser::getHost(){
-    if(this->headers.contains("Host"))
-        return this->getHeaders()["Host"][0];
-    else return "";
+QByteArray HTTPParserCore::getHost(){
+    return this->headers.value(HEADER_HOST);
 }
 
 /**
- * @fn QString HTTPParser::getURL()
+ * @fn QByteArray HTTPParserCore::getURL()
  * @brief Getter for http url
- * @return Returns QString containing url
+ * @return Returns QByteArray containing url
  */
-QString HTTPParser::getURL(){
+QByteArray HTTPParserCore::getURL(){
     return this->url;
 }
 
 /**
- * @fn QString HTTPParser::getHTTPVersion()
+ * @fn QByteArray HTTPParserCore::getHTTPVersion()
  * @brief Getter for http version
- * @return Returns QString containing version
+ * @return Returns QByteArray containing version
  */
-QString HTTPParser::getHTTPVersion(){
+QByteArray HTTPParserCore::getHTTPVersion(){
     return this->version;
 }
 
 /**
- * @fn QString HTTPParser::getCode()
+ * @fn QByteArray HTTPParserCore::getCode()
  * @brief Getter for http code
- * @return Returns QString containing code
+ * @return Returns QByteArray containing code
  */
-QString HTTPParser::getCode(){
+QByteArray HTTPParserCore::getCode(){
     return this->code;
 }
 
 /**
- * @fn QString HTTPParser::getDescription()
+ * @fn QByteArray HTTPParserCore::getDescription()
  * @brief Getter for http description
- * @return Returns QString containing description
+ * @return Returns QByteArray containing description
  */
-QString HTTPParser::getDescription(){
+QByteArray HTTPParserCore::getDescription(){
     return this->description;
 }
 
 /**
- * @fn QString HTTPParser::getData()
+ * @fn char *HTTPParserCore::getData()
  * @brief Getter for http data section
- * @return Returns char array containing raw data
+ * @return Returns char array containing raw data, inside the parsed buffer
  */
-char *HTTPParser::getData(){
+char *HTTPParserCore::getData(){
     return this->splitted.body;
 }
 
 /**
- * @fn QString HTTPParser::getDataSize()
+ * @fn size_t HTTPParserCore::getDataSize()
  * @return Returns size of data section
  */
-size_t HTTPParser::getDataSize(){
+size_t HTTPParserCore::getDataSize(){
     return this->splitted.body_size;
 }
 
 /**
- * @fn QString HTTPParser::getHeaders()
+ * @fn const Headers &HTTPParserCore::getHeaders()
  * @brief Getter for headers
- * @return Returns headers hashmap
+ * @return Returns the header table, valid until the next parse
  */
-Headers HTTPParser::getHeaders(){
+const Headers &HTTPParserCore::getHeaders(){
     return this->headers;
 }
 
 /**
- * @fn QString HTTPParser::getHeadersSize()
+ * @fn QByteArray HTTPParserCore::getDecodedData(QByteArray *trailer)
+ * @brief Getter for the data section without its chunked framing
+ * @param trailer Address to store the trailer fields of a chunked body (nullptr to skip them)
+ * @return Returns the data of the chunks received if the message is chunked,
+ * a copy of the raw data otherwise
+ */
+QByteArray HTTPParserCore::getDecodedData(QByteArray *trailer){
+    if(trailer != nullptr)
+        trailer->clear();
+
+    if(!ChunkedCodec::chunked(this->headers.joined(HEADER_TRANSFER_ENCODING)))
+        return QByteArray(this->getData(), static_cast<int>(this->getDataSize()));
+
+    return ChunkedCodec::decoded(this->getData(), this->getDataSize(), trailer);
+}
+
+/**
+ * @fn ParserError HTTPParserCore::getError()
+ * @brief Getter for the reason the last parse failed
+ * @return Returns the error (PARSER_OK if the last parse succeeded)
+ */
+ParserError HTTPParserCore::getError(){
+    return this->error;
+}
+
+/**
+ * @fn std::string HTTPParserCore::errorMessage()
+ * @brief Describes the reason the last parse failed, for a log
+ * @return Returns the description (empty if the last parse succeeded)
+ */
+std::string HTTPParserCore::errorMessage(){
+    switch(this->error){
+        case PARSER_BAD_START_LINE:
+            return "Could not parse COMMAND LINE: \"" + this->errorText.toStdString() + "\"";
+        case PARSER_BAD_HEADER_LINE:
+            return "Could not parse HEADER LINE: \"" + this->errorText.toStdString() + "\"";
+        case PARSER_BAD_CONTENT_LENGTH:
+            return "Invalid Content-Length: \"" + this->errorText.toStdString() + "\"";
+        case PARSER_BAD_TRANSFER_ENCODING:
+            return "Request body is not chunked: \"" + this->errorText.toStdString() + "\"";
+        case PARSER_BAD_CHUNK:
+            return "Invalid chunked body, " + this->errorText.toStdString() + " bytes into it";
+        default:
+            return std::string();
+    }
+}
+
+/**
+ * @fn int HTTPParserCore::getHeadersSize()
  * @return Returns number header size in bytes
  */
-int HTTPParser::getHeadersSize(){
-    return this->splitted.header.size();
+int HTTPParserCore::getHeadersSize(){
+    return this->splitted.header_size;
 }
 
 /**
- * @fn bool HTTPParser::parseRequest(char *request, ssize_t size)
+ * @fn bool HTTPParserCore::parseRequest(char *request, ssize_t size)
  * @brief Public method that parsers a request
  * @param request array of chars with request to be parsed
  * @param size size of array of chars with request
  * @return Returns true if parsed ok, false otherwise
  */
-bool HTTPParser::parseRequest(char *request, ssize_t size){
+bool HTTPParserCore::parseRequest(char *request, ssize_t size){
     return this->parse(request, size);
 }
 
-
 /**
-* @fn void HTTPParser::prettyPrinter()
-* @brief Shows in stdout beautified the parsed HTTP request
-*/
-void HTTPParser::prettyPrinter(){
-    QHashIterator<QString,QList<QString>> i(this->getHeaders());
-    while(i.hasNext()){
-        i.next();
-        for(QString value : i.value()){
-            logger.info("Parsed Header: " + i.key().toUtf8().toStdString() + " -> " + value.toUtf8().toStdString());
+ * @fn ParseStatus HTTPParserCore::feed(MessageState *state, char *request, size_t size, bool answer, bool headRequest)
+ * @brief Public method that follows a message as it arrives
+ * @param state State of the message, kept between calls (see resetMessage)
+ * @param request Array of chars with the message received so far
+ * @param size Size of array of chars
+ * @param answer True if the message is an answer
+ * @param headRequest True if the answer is for a HEAD request
+ * @return Returns PARSE_NEED_MORE until the headers arrive,
+ * PARSE_HEADERS_COMPLETE until the body arrives, PARSE_MESSAGE_COMPLETE once
+ * the whole message did and PARSE_ERROR if the headers are invalid
+ *
+ * The array must hold the same message on every call, with the new data
+ * appended. Only the new data is searched for the end of the headers, which
+ * are parsed once, when they are complete: later calls only compare the size
+ * with the framing found then (or decode the new part of a chunked body), so
+ * a message costs the same however many pieces it arrives in. The parse done
+ * when the headers complete is left in the parser.
+ *
+ * Answers to HEAD requests and answers with a 1xx, 204 or 304 code have no
+ * body. A body whose last transfer coding is chunked ends after its last chunk
+ * and trailer, whatever its Content-Length says. Requests with another
+ * transfer coding are invalid, requests without either header have no body.
+ * Other answers without a Content-Length header end when the website closes
+ * the connection. A Content-Length repeated with different values, or too
+ * large for a message (for a request, larger than HTTP_BUFFER_SIZE with its
+ * headers) is invalid.
+ */
+ParseStatus HTTPParserCore::feed(MessageState *state, char *request, size_t size, bool answer, bool headRequest){
+    size_t from;
+    ssize_t headerEnd;
+    QList<QByteArray> lengths;
+    bool ok;
+
+    if(state->status == PARSE_ERROR)
+        return PARSE_ERROR;
+
+    if(state->header_end == -1){
+
+        // The empty line may have started in the previous piece
+        from = state->scanned > 3 ? state->scanned - 3 : 0;
+
+        if(from > size || (headerEnd = findHeaderEnd(request + from, size - from)) == -1){
+            state->scanned = size;
+            return state->status = PARSE_NEED_MORE;
+        }
+
+        state->header_end = static_cast<ssize_t>(from) + headerEnd;
+        state->scanned = static_cast<size_t>(state->header_end);
+
+        if(!this->parse(request, static_cast<ssize_t>(size)))
+            return state->status = PARSE_ERROR;
+
+        // Find the body framing
+        if(answer && (headRequest || this->code.startsWith("1") || this->code == "204" ||
+                      this->code == "304")){
+            state->framing = FRAMING_NONE;
+            state->length = state->header_end;
+        }
+        else if(ChunkedCodec::chunked(this->headers.joined(HEADER_TRANSFER_ENCODING))){
+            state->framing = FRAMING_CHUNKED;
+            state->length = -1;
+            ChunkedCodec::reset(&(state->chunks));
+        }
+        else if(this->headers.contains(HEADER_TRANSFER_ENCODING)){
+            if(!answer){
+                error = PARSER_BAD_TRANSFER_ENCODING;
+                errorText = this->headers.joined(HEADER_TRANSFER_ENCODING);
+                return state->status = PARSE_ERROR;
+            }
+
+            state->framing = FRAMING_CLOSE;
+            state->length = -1;
+        }
+        else if(this->headers.contains(HEADER_CONTENT_LENGTH)){
+            state->framing = FRAMING_LENGTH;
+            lengths = this->headers.joined(HEADER_CONTENT_LENGTH).split(',');
+            state->length = lengths.first().trimmed().toLongLong(&ok);
+
+            // Repeated lengths must agree, or the message could be framed two ways
+            for(int i = 1; ok && i < lengths.size(); i++)
+                ok = lengths[i].trimmed() == lengths.first().trimmed();
+
+            if(!ok || state->length < 0 || state->length > SSIZE_MAX - state->header_end ||
+               (!answer && state->length > HTTP_BUFFER_SIZE - state->header_end)){
+                error = PARSER_BAD_CONTENT_LENGTH;
+                errorText = this->headers.joined(HEADER_CONTENT_LENGTH);
+                return state->status = PARSE_ERROR;
+            }
+
+            state->length += state->header_end;
+        }
+        else if(answer){
+            state->framing = FRAMING_CLOSE;
+            state->length = -1;
+        }
+        else{
+            state->framing = FRAMING_NONE;
+            state->length = state->header_end;
         }
     }
-    logger.info("Parsed Method: " + this->getMethod().toUtf8().toStdString());
-    logger.info("Parsed HTTP Version: " + this->getHTTPVersion().toUtf8().toStdString());
-    logger.info("Parsed URL: " + this->getURL().toUtf8().toStdString());
-    for(size_t i=0 ; i<this->getDataSize(); i++){
-//        if(this->getData()[i] == '\0'){
-//            std::cout << "END OF STRING FOUND, MAYBE BINARY DATA" << endl;
-//            //break;
-//        }
-        std::cout << this->getData()[i] << " (" << (static_cast<int>(this->getData()[i])) << ")" << endl;
+
+    // Only the part of a chunked body that arrived since the last call is decoded
+    if(state->framing == FRAMING_CHUNKED && state->length == -1){
+        if(state->scanned < size)
+            state->scanned += ChunkedCodec::decode(&(state->chunks), request + state->scanned,
+                                                   size - state->scanned, nullptr, nullptr);
+
+        if(state->chunks.step == CHUNK_ERROR){
+            error = PARSER_BAD_CHUNK;
+            errorText = QByteArray::number(static_cast<quint64>(state->scanned - static_cast<size_t>(state->header_end)));
+            return state->status = PARSE_ERROR;
+        }
+
+        if(state->chunks.step != CHUNK_DONE)
+            return state->status = PARSE_HEADERS_COMPLETE;
+
+        state->length = static_cast<ssize_t>(state->scanned);
     }
-    cout << endl;
+
+    if(state->framing == FRAMING_CLOSE || static_cast<ssize_t>(size) < state->length)
+        return state->status = PARSE_HEADERS_COMPLETE;
+
+    return state->status = PARSE_MESSAGE_COMPLETE;
+}
+
+/**
+ * @fn void HTTPParserCore::resetMessage(MessageState *state)
+ * @brief Prepares the state of a message that did not arrive yet
+ * @param state State of the message
+ */
+void HTTPParserCore::resetMessage(MessageState *state){
+    state->scanned = 0;
+    state->header_end = -1;
+    state->framing = FRAMING_NONE;
+    state->length = -1;
+    state->status = PARSE_NEED_MORE;
+    ChunkedCodec::reset(&(state->chunks));
 }
 
 /**
-* @fn QString HTTPParser::answerHeaderToQString()
-* @return Returns as a QString the header with answer line
+ * @fn ssize_t HTTPParserCore::findHeaderEnd(char *request, size_t size)
+ * @brief Finds the end of the headers section of a possibly incomplete request
+ * @param request Array of chars received so far
+ * @param size Size of array of chars
+ * @return Returns the size of the headers section, including the empty line
+ * that ends it, or -1 if the empty line was not received yet
+ */
+ssize_t HTTPParserCore::findHeaderEnd(char *request, size_t size){
+    return ByteScan::find_header_end(request, size);
+}
+
+/**
+* @fn QByteArray HTTPParserCore::answerHeaderBuffer()
+* @return Returns as a QByteArray the header with answer line
 */
-QString HTTPParser::answerHeaderToQString() {
-  QString ret;
+QByteArray HTTPParserCore::answerHeaderBuffer() {
+  QByteArray ret;
 
   // Renders the answer line:
-  ret += this->getHTTPVersion() + " " + this->getCode() + " " + this->getDescription() + "\r\n";
-  ret += headerFieldsToQString();
+  ret.reserve(this->splitted.header_size + 4);
+  ret.append(this->version).append(' ').append(this->code).append(' ').append(this->description).append("\r\n");
+  appendHeaderFields(&ret);
 
   return ret;
 
 }
 
 /**
-* @fn QString HTTPParser::headerFieldsToQString()
-* @brief Converts header of HTTPParser object into a QString
-* @return Returns as a QString the header lines
+* @fn QByteArray HTTPParserCore::headerFieldsBuffer()
+* @brief Converts header of HTTPParser object into a QByteArray
+* @return Returns as a QByteArray the header lines
 */
-QString HTTPParser::headerFieldsToQString(){
-    QString ret;
-    QHashIterator<QString,QList<QString>> i(this->getHeaders());
-
-    // Renders each header line
-    while(i.hasNext()){
-        i.next();
-        for(QString value : i.value()){
-            ret += i.key() + ": " + value + "\r\n";
-        }
-    }
+QByteArray HTTPParserCore::headerFieldsBuffer(){
+    QByteArray ret;
 
-    // Renders empty line
-    ret += "\r\n";
+    ret.reserve(this->splitted.header_size + 4);
+    appendHeaderFields(&ret);
 
     return ret;
 }
 
 /**
-* @fn QString HTTPParser::requestHeaderToQString()
-* @return Returns as a QString the header with request line
+* @fn QByteArray HTTPParserCore::requestHeaderBuffer()
+* @return Returns as a QByteArray the header with request line
 */
-QString HTTPParser::requestHeaderToQString() {
-  QString ret;
+QByteArray HTTPParserCore::requestHeaderBuffer() {
+  QByteArray ret;
 
-  // Renders the answer line:
-  ret += this->getMethod() + " " + this->getURL() + " " + this->getHTTPVersion() + "\r\n";
-  ret += headerFieldsToQString();
+  // Renders the request line:
+  ret.reserve(this->splitted.header_size + 4);
+  ret.append(this->method).append(' ').append(this->url).append(' ').append(this->version).append("\r\n");
+  appendHeaderFields(&ret);
 
   return ret;
 
 }
 
 /**
-* @fn QByteArray HTTPParser::requestBuffer()
+* @fn void HTTPParserCore::appendHeaderFields(QByteArray *buffer)
+* @brief Renders the header lines and the empty line that ends them
+* @param buffer Buffer the lines are appended to
+*
+* The lines are appended in the order they were received, straight from the
+* bytes kept in the header table.
+*/
+void HTTPParserCore::appendHeaderFields(QByteArray *buffer){
+    for(int i = 0; i < this->headers.size(); i++){
+        const header_field &field = this->headers.at(i);
+        buffer->append(field.name).append(": ").append(field.value).append("\r\n");
+    }
+
+    // Renders empty line
+    buffer->append("\r\n");
+}
+
+/**
+* @fn QByteArray HTTPParserCore::requestBuffer()
 * @return raw request buffer as QByteArray
 */
-QByteArray HTTPParser::requestBuffer(){
-    QByteArray ret;
-    ret.append(this->requestHeaderToQString());
+QByteArray HTTPParserCore::requestBuffer(){
+    QByteArray ret = this->requestHeaderBuffer();
     ret.append(this->getData(), static_cast<int>(this->getDataSize()));
     return ret;
 }
 
 /**
-* @fn QByteArray HTTPParser::answerBuffer()
+* @fn QByteArray HTTPParserCore::answerBuffer()
 * @return raw answer buffer as QByteArray
 */
-QByteArray HTTPParser::answerBuffer(){
-    QByteArray ret;
-    ret.append(this->answerHeaderToQString());
+QByteArray HTTPParserCore::answerBuffer(){
+    QByteArray ret = this->answerHeaderBuffer();
     ret.append(this->getData(), static_cast<int>(this->getDataSize()));
     return ret;
 }
 
 /**
-* @fn void HTTPParser::updateContentLength()
+* @fn QByteArray HTTPParserCore::setHeaderValue(QByteArray message, HeaderId id, QByteArray value)
+* @brief Replaces the value of a header of a raw message
+* @param message The raw message
+* @param id Identifier of the header
+* @param value The new value
+* @return Returns the message with the value of the first field of the header
+* replaced, everything else (the other fields, their order and spelling and
+* the body) is left as it was
+*/
+QByteArray HTTPParserCore::setHeaderValue(QByteArray message, HeaderId id, QByteArray value){
+    const char *begin = message.constData();
+    const char *headerEnd, *line, *lineEnd;
+    TextSpan name, field;
+    int end = message.indexOf("\r\n\r\n");
+
+    if(end == -1)
+        return message;
+
+    headerEnd = begin + end;
+
+    // Skip the first line, look for the header in the others
+    lineEnd = findLineEnd(begin, headerEnd);
+
+    while(lineEnd < headerEnd){
+        line = lineEnd + 2;
+        lineEnd = findLineEnd(line, headerEnd);
+
+        if(scanHeaderLine(line, lineEnd, &name, &field) && HeaderTable::identify(name.data, name.size) == id)
+            return message.replace(static_cast<int>(field.data - begin), field.size, value);
+    }
+
+    return message;
+}
+
+/**
+* @fn void HTTPParserCore::updateContentLength()
 * @brief Recomputes content-length based on body size
 */
-void HTTPParser::updateContentLength(){
-    if(this->headers.contains("Content-Length")){
-        this->headers["Content-Length"][0] = QString::fromStdString(std::to_string(this->splitted.body_size));
+void HTTPParserCore::updateContentLength(){
+    if(this->headers.contains(HEADER_CONTENT_LENGTH)){
+        this->headers.set_value(HEADER_CONTENT_LENGTH, QByteArray::number(static_cast<quint64>(this->splitted.body_size)));
+    }
+}
+
+// HTTPParser adapter:
+
+/**
+ * @fn HTTPParser::HTTPParser()
+ * @brief HTTPParser constructor
+ *
+ * Creates HTTP parser object, connecting its logger to mainwindow
+ *
+ */
+HTTPParser::HTTPParser() : logger("HTTPParser"){
+  // Connect message logger:
+  connect(&logger, SIGNAL (sendMessage(QString)), this, SIGNAL (logMessage(QString)));
+}
+
+HTTPParser::~HTTPParser() {
+
+}
+
+/**
+ * @fn bool HTTPParser::parseRequest(char *request, ssize_t size)
+ * @brief Parses a request (see HTTPParserCore::parseRequest), logging the result
+ * @param request array of chars with request to be parsed
+ * @param size size of array of chars with request
+ * @return Returns true if parsed ok, false otherwise
+ */
+bool HTTPParser::parseRequest(char *request, ssize_t size){
+    if(!HTTPParserCore::parseRequest(request, size)){
+        logger.error(errorMessage());
+        return false;
+    }
+
+    logger.info("Successfully parsed HTTP request");
+    return true;
+}
+
+/**
+ * @fn ParseStatus HTTPParser::feed(MessageState *state, char *request, size_t size, bool answer, bool headRequest)
+ * @brief Follows a message as it arrives (see HTTPParserCore::feed), logging errors
+ * @return Returns how much of the message arrived
+ */
+ParseStatus HTTPParser::feed(MessageState *state, char *request, size_t size, bool answer, bool headRequest){
+    bool parsing = state->status != PARSE_ERROR;
+    ParseStatus status = HTTPParserCore::feed(state, request, size, answer, headRequest);
+
+    if(parsing && status == PARSE_ERROR)
+        logger.error(errorMessage());
+
+    return status;
+}
+
+/**
+* @fn void HTTPParser::prettyPrinter()
+* @brief Shows in stdout beautified the parsed HTTP request
+*/
+void HTTPParser::prettyPrinter(){
+    const Headers &headers = this->getHeaders();
+
+    for(int i = 0; i < headers.size(); i++){
+        logger.info("Parsed Header: " + headers.at(i).name.toStdString() + " -> " + headers.at(i).value.toStdString());
     }
+    logger.info("Parsed Method: " + this->getMethod().toStdString());
+    logger.info("Parsed HTTP Version: " + this->getHTTPVersion().toStdString());
+    logger.info("Parsed URL: " + this->getURL().toStdString());
+    for(size_t i=0 ; i<this->getDataSize(); i++){
+//        if(this->getData()[i] == '\0'){
+//            std::cout << "END OF STRING FOUND, MAYBE BINARY DATA" << endl;
+//            //break;
+//        }
+        std::cout << this->getData()[i] << " (" << (static_cast<int>(this->getData()[i])) << ")" << endl;
+    }
+    cout << endl;
 }
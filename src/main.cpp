@@ -9,6 +9,9 @@
  *
  */
 
+// Library includes:
+#include <signal.h>
+
 // Qt includes:
 #include <QApplication>
 
@@ -27,6 +30,10 @@
  * This main function is a simple default Qt main function that starts the Qt
  * application.
  *
+ * The SIGPIPE signal is ignored, so a client or website closing its
+ * connection while the proxy sends data to it (even through splice) fails the
+ * send with EPIPE instead of killing the application.
+ *
  */
 
 int main(int argc, char *argv[]) {
@@ -34,6 +41,8 @@ int main(int argc, char *argv[]) {
   // Class declarations:
   QApplication a(argc, argv);     // This declaration should always come first!
 
+  signal(SIGPIPE, SIG_IGN);
+
   MainWindow w;
 
   // Show the main window contents:
@@ -17,7 +17,10 @@
  */
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent),
                                           ui(new Ui::MainWindow),
-                                          logger("Main window") {
+                                          logger("Main window"),
+                                          gate(new Gate),
+                                          dns_cache(new DNSCache),
+                                          rules(new RuleSet) {
                                             
   // UI configuration:
   ui->setupUi(this);
@@ -42,14 +45,19 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent),
   start_server();
   start_tools();
 
+  // Worker counters display:
+  stats_timer = new QTimer(this);
+  connect(stats_timer, SIGNAL (timeout()), this, SLOT (updateStats()));
+  stats_timer->start(STATS_INTERVAL);
+
 }
 
 /**
  * @fn MainWindow::~MainWindow()
  * @brief MainWindow destructor for MainWindow class
  *
- * Deallocates qhexedits and Ui, cleans up server thread and
- * schedule server thread to stop
+ * Deallocates qhexedits and Ui, cleans up the server threads and
+ * schedule the server threads to stop
  *
  */
 MainWindow::~MainWindow() {
@@ -61,9 +69,10 @@ MainWindow::~MainWindow() {
   // Clean up the UI:
   delete ui;
 
-  // Clean up the server thread:
-  if(server_t->isRunning())
-    server->stop();     // Stop the server. Signals and slots handle the rest!
+  // Clean up the server threads:
+  for(int i = 0; i < servers.size(); i++)
+    if(server_threads[i]->isRunning())
+      servers[i]->stop(); // Stop the server. Signals and slots handle the rest!
 
   // Success message:
   logger.success("Exited application!");
@@ -74,36 +83,77 @@ MainWindow::~MainWindow() {
 
 /**
  * @fn int MainWindow::start_server()
- * @brief Starts the server thread.
+ * @brief Starts the server threads.
  * @return Returns 0 when the successfully executed and -1 if an error occurs.
  *
- * This method starts the server thread and the Server functionalities of the
- * application. If successful, a new thread is created with a Server class
- * running in it.
+ * This method starts the server threads and the Server functionalities of the
+ * application. The shared DNS cache is configured first, with the DNS server
+ * and the hosts files given, the HTTP cache is created and the interception
+ * rules are loaded. For each configured worker, a new thread is created with
+ * a Server class running in it. Workers that fail to initialize are
+ * discarded, and an error is only returned if no worker could be started.
  *
  */
 
 int MainWindow::start_server() {
 
-  // Initialize classes:
-  server_t = new QThread;
-  server = new Server(server_port());
-
-  // If the server initializes, start the thread:
-  if(server->init() == 0) {
-    server->moveToThread(server_t);
-    config_server_thread();
-    server_t->start();
+  ServerConfig config = server_config();
+  QThread *server_t;
+  Server *server;
+  QString rules_error;
+
+  // Configure the DNS cache shared with the spider:
+  if(dns_cache->set_server(config.dns_server) != 0)
+    logger.warning("Invalid DNS server! Using the local host instead.");
+
+  dns_cache->load_hosts(RESOLVER_HOSTS_FILE);
+
+  if(!config.hosts_file.isEmpty() && dns_cache->load_hosts(config.hosts_file) != 0)
+    logger.warning("Failed to read the hosts file " + config.hosts_file.toStdString() + "!");
+
+  // Create the HTTP cache shared by the workers:
+  cache = QSharedPointer<HTTPCache>(new HTTPCache(static_cast<size_t> (config.cache_size) * 1048576));
+
+  if(!config.disk_cache.isEmpty() &&
+     cache->open_disk(config.disk_cache, static_cast<size_t> (config.disk_cache_size) * 1048576) != 0)
+    logger.warning("Failed to open the disk cache " + config.disk_cache.toStdString() + "! Caching in memory only.");
+
+  // Load the interception rules (a rejected file intercepts everything):
+  if(!config.rules_file.isEmpty() && rules->load(config.rules_file, &rules_error) != 0)
+    logger.warning("Invalid rules file " + config.rules_file.toStdString() + " (" + rules_error.toStdString() + ")! Intercepting every exchange instead.");
+
+  for(unsigned int id = 0; id < config.workers; id++) {
+
+    // Initialize classes:
+    server_t = new QThread;
+    server = new Server(config, id, gate, dns_cache, rules, cache);
+
+    // If the server initializes, start the thread:
+    if(server->init() == 0) {
+      server->moveToThread(server_t);
+      config_server_thread(server, server_t);
+      servers.append(server);
+      server_threads.append(server_t);
+      last_exchanges.append(0);
+      server_t->start();
+    }
+
+    // Else, schedule the thread and the server for deletion:
+    else {
+      logger.error("Failed to initialize server worker " + to_string(id) + "!");
+      server->deleteLater();
+      server_t->deleteLater();
+    }
+
   }
 
-  // Else, schedule the thread and the server for deletion:
-  else {
+  if(servers.isEmpty()) {
     logger.error("Failed to initialize server!");
-    server->deleteLater();
-    server_t->deleteLater();
     return -1;
   }
 
+  logger.info("Started " + to_string(servers.size()) + " server workers.");
+
   return 0;
 
 }
@@ -123,7 +173,7 @@ void MainWindow::start_tools() {
 
   // Initialize classes:
   tools_t = new QThread;
-  spider = new SpiderDumper;
+  spider = new SpiderDumper(dns_cache);
 
   // Move classes to the thread:
   spider->moveToThread(tools_t);
@@ -137,34 +187,132 @@ void MainWindow::start_tools() {
 // Private methods:
 
 /**
- * @fn in_port_t MainWindow::server_port()
- * @brief Method to determine the Server class port number.
- * @returns Returns the port number used by the Server class.
+ * @fn ServerConfig MainWindow::server_config()
+ * @brief Method to determine the Server class configuration.
+ * @returns Returns the configuration used by the Server workers.
+ *
+ * This method receives the program arguments and uses them to configure the
+ * Server workers. If the user provided a valid port number as a program
+ * argument, it is used by the Server. Else, we use the default port number
+ * specified in the Server module.
+ *
+ * The number of workers is given by the '-w' ('--workers') option. If it is
+ * missing or invalid, one worker per CPU core is started.
+ *
+ * The '--dns-server' option sets the DNS server ('address[:port]') used
+ * instead of the one in '/etc/resolv.conf', and the '--hosts' option loads
+ * static host addresses from a file in the '/etc/hosts' format, on top of
+ * '/etc/hosts' itself.
+ *
+ * The '--rules' option loads the interception rules from a file, so only the
+ * exchanges they choose stop at the gate (see RuleSet for the file format).
+ *
+ * The '--pass-through' option disables the gate: exchanges are not shown to
+ * the user and the answers are spliced from the websites to the clients.
+ *
+ * The '--preview' option sets how many body bytes of a website answer are
+ * shown at the gate. The rest of a larger answer is relayed to the client.
+ *
+ * The '--client-idle' option sets how long (in seconds) an idle client
+ * connection is kept open between two requests.
+ *
+ * The '--upstream-idle' and '--upstream-per-host' options set how long (in
+ * seconds) and how many idle website connections each worker keeps open for
+ * a website. An upstream limit of 0 disables website connection reuse.
+ *
+ * The '--connect-timeout' option sets how long (in seconds) the connection
+ * attempts to a website may take before the request fails.
+ *
+ * The '--tunnel-idle' option sets how long (in seconds) a CONNECT tunnel with
+ * no traffic is kept open.
  *
- * This method receives the program arguments and uses it to determine the port
- * number used by the Server class. If the user provided a valid port number as
- * a program argument, it is used by the Server. Else, we use the default port
- * number specified in the Server module.
+ * The '--cache-size' option sets the memory budget (in MB) of the HTTP cache
+ * shared by the workers. A size of 0 disables the cache.
+ *
+ * The '--disk-cache' option adds a persistent tier to the HTTP cache, kept in
+ * the directory given and reused by the next runs. The '--disk-cache-size'
+ * option sets its disk budget (in MB), at least one segment.
  *
  */
 
-in_port_t MainWindow::server_port() {
-
-  const QStringList args = QCoreApplication::arguments();
-  in_port_t port_num;
+ServerConfig MainWindow::server_config() {
+
+  QCommandLineParser args;
+  QCommandLineOption workers_option(QStringList() << "w" << "workers",
+                                    "Number of server workers.", "workers");
+  QCommandLineOption dns_server_option("dns-server",
+                                       "DNS server (address[:port]).",
+                                       "server");
+  QCommandLineOption hosts_option("hosts",
+                                  "File with static host addresses.",
+                                  "file");
+  QCommandLineOption rules_option("rules",
+                                  "File with the interception rules.",
+                                  "file");
+  QCommandLineOption pass_through_option("pass-through",
+                                         "Skip the gate and splice the answers.");
+  QCommandLineOption preview_option("preview",
+                                    "Body bytes of an answer shown at the gate.",
+                                    "bytes");
+  QCommandLineOption client_idle_option("client-idle",
+                                        "Seconds an idle client connection is kept.",
+                                        "seconds");
+  QCommandLineOption idle_option("upstream-idle",
+                                 "Seconds an idle website connection is kept.",
+                                 "seconds");
+  QCommandLineOption per_host_option("upstream-per-host",
+                                     "Idle connections kept per website.",
+                                     "connections");
+  QCommandLineOption connect_timeout_option("connect-timeout",
+                                            "Seconds a website connection may take.",
+                                            "seconds");
+  QCommandLineOption tunnel_idle_option("tunnel-idle",
+                                        "Seconds an idle tunnel is kept.",
+                                        "seconds");
+  QCommandLineOption cache_size_option("cache-size",
+                                       "Memory (in MB) of the HTTP cache.",
+                                       "megabytes");
+  QCommandLineOption disk_cache_option("disk-cache",
+                                       "Directory of the disk cache.",
+                                       "directory");
+  QCommandLineOption disk_cache_size_option("disk-cache-size",
+                                            "Disk space (in MB) of the disk cache.",
+                                            "megabytes");
+  ServerConfig config;
   unsigned int arg_port_num;
+  int arg_workers, arg_preview, arg_client_idle, arg_idle, arg_per_host;
+  int arg_connect_timeout, arg_tunnel_idle, arg_cache_size, arg_disk_cache_size;
+
+  args.addPositionalArgument("port", "Port number used by the proxy.");
+  args.addOption(workers_option);
+  args.addOption(dns_server_option);
+  args.addOption(hosts_option);
+  args.addOption(rules_option);
+  args.addOption(pass_through_option);
+  args.addOption(preview_option);
+  args.addOption(client_idle_option);
+  args.addOption(idle_option);
+  args.addOption(per_host_option);
+  args.addOption(connect_timeout_option);
+  args.addOption(tunnel_idle_option);
+  args.addOption(cache_size_option);
+  args.addOption(disk_cache_option);
+  args.addOption(disk_cache_size_option);
+
+  if(!args.parse(QCoreApplication::arguments()))
+    logger.warning("Invalid arguments: " + args.errorText().toStdString());
 
   // Check for a specific port number:
-  if(args.count() == 2) {
-    arg_port_num = unsigned (args[1].toInt());
+  if(args.positionalArguments().count() == 1) {
+    arg_port_num = unsigned (args.positionalArguments()[0].toInt());
 
     // Valid port number:
     if(arg_port_num <= 65535)
-      port_num = in_port_t (arg_port_num);
+      config.port_number = in_port_t (arg_port_num);
 
     // Invalid port number:
     else {
-      port_num = DEFAULT_PORT;
+      config.port_number = DEFAULT_PORT;
       logger.warning("Invalid port number argument! Using default port " + to_string(DEFAULT_PORT) + " instead.");
     }
 
@@ -172,22 +320,127 @@ in_port_t MainWindow::server_port() {
 
   // Else, just use the default:
   else
-    port_num = DEFAULT_PORT;
+    config.port_number = DEFAULT_PORT;
+
+  // Check for a specific number of workers:
+  arg_workers = args.isSet(workers_option) ? args.value(workers_option).toInt() : DEFAULT_WORKERS;
+
+  if(arg_workers < 0) {
+    logger.warning("Invalid number of workers! Using one worker per CPU core instead.");
+    arg_workers = 0;
+  }
+
+  if(arg_workers == 0)
+    arg_workers = QThread::idealThreadCount();
+
+  config.workers = arg_workers > 0 ? unsigned (arg_workers) : 1;
+
+  // Check for a specific DNS server and hosts file:
+  config.dns_server = args.value(dns_server_option);
+  config.hosts_file = args.value(hosts_option);
+
+  // Check for an interception rules file:
+  config.rules_file = args.value(rules_option);
+
+  // Check for the pass-through mode:
+  config.pass_through = args.isSet(pass_through_option);
+
+  // Check for a specific preview size:
+  arg_preview = args.isSet(preview_option) ? args.value(preview_option).toInt() : PREVIEW_SIZE;
+
+  if(arg_preview < 0 || arg_preview > PREVIEW_SIZE) {
+    logger.warning("Invalid preview size! Using the default preview size instead.");
+    arg_preview = PREVIEW_SIZE;
+  }
+
+  config.preview_size = unsigned (arg_preview);
+
+  // Check for a specific client idle time:
+  arg_client_idle = args.isSet(client_idle_option) ? args.value(client_idle_option).toInt() : CLIENT_IDLE_TIME;
+
+  if(arg_client_idle < 0) {
+    logger.warning("Invalid client idle time! Using the default idle time instead.");
+    arg_client_idle = CLIENT_IDLE_TIME;
+  }
+
+  config.client_idle_time = unsigned (arg_client_idle);
+
+  // Check for specific upstream pool limits:
+  arg_idle = args.isSet(idle_option) ? args.value(idle_option).toInt() : POOL_MAX_IDLE_TIME;
+  arg_per_host = args.isSet(per_host_option) ? args.value(per_host_option).toInt() : POOL_MAX_PER_HOST;
+
+  if(arg_idle < 0 || arg_per_host < 0) {
+    logger.warning("Invalid upstream pool limits! Using the default limits instead.");
+    arg_idle = POOL_MAX_IDLE_TIME;
+    arg_per_host = POOL_MAX_PER_HOST;
+  }
+
+  config.pool_idle_time = unsigned (arg_idle);
+  config.pool_per_host = unsigned (arg_per_host);
+
+  // Check for a specific website connect timeout:
+  arg_connect_timeout = args.isSet(connect_timeout_option) ? args.value(connect_timeout_option).toInt() : CONNECT_TIMEOUT;
+
+  if(arg_connect_timeout <= 0) {
+    logger.warning("Invalid connect timeout! Using the default timeout instead.");
+    arg_connect_timeout = CONNECT_TIMEOUT;
+  }
+
+  config.connect_timeout = unsigned (arg_connect_timeout);
 
-  return port_num;
+  // Check for a specific tunnel idle time:
+  arg_tunnel_idle = args.isSet(tunnel_idle_option) ? args.value(tunnel_idle_option).toInt() : TUNNEL_IDLE_TIME;
+
+  if(arg_tunnel_idle <= 0) {
+    logger.warning("Invalid tunnel idle time! Using the default idle time instead.");
+    arg_tunnel_idle = TUNNEL_IDLE_TIME;
+  }
+
+  config.tunnel_idle_time = unsigned (arg_tunnel_idle);
+
+  // Check for a specific cache size:
+  arg_cache_size = args.isSet(cache_size_option) ? args.value(cache_size_option).toInt() : CACHE_SIZE;
+
+  if(arg_cache_size < 0) {
+    logger.warning("Invalid cache size! Using the default cache size instead.");
+    arg_cache_size = CACHE_SIZE;
+  }
+
+  config.cache_size = unsigned (arg_cache_size);
+
+  // Check for a disk cache:
+  config.disk_cache = args.value(disk_cache_option);
+  arg_disk_cache_size = args.isSet(disk_cache_size_option) ? args.value(disk_cache_size_option).toInt() : DISK_CACHE_SIZE;
+
+  if(arg_disk_cache_size <= 0) {
+    logger.warning("Invalid disk cache size! Using the default disk cache size instead.");
+    arg_disk_cache_size = DISK_CACHE_SIZE;
+  }
+
+  // The budget is enforced a segment at a time, so it holds one at least:
+  else if(arg_disk_cache_size < DISK_SEGMENT_SIZE / 1048576) {
+    logger.warning("Disk cache size smaller than a segment! Using " + to_string(DISK_SEGMENT_SIZE / 1048576) + " MB instead.");
+    arg_disk_cache_size = DISK_SEGMENT_SIZE / 1048576;
+  }
+
+  config.disk_cache_size = unsigned (arg_disk_cache_size);
+
+  return config;
 
 }
 
 /**
- * @fn void MainWindow::config_server_thread()
+ * @fn void MainWindow::config_server_thread(Server *server, QThread *server_t)
  * @brief Method to configure the server thread signals and slots.
+ * @param server Server worker running in the thread.
+ * @param server_t Server worker thread.
  *
  * This method configures the server thread connections using the Qt signals
  * and slots system.
  *
  */
 
-void MainWindow::config_server_thread() {
+void MainWindow::config_server_thread(Server *server, QThread *server_t) {
 
   // Configure server thread signals and slots:
 
@@ -196,17 +449,23 @@ void MainWindow::config_server_thread() {
           SLOT (append(QString)));
 
   // Configure the client request body to be displayed:
-  connect(server, SIGNAL (clientData(QString, QByteArray)), this,
-          SLOT (setClientData(QString, QByteArray)));
+  connect(server, SIGNAL (clientData(QByteArray, QByteArray)), this,
+          SLOT (setClientData(QByteArray, QByteArray)));
 
   // Configure the website request to be displayed:
-  connect(server, SIGNAL (websiteData(QString, QByteArray)), this,
-          SLOT (setWebsiteData(QString, QByteArray)));
+  connect(server, SIGNAL (websiteData(QByteArray, QByteArray)), this,
+          SLOT (setWebsiteData(QByteArray, QByteArray)));
 
   // Configure the gate to erase both requests displayed in text boxes:
   connect(server, SIGNAL (gateOpened()), this, SLOT (clearClientData()));
   connect(server, SIGNAL (gateOpened()), this, SLOT (clearWebsiteData()));
 
+  // Configure the list of exchanges parked at the gate:
+  connect(server, SIGNAL (exchangeParked(quint64, QString)), this,
+          SLOT (addParkedExchange(quint64, QString)));
+  connect(server, SIGNAL (exchangeUnparked(quint64)), this,
+          SLOT (removeParkedExchange(quint64)));
+
   // The server thread should start the server:
   connect(server_t, SIGNAL (started()), server, SLOT (run()));
 
@@ -244,7 +503,8 @@ void MainWindow::config_tools_thread() {
   // Configure the spider host text field to receive updates from the server:
   // REFACTOR: Maybe we should check to see if a spider tree is running
   // before overwriting the host field.
-  connect(server, SIGNAL (newHost(QString)), ui->spider_host, SLOT(setText(QString)));
+  for(Server *server : servers)
+    connect(server, SIGNAL (newHost(QString)), ui->spider_host, SLOT(setText(QString)));
 
   // Configure the spider output to be displayed:
   connect(spider, SIGNAL(updateSpiderTree(QString)), ui->spider_tree, SLOT(setText(QString)));
@@ -257,22 +517,65 @@ void MainWindow::config_tools_thread() {
 
 }
 
+/**
+ * @fn gate_edit MainWindow::user_edit(QTextEdit *headers, QHexEdit *data)
+ * @brief Method to gather the user edits of a message on display.
+ * @param headers Text box holding the message headers.
+ * @param data Hexadecimal edit holding the message data.
+ * @return Returns the edits, to be loaded into the gate.
+ *
+ * Both widgets track whether the user changed them since the message was
+ * displayed, so only the parts the user touched are copied (and checked by
+ * the server). The headers go back to Latin-1 bytes, as they were shown.
+ *
+ */
+
+gate_edit MainWindow::user_edit(QTextEdit *headers, QHexEdit *data) {
+
+  gate_edit edit;
+
+  edit.headers_edited = headers->document()->isModified();
+  edit.data_edited = data->isModified();
+
+  if(edit.headers_edited)
+    edit.headers = headers->toPlainText().toLatin1();
+
+  if(edit.data_edited)
+    edit.data = data->data();
+
+  return edit;
+
+}
+
 // Private slots:
 
 /**
  * @fn void MainWindow::on_button_gate_clicked()
  * @brief This function is executed when button_gate is clicked
  *
- * When button gate is clicked it sends to server the requests and replies
- * stored on textboxes and qhexedits. After that it sets open gate internal server
- * flag with a call to server->open_gate()
+ * When button gate is clicked it sends to the gate the requests and replies
+ * stored on textboxes and qhexedits, if the user edited them. After that it
+ * opens the gate shared by the server workers with a call to gate->open()
  *
  */
 void MainWindow::on_button_gate_clicked() {
-    // !TODO: Fix to add headers
-  server->load_client_request(ui->request_headers->toPlainText(), text_client->data());
-  server->load_website_request(ui->reply_headers->toPlainText(), text_website->data());
-  server->open_gate();
+  gate->load_client_request(user_edit(ui->request_headers, text_client));
+  gate->load_website_request(user_edit(ui->reply_headers, text_website));
+  gate->open();
+}
+
+/**
+ * @fn void MainWindow::on_button_release_clicked()
+ * @brief This function is executed when button_release is clicked
+ *
+ * When button release is clicked, every exchange selected in the list of
+ * parked exchanges is let through the gate unchanged, wherever it is queued.
+ * Edits made to an exchange on display are discarded.
+ *
+ */
+void MainWindow::on_button_release_clicked() {
+  for(QListWidgetItem *item : ui->parked_exchanges->selectedItems())
+    gate->let_through(item->data(Qt::UserRole).toULongLong());
 }
 
 /**
@@ -302,30 +605,32 @@ void MainWindow::on_dumper_push_clicked() {
 }
 
 /**
- * @fn void MainWindow::setClientData(QString headers, QByteArray data)
+ * @fn void MainWindow::setClientData(QByteArray headers, QByteArray data)
  * @brief This is a slot that updates textbox with header data and
  * qhexedit with body data on client side.
- * @param headers QString with headers to be inserted on client textbox
+ * @param headers Raw headers (Latin-1) to be inserted on client textbox
  * @param data Raw data to be inserted on client qhexedit
  *
  */
-void MainWindow::setClientData(QString headers, QByteArray data){
+void MainWindow::setClientData(QByteArray headers, QByteArray data){
     text_client->setData(data);
-    ui->request_headers->setText(headers);
+    ui->request_headers->setText(QString::fromLatin1(headers));
+    ui->request_headers->document()->setModified(false);
 }
 
 
 /**
- * @fn void MainWindow::setWebsiteData(QString headers, QByteArray data)
+ * @fn void MainWindow::setWebsiteData(QByteArray headers, QByteArray data)
  * @brief This is a slot that updates textbox with header data and
  * qhexedit with body data on website side.
- * @param headers QString with headers to be inserted on website textbox
+ * @param headers Raw headers (Latin-1) to be inserted on website textbox
  * @param data Raw data to be inserted on website qhexedit
  *
  */
-void MainWindow::setWebsiteData(QString headers, QByteArray data){
+void MainWindow::setWebsiteData(QByteArray headers, QByteArray data){
     text_website->setData(data);
-    ui->reply_headers->setText(headers);
+    ui->reply_headers->setText(QString::fromLatin1(headers));
+    ui->reply_headers->document()->setModified(false);
 }
 
 
@@ -336,6 +641,7 @@ void MainWindow::setWebsiteData(QString headers, QByteArray data){
 void MainWindow::clearClientData(){
     text_client->setData(QByteArray());
     ui->request_headers->clear();
+    ui->request_headers->document()->setModified(false);
 }
 
 /**
@@ -345,4 +651,67 @@ void MainWindow::clearClientData(){
 void MainWindow::clearWebsiteData(){
     text_website->setData(QByteArray());
     ui->reply_headers->clear();
+    ui->reply_headers->document()->setModified(false);
+}
+
+/**
+ * @fn void MainWindow::addParkedExchange(quint64 ticket, QString summary)
+ * @brief This is a slot that lists an exchange parked at the gate
+ * @param ticket Ticket of the exchange at the gate
+ * @param summary Description of the exchange (method and URL)
+ */
+void MainWindow::addParkedExchange(quint64 ticket, QString summary){
+    QListWidgetItem *item = new QListWidgetItem(summary);
+    item->setData(Qt::UserRole, QVariant(ticket));
+    ui->parked_exchanges->addItem(item);
+}
+
+/**
+ * @fn void MainWindow::removeParkedExchange(quint64 ticket)
+ * @brief This is a slot that removes an exchange that left the gate from the list
+ * @param ticket Ticket of the exchange at the gate
+ */
+void MainWindow::removeParkedExchange(quint64 ticket){
+    for(int i = 0; i < ui->parked_exchanges->count(); i++){
+        if(ui->parked_exchanges->item(i)->data(Qt::UserRole).toULongLong() == ticket){
+            delete ui->parked_exchanges->takeItem(i);
+            return;
+        }
+    }
+}
+
+/**
+ * @fn void MainWindow::updateStats()
+ * @brief This is a slot that shows the server worker counters in the status bar
+ *
+ * Shows the number of exchanges answered per second by all workers together
+ * and by each worker, so the scaling across CPU cores can be checked, along
+ * with the hit ratio of the HTTP cache, the website bytes it saved and the
+ * requests it collapsed into identical ones in flight.
+ */
+void MainWindow::updateStats(){
+    QString message;
+    quint64 exchanges, total_rate = 0, hits, lookups;
+    QStringList worker_rates;
+
+    for(int i = 0; i < servers.size(); i++){
+        exchanges = servers[i]->get_stats()->exchanges.load();
+        worker_rates << QString::number((exchanges - last_exchanges[i]) * 1000 / STATS_INTERVAL);
+        total_rate += (exchanges - last_exchanges[i]) * 1000 / STATS_INTERVAL;
+        last_exchanges[i] = exchanges;
+    }
+
+    message = "Workers: " + QString::number(servers.size()) +
+              " | Exchanges/s: " + QString::number(total_rate) +
+              " (" + worker_rates.join(", ") + ")";
+
+    if(!cache.isNull() && cache->enabled()){
+        hits = cache->get_stats()->hits.load();
+        lookups = hits + cache->get_stats()->misses.load();
+        message += " | Cache hits: " + QString::number(lookups > 0 ? hits * 100 / lookups : 0) + "%" +
+                   " | Saved: " + QString::number(cache->get_stats()->saved_bytes.load() / 1024) + " KB" +
+                   " | Collapsed: " + QString::number(cache->get_stats()->collapsed.load());
+    }
+
+    ui->statusBar->showMessage(message);
 }
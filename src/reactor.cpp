@@ -0,0 +1,182 @@
+// Reactor module - Source code.
+
+/**
+ * @file reactor.cpp
+ * @brief Reactor module - Source code.
+ *
+ * The reactor module contains a small wrapper around the Linux epoll
+ * interface, used by the proxy server to wait for activity on many sockets at
+ * once, a monotonic clock used to measure timeouts and the wake up of a
+ * worker through its eventfd. This source file contains the function and
+ * class method implementations for this module.
+ *
+ */
+
+// Includes:
+#include "include/reactor.h"
+
+// Function implementations:
+
+/**
+ * @fn long long monotonic_ms()
+ * @brief Function to read a monotonic clock.
+ * @return Returns the current time of the monotonic clock, in milliseconds.
+ *
+ * The monotonic clock is not affected by changes to the system time, so it is
+ * the right clock to measure timeouts with. Its origin is unspecified, so
+ * only differences between its values are meaningful.
+ *
+ */
+
+long long monotonic_ms() {
+
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return static_cast<long long> (now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+
+}
+
+/**
+ * @fn void wake_eventfd(int fd)
+ * @brief Function to wake the worker reading an eventfd.
+ * @param fd File descriptor of the eventfd (non-blocking).
+ *
+ * Adds 1 to the eventfd counter, which makes it readable until the worker
+ * reads it. Used by the objects shared by the workers (the Gate and the
+ * HTTPCache) to make a worker look at them.
+ *
+ */
+
+void wake_eventfd(int fd) {
+
+  uint64_t one = 1;
+  ssize_t written;
+
+  written = write(fd, &one, sizeof(one));
+
+  // The only failure of a valid eventfd is EAGAIN, when its counter is full:
+  // the worker was woken already and has not read it yet, so nothing is lost.
+  static_cast<void> (written);
+
+}
+
+// Class methods:
+
+/**
+ * @fn Reactor::Reactor()
+ * @brief Class constructor for the Reactor class.
+ *
+ * This constructor creates a new instance of the Reactor class. The epoll
+ * instance is only created by the init() method.
+ *
+ */
+
+Reactor::Reactor() : epoll_fd(-1) {
+
+}
+
+/**
+ * @fn Reactor::~Reactor()
+ * @brief Class destructor for the Reactor class.
+ *
+ * This destructor closes the epoll instance, if one was created.
+ *
+ */
+
+Reactor::~Reactor() {
+  if(epoll_fd != -1)
+    close(epoll_fd);
+}
+
+// Public methods:
+
+/**
+ * @fn int Reactor::init()
+ * @brief Method to create the epoll instance used by the Reactor.
+ * @return Returns 0 when successfully executed and -1 if an error occurs.
+ *
+ * You should always call this method BEFORE arming any file descriptor.
+ *
+ */
+
+int Reactor::init() {
+
+  if((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+    return -1;
+
+  return 0;
+
+}
+
+/**
+ * @fn int Reactor::arm(int fd, unsigned int events, void *data)
+ * @brief Method to wait for events on a file descriptor.
+ * @param fd File descriptor to be watched.
+ * @param events Epoll events of interest (EPOLLIN, EPOLLOUT...).
+ * @param data Opaque pointer reported together with the events.
+ * @return Returns 0 when successfully executed and -1 if an error occurs.
+ *
+ * This method arms a file descriptor in one-shot mode. If the file descriptor
+ * is already known by the epoll instance, its interest list is modified.
+ * Otherwise, it is added to the epoll instance.
+ *
+ */
+
+int Reactor::arm(int fd, unsigned int events, void *data) {
+
+  struct epoll_event event;
+
+  event.events = events | EPOLLONESHOT;
+  event.data.ptr = data;
+
+  // Most of the time the descriptor was armed before, so try that first:
+  if(epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0)
+    return 0;
+
+  if(errno == ENOENT && epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0)
+    return 0;
+
+  return -1;
+
+}
+
+/**
+ * @fn int Reactor::remove(int fd)
+ * @brief Method to stop watching a file descriptor.
+ * @param fd File descriptor to be removed from the epoll instance.
+ * @return Returns 0 when successfully executed and -1 if an error occurs.
+ *
+ * Closing a file descriptor already removes it from the epoll instance, so
+ * this method is only needed when a descriptor is kept open.
+ *
+ */
+
+int Reactor::remove(int fd) {
+  return epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+/**
+ * @fn int Reactor::wait(struct epoll_event *events, int max_events, int timeout)
+ * @brief Method to wait for events on the armed file descriptors.
+ * @param events Array where the reported events are stored.
+ * @param max_events Size of the events array.
+ * @param timeout Maximum time to wait, in milliseconds.
+ * @return Returns the number of events reported and -1 if an error occurs.
+ *
+ * A wait interrupted by a signal is not considered an error and reports no
+ * events.
+ *
+ */
+
+int Reactor::wait(struct epoll_event *events, int max_events, int timeout) {
+
+  int ready = epoll_wait(epoll_fd, events, max_events, timeout);
+
+  if(ready == -1 && errno == EINTR)
+    return 0;
+
+  return ready;
+
+}
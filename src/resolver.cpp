@@ -0,0 +1,825 @@
+// Resolver module - Source code.
+
+/**
+ * @file resolver.cpp
+ * @brief Resolver module - Source code.
+ *
+ * The resolver module contains the implementation of an asynchronous DNS
+ * resolver with a cache shared by every thread of the application. It replaces
+ * the blocking gethostbyname calls made by the proxy server and by the spider.
+ * Both IPv4 (A) and IPv6 (AAAA) addresses are resolved. This source file
+ * contains the class method implementations for this module.
+ *
+ */
+
+// Includes:
+#include "include/resolver.h"
+
+// DNSCache class methods:
+
+/**
+ * @fn DNSCache::DNSCache()
+ * @brief Class constructor for the DNSCache class.
+ *
+ * This constructor creates an empty cache. Until set_server() is called, the
+ * DNS server is the local host.
+ *
+ */
+
+DNSCache::DNSCache() {
+  memset(&server_addr, 0, sizeof(server_addr));
+  server_addr.sin_family = AF_INET;
+  server_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  server_addr.sin_port = htons(RESOLVER_PORT);
+}
+
+/**
+ * @fn DNSCache::~DNSCache()
+ * @brief Class destructor for the DNSCache class.
+ *
+ * This destructor destroys an instance of the DNSCache class. It is currently
+ * empty!
+ *
+ */
+
+DNSCache::~DNSCache() {
+
+}
+
+// DNSCache public methods:
+
+/**
+ * @fn bool DNSCache::lookup(QString host, quint16 type, dns_entry *entry)
+ * @brief Method to look a host up in the cache.
+ * @param host Name of the host (lower case).
+ * @param type Record type (DNS_TYPE_A or DNS_TYPE_AAAA).
+ * @param entry Address to store the cached entry.
+ * @return Returns true if the host has an entry that did not expire.
+ */
+
+bool DNSCache::lookup(QString host, quint16 type, dns_entry *entry) {
+
+  QHash<QString, dns_entry>::iterator cached;
+  bool found = false;
+
+  cache_mutex.lock();
+
+  cached = entries.find(key(host, type));
+
+  if(cached != entries.end()) {
+    if(cached.value().expires == -1 || cached.value().expires > monotonic_ms()) {
+      *entry = cached.value();
+      found = true;
+    }
+    else
+      entries.erase(cached);
+  }
+
+  cache_mutex.unlock();
+
+  return found;
+
+}
+
+/**
+ * @fn int DNSCache::load_hosts(QString file_name)
+ * @brief Method to load static host addresses from a hosts file.
+ * @param file_name Name of the hosts file.
+ * @return Returns 0 when successfully executed and -1 if the file can not be
+ * read.
+ *
+ * The file follows the format of '/etc/hosts': each line has an address
+ * followed by the names of the hosts with that address, and '#' starts a
+ * comment. The entries loaded never expire and take precedence over the DNS
+ * server: a host listed with IPv4 addresses only is never asked for its IPv6
+ * addresses, and the other way around.
+ *
+ */
+
+int DNSCache::load_hosts(QString file_name) {
+
+  QFile file(file_name);
+  QStringList fields;
+  struct sockaddr_storage addr;
+  struct sockaddr_in *addr4 = reinterpret_cast<struct sockaddr_in*> (&addr);
+  struct sockaddr_in6 *addr6 = reinterpret_cast<struct sockaddr_in6*> (&addr);
+  quint16 type;
+  dns_entry none;
+
+  if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    return -1;
+
+  QTextStream hosts(&file);
+
+  none.expires = -1;
+
+  cache_mutex.lock();
+
+  while(!hosts.atEnd()) {
+
+    fields = hosts.readLine().section('#', 0, 0).simplified().split(' ');
+    memset(&addr, 0, sizeof(addr));
+
+    if(fields.size() < 2)
+      continue;
+
+    if(inet_pton(AF_INET, fields[0].toStdString().c_str(), &(addr4->sin_addr)) == 1) {
+      addr.ss_family = AF_INET;
+      type = DNS_TYPE_A;
+    }
+    else if(inet_pton(AF_INET6, fields[0].toStdString().c_str(), &(addr6->sin6_addr)) == 1) {
+      addr.ss_family = AF_INET6;
+      type = DNS_TYPE_AAAA;
+    }
+    else
+      continue;
+
+    for(int i = 1; i < fields.size(); i++) {
+
+      QString host = fields[i].toLower();
+
+      // Hide the other family from the DNS server as well:
+      if(!entries.contains(key(host, DNS_TYPE_A)))
+        entries.insert(key(host, DNS_TYPE_A), none);
+      if(!entries.contains(key(host, DNS_TYPE_AAAA)))
+        entries.insert(key(host, DNS_TYPE_AAAA), none);
+
+      entries[key(host, type)].addrs.append(addr);
+
+    }
+
+  }
+
+  cache_mutex.unlock();
+
+  return 0;
+
+}
+
+/**
+ * @fn int DNSCache::set_server(QString server)
+ * @brief Method to choose the DNS server.
+ * @param server Address of the DNS server ('address' or 'address:port'). If
+ * empty, the first IPv4 name server of RESOLVER_CONF_FILE is used.
+ * @return Returns 0 when successfully executed and -1 if the address is
+ * invalid or no name server was found.
+ */
+
+int DNSCache::set_server(QString server) {
+
+  QFile file(RESOLVER_CONF_FILE);
+  QStringList fields;
+  struct sockaddr_in addr;
+  int port = RESOLVER_PORT;
+
+  // Look for the name server of the system:
+  if(server.isEmpty() && file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+
+    QTextStream conf(&file);
+
+    while(!conf.atEnd() && server.isEmpty()) {
+      fields = conf.readLine().section('#', 0, 0).simplified().split(' ');
+      if(fields.size() >= 2 && fields[0] == "nameserver" && !fields[1].contains(':'))
+        server = fields[1];
+    }
+
+  }
+
+  if(server.contains(':')) {
+    port = server.section(':', 1).toInt();
+    server = server.section(':', 0, 0);
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(static_cast<in_port_t> (port));
+
+  if(port <= 0 || port > 65535 ||
+     inet_pton(AF_INET, server.toStdString().c_str(), &(addr.sin_addr)) != 1)
+    return -1;
+
+  cache_mutex.lock();
+  server_addr = addr;
+  cache_mutex.unlock();
+
+  return 0;
+
+}
+
+/**
+ * @fn struct sockaddr_in DNSCache::server()
+ * @brief Method to get the address of the DNS server.
+ * @return Returns the address of the DNS server.
+ */
+
+struct sockaddr_in DNSCache::server() {
+
+  struct sockaddr_in addr;
+
+  cache_mutex.lock();
+  addr = server_addr;
+  cache_mutex.unlock();
+
+  return addr;
+
+}
+
+/**
+ * @fn void DNSCache::store(QString host, quint16 type, dns_entry entry)
+ * @brief Method to store the result of a resolution in the cache.
+ * @param host Name of the host (lower case).
+ * @param type Record type (DNS_TYPE_A or DNS_TYPE_AAAA).
+ * @param entry Entry to be stored.
+ *
+ * Entries loaded from the hosts file are never replaced. If the cache is full,
+ * the expired entries are dropped first and, if that is not enough, an
+ * arbitrary entry that could expire is dropped.
+ *
+ */
+
+void DNSCache::store(QString host, quint16 type, dns_entry entry) {
+
+  QHash<QString, dns_entry>::iterator cached;
+  long long now = monotonic_ms();
+
+  host = key(host, type);
+
+  cache_mutex.lock();
+
+  cached = entries.find(host);
+
+  if(cached != entries.end() && cached.value().expires == -1) {
+    cache_mutex.unlock();
+    return;
+  }
+
+  if(cached == entries.end() && entries.size() >= RESOLVER_CACHE_SIZE) {
+
+    for(cached = entries.begin(); cached != entries.end();) {
+      if(cached.value().expires != -1 && cached.value().expires <= now)
+        cached = entries.erase(cached);
+      else
+        ++cached;
+    }
+
+    for(cached = entries.begin(); cached != entries.end() &&
+        entries.size() >= RESOLVER_CACHE_SIZE;) {
+      if(cached.value().expires != -1)
+        cached = entries.erase(cached);
+      else
+        ++cached;
+    }
+
+  }
+
+  entries.insert(host, entry);
+
+  cache_mutex.unlock();
+
+}
+
+/**
+ * @fn QString DNSCache::key(QString host, quint16 type)
+ * @brief Method to build the key of a host and record type.
+ * @param host Name of the host (lower case).
+ * @param type Record type (DNS_TYPE_A or DNS_TYPE_AAAA).
+ * @return Returns the key of the cache entry ('host/type').
+ */
+
+QString DNSCache::key(QString host, quint16 type) {
+  return host + '/' + QString::number(type);
+}
+
+// Resolver class methods:
+
+/**
+ * @fn Resolver::Resolver(QSharedPointer<DNSCache> cache)
+ * @brief Class constructor for the Resolver class.
+ * @param cache Cache shared by every Resolver.
+ *
+ * The UDP socket of the Resolver is only created by the init() method.
+ *
+ */
+
+Resolver::Resolver(QSharedPointer<DNSCache> cache) : fd(-1), cache(cache) {
+  std::random_device seed;
+  random.seed(seed());
+}
+
+/**
+ * @fn Resolver::~Resolver()
+ * @brief Class destructor for the Resolver class.
+ *
+ * This destructor closes the UDP socket of the Resolver. Lookups still
+ * waiting are dropped.
+ *
+ */
+
+Resolver::~Resolver() {
+  if(fd != -1)
+    close(fd);
+}
+
+// Resolver public methods:
+
+/**
+ * @fn int Resolver::get_fd()
+ * @brief Method to get the file descriptor of the Resolver socket.
+ * @return Returns the file descriptor to be watched for answers.
+ */
+
+int Resolver::get_fd() {
+  return fd;
+}
+
+/**
+ * @fn int Resolver::init()
+ * @brief Method to create the UDP socket used by the Resolver.
+ * @return Returns 0 when successfully executed and -1 if an error occurs.
+ *
+ * The socket is connected to the DNS server, so answers from any other address
+ * are discarded by the kernel.
+ *
+ */
+
+int Resolver::init() {
+
+  struct sockaddr_in server_addr = cache->server();
+
+  if((fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1)
+    return -1;
+
+  if(connect(fd, reinterpret_cast<struct sockaddr*> (&server_addr),
+             sizeof(server_addr)) != 0) {
+    close(fd);
+    fd = -1;
+    return -1;
+  }
+
+  return 0;
+
+}
+
+/**
+ * @fn int Resolver::resolve(QString host, QList<struct sockaddr_storage> *addrs, void *waiter)
+ * @brief Method to find the IPv4 and IPv6 addresses of a host.
+ * @param host Name (or IPv4 or IPv6 address) of the host.
+ * @param addrs Address of a list to store the addresses found (port 0).
+ * @param waiter Opaque pointer reported once the lookup finishes.
+ * @return Returns 0 if at least one address was found, RESOLVER_PENDING if
+ * the lookup waits for the DNS server and -1 if the host could not be
+ * resolved.
+ *
+ * If the host is not cached, the queries for both record types are sent to
+ * the DNS server (unless they are already waiting for an answer) and the
+ * waiter is reported by process() or expire() every time one of them
+ * finishes. Calling this method again for the same waiter before that does not
+ * send other queries.
+ *
+ * The addresses found alternate between the families, starting with IPv6, as
+ * suggested by RFC 8305 (section 4), so connection attempts made in that order
+ * try both families early.
+ *
+ */
+
+int Resolver::resolve(QString host, QList<struct sockaddr_storage> *addrs,
+                      void *waiter) {
+
+  static const quint16 types[2] = {DNS_TYPE_AAAA, DNS_TYPE_A};
+  QHash<QString, dns_query>::iterator query;
+  QList<struct sockaddr_storage> found[2];
+  struct sockaddr_storage addr;
+  dns_query new_query;
+  dns_entry entry;
+  bool pending = false;
+
+  addrs->clear();
+  memset(&addr, 0, sizeof(addr));
+
+  // Addresses need no resolution:
+  if(inet_pton(AF_INET, host.toStdString().c_str(),
+               &(reinterpret_cast<struct sockaddr_in*> (&addr)->sin_addr)) == 1)
+    addr.ss_family = AF_INET;
+  else if(inet_pton(AF_INET6, host.toStdString().c_str(),
+                    &(reinterpret_cast<struct sockaddr_in6*> (&addr)->sin6_addr)) == 1)
+    addr.ss_family = AF_INET6;
+
+  if(addr.ss_family != 0) {
+    addrs->append(addr);
+    return 0;
+  }
+
+  host = host.toLower();
+
+  for(int i = 0; i < 2; i++) {
+
+    if(cache->lookup(host, types[i], &entry)) {
+
+      found[i] = entry.addrs;
+
+      // Another thread may have cached the host before our answer arrived:
+      if((query = queries.find(DNSCache::key(host, types[i]))) != queries.end())
+        query.value().waiters.removeAll(waiter);
+
+      continue;
+
+    }
+
+    pending = true;
+
+    // Wait for the query already sent for the host:
+    if((query = queries.find(DNSCache::key(host, types[i]))) != queries.end()) {
+      if(!query.value().waiters.contains(waiter))
+        query.value().waiters.append(waiter);
+      continue;
+    }
+
+    new_query.host = host;
+    new_query.type = types[i];
+    new_query.attempts = 0;
+    new_query.waiters.clear();
+    new_query.waiters.append(waiter);
+
+    if(fd == -1 || send_query(&new_query) != 0)
+      return -1;
+
+    queries.insert(DNSCache::key(host, types[i]), new_query);
+
+  }
+
+  if(pending)
+    return RESOLVER_PENDING;
+
+  for(int i = 0; i < found[0].size() || i < found[1].size(); i++) {
+    if(i < found[0].size())
+      addrs->append(found[0][i]);
+    if(i < found[1].size())
+      addrs->append(found[1][i]);
+  }
+
+  return addrs->isEmpty() ? -1 : 0;
+
+}
+
+/**
+ * @fn int Resolver::resolve_wait(QString host, QList<struct sockaddr_storage> *addrs)
+ * @brief Method to find the addresses of a host, blocking until it is done.
+ * @param host Name (or IPv4 or IPv6 address) of the host.
+ * @param addrs Address of a list to store the addresses found (port 0).
+ * @return Returns 0 if at least one address was found and -1 if the host
+ * could not be resolved.
+ *
+ * This method is meant for threads without an event loop. It waits for the
+ * Resolver socket itself, for at most RESOLVER_ATTEMPTS * RESOLVER_TIMEOUT
+ * milliseconds.
+ *
+ */
+
+int Resolver::resolve_wait(QString host, QList<struct sockaddr_storage> *addrs) {
+
+  struct pollfd answer;
+  QList<void*> done;
+  int return_code;
+
+  answer.fd = fd;
+  answer.events = POLLIN;
+
+  while((return_code = resolve(host, addrs, this)) == RESOLVER_PENDING) {
+
+    if(poll(&answer, 1, RESOLVER_TIMEOUT) > 0)
+      process(&done);
+
+    expire(&done);
+
+  }
+
+  return return_code;
+
+}
+
+/**
+ * @fn void Resolver::cancel(void *waiter)
+ * @brief Method to stop reporting a waiter.
+ * @param waiter Opaque pointer given to resolve().
+ *
+ * The queries themselves are kept, since other lookups may wait for them and
+ * their answers are cached anyway.
+ *
+ */
+
+void Resolver::cancel(void *waiter) {
+  for(dns_query &query : queries)
+    query.waiters.removeAll(waiter);
+}
+
+/**
+ * @fn void Resolver::expire(QList<void*> *done)
+ * @brief Method to handle the queries that are not answered in time.
+ * @param done Address of a list where the finished waiters are appended.
+ *
+ * A query not answered in RESOLVER_TIMEOUT milliseconds is sent again, up to
+ * RESOLVER_ATTEMPTS times. After that, the resolution fails and the failure is
+ * cached for RESOLVER_FAILURE_TTL seconds.
+ *
+ */
+
+void Resolver::expire(QList<void*> *done) {
+
+  QHash<QString, dns_query>::iterator query;
+  long long now = monotonic_ms();
+  dns_entry failure;
+
+  failure.expires = now + RESOLVER_FAILURE_TTL * 1000;
+
+  for(query = queries.begin(); query != queries.end();) {
+
+    if(now - query.value().sent < RESOLVER_TIMEOUT ||
+       (query.value().attempts < RESOLVER_ATTEMPTS &&
+        send_query(&(query.value())) == 0)) {
+      ++query;
+      continue;
+    }
+
+    cache->store(query.value().host, query.value().type, failure);
+    done->append(query.value().waiters);
+    query = queries.erase(query);
+
+  }
+
+}
+
+/**
+ * @fn void Resolver::process(QList<void*> *done)
+ * @brief Method to read the answers received by the Resolver socket.
+ * @param done Address of a list where the finished waiters are appended.
+ *
+ * Every answer waiting in the socket is read and cached. Answers that do not
+ * match a query waiting for them (wrong identifier or host) are discarded.
+ *
+ */
+
+void Resolver::process(QList<void*> *done) {
+
+  unsigned char message[RESOLVER_MESSAGE_SIZE];
+  QHash<QString, dns_query>::iterator query;
+  ssize_t received;
+  quint16 id, type;
+  QString host;
+  dns_entry entry;
+
+  while(true) {
+
+    if((received = recv(fd, message, sizeof(message), 0)) == -1) {
+      if(errno == ECONNREFUSED || errno == EINTR)
+        continue;   // Reported by an earlier query, keep reading.
+      return;
+    }
+
+    if(parse_answer(message, static_cast<size_t> (received), &id, &host, &type,
+                    &entry) != 0)
+      continue;
+
+    query = queries.find(DNSCache::key(host, type));
+
+    if(query == queries.end() || query.value().id != id)
+      continue;
+
+    cache->store(host, type, entry);
+    done->append(query.value().waiters);
+    queries.erase(query);
+
+  }
+
+}
+
+// Resolver private methods:
+
+/**
+ * @fn int Resolver::send_query(dns_query *query)
+ * @brief Method to send a query for the addresses of a host.
+ * @param query Address of the query, updated with the new identifier.
+ * @return Returns 0 when successfully executed and -1 if an error occurs.
+ *
+ * Each attempt uses a new random identifier, so late answers to an earlier
+ * attempt are discarded.
+ *
+ */
+
+int Resolver::send_query(dns_query *query) {
+
+  QByteArray message, label;
+  quint16 id = static_cast<quint16> (random());
+
+  // Header: identifier, recursion desired and a single question:
+  message.append(static_cast<char> (id >> 8));
+  message.append(static_cast<char> (id & 0xFF));
+  message.append("\x01\x00\x00\x01\x00\x00\x00\x00\x00\x00", 10);
+
+  // Question: host name labels, type and class IN:
+  for(QString part : query->host.split('.')) {
+
+    if(part.isEmpty())
+      continue;
+
+    label = part.toLatin1();
+
+    if(label.size() > 63)
+      return -1;
+
+    message.append(static_cast<char> (label.size()));
+    message.append(label);
+
+  }
+
+  message.append('\0');
+  message.append(static_cast<char> (query->type >> 8));
+  message.append(static_cast<char> (query->type & 0xFF));
+  message.append("\x00\x01", 2);
+
+  if(message.size() > RESOLVER_MESSAGE_SIZE ||
+     send(fd, message.constData(), static_cast<size_t> (message.size()), 0) == -1)
+    return -1;
+
+  query->id = id;
+  query->attempts++;
+  query->sent = monotonic_ms();
+
+  return 0;
+
+}
+
+/**
+ * @fn int Resolver::parse_answer(unsigned char *message, size_t size, quint16 *id, QString *host, quint16 *type, dns_entry *entry)
+ * @brief Method to parse a DNS answer.
+ * @param message Address of the message received.
+ * @param size Size of the message.
+ * @param id Address to store the message identifier.
+ * @param host Address to store the host asked for.
+ * @param type Address to store the record type asked for.
+ * @param entry Address to store the cache entry built from the answer.
+ * @return Returns 0 when successfully executed and -1 if the message is not a
+ * valid answer.
+ *
+ * Every record of the type asked for (A or AAAA) is used, and the entry
+ * expires after the smallest TTL among these and the CNAME records. Answers
+ * without an address build a negative entry: a missing host (NXDOMAIN or no
+ * data) expires after the SOA minimum TTL, or RESOLVER_NEGATIVE_TTL if there
+ * is no SOA record, and server errors expire after RESOLVER_FAILURE_TTL. The
+ * TTL is always kept between RESOLVER_MIN_TTL and RESOLVER_MAX_TTL.
+ *
+ */
+
+int Resolver::parse_answer(unsigned char *message, size_t size, quint16 *id,
+                           QString *host, quint16 *type, dns_entry *entry) {
+
+  size_t position = 12, rdata;
+  unsigned int answers, authorities, record_type, ttl, rdlength, rcode;
+  long long min_ttl = -1, record_ttl;
+  struct sockaddr_storage addr;
+
+  if(size < 12 || !(message[2] & 0x80))
+    return -1;
+
+  *id = static_cast<quint16> ((message[0] << 8) | message[1]);
+  rcode = message[3] & 0x0F;
+  answers = static_cast<unsigned int> ((message[6] << 8) | message[7]);
+  authorities = static_cast<unsigned int> ((message[8] << 8) | message[9]);
+
+  // A single question is sent:
+  if(((message[4] << 8) | message[5]) != 1 ||
+     read_name(message, size, &position, host) != 0 || position + 4 > size)
+    return -1;
+
+  *type = static_cast<quint16> ((message[position] << 8) | message[position + 1]);
+  position += 4;
+  entry->addrs.clear();
+
+  // Read the answer and authority records:
+  for(unsigned int i = 0; i < answers + authorities; i++) {
+
+    if(read_name(message, size, &position, nullptr) != 0 || position + 10 > size)
+      return -1;
+
+    record_type = static_cast<unsigned int> ((message[position] << 8) | message[position + 1]);
+    ttl = (static_cast<unsigned int> (message[position + 4]) << 24) |
+          (static_cast<unsigned int> (message[position + 5]) << 16) |
+          (static_cast<unsigned int> (message[position + 6]) << 8) |
+          static_cast<unsigned int> (message[position + 7]);
+    rdlength = static_cast<unsigned int> ((message[position + 8] << 8) | message[position + 9]);
+    rdata = position + 10;
+    position = rdata + rdlength;
+
+    if(position > size)
+      return -1;
+
+    record_ttl = -1;
+
+    // Answer: address and CNAME records:
+    if(i < answers && (record_type == *type || record_type == 5)) {
+
+      record_ttl = ttl;
+      memset(&addr, 0, sizeof(addr));
+
+      if(record_type == DNS_TYPE_A && rdlength == 4) {
+        addr.ss_family = AF_INET;
+        memcpy(&(reinterpret_cast<struct sockaddr_in*> (&addr)->sin_addr),
+               message + rdata, 4);
+        entry->addrs.append(addr);
+      }
+      else if(record_type == DNS_TYPE_AAAA && rdlength == 16) {
+        addr.ss_family = AF_INET6;
+        memcpy(&(reinterpret_cast<struct sockaddr_in6*> (&addr)->sin6_addr),
+               message + rdata, 16);
+        entry->addrs.append(addr);
+      }
+
+    }
+
+    // Authority: the SOA minimum bounds the negative TTL:
+    else if(i >= answers && record_type == 6 && rdlength >= 20) {
+      record_ttl = (static_cast<unsigned int> (message[position - 4]) << 24) |
+                   (static_cast<unsigned int> (message[position - 3]) << 16) |
+                   (static_cast<unsigned int> (message[position - 2]) << 8) |
+                   static_cast<unsigned int> (message[position - 1]);
+      if(ttl < record_ttl)
+        record_ttl = ttl;
+    }
+
+    if(record_ttl != -1 && (min_ttl == -1 || record_ttl < min_ttl))
+      min_ttl = record_ttl;
+
+  }
+
+  if(entry->addrs.isEmpty())
+    min_ttl = rcode != 0 && rcode != 3 ? RESOLVER_FAILURE_TTL :
+              min_ttl == -1 ? RESOLVER_NEGATIVE_TTL : min_ttl;
+
+  if(min_ttl < RESOLVER_MIN_TTL)
+    min_ttl = RESOLVER_MIN_TTL;
+  if(min_ttl > RESOLVER_MAX_TTL)
+    min_ttl = RESOLVER_MAX_TTL;
+
+  entry->expires = monotonic_ms() + min_ttl * 1000;
+
+  return 0;
+
+}
+
+/**
+ * @fn int Resolver::read_name(unsigned char *message, size_t size, size_t *position, QString *name)
+ * @brief Method to read a (possibly compressed) name from a DNS message.
+ * @param message Address of the message received.
+ * @param size Size of the message.
+ * @param position Address of the position of the name, moved past it.
+ * @param name Address to store the name read (lower case), or nullptr to
+ * skip the name.
+ * @return Returns 0 when successfully executed and -1 if the name is invalid.
+ */
+
+int Resolver::read_name(unsigned char *message, size_t size, size_t *position,
+                        QString *name) {
+
+  size_t current = *position;
+  unsigned int length;
+  int jumps = 0;
+  bool jumped = false;
+
+  if(name != nullptr)
+    name->clear();
+
+  while(current < size && (length = message[current]) != 0) {
+
+    // Compression pointer (limited, to avoid loops):
+    if((length & 0xC0) == 0xC0) {
+      if(current + 1 >= size || ++jumps > 16)
+        return -1;
+      if(!jumped)
+        *position = current + 2;
+      jumped = true;
+      current = ((length & 0x3F) << 8) | message[current + 1];
+      continue;
+    }
+
+    if(current + 1 + length > size)
+      return -1;
+
+    if(name != nullptr) {
+      if(!name->isEmpty())
+        name->append('.');
+      name->append(QString::fromLatin1(reinterpret_cast<char*> (message + current + 1),
+                                       static_cast<int> (length)).toLower());
+    }
+
+    current += 1 + length;
+
+  }
+
+  if(current >= size)
+    return -1;
+
+  if(!jumped)
+    *position = current + 1;
+
+  return 0;
+
+}
@@ -0,0 +1,243 @@
+// Ring buffer module - Source code.
+
+/**
+ * @file ring_buffer.cpp
+ * @brief Ring buffer module - Source code.
+ *
+ * The ring buffer module contains the implementation of a fixed size ring
+ * buffer, used by the proxy server to relay data between two sockets with a
+ * bounded amount of memory, either in user space or inside the kernel (with a
+ * pipe and splice). This source file contains the class method
+ * implementations for this module.
+ *
+ */
+
+// Includes:
+#include "include/ring_buffer.h"
+
+// Class methods:
+
+/**
+ * @fn RingBuffer::RingBuffer(size_t capacity, bool kernel)
+ * @brief Class constructor for the RingBuffer class.
+ * @param capacity Size of the ring buffer, in bytes.
+ * @param kernel True to keep the ring buffer inside the kernel (as a pipe).
+ *
+ * The capacity of a pipe is rounded by the kernel (and may be capped by the
+ * system pipe size limit), so the capacity of a kernel ring buffer may differ
+ * from the one requested.
+ *
+ */
+
+RingBuffer::RingBuffer(size_t capacity, bool kernel) : data(nullptr),
+                                                       capacity(capacity),
+                                                       head(0),
+                                                       used(0) {
+
+  int pipe_size;
+
+  pipe_fd[0] = pipe_fd[1] = -1;
+
+  if(kernel && pipe2(pipe_fd, O_NONBLOCK | O_CLOEXEC) == 0) {
+
+    // Grow the pipe, or use whatever size it has:
+    fcntl(pipe_fd[1], F_SETPIPE_SZ, static_cast<int> (capacity));
+
+    if((pipe_size = fcntl(pipe_fd[1], F_GETPIPE_SZ)) > 0) {
+      this->capacity = static_cast<size_t> (pipe_size);
+      return;
+    }
+
+    close(pipe_fd[0]);
+    close(pipe_fd[1]);
+    pipe_fd[0] = pipe_fd[1] = -1;
+
+  }
+
+  data = new char[capacity];
+
+}
+
+/**
+ * @fn RingBuffer::~RingBuffer()
+ * @brief Class destructor for the RingBuffer class.
+ *
+ * This destructor frees the memory of the ring buffer. Any data still stored
+ * is lost.
+ *
+ */
+
+RingBuffer::~RingBuffer() {
+
+  if(pipe_fd[0] != -1) {
+    close(pipe_fd[0]);
+    close(pipe_fd[1]);
+  }
+
+  delete[] data;
+
+}
+
+// Public methods:
+
+/**
+ * @fn bool RingBuffer::empty()
+ * @brief Method to check if the ring buffer stores no data.
+ * @return Returns true if the ring buffer is empty.
+ */
+
+bool RingBuffer::empty() {
+  return used == 0;
+}
+
+/**
+ * @fn bool RingBuffer::full()
+ * @brief Method to check if the ring buffer has no room for more data.
+ * @return Returns true if the ring buffer is full.
+ */
+
+bool RingBuffer::full() {
+  return used == capacity;
+}
+
+/**
+ * @fn bool RingBuffer::in_kernel()
+ * @brief Method to check if the ring buffer is kept inside the kernel.
+ * @return Returns true if the ring buffer is a pipe.
+ */
+
+bool RingBuffer::in_kernel() {
+  return pipe_fd[0] != -1;
+}
+
+/**
+ * @fn int RingBuffer::recent(size_t count, struct iovec *pieces)
+ * @brief Method to look at the data stored last in the ring buffer.
+ * @param count Number of bytes (at most the amount stored).
+ * @param pieces Address of two pieces, to store where the bytes are.
+ * @return Returns the number of pieces the bytes take (0 for a kernel ring
+ * buffer, whose data can not be looked at).
+ *
+ * Used right after a fill, to look at the data it read.
+ *
+ */
+
+int RingBuffer::recent(size_t count, struct iovec *pieces) {
+
+  size_t start = (head + used - count) % capacity;
+
+  if(in_kernel() || count == 0)
+    return 0;
+
+  pieces[0].iov_base = data + start;
+  pieces[0].iov_len = count < capacity - start ? count : capacity - start;
+  pieces[1].iov_base = data;
+  pieces[1].iov_len = count - pieces[0].iov_len;
+
+  return pieces[1].iov_len > 0 ? 2 : 1;
+
+}
+
+/**
+ * @fn size_t RingBuffer::size()
+ * @brief Method to get the amount of data stored in the ring buffer.
+ * @return Returns the number of bytes stored.
+ */
+
+size_t RingBuffer::size() {
+  return used;
+}
+
+/**
+ * @fn ssize_t RingBuffer::drain(int fd)
+ * @brief Method to send the data stored in the ring buffer through a socket.
+ * @param fd File descriptor of the socket.
+ * @return Returns the number of bytes sent and -1 if an error occurs.
+ *
+ * The bytes sent are removed from the ring buffer. A socket that is full (or
+ * non-blocking and unable to take more data) makes this method return -1 with
+ * errno set to EAGAIN. The SIGPIPE signal is only avoided in user space: a
+ * kernel ring buffer relies on the application ignoring it.
+ *
+ */
+
+ssize_t RingBuffer::drain(int fd) {
+
+  struct iovec pieces[2];
+  struct msghdr message = {};
+  size_t first = used < capacity - head ? used : capacity - head;
+  ssize_t sent;
+
+  if(in_kernel()) {
+    if((sent = splice(pipe_fd[0], nullptr, fd, nullptr, used,
+                      SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) > 0)
+      used -= static_cast<size_t> (sent);
+    return sent;
+  }
+
+  pieces[0].iov_base = data + head;
+  pieces[0].iov_len = first;
+  pieces[1].iov_base = data;
+  pieces[1].iov_len = used - first;
+
+  message.msg_iov = pieces;
+  message.msg_iovlen = used > first ? 2 : 1;
+
+  if((sent = sendmsg(fd, &message, MSG_NOSIGNAL)) > 0) {
+    head = (head + static_cast<size_t> (sent)) % capacity;
+    used -= static_cast<size_t> (sent);
+  }
+
+  // Keep the data contiguous while possible:
+  if(used == 0)
+    head = 0;
+
+  return sent;
+
+}
+
+/**
+ * @fn ssize_t RingBuffer::fill(int fd, size_t max)
+ * @brief Method to store the data read from a socket in the ring buffer.
+ * @param fd File descriptor of the socket.
+ * @param max Maximum number of bytes to be read.
+ * @return Returns the number of bytes read, 0 if the socket connection was
+ * closed and -1 if an error occurs.
+ *
+ * A socket with no data available (and non-blocking) makes this method return
+ * -1 with errno set to EAGAIN. This method should not be called while the ring
+ * buffer is full.
+ *
+ */
+
+ssize_t RingBuffer::fill(int fd, size_t max) {
+
+  struct iovec pieces[2];
+  size_t tail = (head + used) % capacity;
+  size_t room = capacity - used;
+  size_t first;
+  ssize_t received;
+
+  if(room > max)
+    room = max;
+
+  if(in_kernel()) {
+    if((received = splice(fd, nullptr, pipe_fd[1], nullptr, room,
+                          SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) > 0)
+      used += static_cast<size_t> (received);
+    return received;
+  }
+
+  first = room < capacity - tail ? room : capacity - tail;
+
+  pieces[0].iov_base = data + tail;
+  pieces[0].iov_len = first;
+  pieces[1].iov_base = data;
+  pieces[1].iov_len = room - first;
+
+  if((received = readv(fd, pieces, room > first ? 2 : 1)) > 0)
+    used += static_cast<size_t> (received);
+
+  return received;
+
+}
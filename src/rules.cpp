@@ -0,0 +1,557 @@
+// Rules module - Source code.
+
+/**
+ * @file rules.cpp
+ * @brief Rules module - Source code.
+ *
+ * The rules module contains the implementation of the interception rules,
+ * which decide which exchanges stop at the gate and which ones are passed
+ * through without being shown to the user. The rules are read from a file and
+ * compiled into a matcher shared by every Server worker. This source file
+ * contains the class method implementations for this module.
+ *
+ */
+
+// Includes:
+#include "include/rules.h"
+
+// Class methods:
+
+/**
+ * @fn RuleSet::RuleSet()
+ * @brief Class constructor for the RuleSet class.
+ *
+ * This constructor creates a RuleSet with no rules loaded, which intercepts
+ * every exchange.
+ *
+ */
+
+RuleSet::RuleSet() {
+  clear();
+}
+
+/**
+ * @fn RuleSet::~RuleSet()
+ * @brief Class destructor for the RuleSet class.
+ *
+ * This destructor frees the counters of the sampled rules.
+ *
+ */
+
+RuleSet::~RuleSet() {
+  clear();
+}
+
+// Public methods:
+
+/**
+ * @fn bool RuleSet::intercept(RuleStage stage, rule_request *request, const Headers *headers)
+ * @brief Method to decide whether an exchange stops at the gate.
+ * @param stage Point of the exchange (request or answer).
+ * @param request Facts of the client request.
+ * @param headers Headers of the message being gated.
+ * @return Returns true if the exchange should be intercepted.
+ *
+ * Only the rules with no host condition and the ones the host trie finds for
+ * the request host are checked, in the order of the rules file.
+ *
+ */
+
+bool RuleSet::intercept(RuleStage stage, rule_request *request,
+                        const Headers *headers) {
+
+  QVarLengthArray<int, RULES_CANDIDATES> candidates;
+  int *end;
+
+  if(!loaded)
+    return true;
+
+  candidates.append(any_host.constData(), any_host.size());
+  match_hosts(request->host, &candidates);
+
+  // A rule may be found through more than one of its hosts:
+  std::sort(candidates.begin(), candidates.end());
+  end = std::unique(candidates.begin(), candidates.end());
+
+  for(int *index = candidates.begin(); index != end; index++)
+    if(applies(&(rules.at(*index)), stage, request, headers))
+      return rules.at(*index).intercept;
+
+  return default_intercept;
+
+}
+
+/**
+ * @fn int RuleSet::load(QString file_name, QString *error)
+ * @brief Method to load and compile the rules of a file.
+ * @param file_name Name of the rules file.
+ * @param error Address to store the reason the file was rejected.
+ * @return Returns 0 when the successfully executed and -1 if an error occurs.
+ *
+ * This method replaces the rules with the ones of the file. A file with an
+ * invalid line is rejected as a whole, and leaves no rules loaded (so every
+ * exchange is intercepted). It should not be called while the rules are being
+ * matched.
+ *
+ */
+
+int RuleSet::load(QString file_name, QString *error) {
+
+  QFile file(file_name);
+  QStringList fields, hosts;
+  int line_number = 0;
+  rule r;
+
+  if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    *error = "the file can not be read";
+    return -1;
+  }
+
+  QTextStream lines(&file);
+
+  clear();
+
+  while(!lines.atEnd()) {
+
+    fields = lines.readLine().section('#', 0, 0).simplified().split(' ');
+    line_number++;
+
+    if(fields[0].isEmpty())
+      continue;
+
+    // Action of the exchanges no rule applies to:
+    if(fields[0] == "default") {
+
+      if(fields.size() != 2 || (fields[1] != "intercept" && fields[1] != "pass")) {
+        *error = "line " + QString::number(line_number) + ": expected 'default intercept' or 'default pass'";
+        clear();
+        return -1;
+      }
+
+      default_intercept = fields[1] == "intercept";
+      continue;
+
+    }
+
+    if(compile(fields, &r, &hosts, error) != 0) {
+      *error = "line " + QString::number(line_number) + ": " + *error;
+      clear();
+      return -1;
+    }
+
+    r.seen = new QAtomicInteger<quint32>(0);
+    rules.append(r);
+
+    if(hosts.isEmpty())
+      any_host.append(rules.size() - 1);
+
+    for(int i = 0; i < hosts.size(); i++)
+      add_host(hosts[i], rules.size() - 1);
+
+  }
+
+  loaded = true;
+
+  return 0;
+
+}
+
+/**
+ * @fn rule_request RuleSet::describe(QString method, QString url, QString host)
+ * @brief Method to gather the facts of a client request the rules look at.
+ * @param method Method of the request.
+ * @param url URL of the request (absolute or just the path).
+ * @param host Value of the Host header (empty if there is none).
+ * @return Returns the facts of the request.
+ *
+ * The host is taken from the URL when the request has no Host header. Its
+ * port (and the brackets of an IPv6 address) and the query of the path are
+ * dropped.
+ *
+ */
+
+rule_request RuleSet::describe(QString method, QString url, QString host) {
+
+  rule_request request;
+  int scheme = url.indexOf("://"), start = 0, end;
+
+  // The path of an absolute URL starts after the authority:
+  if(!url.startsWith('/') && scheme != -1) {
+    start = url.indexOf('/', scheme + 3);
+    if(host.isEmpty())
+      host = url.mid(scheme + 3, start == -1 ? -1 : start - scheme - 3);
+  }
+
+  if(start == -1)
+    request.path = "/";
+
+  else {
+    end = url.indexOf('?', start);
+    request.path = url.mid(start, end == -1 ? -1 : end - start);
+  }
+
+  if(host.startsWith('['))
+    host = host.mid(1, host.indexOf(']') - 1);
+
+  else if(host.count(':') == 1)
+    host = host.section(':', 0, 0);
+
+  if(host.endsWith('.'))
+    host.chop(1);
+
+  request.host = host.toLower();
+  request.method = method;
+
+  return request;
+
+}
+
+// Private methods:
+
+/**
+ * @fn bool RuleSet::applies(const rule *r, RuleStage stage, rule_request *request, const Headers *headers)
+ * @brief Method to check if a rule applies to an exchange.
+ * @param r Rule to be checked (its host already matched).
+ * @param stage Point of the exchange (request or answer).
+ * @param request Facts of the client request.
+ * @param headers Headers of the message being gated.
+ * @return Returns true if the rule applies to the exchange.
+ *
+ * The cheapest conditions are checked first. A sampled rule applies to the
+ * first of every r->sample exchanges that meet its conditions.
+ *
+ */
+
+bool RuleSet::applies(const rule *r, RuleStage stage, rule_request *request,
+                      const Headers *headers) {
+
+  QString type;
+  bool found = false;
+
+  if(!(stage == RULE_REQUEST ? r->request : r->answer))
+    return false;
+
+  if(!r->methods.isEmpty() && !r->methods.contains(request->method))
+    return false;
+
+  if(r->path_glob && !glob(r->path.constData(), r->path.constData() + r->path.size(),
+                           request->path.constData(), request->path.constData() + request->path.size()))
+    return false;
+
+  if(!r->path_glob && !request->path.startsWith(r->path))
+    return false;
+
+  for(int i = 0; i < r->headers.size(); i++)
+    if(!find_header(headers, r->headers[i], nullptr))
+      return false;
+
+  if(!r->types.isEmpty()) {
+
+    if(!find_header(headers, "Content-Type", &type))
+      return false;
+
+    type = type.section(';', 0, 0).trimmed().toLower();
+
+    for(int i = 0; i < r->types.size() && !found; i++)
+      found = r->types[i].endsWith('/') ? type.startsWith(r->types[i]) : type == r->types[i];
+
+    if(!found)
+      return false;
+
+  }
+
+  return r->sample <= 1 || r->seen->fetchAndAddRelaxed(1) % r->sample == 0;
+
+}
+
+/**
+ * @fn int RuleSet::compile(QStringList fields, rule *r, QStringList *hosts, QString *error)
+ * @brief Method to compile a line of the rules file.
+ * @param fields Words of the line (the action and the conditions).
+ * @param r Address to store the compiled rule.
+ * @param hosts Address to store the host conditions of the rule.
+ * @param error Address to store the reason the line was rejected.
+ * @return Returns 0 when the successfully executed and -1 if an error occurs.
+ *
+ * The host conditions are not part of the rule: they are added to the host
+ * trie by the caller. A path whose only wildcard is a trailing '*' is kept as
+ * a prefix, which is faster to match than a glob.
+ *
+ */
+
+int RuleSet::compile(QStringList fields, rule *r, QStringList *hosts,
+                     QString *error) {
+
+  QString name, value;
+  QStringList values;
+  bool ok;
+
+  r->intercept = fields[0] == "intercept";
+  r->request = true;
+  r->answer = true;
+  r->methods.clear();
+  r->path.clear();
+  r->path_glob = false;
+  r->headers.clear();
+  r->types.clear();
+  r->sample = 1;
+  r->seen = nullptr;
+  hosts->clear();
+
+  if(!r->intercept && fields[0] != "pass") {
+    *error = "unknown action '" + fields[0] + "'";
+    return -1;
+  }
+
+  for(int i = 1; i < fields.size(); i++) {
+
+    name = fields[i].section('=', 0, 0);
+    value = fields[i].section('=', 1);
+    values = value.split(',');
+    values.removeAll("");
+
+    if(values.isEmpty()) {
+      *error = "condition '" + fields[i] + "' has no value";
+      return -1;
+    }
+
+    if(name == "host") {
+
+      for(int j = 0; j < values.size(); j++) {
+        if(values[j].lastIndexOf('*') > 0 || (values[j].startsWith('*') && !values[j].startsWith("*."))) {
+          *error = "host '" + values[j] + "' may only start with '*.'";
+          return -1;
+        }
+        hosts->append(values[j].toLower());
+      }
+
+    }
+
+    else if(name == "method") {
+      for(int j = 0; j < values.size(); j++)
+        r->methods.append(values[j].toUpper());
+    }
+
+    else if(name == "path") {
+
+      r->path = value;
+
+      if(r->path.endsWith('*') && r->path.count("*") == 1 && !r->path.contains('?'))
+        r->path.chop(1);
+
+      r->path_glob = r->path.contains('*') || r->path.contains('?');
+
+    }
+
+    else if(name == "header")
+      r->headers.append(value);
+
+    else if(name == "type") {
+
+      for(int j = 0; j < values.size(); j++) {
+        if(values[j].endsWith("/*"))
+          values[j].chop(1);
+        r->types.append(values[j].toLower());
+      }
+
+    }
+
+    else if(name == "stage") {
+
+      r->request = value == "request";
+      r->answer = value == "answer";
+
+      if(!r->request && !r->answer) {
+        *error = "stage must be 'request' or 'answer'";
+        return -1;
+      }
+
+    }
+
+    else if(name == "sample") {
+
+      r->sample = value.toUInt(&ok);
+
+      if(!ok || r->sample == 0) {
+        *error = "sample must be a positive number";
+        return -1;
+      }
+
+    }
+
+    else {
+      *error = "unknown condition '" + name + "'";
+      return -1;
+    }
+
+  }
+
+  return 0;
+
+}
+
+/**
+ * @fn void RuleSet::add_host(QString host, int index)
+ * @brief Method to add a host condition to the host trie.
+ * @param host Host name, or '*.domain' for any host below the domain.
+ * @param index Index of the rule with the condition.
+ */
+
+void RuleSet::add_host(QString host, int index) {
+
+  bool below = host.startsWith('*');
+  int node = 0, key;
+
+  // Keep the '.' of '*.domain', its node marks the hosts below:
+  if(below)
+    host = host.mid(1);
+
+  for(int i = host.size() - 1; i >= 0; i--) {
+
+    if((key = nodes[node].keys.indexOf(host[i])) != -1) {
+      node = nodes[node].children[key];
+      continue;
+    }
+
+    nodes.append(rule_node());
+    nodes[node].keys.append(host[i]);
+    nodes[node].children.append(nodes.size() - 1);
+    node = nodes.size() - 1;
+
+  }
+
+  if(below)
+    nodes[node].below.append(index);
+  else
+    nodes[node].exact.append(index);
+
+}
+
+/**
+ * @fn void RuleSet::clear()
+ * @brief Method to remove every rule.
+ *
+ * After this method, no rules are loaded and every exchange is intercepted.
+ *
+ */
+
+void RuleSet::clear() {
+
+  for(int i = 0; i < rules.size(); i++)
+    delete rules[i].seen;
+
+  rules.clear();
+  any_host.clear();
+  nodes.clear();
+  nodes.append(rule_node());
+  loaded = false;
+  default_intercept = false;
+
+}
+
+/**
+ * @fn void RuleSet::match_hosts(QString host, QVarLengthArray<int, RULES_CANDIDATES> *candidates)
+ * @brief Method to find the rules whose host conditions match a host.
+ * @param host Host of the request (lower case).
+ * @param candidates Address to append the indexes of the rules found.
+ *
+ * The host is walked backwards down the trie, one character at a time, so
+ * the cost depends on the length of the host and not on the number of rules.
+ *
+ */
+
+void RuleSet::match_hosts(QString host,
+                          QVarLengthArray<int, RULES_CANDIDATES> *candidates) {
+
+  const rule_node *node = &(nodes.at(0));
+  int key;
+
+  for(int i = host.size() - 1; i >= 0; i--) {
+
+    if((key = node->keys.indexOf(host.at(i))) == -1)
+      return;
+
+    node = &(nodes.at(node->children.at(key)));
+
+    // A '.' with more labels before it:
+    if(i > 0)
+      candidates->append(node->below.constData(), node->below.size());
+
+  }
+
+  candidates->append(node->exact.constData(), node->exact.size());
+
+}
+
+/**
+ * @fn bool RuleSet::find_header(const Headers *headers, QString name, QString *value)
+ * @brief Method to look a header up, ignoring the case of its name.
+ * @param headers Headers of the message.
+ * @param name Name of the header.
+ * @param value Address to store the first value of the header (or nullptr).
+ * @return Returns true if the message has the header.
+ */
+
+bool RuleSet::find_header(const Headers *headers, QString name, QString *value) {
+
+  QByteArray key = name.toLatin1();
+
+  if(!headers->contains(key))
+    return false;
+
+  if(value != nullptr)
+    *value = QString::fromLatin1(headers->value(key));
+
+  return true;
+
+}
+
+/**
+ * @fn bool RuleSet::glob(const QChar *pattern, const QChar *pattern_end, const QChar *text, const QChar *text_end)
+ * @brief Method to match a text against a glob.
+ * @param pattern Start of the glob.
+ * @param pattern_end End of the glob.
+ * @param text Start of the text.
+ * @param text_end End of the text.
+ * @return Returns true if the whole text matches the glob.
+ *
+ * A '*' matches any sequence of characters (including '/') and a '?' matches
+ * any single character. Only the last '*' seen is backtracked to, so the cost
+ * is bounded by the product of both lengths and usually linear.
+ *
+ */
+
+bool RuleSet::glob(const QChar *pattern, const QChar *pattern_end,
+                   const QChar *text, const QChar *text_end) {
+
+  const QChar *star = nullptr, *resume = nullptr;
+
+  while(text != text_end) {
+
+    if(pattern != pattern_end && (*pattern == QLatin1Char('?') || *pattern == *text)) {
+      pattern++;
+      text++;
+    }
+
+    else if(pattern != pattern_end && *pattern == QLatin1Char('*')) {
+      star = pattern++;
+      resume = text;
+    }
+
+    // Let the last '*' take one more character:
+    else if(star != nullptr) {
+      pattern = star + 1;
+      text = ++resume;
+    }
+
+    else
+      return false;
+
+  }
+
+  while(pattern != pattern_end && *pattern == QLatin1Char('*'))
+    pattern++;
+
+  return pattern == pattern_end;
+
+}
@@ -18,34 +18,65 @@
 // Class methods:
 
 /**
- * @fn Server::Server(in_port_t port_number)
+ * @fn Server::Server(ServerConfig config, unsigned int worker_id, QSharedPointer<Gate> gate, QSharedPointer<DNSCache> dns_cache, QSharedPointer<RuleSet> rules, QSharedPointer<HTTPCache> cache)
  * @brief Class constructor for the Server class.
- * @param port_number Local port number used by the proxy server.
+ * @param config Proxy server configuration.
+ * @param worker_id Identifier of the Server worker.
+ * @param gate Gate shared by every Server worker.
+ * @param dns_cache DNS cache shared by every Server worker.
+ * @param rules Interception rules shared by every Server worker.
+ * @param cache HTTP cache shared by every Server worker.
  *
  * This constructor creates a new instance of the Server class. Each instance
- * has a port_number argument that configures the local port number used by the
- * server class.
+ * has a config argument that configures the local port number used by the
+ * server class, and a worker_id argument that identifies the instance among
+ * the other workers.
  *
- * The server class contains an instance of a MessageLogger class
- * and an instance of a HTTPParser class, both of which have their message log
- * signal connected to the logMessage(QString) signal used by the server.
+ * The server class contains an instance of a MessageLogger class, which has
+ * its message log signal connected to the logMessage(QString) signal used by
+ * the server, and an instance of a HTTPParserCore class, whose parse errors
+ * are logged through it.
  *
  * This method logs a message with port number in which the server was
  * configured.
  *
  */
 
-Server::Server(in_port_t port_number) : port_number(port_number), logger("Server") {
+Server::Server(ServerConfig config, unsigned int worker_id,
+               QSharedPointer<Gate> gate,
+               QSharedPointer<DNSCache> dns_cache,
+               QSharedPointer<RuleSet> rules,
+               QSharedPointer<HTTPCache> cache) : running(false),
+                                            pass_through(config.pass_through),
+                                            gate_changed(false),
+                                            server_fd(-1),
+                                            wake_fd(-1),
+                                            client_idle_time(static_cast<long long> (config.client_idle_time) * 1000),
+                                            connect_timeout(static_cast<long long> (config.connect_timeout) * 1000),
+                                            tunnel_idle_time(static_cast<long long> (config.tunnel_idle_time) * 1000),
+                                            last_sweep(0),
+                                            preview_size(config.pass_through ? 0 : config.preview_size),
+                                            port_number(config.port_number),
+                                            worker_id(worker_id),
+                                            parsed_buffer(nullptr),
+                                            logger("Server " + to_string(worker_id)),
+                                            gate(gate),
+                                            rules(rules),
+                                            cache(cache),
+                                            pool(config.pool_idle_time,
+                                                 config.pool_per_host),
+                                            resolver(dns_cache) {
 
   // Connect message loggers:
   connect(&logger, SIGNAL (sendMessage(QString)), this,
           SIGNAL (logMessage(QString)));
-  connect(&parser, SIGNAL (logMessage(QString)), this,
-          SIGNAL (logMessage(QString)));
 
   // Info message:
   logger.info("Server configured in port " + to_string(port_number) + ".");
 
+  if(pass_through)
+    logger.warning("Pass-through mode: exchanges will not stop at the gate.");
+
 }
 
 /**
@@ -63,6 +94,20 @@ Server::~Server() {
 
 // Public methods:
 
+/**
+ * @fn ServerStats *Server::get_stats()
+ * @brief Method to access the counters of the Server worker.
+ * @return Returns the address of the Server worker counters.
+ *
+ * The counters are atomic, so they can be read from any thread while the
+ * Server is running.
+ *
+ */
+
+ServerStats *Server::get_stats() {
+  return &stats;
+}
+
 /**
  * @fn int Server::init()
  * @brief Method to initialize the Server internal variables.
@@ -81,29 +126,45 @@ int Server::init() {
   // Variable declaration:
   int opt = 1;
   struct sockaddr_in client_addr;
-  struct timeval tv;
-  tv.tv_sec = 5;
-  tv.tv_usec = 0;
 
   // Configure address on client side
   config_client_addr(&client_addr);
 
-  // Creating the proxy socket to listen to the client:
-  if((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-    logger.error("Failed to create server socket!");
+  // Create the reactor used to wait for socket events:
+  if(reactor.init() != 0) {
+    logger.error("Failed to create the server reactor!");
     return -1;
   }
 
-  // Configure socket to reuse addresses and ports:
-  if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt,
-                 sizeof(opt)) != 0) {
-    logger.error("Failed to configure server socket options!");
+  // Create the resolver used to find the website addresses:
+  if(resolver.init() != 0) {
+    logger.error("Failed to create the server resolver!");
+    return -1;
+  }
+
+  // Create the eventfd the gate wakes the server with:
+  if((wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+    logger.error("Failed to create the server gate eventfd!");
+    return -1;
+  }
+
+  gate->attach(worker_id, wake_fd);
+  cache->attach(worker_id, wake_fd);
+
+  // Creating the proxy socket to listen to the client (accept() should never
+  // block the reactor):
+  if((server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) == -1) {
+    logger.error("Failed to create server socket!");
     return -1;
   }
 
-  // Configure timeout
-  if (setsockopt(server_fd, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&tv), sizeof tv) != 0) {
-    logger.error("Failed to configure server socket timeout!");
+  // Configure socket to reuse addresses and ports (each option must be set
+  // with its own call):
+  if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt,
+                 sizeof(opt)) != 0 ||
+      setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt,
+                 sizeof(opt)) != 0) {
+    logger.error("Failed to configure server socket options!");
     return -1;
   }
 
@@ -129,55 +190,6 @@ int Server::init() {
 
 }
 
-/**
- * @fn void Server::load_client_request(QString new_headers, QByteArray new_data)
- * @brief Method to load an updated client request into the Server.
- * @param new_headers New headers for the client request.
- * @param new_data New data for the client request.
- *
- * This method is used to update the client request inside the Server to
- * reflect the changes made by an user. It is called from the MainWindow class
- * after an user edits the client request.
- *
- */
-
-void Server::load_client_request(QString new_headers, QByteArray new_data) {
-  new_client_data = new_data;
-  new_client_headers = new_headers;
-  new_client_headers.replace('\n', "\r\n");   // Adjust line endings.
-}
-
-/**
- * @fn void Server::load_website_request(QString new_headers, QByteArray new_data)
- * @brief Method to load an updated website request into the Server.
- * @param new_headers New headers for the website request.
- * @param new_data New data for the website request.
- *
- * This method is used to update the website request inside the Server to
- * reflect the changes made by an user. It is called from the MainWindow class
- * after an user edits the website request.
- *
- */
-
-void Server::load_website_request(QString new_headers, QByteArray new_data) {
-  new_website_data = new_data;
-  new_website_headers = new_headers;
-  new_website_headers.replace('\n', "\r\n");   // Adjust line endings.
-}
-
-/**
- * @fn void Server::open_gate()
- * @brief Method to open the Server gate.
- *
- * This method opens the Server gate, allowing a pending HTTP request from the
- * client or the website to be sent to a website or the client, respectively.
- *
- */
-
-void Server::open_gate() {
-  set_gate_closed(false);
-}
-
 /**
  * @fn void Server::run()
  * @brief Slot method for the Server to start handling client connections.
@@ -187,6 +199,13 @@ void Server::open_gate() {
  * of server tasks and counting the number of runtime errors encountered during
  * the server execution.
  *
+ * The method is an event loop: it waits for the Reactor to report ready
+ * sockets, accepts new client connections when the Server socket is ready and
+ * resumes the session waiting on every other ready socket. Between waits, the
+ * proxy gate is serviced, unanswered DNS queries are retried and idle
+ * connections are expired. Every session still open when the Server stops is
+ * closed.
+ *
  * Calling the method stop() will stop the Server from executing new tasks,
  * ending this method. Once this method ends, the Server emits the finished()
  * signal, signaling it has finished it's execution and is ready to be deleted.
@@ -200,24 +219,89 @@ void Server::open_gate() {
 
 void Server::run() {
 
-  connection client, website;
-  unsigned int runtime_errors = 0;
-
-  // Configure connection addresses:
-  config_client_addr(&(client.addr));
-  config_website_addr(&(website.addr));
+  struct epoll_event events[REACTOR_MAX_EVENTS];
+  QSet<session*> handled;
+  bool woken;
+  int ready;
 
   // Set control variables:
-  set_gate_closed(true);
   set_running(true);
-  next_task = AWAIT_CONNECTION;
 
-  while(is_program_running())
-    if(execute_task(next_task, &client, &website) != 0)
-      runtime_errors++;
+  // Wait for client connections, DNS answers and the gate:
+  if(reactor.arm(server_fd, EPOLLIN, nullptr) != 0 ||
+     reactor.arm(resolver.get_fd(), EPOLLIN, &resolver) != 0 ||
+     reactor.arm(wake_fd, EPOLLIN, &wake_fd) != 0) {
+    logger.error("Failed to watch the server sockets!");
+    set_running(false);
+  }
+
+  while(is_program_running()) {
+
+    ready = reactor.wait(events, REACTOR_MAX_EVENTS, SERVER_POLL_TIMEOUT);
+
+    if(ready == -1) {
+      logger.error("Failed to wait for socket events: " + string(strerror(errno)));
+      stats.errors.fetchAndAddRelaxed(1);
+      break;
+    }
+
+    // The Server and Resolver sockets and the gate eventfd are the only ones
+    // armed without a session. A session racing website connections may have
+    // several sockets ready at once, but it only runs once (and may be closed
+    // by then):
+    handled.clear();
+    woken = false;
+
+    for(int i = 0; i < ready; i++) {
+      if(events[i].data.ptr == nullptr)
+        await_connection();
+      else if(events[i].data.ptr == &resolver)
+        service_resolver(true);
+      else if(events[i].data.ptr == &wake_fd)
+        woken = true;
+      else if(!handled.contains(static_cast<session*> (events[i].data.ptr))) {
+        handled.insert(static_cast<session*> (events[i].data.ptr));
+        process_session(static_cast<session*> (events[i].data.ptr));
+      }
+    }
+
+    service_resolver(false);
+    service_connects();
+    service_gate(woken);
+    service_flights(woken);
+    expire_sessions();
+    pool.expire();
+
+  }
+
+  // Close every session that is still open:
+  for(session *s : sessions) {
+    end_flight(s);
+    cancel_attempts(s);
+    close_connection(&(s->client));
+    close_connection(&(s->website));
+    slabs.release(&(s->client.buffer));
+    slabs.release(&(s->website.buffer));
+    delete s->ring;
+    delete s->upstream;
+    delete s;
+  }
+
+  sessions.clear();
+  gate_queue.clear();
+  gate->release(worker_id);
+  gate->detach(worker_id);
+  cache->detach(worker_id);
+  close(wake_fd);
+  wake_fd = -1;
+  pool.clear();
 
   logger.success("Server shutdown!");
-  logger.info("Number of runtime errors: " + to_string(runtime_errors));
+  logger.info("Number of connections: " + to_string(stats.connections.load()));
+  logger.info("Number of exchanges: " + to_string(stats.exchanges.load()));
+  logger.info("Number of reused website connections: " + to_string(stats.reused.load()));
+  logger.info("Number of tunnels: " + to_string(stats.tunnels.load()));
+  logger.info("Number of runtime errors: " + to_string(stats.errors.load()));
 
   emit finished();
 
@@ -251,24 +335,6 @@ void Server::stop() {
 
 // Private methods:
 
-/**
- * @fn bool Server::is_gate_closed()
- * @brief Method to check the value of the control variable gate_closed.
- * @return Value of the control variable gate_closed.
- *
- * This method returns the current value of the control variable gate_closed
- * using the QMutex gate_mutex.
- *
- */
-
-bool Server::is_gate_closed() {
-  bool aux;
-  gate_mutex.lock();
-  aux = gate_closed;
-  gate_mutex.unlock();
-  return aux;
-}
-
 /**
  * @fn bool Server::is_program_running()
  * @brief Method to check the value of the control variable 'running'.
@@ -288,151 +354,379 @@ bool Server::is_program_running() {
 }
 
 /**
- * @fn int Server::await_connection(connection *client)
- * @brief Method used by the Server to wait for a client connection.
- * @param client Address of a struct to store the client connection info.
- * @return Returns 0 when the successfully executed and -1 if an error occurs.
+ * @fn bool Server::persistent_connection()
+ * @brief Method to check if the last message parsed keeps its connection open.
+ * @return Returns true if the connection stays open after the message.
  *
- * This method is used by the Server to wait for a client connection. Given
- * that this is the first task to be executed by the Server, an error caused in
- * others tasks usually leads back to this task.
+ * This method checks the HTTP version and the Connection header of the last
+ * message parsed by the Server parser. HTTP/1.1 connections are persistent
+ * unless the message has the 'close' connection option, while HTTP/1.0
+ * connections are only persistent with the 'keep-alive' connection option.
  *
- * If this task is executed succesfully, the next task to be executed will be
- * READ_FROM_CLIENT.
+ */
+
+bool Server::persistent_connection() {
+
+  QList<QByteArray> options;
+
+  for(const QByteArray &value : parser.getHeaders().values(HEADER_CONNECTION))
+    for(const QByteArray &option : value.split(','))
+      options << option.trimmed().toLower();
+
+  if(options.contains("close"))
+    return false;
+
+  if(parser.getHTTPVersion() == "HTTP/1.1")
+    return true;
+
+  return options.contains("keep-alive");
+
+}
+
+/**
+ * @fn bool Server::rebuild_message(connection *conn, gate_edit *edit, bool relayed, QByteArray *message)
+ * @brief Method to build a message edited by the user at the gate.
+ * @param conn Address of the connection holding the original message.
+ * @param edit User edits of the message.
+ * @param relayed True if the data is only the preview of a relayed answer.
+ * @param message Address to store the new message.
+ * @return Returns true if the new message is valid.
+ *
+ * Only the parts the user edited are taken from the edit, the others are
+ * copied from the buffer as they were received. The new message is checked
+ * by a parser of its own and its Content-Length is set to the size of the
+ * data, in place, so the other headers keep their order and spelling. The
+ * data of a relayed answer can not be edited, as the rest of it is still on
+ * its way.
+ *
+ * The gate shows chunked bodies decoded: data left as it was keeps the
+ * original chunks, edited data of a chunked message is sent as a single chunk
+ * followed by the original trailer.
  *
  */
 
-int Server::await_connection(connection *client) {
+bool Server::rebuild_message(connection *conn, gate_edit *edit, bool relayed,
+                             QByteArray *message) {
 
-  int addrlen = sizeof(client->addr), client_fd;
+  HTTPParserCore edited;
+  QByteArray trailer;
+  bool chunked;
 
-  // Accept an incoming client connection (blocking function call):
-  logger.info("Waiting for connection from client");
+  parse_buffer(&(conn->buffer));
 
-  client_fd = accept(server_fd,
-                     reinterpret_cast<struct sockaddr*> (&(client->addr)),
-                     reinterpret_cast<socklen_t*> (&addrlen));
+  if(edit->headers_edited)
+    *message = edit->headers;
+  else
+    *message = QByteArray(conn->buffer.content, parser.getHeadersSize() + 4);
 
-  // Check to see if the connection succeded:
-  if(client_fd != -1) {
-    client->fd = client_fd;
-    next_task = READ_FROM_CLIENT;
-    return 0;
-  }
+  if(edit->data_edited && relayed)
+    logger.warning("The body of a relayed answer can not be edited! Keeping the original preview");
 
-  else if(!is_program_running()) {
-    close_socket(client_fd);
-    return 0;
+  // The framing of the new headers decides how edited data is sent:
+  if(!edited.parseRequest(message->data(), message->size()))
+    return false;
+
+  chunked = ChunkedCodec::chunked(edited.getHeaders().joined(HEADER_TRANSFER_ENCODING));
+
+  if(edit->data_edited && !relayed && chunked) {
+    parser.getDecodedData(&trailer);
+    *message += ChunkedCodec::encode(edit->data, trailer);
   }
+  else if(edit->data_edited && !relayed)
+    *message += edit->data;
+  else
+    message->append(parser.getData(), static_cast<int> (parser.getDataSize()));
+
+  if(!edited.parseRequest(message->data(), message->size()))
+    return false;
+
+  if(!relayed && !chunked && edited.getHeaders().contains(HEADER_CONTENT_LENGTH))
+    *message = HTTPParserCore::setHeaderValue(*message, HEADER_CONTENT_LENGTH,
+                                          QByteArray::number(static_cast<quint64> (edited.getDataSize())));
+
+  return true;
+
+}
+
+/**
+ * @fn bool Server::retry_website(session *s)
+ * @brief Method to send a request again through a new website connection.
+ * @param s Address of the session whose reused website connection failed.
+ * @return Returns true if the request will be sent again.
+ *
+ * A connection taken from the upstream pool may be closed by the website
+ * right before the request is sent through it. When that happens before any
+ * answer arrives, idempotent requests are safe to send again. The failed
+ * connection is closed and the next task of the session is set to
+ * CONNECT_TO_WEBSITE.
+ *
+ */
+
+bool Server::retry_website(session *s) {
+
+  HttpMethod method;
+
+  if(!s->reused || s->website.buffer.size != 0)
+    return false;
+
+  // Only idempotent requests can be sent again:
+  parse_buffer(&(s->client.buffer));
+  method = parser.getMethodId();
+
+  if(method != METHOD_GET && method != METHOD_HEAD && method != METHOD_PUT &&
+     method != METHOD_DELETE && method != METHOD_OPTIONS && method != METHOD_TRACE)
+    return false;
+
+  logger.warning("Idle website connection was closed, connecting again");
+
+  close_connection(&(s->website));
+  s->reused = false;
+  s->sent = 0;
+  s->next_task = CONNECT_TO_WEBSITE;
+
+  return true;
+
+}
+
+/**
+ * @fn bool Server::split_host(QString authority, in_port_t default_port, QString *host, in_port_t *port)
+ * @brief Method to split the value of a Host header (or the target of a
+ * CONNECT request) into host and port.
+ * @param authority Value to be split ('host', 'host:port' or
+ * '[IPv6 address]:port').
+ * @param default_port Port used if the value gives none.
+ * @param host Address to store the host name (or address, without brackets).
+ * @param port Address to store the port.
+ * @return Returns true if the value is valid.
+ */
+
+bool Server::split_host(QString authority, in_port_t default_port,
+                        QString *host, in_port_t *port) {
 
+  QString rest;
+  int end;
+  unsigned int number;
+  bool valid;
+
+  authority = authority.trimmed();
+  *port = default_port;
+
+  // IPv6 addresses are enclosed in brackets:
+  if(authority.startsWith('[')) {
+    if((end = authority.indexOf(']')) == -1)
+      return false;
+    *host = authority.mid(1, end - 1);
+    rest = authority.mid(end + 1);
+  }
   else {
+    end = authority.indexOf(':');
+    *host = end == -1 ? authority : authority.left(end);
+    rest = end == -1 ? QString() : authority.mid(end);
+  }
+
+  if(!rest.isEmpty()) {
+    number = rest.mid(1).toUInt(&valid);
+    if(!rest.startsWith(':') || !valid || number == 0 || number > 65535)
+      return false;
+    *port = static_cast<in_port_t> (number);
+  }
+
+  return !host->isEmpty();
+
+}
+
+/**
+ * @fn int Server::await_connection()
+ * @brief Method used by the Server to accept client connections.
+ * @return Returns 0 when the successfully executed and -1 if an error occurs.
+ *
+ * This method is used by the Server to accept the client connections waiting
+ * on the Server socket. It is called whenever the Reactor reports the Server
+ * socket as ready and accepts every pending connection, creating a new session
+ * for each one of them. The Server socket is armed again before returning.
+ *
+ * The first task executed by a new session is READ_FROM_CLIENT. A session
+ * whose next task is AWAIT_CONNECTION is finished and is closed by the Server.
+ *
+ */
+
+int Server::await_connection() {
+
+  struct sockaddr_storage client_addr;
+  socklen_t addrlen;
+  int client_fd, return_code = 0;
+
+  // Accept every incoming client connection (non-blocking function call):
+  while(true) {
+
+    addrlen = sizeof(client_addr);
+    client_fd = accept4(server_fd,
+                        reinterpret_cast<struct sockaddr*> (&client_addr),
+                        &addrlen, SOCK_NONBLOCK);
+
+    if(client_fd == -1)
+      break;
+
+    stats.connections.fetchAndAddRelaxed(1);
+
+    // Start the new session right away, the request may already be there:
+    process_session(create_session(client_fd, &client_addr));
+
+  }
+
+  // Check to see if the connections ran out or something failed:
+  if(errno != EAGAIN && errno != EWOULDBLOCK && is_program_running()) {
     logger.error("Failed to accept an incoming connection!");
+    stats.errors.fetchAndAddRelaxed(1);
+    return_code = -1;
+  }
+
+  // Wait for the next client connections:
+  if(is_program_running() && reactor.arm(server_fd, EPOLLIN, nullptr) != 0) {
+    logger.error("Failed to watch the server socket!");
     return -1;
   }
 
+  return return_code;
+
 }
 
 /**
- * @fn int Server::await_gate()
+ * @fn int Server::await_gate(session *s)
  * @brief Method used by the Server to wait for the request gate to open.
- * @return Returns 0 when the successfully executed.
+ * @param s Address of the session waiting for the gate.
+ * @return Returns TASK_PENDING, since the session is parked in the gate queue.
  *
- * This method is used by the Server to wait for the request gate to open.
- * While the gate does not open, the Server is stuck in busy waiting. When the
- * request gate is opened, the Server emits a gateOpened() signal and closes
- * the request gate again.
+ * This method is used by the Server to park a session until the request gate
+ * opens. The session is appended to the gate queue, its exchange is parked at
+ * the shared Gate (with an exchangeParked(quint64, QString) signal) and the
+ * Server moves on to other sessions. The service_gate() method shows the
+ * exchange at the head of the queue to the user and resumes it when the gate
+ * opens, or resumes any parked exchange the user lets through unchanged.
  *
- * If this task is executed successfully, the next task to be executed will be
- * UPDATE_REQUESTS.
+ * A session whose exchange is already on display (because the user edits
+ * were invalid) goes back to the head of the queue.
  *
- * Important: If another thread or process does not call the open_gate()
- * method, the Server will be STUCK in busy waiting.
+ * If the gate opens, the next task to be executed will be UPDATE_REQUESTS.
  *
  */
 
-int Server::await_gate() {
+int Server::await_gate(session *s) {
 
-  logger.info("Awaiting for gate to open!");
+  QString summary;
 
-  // Wait for the gate to open or for the program to finish:
-  while(is_gate_closed() and is_program_running()) {}
+  logger.info("Awaiting for gate to open!");
 
-  // Signal that the gate actually opened:
-  if(is_program_running())
-    emit gateOpened();
+  if(s->ticket == 0) {
+    parse_buffer(&(s->client.buffer));
+    summary = QString::fromLatin1(parser.getMethod() + " " + parser.getURL());
+    if(s->last_read == WEBSITE)
+      summary.prepend("Answer to ");
+    s->ticket = gate->park(worker_id);
+    emit exchangeParked(s->ticket, summary);
+  }
 
-  // Set the next task:
-  next_task = UPDATE_REQUESTS;
+  if(s->displayed)
+    gate_queue.prepend(s);
+  else
+    gate_queue.append(s);
 
-  // Close the gates again:
-  set_gate_closed(true);
+  gate_changed = true;
 
-  return 0;
+  return TASK_PENDING;
 
 }
 
 /**
- * @fn int Server::connect_to_website(connection *client, connection *website)
+ * @fn int Server::connect_to_website(session *s)
  * @brief Method used by the Server to connect to a website.
- * @param client Address of a struct to store the client connection info.
- * @param website Address of a struct to store the website connection info.
- * @return Returns 0 when the successfully executed and -1 if an error occurs.
+ * @param s Address of the session whose client request is being handled.
+ * @return Returns 0 when the successfully executed, TASK_PENDING while the
+ * connection is being established and -1 if an error occurs.
  *
  * This method is used by the Server to connect to a website specified in a
- * client request. It creates a socket for the website connection, obtains the
- * website IP and tries to connect to it.
+ * client request. It obtains the website IPs from the Resolver (the session
+ * waits for the DNS server if the host is not cached) and takes an idle
+ * connection to one of them from the upstream pool. If the pool has none, the
+ * addresses are raced by the race_website() method, which this method calls
+ * again every time the session is resumed until a connection is established.
  *
  * If this task is executed succesfully, the next task to be executed will be
- * SEND_TO_WEBSITE.
+ * SEND_TO_WEBSITE, or OPEN_TUNNEL for a CONNECT request.
  *
  */
 
-int Server::connect_to_website(connection *client, connection *website){
-    struct hostent *website_IP_data;
+int Server::connect_to_website(session *s) {
 
-    if((website->fd = socket(AF_INET, SOCK_STREAM, 0)) == 0){
-        logger.error("Failed to create server socket!");
-        return -1;
-    }
+  connection *client = &(s->client), *website = &(s->website);
+  QString authority, host;
+  in_port_t port;
+  int return_code;
 
-    // Find the host name from the client request:
-    parser.parseRequest(client->buffer.content, client->buffer.size);
+  // Connection attempts are in progress, check how they are going:
+  if(s->connect_deadline != -1)
+    return race_website(s);
 
-    // Find the IP address for a given host:
-    website_IP_data = gethostbyname(parser.getHost().toStdString().c_str());
+  // Find the host name (and port) from the client request, or from the
+  // target of a CONNECT request:
+  parse_buffer(&(client->buffer));
+  authority = QString::fromLatin1(s->tunnel ? parser.getURL() : parser.getHost());
 
-    if(website_IP_data == nullptr) {
-        logger.error("Failed to find an IP address for the server website");
-        close(website->fd);
-        return -1;
-    }
+  if(!split_host(authority, s->tunnel ? TUNNEL_PORT : WEBSITE_PORT, &host,
+                 &port)) {
+    logger.error("Invalid website host: " + authority.toStdString());
+    return -1;
+  }
 
-    // Copy the IP address obtained:
-    memcpy(&(website->addr.sin_addr.s_addr), website_IP_data->h_addr,
-           static_cast<size_t> (website_IP_data->h_length));
+  // Find the IP addresses for a given host (it may take a while):
+  return_code = resolver.resolve(host, &(s->addresses), s);
 
-    // Connect to the website:
-    logger.info("Connecting to website socket");
-    if(connect_socket(website->fd,
-                      reinterpret_cast<struct sockaddr *> (&(website->addr)),
-                      sizeof(website->addr)) < 0) {
-        logger.error("Failed to connect to the website!");
-        close(website->fd);
-        return -1;
+  if(return_code == RESOLVER_PENDING)
+    return TASK_PENDING;
+
+  if(return_code != 0) {
+    logger.error("Failed to find an IP address for the server website");
+    return -1;
+  }
+
+  for(struct sockaddr_storage &addr : s->addresses) {
+    if(addr.ss_family == AF_INET6)
+      reinterpret_cast<struct sockaddr_in6*> (&addr)->sin6_port = htons(port);
+    else
+      reinterpret_cast<struct sockaddr_in*> (&addr)->sin_port = htons(port);
+  }
+
+  // Reuse an idle connection to the website, if there is one (tunnels
+  // always get a connection of their own):
+  for(struct sockaddr_storage &addr : s->addresses) {
+    if(s->tunnel)
+      break;
+    if((website->fd = pool.acquire(pool.key(&addr))) != -1) {
+      logger.info("Reusing website connection");
+      stats.reused.fetchAndAddRelaxed(1);
+      website->addr = addr;
+      s->addresses.clear();
+      s->reused = true;
+      s->next_task = SEND_TO_WEBSITE;
+      return 0;
     }
+  }
 
-    next_task = SEND_TO_WEBSITE;
-    return 0;
+  // Race the addresses of the website:
+  logger.info("Connecting to website socket");
+  s->connect_deadline = monotonic_ms() + connect_timeout;
+  s->next_attempt = 0;
+  connecting.insert(s);
+
+  return race_website(s);
 
 }
 
 /**
- * @fn int Server::execute_task(ServerTask task, connection *client, connection
- * *website)
+ * @fn int Server::execute_task(ServerTask task, session *s)
  * @brief Method used by the Server to handle task execution.
  * @param task Task to be executed by the Server.
- * @param client Address of a struct to store the client connection info.
- * @param website Address of a struct to store the website connection info.
+ * @param s Address of the session the task is executed for.
  * @return Returns the value returned by the task method executed.
  *
  * This method is used by the Server to figure out which method to execute
@@ -442,46 +736,63 @@ int Server::connect_to_website(connection *client, connection *website){
  *
  * If an underlying method call returns an error code, this method calls the
  * handle_error method and configures the next task to be executed to be
- * AWAIT_CONNECTION, reseting the finite state machine.
+ * AWAIT_CONNECTION, finishing the session.
  *
  */
 
-int Server::execute_task(ServerTask task, connection *client,
-                         connection *website) {
+int Server::execute_task(ServerTask task, session *s) {
 
   int return_code = -1; // A failsafe (in case the switch fails)!
 
   switch(task) {
     case AWAIT_CONNECTION:
-      return_code = await_connection(client);
+      return_code = 0;  // Finished session, nothing left to do.
+      break;
+    case AWAIT_FLIGHT:
+      return_code = TASK_PENDING;  // Resumed by service_flights().
       break;
     case AWAIT_GATE:
-      return_code = await_gate();
+      return_code = await_gate(s);
       break;
     case CONNECT_TO_WEBSITE:
-      return_code = connect_to_website(client, website);
+      return_code = connect_to_website(s);
+      break;
+    case LOOKUP_CACHE:
+      return_code = lookup_cache(s);
+      break;
+    case OPEN_TUNNEL:
+      return_code = open_tunnel(s);
       break;
     case READ_FROM_CLIENT:
-      return_code = read_from_client(client);
+      return_code = read_from_client(s);
       break;
     case READ_FROM_WEBSITE:
-      return_code = read_from_website(website);
+      return_code = read_from_website(s);
+      break;
+    case RELAY_TO_CLIENT:
+      return_code = relay_to_client(s);
+      break;
+    case RELAY_TUNNEL:
+      return_code = relay_tunnel(s);
+      break;
+    case SEND_FILE_TO_CLIENT:
+      return_code = send_file_to_client(s);
       break;
     case SEND_TO_CLIENT:
-      return_code = send_to_client(client, website);
+      return_code = send_to_client(s);
       break;
     case SEND_TO_WEBSITE:
-      return_code = send_to_website(client, website);
+      return_code = send_to_website(s);
       break;
     case UPDATE_REQUESTS:
-      return_code = update_requests(client, website);
+      return_code = update_requests(s);
       break;
   }
 
   // In case an error occurred:
   if(return_code == -1) {
-    handle_error(task, client->fd, website->fd);  // Take necessary actions.
-    next_task = AWAIT_CONNECTION;                 // Reset the event loop;
+    handle_error(task, s);          // Take necessary actions.
+    s->next_task = AWAIT_CONNECTION; // Finish the session.
   }
 
   return return_code;
@@ -489,313 +800,1430 @@ int Server::execute_task(ServerTask task, connection *client,
 }
 
 /**
- * @fn int Server::read_from_client(connection *client)
- * @brief Method used by the Server to read data from the client.
- * @param client Address of a struct to store the client connection info.
- * @return Returns 0 when the successfully executed and -1 if an error occurs.
+ * @fn int Server::finish_exchange(session *s, bool framed)
+ * @brief Method used by the Server once a whole answer was sent to the client.
+ * @param s Address of the session whose answer was sent.
+ * @param framed True if the answer length was known (the answer did not end
+ * with the website closing the connection).
+ * @return Returns 0 when the successfully executed.
  *
- * This method is used by the Server to read data from the client socket. It
- * stores the data read and it's size in the struct specified by the 'client'
- * parameter.
+ * If both the client request and the answer allow the client connection to
+ * stay open, the session moves on to the next request of the client (see
+ * next_request). Otherwise, the next task to be executed will be
+ * AWAIT_CONNECTION and the client socket is closed.
  *
- * If this task is executed succesfully, the next task to be executed will be
- * AWAIT_GATE, the last_read control variable is set to CLIENT and the signals
- * clientData(QString) and newHost(QString) are emitted, specifying the data
- * read from the client and the host in the client request.
+ * An answer can only be followed by another one if it is framed, since the
+ * client would wait for the connection to close to find its end.
  *
  */
 
-int Server::read_from_client(connection *client) {
-
-  // Client sent data:
-  if((client->buffer.size = read_socket(client->fd, client->buffer.content, HTTP_BUFFER_SIZE)) > 0) {
+int Server::finish_exchange(session *s, bool framed) {
 
-    parser.parseRequest(client->buffer.content, client->buffer.size);
-    emit clientData(parser.requestHeaderToQString(), QByteArray(parser.getData(), parser.getDataSize()));
-    emit newHost(parser.getHost());
+  bool keep_alive;
 
-    last_read = CLIENT;
-    next_task = AWAIT_GATE;
+  logger.info("Sent some message to client!");
+  stats.exchanges.fetchAndAddRelaxed(1);
 
-    return 0;
+  // The client connection stays open only if both messages allow it:
+  parse_buffer(&(s->client.buffer));
+  keep_alive = framed && persistent_connection();
 
+  if(keep_alive) {
+    parse_buffer(&(s->website.buffer));
+    keep_alive = persistent_connection();
   }
 
-  // Client didn't send data:
-  else {
-    logger.error("No data read from client!");
-    return -1;
+  if(keep_alive) {
+    next_request(s);
+    return 0;
   }
 
+  close_connection(&(s->client));
+  s->next_task = AWAIT_CONNECTION;
+  return 0;
+
 }
 
 /**
- * @fn int Server::read_from_website(connection *website)
- * @brief Method used by the Server to read data from the client.
- * @param website Address of a struct to store the website connection info.
+ * @fn int Server::lookup_cache(session *s)
+ * @brief Method to look the client request up in the HTTP cache.
+ * @param s Session whose request is looked up.
  * @return Returns 0 when the successfully executed and -1 if an error occurs.
  *
- * This method is used by the Server to read data from the website socket. It
- * stores the data read and it's size in the struct specified by the 'website'
- * parameter. This method behaves differently depending on the header values
- * read from the website request.
+ * A fresh answer to a GET (or HEAD) request is copied to the website buffer,
+ * without contacting the website, and goes to AWAIT_GATE if the interception
+ * rules choose it (SEND_TO_CLIENT otherwise). A stale answer is kept in the
+ * session and the request is made conditional (unless the client already
+ * made it so), so the website can confirm the answer with a 304 (see
+ * cache_answer). The body of a hit kept on disk stays in the session, to be
+ * sent by SEND_FILE_TO_CLIENT, unless the answer is displayed at the gate.
  *
- * If this task is executed succesfully, the next task to be executed will be
- * AWAIT_GATE, the last_read control variable is set to WEBSITE and the signals
- * websiteData(QString) and newHost(QString) are emitted, specifying the data
- * read from the website and the host in the website request. Also, the success
- * of this method causes the website socket to be closed.
+ * A GET request missing the cache while an identical one is in flight is
+ * collapsed into it: its next task is AWAIT_FLIGHT, until the answer lands
+ * (see service_flights). Otherwise the request leads the flight of its URL,
+ * which lands once its answer is read (see end_flight).
+ *
+ * The next task to be executed is CONNECT_TO_WEBSITE for every other request
+ * not answered by the cache.
  *
  */
 
-int Server::read_from_website(connection *website){
+int Server::lookup_cache(session *s) {
 
-    int length;
-    size_t max_size = HTTP_BUFFER_SIZE;
-    ssize_t single_read;
-    ssize_t size_read;
+  connection *client = &(s->client), *website = &(s->website);
+  Headers headers;
+  QByteArray answer, conditional, body;
+  HttpMethod method;
+  QString etag, last_modified;
+  disk_body file;
+  bool landed = s->flight == FLIGHT_LANDED;
+  int end;
 
-    // Read first headers:
-    logger.info("Reading from website");
-    size_read = read_socket(website->fd, website->buffer.content, max_size);
-    parser.parseRequest(website->buffer.content, size_read);
+  s->next_task = CONNECT_TO_WEBSITE;
+  s->flight = FLIGHT_NONE;
+  s->cache_key.clear();
+  s->stale_answer.clear();
+
+  if(!cache->enabled())
+    return 0;
 
-    logger.info("Received " + parser.getCode().toStdString() + " " + parser.getDescription().toStdString() + " from website");
+  parse_buffer(&(client->buffer));
+  method = parser.getMethodId();
+  headers = parser.getHeaders();
+  s->cache_key = HTTPCache::key(QString::fromLatin1(parser.getURL()),
+                                QString::fromLatin1(parser.getHost()));
 
-    // Read content-length:
-    Headers headers = parser.getHeaders();
-    if(headers.contains("Content-Length")){
-        length = headers["Content-Length"].first().toInt();
-        while(size_read < length+parser.getHeadersSize()){
-            logger.info("Reading extra data from website [" + to_string(size_read) + "/" + to_string(length) + "]");
-            single_read = read_socket(website->fd, website->buffer.content+size_read,
-                                      static_cast<ssize_t> (max_size-size_read));
+  if(method != METHOD_GET && method != METHOD_HEAD)
+    return 0;
 
-            if(single_read == -1) {
-                logger.error("Failed to read from website: " + string(strerror(errno)));
-                return -1;
-            }
+  switch(cache->lookup(s->cache_key, &headers, &answer, &file, &etag, &last_modified)) {
 
-            if(static_cast<size_t> (size_read) == max_size){
-                logger.error("Request is greater than buffer! Giving up");
-                return -1;
-            }
+    case CACHE_HIT:
 
-            size_read += single_read;
+      // A HEAD request only takes the headers:
+      if(s->head_request) {
+        answer.truncate(answer.indexOf("\r\n\r\n") + 4);
+        if(file.fd != -1)
+          close(file.fd);
+        file.fd = -1;
+      }
 
-        }
+      parser.parseRequest(answer.data(), answer.size());
+      parsed_buffer = nullptr;
+      s->last_read = WEBSITE;
+      s->next_task = SEND_TO_CLIENT;
 
-    }
+      if(!pass_through && rules->intercept(RULE_ANSWER, &(s->request), &parser.getHeaders()))
+        s->next_task = AWAIT_GATE;
 
-    else if(headers.contains("Transfer-Encoding")){
-        if(headers["Transfer-Encoding"].first() == "chunked"){
-            while(
-                (single_read = read_socket(website->fd,
-                                           website->buffer.content+size_read,
-                                           static_cast<ssize_t> (max_size-size_read))) > 0
-            ){
-                logger.info("Reading extra data from website (chunked) [" + to_string(size_read) + "/" + to_string(max_size) + "]");
-                size_read += single_read;
-            }
+      // The gate shows (and edits) the whole answer:
+      if(file.fd != -1 && s->next_task == AWAIT_GATE) {
+        if(DiskCache::load(&file, &body) != 0) {
+          logger.error("Failed to read the answer from the disk cache");
+          return -1;
         }
-    }
-    else{
-        logger.warning("Website response doesn't contain Content-Length neither Transfer-Encoding");
-    }
+        answer += body;
+      }
 
-    website->buffer.size = size_read;
-    close(website->fd);
+      logger.info("Answer served from the cache");
+      replace_buffer(website, answer);
+      s->body = file;
+      break;
 
-    parser.parseRequest(website->buffer.content, website->buffer.size);
-    emit websiteData(parser.answerHeaderToQString(), QByteArray(parser.getData(), parser.getDataSize()));
-    emit newHost(parser.getHost());
+    case CACHE_STALE:
 
-    last_read = WEBSITE;
-    next_task = AWAIT_GATE;
-    return 0;
+      if(method != METHOD_GET || headers.contains(HEADER_IF_NONE_MATCH) ||
+         headers.contains(HEADER_IF_MODIFIED_SINCE))
+        break;
 
-}
+      // Ask the website whether the cached answer is still good:
+      conditional = QByteArray(client->buffer.content, static_cast<int> (client->buffer.size));
+      end = conditional.indexOf("\r\n\r\n") + 2;
 
-/**
- * @fn int Server::send_to_client(connection *client, connection *website)
- * @brief Method used by the Server to send data to the client.
- * @param client Address of a struct to store the client connection info.
- * @param website Address of a struct to store the website connection info.
- * @return Returns 0 when the successfully executed and -1 if an error occurs.
- *
- * This method is used by the Server to send data to the client socket. The
- * data is taken from the 'website' struct pointer.
- *
- * If this task is executed succesfully, the next task to be executed will be
- * AWAIT_CONNECTION and the client socket is closed.
- *
- */
+      // The headers are always whole here, but nothing is inserted if not:
+      if(end < 2)
+        break;
 
-int Server::send_to_client(connection *client, connection *website){
-    logger.info("Sending message to client");
+      if(!etag.isEmpty())
+        conditional.insert(end, "If-None-Match: " + etag.toLatin1() + "\r\n");
+      else
+        conditional.insert(end, "If-Modified-Since: " + last_modified.toLatin1() + "\r\n");
 
-    if(send(client->fd, website->buffer.content, static_cast<size_t> (website->buffer.size), 0) == -1){
-        logger.error("Failed to send: " + string(strerror(errno)));
-        return -1;
-    }
+      if(conditional.size() > HTTP_BUFFER_SIZE)
+        break;
 
-    logger.info("Sent some message to client!");
-    close(client->fd);
-    next_task = AWAIT_CONNECTION;
-    return 0;
+      logger.info("Revalidating the cached answer");
+      replace_buffer(client, conditional);
+      s->stale_answer = answer;
+      break;
 
-}
+    case CACHE_MISS:
 
-/**
- * @fn int Server::send_to_website(connection *client, connection *website)
- * @brief Method used by the Server to send data to the website.
- * @param client Address of a struct to store the client connection info.
- * @param website Address of a struct to store the website connection info.
- * @return Returns 0 when the successfully executed and -1 if an error occurs.
- *
- * This method is used by the Server to send data to the website socket. The
- * data is taken from the 'client' struct pointer.
- *
- * If this task is executed succesfully, the next task to be executed will be
- * READ_FROM_WEBSITE.
- *
- */
+      // A request that already waited (or private to its client) goes on:
+      if(method != METHOD_GET || landed || headers.contains(HEADER_AUTHORIZATION))
+        break;
 
-int Server::send_to_website(connection *client, connection *website){
+      if(cache->join(s->cache_key, worker_id, s)) {
+        logger.info("Waiting for an identical request in flight");
+        s->flight = FLIGHT_WAITER;
+        s->next_task = AWAIT_FLIGHT;
+      }
 
-    logger.info("Sending message to website");
+      else
+        s->flight = FLIGHT_LEADER;
 
-    if(send(website->fd, client->buffer.content,
-            static_cast<size_t> (client->buffer.size), 0) == -1){
-        logger.error("Failed to send: " + string(strerror(errno)));
-        return -1;
-    }
+      break;
 
-    logger.info("Sent some message to website!");
-    next_task = READ_FROM_WEBSITE;
-    return 0;
+  }
+
+  return 0;
 
 }
 
 /**
- * @fn int Server::update_requests(connection *client, connection *website)
- * @brief Method used by the Server to update requests based on user edits.
- * @param client Address of a struct to store the client connection info.
- * @param website Address of a struct to store the website connection info.
- * @return Returns 0 when the successfully executed.
- *
- * This method is used by the Server to update the header and data contained in
- * both the client and website requests based on the modifications made by the
- * user. If no modifications are made, the method just updates the next_task
- * control variable. If modifications were made, the method checks if the new
- * HTTP request produced is valid or not.
+ * @fn int Server::open_tunnel(session *s)
+ * @brief Method used by the Server to answer a CONNECT request.
+ * @param s Address of the session whose website was connected for a tunnel.
+ * @return Returns 0 when the successfully executed, TASK_PENDING while the
+ * answer waits for the client socket and -1 if an error occurs.
+ *
+ * This method sends TUNNEL_REPLY to the client (through the website buffer,
+ * which a tunnel does not use otherwise) and creates the two kernel ring
+ * buffers of the tunnel. Client data that arrived together with the CONNECT
+ * request is kept in the pipeline of the session and sent to the website
+ * first.
  *
  * If this task is executed succesfully, the next task to be executed will be
- * CONNECT_TO_WEBSITE if the last_read variable is CLIENT and SEND_TO_CLIENT if
- * the last_read variable is WEBSITE.
- *
- * Important: If the request edits made by the user result in a INVALID HTTP
- * request, the user is notified by an error log message, the ORIGINAL request
- * is restored and the next task to be executed is AWAIT_GATE, taking the user
- * back to the request gate.
+ * RELAY_TUNNEL.
  *
  */
 
-int Server::update_requests(connection *client, connection *website){
+int Server::open_tunnel(session *s) {
 
-  QString full_request, original_header;
-  QByteArray original_data;
-  ssize_t body_size, original_size;
-  QByteArray new_buffer;
+  int return_code;
 
-  // Check which request we should update:
-  switch(last_read) {
+  if(s->website.buffer.size == 0)
+    replace_buffer(&(s->website), QByteArray(TUNNEL_REPLY));
 
-    case CLIENT:
+  if((return_code = send_buffer(s, &(s->client), &(s->website.buffer))) != 0)
+    return return_code;
 
-      // Save original request data:
-      parser.parseRequest(client->buffer.content, client->buffer.size);
-      original_header = parser.requestHeaderToQString();
-      original_data = QByteArray(parser.getData(), parser.getDataSize());
-//      original_size = client->buffer.size;
+  logger.info("Tunnel opened");
+  stats.tunnels.fetchAndAddRelaxed(1);
 
+  s->ring = new RingBuffer(TUNNEL_BUFFER_SIZE, true);
+  s->upstream = new RingBuffer(TUNNEL_BUFFER_SIZE, true);
+  s->idle_since = monotonic_ms();
+  s->next_task = RELAY_TUNNEL;
 
-      // If there were no edits, continue:
-      if(new_client_headers == original_header && new_client_data == original_data) {
-        next_task = CONNECT_TO_WEBSITE;
-        logger.info("Client request unchanged!");
-      }
+  return 0;
 
-      // If there were edits, we might need to overwrite the connection buffer:
-      else {
+}
 
-        HTTPParser new_client_request;
+/**
+ * @fn int Server::pump_tunnel(RingBuffer *ring, connection *source, connection *destination, bool *eof, quint64 *relayed)
+ * @brief Method to move the data of one direction of a tunnel.
+ * @param ring Address of the ring buffer of the direction.
+ * @param source Address of the connection the data is read from.
+ * @param destination Address of the connection the data is sent to.
+ * @param eof Address of the flag set once the source closes its side.
+ * @param relayed Address of the counter of bytes sent to the destination.
+ * @return Returns 1 if some data moved (or the source closed), 0 if neither
+ * socket was ready and -1 if an error occurs.
+ *
+ * The ring is filled from the source once while it has room, and drained to
+ * the destination once while it has data.
+ *
+ */
+
+int Server::pump_tunnel(RingBuffer *ring, connection *source,
+                        connection *destination, bool *eof, quint64 *relayed) {
+
+  ssize_t single_read, single_send;
+  int return_code = 0;
+
+  // Fill the ring with data from the source:
+  if(!*eof && !ring->full()) {
+
+    single_read = ring->fill(source->fd, TUNNEL_BUFFER_SIZE);
+
+    if(single_read >= 0) {
+      *eof = single_read == 0;
+      return_code = 1;
+    }
+
+    else if(errno != EAGAIN && errno != EWOULDBLOCK) {
+      logger.error("Failed to relay from tunnel: " + string(strerror(errno)));
+      return -1;
+    }
+
+  }
+
+  // Send the data in the ring to the destination:
+  if(!ring->empty()) {
+
+    if((single_send = ring->drain(destination->fd)) > 0) {
+      *relayed += static_cast<quint64> (single_send);
+      stats.tunnel_bytes.fetchAndAddRelaxed(static_cast<quint64> (single_send));
+      return_code = 1;
+    }
+
+    else if(errno != EAGAIN && errno != EWOULDBLOCK) {
+      logger.error("Failed to relay to tunnel: " + string(strerror(errno)));
+      return -1;
+    }
+
+  }
+
+  return return_code;
+
+}
+
+/**
+ * @fn int Server::race_website(session *s)
+ * @brief Method used by the Server to race connection attempts to a website.
+ * @param s Address of the session whose website addresses are raced.
+ * @return Returns 0 once a connection is established, TASK_PENDING while the
+ * attempts are in progress and -1 if every attempt failed or the connect
+ * timeout expired.
+ *
+ * This method implements the connection racing of Happy Eyeballs (RFC 8305).
+ * The addresses of the website, alternating between IPv6 and IPv4, are tried
+ * with non-blocking sockets: a new attempt starts CONNECT_ATTEMPT_DELAY
+ * milliseconds after the previous one, or right away if every other attempt
+ * failed. Attempts in progress are not cancelled, and the first one to be
+ * established becomes the website connection of the session.
+ *
+ * Every attempt socket is armed in the Reactor, and the Server also resumes
+ * the session when its next attempt or its timeout is due (see
+ * service_connects()), so this method is executed again until the race ends.
+ *
+ */
+
+int Server::race_website(session *s) {
+
+  long long now = monotonic_ms();
+  connect_attempt attempt;
+  struct pollfd state;
+  int connect_error;
+  socklen_t error_size;
+
+  // Check which attempts finished (the Reactor reports one at a time):
+  for(int i = 0; i < s->attempts.size();) {
+
+    state.fd = s->attempts[i].fd;
+    state.events = POLLOUT;
+    state.revents = 0;
+
+    if(poll(&state, 1, 0) <= 0) {
+      i++;
+      continue;
+    }
+
+    error_size = sizeof(connect_error);
+
+    if(getsockopt(state.fd, SOL_SOCKET, SO_ERROR, &connect_error,
+                  &error_size) == 0 && connect_error == 0) {
+      s->website.fd = state.fd;
+      s->website.addr = s->attempts[i].addr;
+      s->attempts.removeAt(i);
+      cancel_attempts(s);
+      s->next_task = s->tunnel ? OPEN_TUNNEL : SEND_TO_WEBSITE;
+      return 0;
+    }
+
+    // A failed attempt lets the next address be tried right away:
+    close(state.fd);
+    s->attempts.removeAt(i);
+    s->next_attempt = now;
+
+  }
+
+  // Start the next attempts that are due:
+  while(!s->addresses.isEmpty() &&
+        (s->attempts.isEmpty() || now >= s->next_attempt)) {
+
+    attempt.addr = s->addresses.takeFirst();
+    s->next_attempt = now + CONNECT_ATTEMPT_DELAY;
+
+    if((attempt.fd = socket(attempt.addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK, 0)) == -1) {
+      s->next_attempt = now;
+      continue;
+    }
+
+    if(connect_socket(attempt.fd,
+                      reinterpret_cast<struct sockaddr*> (&(attempt.addr)),
+                      attempt.addr.ss_family == AF_INET6 ?
+                      sizeof(struct sockaddr_in6) :
+                      sizeof(struct sockaddr_in)) == 0) {
+      s->website.fd = attempt.fd;
+      s->website.addr = attempt.addr;
+      cancel_attempts(s);
+      s->next_task = s->tunnel ? OPEN_TUNNEL : SEND_TO_WEBSITE;
+      return 0;
+    }
+
+    if(errno == EINPROGRESS && reactor.arm(attempt.fd, EPOLLOUT, s) == 0) {
+      s->attempts.append(attempt);
+      continue;
+    }
+
+    // Unreachable address (e.g. no IPv6 route), try the next one:
+    close(attempt.fd);
+    s->next_attempt = now;
+
+  }
+
+  if(s->attempts.isEmpty()) {
+    logger.error("Failed to connect to the website!");
+    return -1;
+  }
+
+  if(now >= s->connect_deadline) {
+    logger.error("Timed out connecting to the website!");
+    return -1;
+  }
+
+  return TASK_PENDING;
+
+}
+
+/**
+ * @fn int Server::read_from_client(session *s)
+ * @brief Method used by the Server to read data from the client.
+ * @param s Address of the session whose client is read.
+ * @return Returns 0 when the successfully executed, TASK_PENDING while the
+ * request is incomplete and -1 if an error occurs.
+ *
+ * This method is used by the Server to read data from the client socket. It
+ * stores the data read and it's size in the client connection of the session.
+ * The client socket is read until a whole request (headers and the body given
+ * by the Content-Length header) arrives. If the socket runs out of data
+ * before that, the session waits for the client socket to become readable.
+ * Data read after the end of the request belongs to the next (pipelined)
+ * requests and is kept in the session pipeline.
+ *
+ * A persistent client connection closed by the client between two requests
+ * finishes the session without an error.
+ *
+ * If this task is executed succesfully, the next task to be executed will be
+ * AWAIT_GATE if the interception rules choose the request (LOOKUP_CACHE
+ * otherwise and in pass-through mode, CONNECT_TO_WEBSITE for tunnels), the
+ * last_read control variable is set to CLIENT and the newHost(QString) signal
+ * is emitted, specifying the host in the client request.
+ *
+ */
+
+int Server::read_from_client(session *s) {
+
+  connection *client = &(s->client);
+  ssize_t length, single_read;
+  size_t room;
+  ParseStatus status;
+
+  // Read until the whole request arrives, each piece is only parsed once:
+  while((status = parse_message(client, false, false)) != PARSE_MESSAGE_COMPLETE) {
+
+    if(status == PARSE_ERROR) {
+      logger.error("Could not parse the request from client");
+      return -1;
+    }
+
+    // The buffer grows as the request arrives:
+    if((room = slabs.room(&(client->buffer), HTTP_BUFFER_SIZE)) == 0) {
+      logger.error("Request is greater than buffer! Giving up");
+      return -1;
+    }
+
+    single_read = read_socket(client->fd,
+                              client->buffer.content + client->buffer.size,
+                              room);
+
+    // Client sent data:
+    if(single_read > 0) {
+      client->buffer.size += single_read;
+      client->buffer.parsed = false;
+      s->idle_since = -1;
+      stats.client_bytes.fetchAndAddRelaxed(static_cast<quint64> (single_read));
+    }
+
+    // The client closed an idle persistent connection:
+    else if(single_read == 0 && s->idle_since != -1 && client->buffer.size == 0) {
+      logger.info("Client closed the connection");
+      s->next_task = AWAIT_CONNECTION;
+      return 0;
+    }
+
+    // Client didn't send data:
+    else if(single_read == 0) {
+      logger.error("No data read from client!");
+      return -1;
+    }
+
+    // No data available yet:
+    else if(errno == EAGAIN || errno == EWOULDBLOCK)
+      return wait_for(s, client, EPOLLIN);
+
+    else {
+      logger.error("Failed to read from client: " + string(strerror(errno)));
+      return -1;
+    }
+
+  }
+
+  // Keep the pipelined requests for later:
+  length = client->message.length;
+
+  if(client->buffer.size > length) {
+    s->pipeline = QByteArray(client->buffer.content + length,
+                             static_cast<int> (client->buffer.size - length));
+    client->buffer.size = length;
+    client->buffer.parsed = false;
+  }
+
+  parse_buffer(&(client->buffer));
+  s->head_request = parser.getMethodId() == METHOD_HEAD;
+  s->tunnel = parser.getMethodId() == METHOD_CONNECT;
+  emit newHost(QString::fromLatin1(s->tunnel ? parser.getURL() : parser.getHost()));
+
+  // Tunnels skip the gate and the cache, their data is opaque:
+  s->last_read = CLIENT;
+  s->next_task = s->tunnel ? CONNECT_TO_WEBSITE : LOOKUP_CACHE;
+
+  if(!pass_through && !s->tunnel) {
+    s->request = RuleSet::describe(QString::fromLatin1(parser.getMethod()),
+                                   QString::fromLatin1(parser.getURL()),
+                                   QString::fromLatin1(parser.getHost()));
+    if(rules->intercept(RULE_REQUEST, &(s->request), &parser.getHeaders()))
+      s->next_task = AWAIT_GATE;
+  }
+
+  return 0;
+
+}
+
+/**
+ * @fn int Server::read_from_website(session *s)
+ * @brief Method used by the Server to read data from the website.
+ * @param s Address of the session whose website is read.
+ * @return Returns 0 when the successfully executed, TASK_PENDING while the
+ * answer is incomplete and -1 if an error occurs.
+ *
+ * This method is used by the Server to read data from the website socket. It
+ * stores the data read and it's size in the website connection of the
+ * session. This method behaves differently depending on the header values
+ * read from the website request: answers with a Content-Length header are
+ * complete once the whole body arrives, chunked answers once their last chunk
+ * arrives, while the others are complete once the website closes the
+ * connection. If the socket runs out of data before the answer is complete,
+ * the session waits for the website socket to become readable.
+ *
+ * Only the headers and the first preview_size bytes of the body are read
+ * here. If the answer is larger than that, the website socket is kept open
+ * and the rest of the answer is relayed to the client after the gate (see
+ * relay_to_client). In pass-through mode there is no preview: the body is
+ * relayed as soon as the headers arrive.
+ *
+ * If this task is executed succesfully, the next task to be executed will be
+ * AWAIT_GATE if the interception rules choose the answer (SEND_TO_CLIENT
+ * otherwise and in pass-through mode), the last_read control variable is set
+ * to WEBSITE and the newHost(QString) signal is emitted, specifying the host
+ * in the website request. Also, the success of this method causes the website
+ * socket to be released to the upstream pool, if the answer was complete and
+ * left the connection persistent, or to be closed otherwise.
+ *
+ * If a connection taken from the upstream pool turns out to be closed, the
+ * request is sent again through a new connection (see retry_website).
+ *
+ */
+
+int Server::read_from_website(session *s) {
+
+  connection *website = &(s->website);
+  ssize_t length, limit, single_read;
+  size_t room;
+  ParseStatus status;
+  bool framed;
+
+  if(website->buffer.size == 0)
+    logger.info("Reading from website");
+
+  // Read until the whole answer (or its preview) arrives, each piece is
+  // only parsed once:
+  while((status = parse_message(website, true, s->head_request)) != PARSE_MESSAGE_COMPLETE) {
+
+    if(status == PARSE_ERROR) {
+      logger.error("Could not parse the answer from website");
+      return -1;
+    }
+
+    length = website->message.length;
+    limit = HTTP_BUFFER_SIZE;
+
+    if(pass_through && website->buffer.size + PASS_THROUGH_CHUNK < limit)
+      limit = website->buffer.size + PASS_THROUGH_CHUNK;
+
+    // The rest of a large answer is relayed after the gate:
+    if(status == PARSE_HEADERS_COMPLETE) {
+
+      limit = website->message.header_end + preview_size;
+
+      if(limit > HTTP_BUFFER_SIZE)
+        limit = HTTP_BUFFER_SIZE;
+
+      if(website->buffer.size >= limit) {
+        logger.info("Answer is larger than the preview, the rest of it will be relayed");
+        // The chunks of the rest are followed, so they are never kept in the kernel:
+        s->ring = new RingBuffer(RING_BUFFER_SIZE, pass_through &&
+                                 website->message.framing != FRAMING_CHUNKED);
+        s->relay_left = length > 0 ? length - website->buffer.size : -1;
+        break;
+      }
+
+    }
+
+    // The buffer grows as the answer arrives:
+    if((room = slabs.room(&(website->buffer), static_cast<size_t> (limit))) == 0) {
+      logger.error("Request is greater than buffer! Giving up");
+      return -1;
+    }
+
+    single_read = read_socket(website->fd,
+                              website->buffer.content + website->buffer.size,
+                              room);
+
+    if(single_read > 0) {
+      website->buffer.size += single_read;
+      website->buffer.parsed = false;
+      stats.website_bytes.fetchAndAddRelaxed(static_cast<quint64> (single_read));
+      continue;
+    }
+
+    // The website closed the connection:
+    if(single_read == 0) {
+
+      if(retry_website(s))
+        return 0;
+
+      if(website->buffer.size == 0) {
+        logger.error("No data read from website!");
+        return -1;
+      }
+
+      if(length > 0 || website->message.framing == FRAMING_CHUNKED)
+        logger.warning("Website closed the connection before sending the whole answer");
+      else if(status == PARSE_NEED_MORE)
+        logger.warning("Website response doesn't contain a complete header");
+
+      break;
+
+    }
+
+    // No data available yet:
+    if(errno == EAGAIN || errno == EWOULDBLOCK)
+      return wait_for(s, website, EPOLLIN);
+
+    if(errno == ECONNRESET && retry_website(s))
+      return 0;
+
+    logger.error("Failed to read from website: " + string(strerror(errno)));
+    return -1;
+
+  }
+
+  parse_buffer(&(website->buffer));
+  logger.info("Received " + parser.getCode().toStdString() + " " + parser.getDescription().toStdString() + " from website");
+  emit newHost(QString::fromLatin1(parser.getHost()));
+  framed = s->ring == nullptr && status == PARSE_MESSAGE_COMPLETE &&
+           website->buffer.size == website->message.length;
+
+  // Keep the connection only if the answer framing says where it ended:
+  if(s->ring != nullptr)
+    logger.info("Website connection kept open to relay the answer");
+
+  else if(framed && persistent_connection()) {
+    pool.release(pool.key(&(website->addr)), website->fd);
+    website->fd = -1;
+  }
+
+  else
+    close_connection(website);
+
+  // Only whole answers are cached:
+  if(framed && !s->cache_key.isEmpty()) {
+    cache_answer(s);
+    parse_buffer(&(website->buffer));
+  }
+
+  // Requests collapsed into this one can look the answer up now:
+  end_flight(s);
+
+  // Only the answers the rules choose stop at the gate:
+  s->last_read = WEBSITE;
+  s->next_task = SEND_TO_CLIENT;
+
+  if(!pass_through && rules->intercept(RULE_ANSWER, &(s->request), &parser.getHeaders()))
+    s->next_task = AWAIT_GATE;
+  return 0;
+
+}
+
+/**
+ * @fn int Server::relay_to_client(session *s)
+ * @brief Method used by the Server to relay the rest of an answer to the client.
+ * @param s Address of the session whose answer is relayed.
+ * @return Returns 0 when the successfully executed, TASK_PENDING while the
+ * relay waits for one of the sockets and -1 if an error occurs.
+ *
+ * This method moves the part of a website answer that did not fit in the
+ * preview from the website socket to the client socket, through the ring
+ * buffer of the session. Data is read from the website while the ring has
+ * room and sent to the client while the ring has data. When neither socket
+ * can make progress, the session waits for the client socket to become
+ * writable if the ring has data, or for the website socket to become
+ * readable otherwise.
+ *
+ * The end of a chunked answer is found by decoding the data relayed (see
+ * relay_chunks), so the relay does not wait for the website to close the
+ * connection.
+ *
+ * Once the whole answer is relayed, the ring buffer is freed, the website
+ * connection is released to the upstream pool (or closed) and the exchange is
+ * finished (see finish_exchange).
+ *
+ */
+
+int Server::relay_to_client(session *s) {
+
+  connection *client = &(s->client), *website = &(s->website);
+  RingBuffer *ring = s->ring;
+  ssize_t single_read, single_send;
+  bool progress, framed;
+
+  // The chunks of the preview are decoded first (the gate may have replaced
+  // it), only the data read from here on is left to relay_chunks:
+  if(s->relay_left == -1)
+    parse_message(website, true, s->head_request);
+
+  while(!ring->empty() || (website->fd != -1 && s->relay_left != 0)) {
+
+    progress = false;
+
+    // Send the data in the ring to the client:
+    if(!ring->empty()) {
+
+      if((single_send = ring->drain(client->fd)) > 0)
+        progress = true;
+
+      else if(errno != EAGAIN && errno != EWOULDBLOCK) {
+        logger.error("Failed to relay to client: " + string(strerror(errno)));
+        return -1;
+      }
+
+    }
+
+    // Fill the ring with data from the website:
+    if(website->fd != -1 && s->relay_left != 0 && !ring->full()) {
+
+      single_read = ring->fill(website->fd, s->relay_left > 0 ? static_cast<size_t> (s->relay_left) : RING_BUFFER_SIZE);
+
+      if(single_read > 0) {
+        stats.website_bytes.fetchAndAddRelaxed(static_cast<quint64> (single_read));
+        if(s->relay_left > 0)
+          s->relay_left -= single_read;
+        else if(website->message.framing == FRAMING_CHUNKED)
+          relay_chunks(s, static_cast<size_t> (single_read));
+        progress = true;
+      }
+
+      // The website closed the connection:
+      else if(single_read == 0) {
+        if(s->relay_left > 0)
+          logger.warning("Website closed the connection before sending the whole answer");
+        close_connection(website);
+        progress = true;
+      }
+
+      else if(errno != EAGAIN && errno != EWOULDBLOCK) {
+        logger.error("Failed to relay from website: " + string(strerror(errno)));
+        return -1;
+      }
+
+    }
+
+    // Nothing moved, so wait for the socket holding the relay back:
+    if(!progress) {
+      if(ring->empty())
+        return wait_for(s, website, EPOLLIN);
+      return wait_for(s, client, EPOLLOUT);
+    }
+
+  }
+
+  delete s->ring;
+  s->ring = nullptr;
+
+  // Only a website connection left open sent a framed answer:
+  framed = website->fd != -1;
+
+  if(framed) {
+    parse_buffer(&(website->buffer));
+    if(persistent_connection()) {
+      pool.release(pool.key(&(website->addr)), website->fd);
+      website->fd = -1;
+    }
+    else
+      close_connection(website);
+  }
+
+  return finish_exchange(s, framed);
+
+}
+
+/**
+ * @fn void Server::relay_chunks(session *s, size_t count)
+ * @brief Method to follow the chunks of an answer as they are relayed.
+ * @param s Address of the session whose answer is relayed.
+ * @param count Number of bytes just stored in the ring of the session.
+ *
+ * The bytes are decoded from where the website connection message state left
+ * off. Once the last chunk and its trailer arrive, nothing is left to relay.
+ * Data past them, or an invalid framing, leaves the connection unfit for
+ * another answer: it is closed after the last chunk, or relayed until the
+ * website closes it otherwise.
+ *
+ */
+
+void Server::relay_chunks(session *s, size_t count) {
+
+  connection *website = &(s->website);
+  chunk_state *chunks = &(website->message.chunks);
+  struct iovec pieces[2];
+  size_t used = 0;
+  int total = s->ring->recent(count, pieces);
+
+  for(int piece = 0; piece < total && chunks->step != CHUNK_DONE && chunks->step != CHUNK_ERROR; piece++)
+    used += ChunkedCodec::decode(chunks, static_cast<const char*> (pieces[piece].iov_base),
+                                 pieces[piece].iov_len, nullptr, nullptr);
+
+  if(chunks->step == CHUNK_ERROR) {
+    logger.warning("Invalid chunked answer from website, relaying it until the connection closes");
+    website->message.framing = FRAMING_CLOSE;
+  }
+
+  else if(chunks->step == CHUNK_DONE) {
+    s->relay_left = 0;
+    if(used < count) {
+      logger.warning("Website sent data after the last chunk of the answer");
+      close_connection(website);
+    }
+  }
+
+}
+
+/**
+ * @fn int Server::relay_tunnel(session *s)
+ * @brief Method used by the Server to relay the data of a tunnel both ways.
+ * @param s Address of the session whose tunnel is relayed.
+ * @return Returns 0 when the tunnel is closed, TASK_PENDING while the relay
+ * waits for the sockets and -1 if an error occurs.
+ *
+ * This method moves data from the client to the website through the upstream
+ * ring of the session and from the website to the client through its ring,
+ * until neither direction can make progress. Both rings are kept inside the
+ * kernel, so the data of a tunnel is spliced and never copied to user space.
+ * Then, each socket is armed for the events that would let the relay go on
+ * (reading while its ring has room and writing while the other ring has
+ * data), so a session relaying a tunnel may wait for both of its sockets.
+ *
+ * When one side closes its connection, the other side is shut down for
+ * writing once the data left in the ring is sent. The tunnel is closed when
+ * both sides are closed (the next task will be AWAIT_CONNECTION), or by
+ * expire_sessions() when it stays idle for too long.
+ *
+ */
+
+int Server::relay_tunnel(session *s) {
+
+  connection *client = &(s->client), *website = &(s->website);
+  unsigned int client_events, website_events;
+  ssize_t single_send;
+  int return_code;
+  bool progress, moved = false;
+
+  do {
+
+    progress = false;
+
+    // Data read together with the CONNECT request goes first:
+    if(!s->pipeline.isEmpty()) {
+
+      single_send = send(website->fd, s->pipeline.constData(),
+                         static_cast<size_t> (s->pipeline.size()), MSG_NOSIGNAL);
+
+      if(single_send > 0) {
+        s->pipeline.remove(0, static_cast<int> (single_send));
+        s->tunnel_up += static_cast<quint64> (single_send);
+        stats.tunnel_bytes.fetchAndAddRelaxed(static_cast<quint64> (single_send));
+        progress = true;
+      }
+
+      else if(errno != EAGAIN && errno != EWOULDBLOCK) {
+        logger.error("Failed to relay to website: " + string(strerror(errno)));
+        return -1;
+      }
+
+    }
+
+    // Client to website:
+    if(s->pipeline.isEmpty()) {
+      if((return_code = pump_tunnel(s->upstream, client, website,
+                                    &(s->client_eof), &(s->tunnel_up))) == -1)
+        return -1;
+      progress |= return_code == 1;
+    }
+
+    // Website to client:
+    if((return_code = pump_tunnel(s->ring, website, client, &(s->website_eof),
+                                  &(s->tunnel_down))) == -1)
+      return -1;
+    progress |= return_code == 1;
+
+    moved |= progress;
+
+  } while(progress);
+
+  if(moved)
+    s->idle_since = monotonic_ms();
+
+  // Pass the end of each direction on, once its data is sent:
+  if(s->client_eof && s->pipeline.isEmpty() && s->upstream->empty())
+    shutdown(website->fd, SHUT_WR);
+  if(s->website_eof && s->ring->empty())
+    shutdown(client->fd, SHUT_WR);
+
+  if(s->client_eof && s->website_eof && s->pipeline.isEmpty() &&
+     s->upstream->empty() && s->ring->empty()) {
+    s->next_task = AWAIT_CONNECTION;
+    return 0;
+  }
+
+  client_events = website_events = 0;
+
+  if(!s->client_eof && s->pipeline.isEmpty() && !s->upstream->full())
+    client_events |= EPOLLIN;
+  if(!s->ring->empty())
+    client_events |= EPOLLOUT;
+  if(!s->website_eof && !s->ring->full())
+    website_events |= EPOLLIN;
+  if(!s->pipeline.isEmpty() || !s->upstream->empty())
+    website_events |= EPOLLOUT;
+
+  if(client_events != 0 && wait_for(s, client, client_events) == -1)
+    return -1;
+  if(website_events != 0 && wait_for(s, website, website_events) == -1)
+    return -1;
+
+  return TASK_PENDING;
+
+}
+
+/**
+ * @fn int Server::send_buffer(session *s, connection *destination, request *req)
+ * @brief Method used by the Server to send a buffer through a socket.
+ * @param s Address of the session sending the buffer.
+ * @param destination Address of the connection where the buffer is sent.
+ * @param req Address of the buffer to be sent.
+ * @return Returns 0 when the whole buffer was sent, TASK_PENDING while the
+ * socket is full and -1 if an error occurs.
+ *
+ * This method sends as much of a buffer as the destination socket accepts,
+ * keeping track of the bytes already sent in the session. If the socket is
+ * full, the session waits for the socket to become writable.
+ *
+ */
+
+int Server::send_buffer(session *s, connection *destination, request *req) {
+
+  ssize_t single_send;
+
+  while(s->sent < static_cast<size_t> (req->size)) {
+
+    single_send = send(destination->fd, req->content + s->sent,
+                       static_cast<size_t> (req->size) - s->sent, MSG_NOSIGNAL);
+
+    if(single_send >= 0)
+      s->sent += static_cast<size_t> (single_send);
+
+    else if(errno == EAGAIN || errno == EWOULDBLOCK)
+      return wait_for(s, destination, EPOLLOUT);
+
+    else {
+      logger.error("Failed to send: " + string(strerror(errno)));
+      return -1;
+    }
+
+  }
+
+  s->sent = 0;
+  return 0;
+
+}
+
+/**
+ * @fn int Server::send_file_to_client(session *s)
+ * @brief Method used by the Server to send a body kept on disk to the client.
+ * @param s Address of the session whose cached answer is sent.
+ * @return Returns 0 when the successfully executed, TASK_PENDING while the
+ * client socket is full and -1 if an error occurs.
+ *
+ * The body is copied from its segment file to the client socket by the
+ * kernel (sendfile), without passing through the session buffers. Once it
+ * is sent, the exchange is finished (see finish_exchange).
+ *
+ */
+
+int Server::send_file_to_client(session *s) {
+
+  disk_body *body = &(s->body);
+  ssize_t single_send;
+
+  while(body->size > 0) {
+
+    if((single_send = sendfile(s->client.fd, body->fd, &(body->offset), body->size)) > 0) {
+      body->size -= static_cast<size_t> (single_send);
+      continue;
+    }
+
+    if(single_send == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return wait_for(s, &(s->client), EPOLLOUT);
+
+    // The segment was shortened, so the answer can not be completed:
+    logger.error("Failed to send the cached answer: " + string(single_send == 0 ? "file truncated" : strerror(errno)));
+    return -1;
+
+  }
+
+  close(body->fd);
+  body->fd = -1;
+
+  return finish_exchange(s, true);
+
+}
+
+/**
+ * @fn int Server::send_to_client(session *s)
+ * @brief Method used by the Server to send data to the client.
+ * @param s Address of the session whose answer is sent.
+ * @return Returns 0 when the successfully executed, TASK_PENDING while the
+ * client socket is full and -1 if an error occurs.
+ *
+ * This method is used by the Server to send data to the client socket. The
+ * data is taken from the website connection of the session.
+ *
+ * If this task is executed succesfully and the answer is being relayed, the
+ * next task to be executed will be RELAY_TO_CLIENT, or SEND_FILE_TO_CLIENT if
+ * the body of the answer is in the disk cache. Otherwise, the exchange is
+ * finished (see finish_exchange).
+ *
+ */
+
+int Server::send_to_client(session *s) {
+
+  int return_code;
+  bool framed;
+
+  if(s->sent == 0)
+    logger.info("Sending message to client");
+
+  if((return_code = send_buffer(s, &(s->client), &(s->website.buffer))) != 0)
+    return return_code;
+
+  if(s->body.fd != -1) {
+    s->next_task = SEND_FILE_TO_CLIENT;
+    return 0;
+  }
+
+  if(s->ring != nullptr) {
+    logger.info("Relaying the rest of the answer to client");
+    s->next_task = RELAY_TO_CLIENT;
+    return 0;
+  }
+
+  framed = parse_message(&(s->website), true, s->head_request) == PARSE_MESSAGE_COMPLETE &&
+           s->website.buffer.size == s->website.message.length;
+
+  return finish_exchange(s, framed);
+
+}
+
+/**
+ * @fn int Server::send_to_website(session *s)
+ * @brief Method used by the Server to send data to the website.
+ * @param s Address of the session whose request is sent.
+ * @return Returns 0 when the successfully executed, TASK_PENDING while the
+ * website socket is full and -1 if an error occurs.
+ *
+ * This method is used by the Server to send data to the website socket. The
+ * data is taken from the client connection of the session.
+ *
+ * If this task is executed succesfully, the next task to be executed will be
+ * READ_FROM_WEBSITE.
+ *
+ */
+
+int Server::send_to_website(session *s) {
+
+  int return_code;
+
+  if(s->sent == 0)
+    logger.info("Sending message to website");
+
+  if((return_code = send_buffer(s, &(s->website), &(s->client.buffer))) != 0)
+    return return_code;
+
+  logger.info("Sent some message to website!");
+  s->website.buffer.size = 0;
+  s->website.buffer.parsed = false;
+  HTTPParserCore::resetMessage(&(s->website.message));
+  s->next_task = READ_FROM_WEBSITE;
+  return 0;
+
+}
+
+/**
+ * @fn int Server::update_requests(session *s)
+ * @brief Method used by the Server to update requests based on user edits.
+ * @param s Address of the session whose exchange was released by the gate.
+ * @return Returns 0 when the successfully executed.
+ *
+ * This method is used by the Server to update the header and data contained in
+ * both the client and website requests based on the modifications made by the
+ * user. The MainWindow tracks which parts the user edited: if no
+ * modifications are made, the method just updates the next_task control
+ * variable and the original bytes go on. If modifications were made, the new
+ * message is built from the edited parts only (see rebuild_message) and the
+ * method checks if it is valid or not.
+ *
+ * If this task is executed succesfully, the next task to be executed will be
+ * LOOKUP_CACHE if the last_read variable is CLIENT and SEND_TO_CLIENT if the
+ * last_read variable is WEBSITE.
+ *
+ * Important: If the request edits made by the user result in a INVALID HTTP
+ * request, the user is notified by an error log message, the ORIGINAL request
+ * is restored and the next task to be executed is AWAIT_GATE, taking the user
+ * back to the request gate.
+ *
+ */
 
-        new_buffer.append(new_client_headers);
-        new_buffer.append(new_client_data);
+int Server::update_requests(session *s){
 
-        // If the new request is valid, overwrite the buffer:
-        if(new_client_request.parseRequest(new_buffer.data(), new_buffer.size())){
-            new_client_request.updateContentLength();
-            emit newHost(parser.getHost());
-            replace_buffer(&(client->buffer), new_client_request.requestBuffer());
-            next_task = CONNECT_TO_WEBSITE;
-            logger.info("Edited client request!");
-        }
-        // Else, go back to the gate with the old request:
-        else {
-            emit clientData(parser.requestHeaderToQString(), QByteArray(parser.getData(), parser.getDataSize()));
-            logger.error("Invalid client request entered! Try again!");
-            next_task = AWAIT_GATE;
-        }
+  connection *client = &(s->client), *website = &(s->website);
+  QByteArray new_buffer;
+
+  // Check which request we should update:
+  switch(s->last_read) {
+
+    case CLIENT:
+
+      s->next_task = LOOKUP_CACHE;
+
+      // If there were no edits, the original bytes go on:
+      if(!client_edit.headers_edited && !client_edit.data_edited) {
+        logger.info("Client request unchanged!");
+        break;
+      }
+
+      // If the new request is valid, overwrite the buffer:
+      if(rebuild_message(client, &client_edit, false, &new_buffer)) {
+        replace_buffer(client, new_buffer);
+        parse_buffer(&(client->buffer));
+        s->request = RuleSet::describe(QString::fromLatin1(parser.getMethod()),
+                                       QString::fromLatin1(parser.getURL()),
+                                       QString::fromLatin1(parser.getHost()));
+        emit newHost(QString::fromLatin1(parser.getHost()));
+        logger.info("Edited client request!");
+      }
 
+      // Else, go back to the gate with the old request:
+      else {
+        parse_buffer(&(client->buffer));
+        emit clientData(parser.requestHeaderBuffer(), parser.getDecodedData());
+        logger.error("Invalid client request entered! Try again!");
+        s->displayed = true;
+        s->next_task = AWAIT_GATE;
       }
 
       break;
 
     case WEBSITE:
 
-      // Save original request data:
-      parser.parseRequest(website->buffer.content, website->buffer.size);
-      original_header = parser.answerHeaderToQString();
-      original_data = QByteArray(parser.getData(), parser.getDataSize());
+      s->next_task = SEND_TO_CLIENT;
 
-      // If there were no edits, continue:
-      if(new_website_headers == original_header && new_website_data == original_data) {
-        next_task = SEND_TO_CLIENT;
+      // If there were no edits, the original bytes go on:
+      if(!website_edit.headers_edited && !website_edit.data_edited) {
         logger.info("Website answer unchanged!");
+        break;
       }
 
-      // If there were edits, we might need to overwrite the connection buffer:
+      // If the new answer is valid, overwrite the buffer (only the headers
+      // of a relayed answer can be edited):
+      if(rebuild_message(website, &website_edit, s->ring != nullptr, &new_buffer)) {
+        replace_buffer(website, new_buffer);
+        parse_buffer(&(website->buffer));
+        emit newHost(QString::fromLatin1(parser.getHost()));
+        logger.info("Edited website request!");
+      }
+
+      // Else, go back to the gate with the old answer:
       else {
+        parse_buffer(&(website->buffer));
+        emit websiteData(parser.answerHeaderBuffer(), parser.getDecodedData());
+        logger.error("Invalid website answer entered! Try again!");
+        s->displayed = true;
+        s->next_task = AWAIT_GATE;
+      }
 
-        HTTPParser new_website_answer;
+      break;
 
-        new_buffer.append(new_website_headers);
-        new_buffer.append(new_website_data);
+  }
 
-        // If the new request is valid, overwrite the buffer:
-        if(new_website_answer.parseRequest(new_buffer.data(), new_buffer.size())){
-            new_website_answer.updateContentLength();
-            emit newHost(parser.getHost());
-            replace_buffer(&(website->buffer), new_website_answer.answerBuffer());
-            next_task = SEND_TO_CLIENT;
-            logger.info("Edited website request!");
-        }
-        // Else, go back to the gate with the old request:
-        else {
-            emit websiteData(parser.answerHeaderToQString(), QByteArray(parser.getData(), parser.getDataSize()));
-            logger.error("Invalid website answer entered! Try again!");
-            next_task = AWAIT_GATE;
-        }
+  return 0;
 
-      }
+}
+
+/**
+ * @fn int Server::wait_for(session *s, connection *conn, unsigned int events)
+ * @brief Method used by a session to wait for a socket to become ready.
+ * @param s Address of the session that waits.
+ * @param conn Address of the connection whose socket is watched.
+ * @param events Epoll events the session waits for (EPOLLIN or EPOLLOUT).
+ * @return Returns TASK_PENDING when successfully executed and -1 if an error
+ * occurs.
+ *
+ * This method arms a socket of the session in the Reactor. When the socket
+ * becomes ready, the run() method resumes the session with the same task.
+ *
+ */
+
+int Server::wait_for(session *s, connection *conn, unsigned int events) {
 
-    break;
+  if(reactor.arm(conn->fd, events, s) != 0) {
+    logger.error("Failed to watch socket: " + string(strerror(errno)));
+    return -1;
+  }
+
+  return TASK_PENDING;
+
+}
+
+/**
+ * @fn ParseStatus Server::parse_message(connection *conn, bool answer, bool head_request)
+ * @brief Method to follow the HTTP message arriving in the buffer of a connection.
+ * @param conn Address of the connection holding the message received so far.
+ * @param answer True if the message is a website answer.
+ * @param head_request True if the answer is for a HEAD request.
+ * @return Returns how much of the message arrived (see HTTPParserCore::feed).
+ *
+ * The parse state of the message is kept in the connection, so only the data
+ * read since the last call is looked at: the headers are parsed once, when
+ * they are complete, and the end of the message is found from their framing.
+ * The state is reset whenever the buffer is emptied or replaced.
+ *
+ */
+
+ParseStatus Server::parse_message(connection *conn, bool answer, bool head_request) {
+
+  request *req = &(conn->buffer);
+  bool parsing = conn->message.header_end == -1;
+  ParseStatus status;
+
+  status = parser.feed(&(conn->message), req->content,
+                       static_cast<size_t> (req->size), answer, head_request);
 
+  // The parse is kept for the tasks that follow (see parse_buffer):
+  if(parsing && status != PARSE_NEED_MORE) {
+    if(status == PARSE_ERROR)
+      logger.error(parser.errorMessage());
+    parsed_buffer = status == PARSE_ERROR ? nullptr : req;
+    req->parsed = status != PARSE_ERROR;
   }
 
-  return 0;
+  return status;
+
+}
+
+/**
+ * @fn session *Server::create_session(int client_fd, struct sockaddr_storage *client_addr)
+ * @brief Method to create a session for a new client connection.
+ * @param client_fd File descriptor for the client socket connection.
+ * @param client_addr Address information of the client socket connection.
+ * @return Returns the address of the new session.
+ *
+ * The new session is registered in the Server and its first task is
+ * READ_FROM_CLIENT.
+ *
+ */
+
+session *Server::create_session(int client_fd, struct sockaddr_storage *client_addr) {
+
+  // The buffers are only taken as data arrives:
+  session *s = new session;
+
+  s->client.fd = client_fd;
+  s->client.buffer = {nullptr, 0, 0, false};
+  HTTPParserCore::resetMessage(&(s->client.message));
+  s->client.addr = *client_addr;
+  s->website.fd = -1;
+  s->website.buffer = {nullptr, 0, 0, false};
+  HTTPParserCore::resetMessage(&(s->website.message));
+  s->last_read = CLIENT;
+  s->next_task = READ_FROM_CLIENT;
+  s->sent = 0;
+  s->head_request = false;
+  s->reused = false;
+  s->displayed = false;
+  s->idle_since = -1;
+  s->ring = nullptr;
+  s->relay_left = -1;
+  s->next_attempt = 0;
+  s->connect_deadline = -1;
+  s->tunnel = false;
+  s->upstream = nullptr;
+  s->client_eof = false;
+  s->website_eof = false;
+  s->tunnel_up = 0;
+  s->tunnel_down = 0;
+  s->ticket = 0;
+  s->body.fd = -1;
+  s->flight = FLIGHT_NONE;
+
+  sessions.insert(s);
+
+  return s;
+
+}
+
+/**
+ * @fn void Server::cache_answer(session *s)
+ * @brief Method to update the HTTP cache with a whole website answer.
+ * @param s Session whose answer was read.
+ *
+ * A 304 answer to a request made conditional by lookup_cache refreshes the
+ * stale answer, which replaces the 304 in the website buffer (the client did
+ * not ask for a conditional request). Other answers to GET requests are
+ * stored, when the caching rules allow it, and successful answers to unsafe
+ * requests drop the cached answers of their URL.
+ *
+ */
+
+void Server::cache_answer(session *s) {
+
+  connection *client = &(s->client), *website = &(s->website);
+  QByteArray answer(website->buffer.content, static_cast<int> (website->buffer.size));
+  Headers headers;
+  HttpMethod method;
+  QByteArray code;
+
+  parse_buffer(&(website->buffer));
+  code = parser.getCode();
+  parse_buffer(&(client->buffer));
+  method = parser.getMethodId();
+  headers = parser.getHeaders();
+
+  if(code == "304" && !s->stale_answer.isEmpty()) {
+    logger.info("Cached answer confirmed by the website");
+    answer = cache->refresh(s->cache_key, &headers, s->stale_answer, answer);
+    replace_buffer(website, answer);
+  }
+
+  else if(method == METHOD_GET)
+    cache->store(s->cache_key, &headers, answer);
+
+  // Unsafe requests may change the resource (RFC 9111, section 4.4):
+  else if(method != METHOD_HEAD && (code.startsWith('2') || code.startsWith('3')))
+    cache->invalidate(s->cache_key);
+
+  s->stale_answer.clear();
+
+}
+
+/**
+ * @fn void Server::cancel_attempts(session *s)
+ * @brief Method to stop the website connection attempts of a session.
+ * @param s Address of the session racing website connection attempts.
+ *
+ * The sockets of the attempts still in progress are closed and the addresses
+ * not tried yet are dropped. The website connection itself is kept.
+ *
+ */
+
+void Server::cancel_attempts(session *s) {
+
+  for(connect_attempt &attempt : s->attempts)
+    close(attempt.fd);
+
+  s->attempts.clear();
+  s->addresses.clear();
+  s->connect_deadline = -1;
+  connecting.remove(s);
+
+}
+
+/**
+ * @fn void Server::close_connection(connection *conn)
+ * @brief Method to close the socket of a connection.
+ * @param conn Address of the connection to be closed.
+ *
+ * Closing a socket also removes it from the Reactor. Connections that are
+ * already closed are ignored.
+ *
+ */
+
+void Server::close_connection(connection *conn) {
+  if(conn->fd != -1) {
+    close(conn->fd);
+    conn->fd = -1;
+  }
+}
+
+/**
+ * @fn void Server::close_session(session *s)
+ * @brief Method to close a session and release its resources.
+ * @param s Address of the session to be closed.
+ *
+ * The bytes relayed by a tunnel are logged when it is closed.
+ *
+ * Warning: The session is DELETED by this method.
+ *
+ */
+
+void Server::close_session(session *s) {
+
+  if(s->tunnel && s->upstream != nullptr)
+    logger.info("Tunnel closed: " + to_string(s->tunnel_up) + " bytes sent, " +
+                to_string(s->tunnel_down) + " bytes received");
+
+  if(s->ticket != 0) {
+    gate_queue.removeAll(s);
+    unpark_session(s);
+  }
+
+  end_flight(s);
+  resolver.cancel(s);
+  cancel_attempts(s);
+  close_connection(&(s->client));
+  close_connection(&(s->website));
+  slabs.release(&(s->client.buffer));
+  slabs.release(&(s->website.buffer));
+
+  if(s->body.fd != -1)
+    close(s->body.fd);
+
+  delete s->ring;
+  delete s->upstream;
+  sessions.remove(s);
+  delete s;
 
 }
 
@@ -816,28 +2244,91 @@ void Server::config_client_addr(struct sockaddr_in *client_addr) {
 }
 
 /**
- * @fn void Server::config_website_addr(struct sockaddr_in *website_addr)
- * @brief Method to configure the website socket address information.
- * @param website_addr Address of a struct to hold the information.
+ * @fn void Server::display_exchange(session *s)
+ * @brief Method to show the exchange of a session to the user.
+ * @param s Address of the session at the head of the gate queue.
+ *
+ * This method emits the clientData(QByteArray, QByteArray) signal or the
+ * websiteData(QByteArray, QByteArray) signal, depending on the last connection
+ * the session read from, so the exchange can be inspected and edited before
+ * the gate opens. A chunked body is shown without its framing.
+ *
+ */
+
+void Server::display_exchange(session *s) {
+
+  if(s->last_read == CLIENT) {
+    parse_buffer(&(s->client.buffer));
+    emit clientData(parser.requestHeaderBuffer(), parser.getDecodedData());
+  }
+
+  else {
+    parse_buffer(&(s->website.buffer));
+    emit websiteData(parser.answerHeaderBuffer(), parser.getDecodedData());
+  }
+
+}
+
+/**
+ * @fn void Server::end_flight(session *s)
+ * @brief Method to take a session out of its collapsed request.
+ * @param s Address of the session whose answer was read, or that is closed.
+ *
+ * The flight led by the session lands, so the sessions waiting for it look
+ * their request up again, and a waiting session stops waiting.
+ *
+ */
+
+void Server::end_flight(session *s) {
+
+  if(s->flight == FLIGHT_LEADER)
+    cache->land(s->cache_key);
+
+  else if(s->flight == FLIGHT_WAITER)
+    cache->leave(s->cache_key, worker_id, s);
+
+  s->flight = FLIGHT_NONE;
+
+}
+
+/**
+ * @fn void Server::expire_sessions()
+ * @brief Method to close the client connections idle for too long.
  *
- * This method configures the information used to connect to the website
- * socket. The information is saved in the struct pointer website_addr.
+ * A persistent client connection is idle from the moment an answer is sent
+ * until the next request starts arriving, and a tunnel is idle since the last
+ * byte it relayed. This method closes the sessions whose client connection
+ * stays idle for longer than the client (or tunnel) idle time. It
+ * can be called as often as needed: the sessions are only swept once every
+ * SESSION_SWEEP_INTERVAL milliseconds.
  *
  */
 
-void Server::config_website_addr(struct sockaddr_in *website_addr) {
-  memset(website_addr, 0, sizeof(*website_addr));
-  website_addr->sin_family = AF_INET;  // IPv4.
-  website_addr->sin_port = htons(80);  // Port number for website (HTTP).
+void Server::expire_sessions() {
+
+  long long now = monotonic_ms();
+  QList<session*> expired;
+
+  if(now - last_sweep < SESSION_SWEEP_INTERVAL)
+    return;
+
+  last_sweep = now;
+
+  for(session *s : sessions)
+    if(s->idle_since != -1 &&
+       now - s->idle_since >= (s->tunnel ? tunnel_idle_time : client_idle_time))
+      expired.append(s);
+
+  for(session *s : expired)
+    close_session(s);
+
 }
 
 /**
- * @fn void Server::handle_error(ServerTask task, int client_fd, int
- * website_fd)
+ * @fn void Server::handle_error(ServerTask task, session *s)
  * @brief Method to handle errors associated with a Server task.
  * @param task Server task that cause an error.
- * @param client_fd File descriptor for the client socket connection.
- * @param website_fd File descriptor for the website socket connection.
+ * @param s Address of the session whose task failed.
  *
  * This method is used to take the necessary actions when a task performed by
  * the Server run method causes an error. Sometimes, no actions need to be
@@ -845,75 +2336,352 @@ void Server::config_website_addr(struct sockaddr_in *website_addr) {
  *
  */
 
-void Server::handle_error(ServerTask task, int client_fd, int website_fd) {
+void Server::handle_error(ServerTask task, session *s) {
 
   switch(task) {
     case AWAIT_CONNECTION:
       return;
+    case AWAIT_FLIGHT:
+      return;
     case AWAIT_GATE:
       return;
+    case UPDATE_REQUESTS:
+      return;
     case CONNECT_TO_WEBSITE:
-      close(client_fd);
-      break;
+    case LOOKUP_CACHE:
+    case OPEN_TUNNEL:
     case READ_FROM_CLIENT:
-      close(client_fd);
-      break;
     case READ_FROM_WEBSITE:
-      close(client_fd);
-      close(website_fd);
-      break;
+    case RELAY_TO_CLIENT:
+    case RELAY_TUNNEL:
+    case SEND_FILE_TO_CLIENT:
     case SEND_TO_CLIENT:
-      close(client_fd);
-      break;
     case SEND_TO_WEBSITE:
-      close(client_fd);
-      close(website_fd);
+      close_connection(&(s->client));
+      close_connection(&(s->website));
       break;
-    case UPDATE_REQUESTS:
-      return;
   }
 
 }
 
 /**
- * @fn void Server::replace_buffer(request *req, QByteArray new_data)
- * @brief Method to replace the content and size of a request data type.
- * @param req Address of the request whose content and size will be replaced.
- * @param new_data Data to be written to the request.
+ * @fn void Server::next_request(session *s)
+ * @brief Method to prepare a session for the next request of its client.
+ * @param s Address of the session whose exchange was answered.
+ *
+ * This method clears the exchange of the session and moves the pipelined
+ * client data back into the client buffer, so the next task to be executed
+ * is READ_FROM_CLIENT. The buffers of the exchange go back to the slab pool
+ * first, so an idle connection holds none. The client connection is idle
+ * until more data arrives.
  *
- * This method replaces the content of a request specified by the address req
- * with the data provided by new_data. It also changes the size specified in
- * req to that of the data in new_data.
+ */
+
+void Server::next_request(session *s) {
+
+  // An idle connection holds no buffer:
+  slabs.release(&(s->client.buffer));
+  slabs.release(&(s->website.buffer));
+  HTTPParserCore::resetMessage(&(s->client.message));
+  HTTPParserCore::resetMessage(&(s->website.message));
+
+  if(!s->pipeline.isEmpty() && slabs.grow(&(s->client.buffer), static_cast<size_t> (s->pipeline.size()))) {
+    memcpy(s->client.buffer.content, s->pipeline.constData(),
+           static_cast<size_t> (s->pipeline.size()));
+    s->client.buffer.size = s->pipeline.size();
+    s->client.buffer.parsed = false;
+  }
+
+  s->pipeline.clear();
+  s->last_read = CLIENT;
+  s->next_task = READ_FROM_CLIENT;
+  s->sent = 0;
+  s->head_request = false;
+  s->reused = false;
+  s->displayed = false;
+  s->idle_since = s->client.buffer.size == 0 ? monotonic_ms() : -1;
+  s->relay_left = -1;
+
+}
+
+/**
+ * @fn void Server::parse_buffer(request *req)
+ * @brief Method to parse the message held by a buffer with the Server parser.
+ * @param req Address of the buffer.
  *
- * Warning: The old content and size of the request specified by the address
- * req will be OVERWRITTEN.
+ * Several tasks look at the same message, so the parser keeps the parse of
+ * the last buffer it parsed: the message is only parsed again after the
+ * contents of the buffer change (which clears its parsed flag) or after the
+ * parser parsed something else. The body returned by the parser points into
+ * the buffer.
  *
  */
 
-void Server::replace_buffer(request *req, QByteArray new_data){
-    size_t size = static_cast<size_t> (new_data.size());
-    if(size > HTTP_BUFFER_SIZE){
-        logger.warning("Buffer is full");
-        size = HTTP_BUFFER_SIZE;
-    }
+void Server::parse_buffer(request *req) {
+
+  if(req == parsed_buffer && req->parsed)
+    return;
+
+  if(!parser.parseRequest(req->content, req->size))
+    logger.error(parser.errorMessage());
+  parsed_buffer = req;
+  req->parsed = true;
+
+}
+
+/**
+ * @fn void Server::process_session(session *s)
+ * @brief Method to execute the tasks of a session until it has to wait.
+ * @param s Address of the session to be executed.
+ *
+ * This method executes the tasks of a session one after the other, until a
+ * task has to wait for a socket or for the gate (TASK_PENDING), a task fails
+ * or the session finishes. Finished sessions are closed.
+ *
+ */
+
+void Server::process_session(session *s) {
+
+  int return_code;
+
+  do {
+    if((return_code = execute_task(s->next_task, s)) == -1)
+      stats.errors.fetchAndAddRelaxed(1);
+  } while(return_code == 0 && s->next_task != AWAIT_CONNECTION);
+
+  if(s->next_task == AWAIT_CONNECTION)
+    close_session(s);
+
+}
+
+/**
+ * @fn void Server::replace_buffer(connection *conn, QByteArray new_data)
+ * @brief Method to replace the content and size of the buffer of a connection.
+ * @param conn Address of the connection whose buffer will be replaced.
+ * @param new_data Data to be written to the buffer.
+ *
+ * This method replaces the content of the buffer of the connection specified
+ * by the address conn with the data provided by new_data. It also changes the
+ * size of the buffer to that of the data in new_data, and the new message is
+ * parsed from scratch.
+ *
+ * Warning: The old content and size of the buffer will be OVERWRITTEN.
+ *
+ */
+
+void Server::replace_buffer(connection *conn, QByteArray new_data) {
+
+  request *req = &(conn->buffer);
+  size_t size = static_cast<size_t> (new_data.size());
+  if(size > HTTP_BUFFER_SIZE) {
+    logger.warning("Buffer is full");
+    size = HTTP_BUFFER_SIZE;
+  }
+  req->size = 0;
+  req->parsed = false;
+  HTTPParserCore::resetMessage(&(conn->message));
+  if(!slabs.grow(req, size)) {
+    logger.warning("Buffer is full");
+    return;
+  }
+  if(size > 0)
     memcpy(req->content, new_data.data(), size);
-    req->size = new_data.size();
+  req->size = static_cast<ssize_t> (size);
+
+}
+
+/**
+ * @fn void Server::service_connects()
+ * @brief Method to resume the sessions whose website connection race is due.
+ *
+ * A session racing website connection attempts is resumed when its next
+ * address should be tried or when its connect timeout expires, even if none
+ * of its sockets became ready. It is checked on every iteration of the run()
+ * loop, so attempts start at most SERVER_POLL_TIMEOUT milliseconds late.
+ *
+ */
+
+void Server::service_connects() {
+
+  long long now = monotonic_ms();
+  QList<session*> due;
+
+  for(session *s : connecting)
+    if(now >= s->connect_deadline ||
+       (!s->addresses.isEmpty() && now >= s->next_attempt))
+      due.append(s);
+
+  for(session *s : due)
+    process_session(s);
+
 }
 
 /**
- * @fn void Server::set_gate_closed(bool value)
- * @brief Method to set the value of the gate_closed control variable.
- * @param value Value to be assigned to the gate_closed control variable.
+ * @fn void Server::service_flights(bool woken)
+ * @brief Method to resume the sessions whose collapsed request landed.
+ * @param woken True if the Reactor reported the wake eventfd as ready (it is
+ * read by service_gate()).
  *
- * This method sets the value of the gate_closed control variable using the
- * QMutex gate_mutex.
+ * The resumed sessions look their request up in the cache again, where the
+ * answer of the flight they waited for usually is. Their next task is
+ * LOOKUP_CACHE.
  *
  */
 
-void Server::set_gate_closed(bool value) {
-  gate_mutex.lock();
-  gate_closed = value;
-  gate_mutex.unlock();
+void Server::service_flights(bool woken) {
+
+  session *resumed;
+
+  if(!woken)
+    return;
+
+  for(void *waiter : cache->take_landed(worker_id)) {
+    resumed = static_cast<session*> (waiter);
+    resumed->flight = FLIGHT_LANDED;
+    resumed->next_task = LOOKUP_CACHE;
+    process_session(resumed);
+  }
+
+}
+
+/**
+ * @fn void Server::service_gate(bool woken)
+ * @brief Method to handle the sessions waiting for the gate.
+ * @param woken True if the Reactor reported the gate eventfd as ready.
+ *
+ * This method only runs when the Gate woke the Server or sessions were parked
+ * since it last ran, so the Gate is never polled. It first resumes the
+ * parked exchanges the user let through unchanged, whose next task will be
+ * LOOKUP_CACHE (for a client request) or SEND_TO_CLIENT (for a website
+ * answer).
+ *
+ * Then, it shows the exchange of the session at the head of the gate queue
+ * to the user, as long as this worker can acquire the shared Gate. When the
+ * Gate opens, the Server takes the user edits from it, emits a gateOpened()
+ * signal and resumes the session at the head of the queue, whose next task
+ * will be UPDATE_REQUESTS. The Gate is then released, so the exchanges of
+ * other workers get their turn, unless the user edits were invalid and the
+ * same exchange is back on display.
+ *
+ */
+
+void Server::service_gate(bool woken) {
+
+  uint64_t wakes;
+  session *head, *resumed;
+
+  if(woken) {
+    if(read(wake_fd, &wakes, sizeof(wakes)) == -1 && errno != EAGAIN)
+      logger.warning("Failed to read the gate eventfd: " + string(strerror(errno)));
+    if(reactor.arm(wake_fd, EPOLLIN, &wake_fd) != 0) {
+      logger.error("Failed to watch the gate eventfd!");
+      stats.errors.fetchAndAddRelaxed(1);
+    }
+  }
+
+  else if(!gate_changed)
+    return;
+
+  gate_changed = false;
+
+  // Resume the exchanges let through without edits, wherever they are queued:
+  for(quint64 ticket : gate->take_released(worker_id)) {
+
+    resumed = nullptr;
+
+    for(session *s : gate_queue)
+      if(s->ticket == ticket)
+        resumed = s;
+
+    if(resumed == nullptr)
+      continue;
+
+    gate_queue.removeOne(resumed);
+    unpark_session(resumed);
+
+    // The exchange on display leaves the Gate to the next one:
+    if(resumed->displayed) {
+      emit gateOpened();
+      resumed->displayed = false;
+      gate->release(worker_id);
+    }
+
+    logger.info("Exchange let through unchanged");
+    resumed->next_task = resumed->last_read == CLIENT ? LOOKUP_CACHE :
+                                                        SEND_TO_CLIENT;
+    process_session(resumed);
+
+  }
+
+  while(!gate_queue.isEmpty()) {
+
+    head = gate_queue.first();
+
+    // Only one worker at a time shows an exchange to the user:
+    if(!gate->acquire(worker_id))
+      return;
+
+    // Show the exchange at the head of the queue:
+    if(!head->displayed) {
+      display_exchange(head);
+      head->displayed = true;
+    }
+
+    if(!gate->pass(worker_id, &client_edit, &website_edit))
+      return;
+
+    // Signal that the gate actually opened:
+    emit gateOpened();
+
+    gate_queue.removeFirst();
+    unpark_session(head);
+    head->displayed = false;
+    head->next_task = UPDATE_REQUESTS;
+    process_session(head);
+
+    // Only an exchange sent back to the gate can be on display already:
+    if(gate_queue.isEmpty() || !gate_queue.first()->displayed)
+      gate->release(worker_id);
+
+  }
+
+}
+
+/**
+ * @fn void Server::service_resolver(bool readable)
+ * @brief Method to resume the sessions whose website lookup finished.
+ * @param readable True if the Reactor reported the Resolver socket as ready.
+ *
+ * This method reads the DNS answers received (if any), retries or fails the
+ * queries that were not answered in time and resumes every session waiting
+ * for them. The resumed sessions look their website up again, this time in
+ * the DNS cache. The Resolver socket is armed again after it is read.
+ *
+ */
+
+void Server::service_resolver(bool readable) {
+
+  QList<void*> done;
+  QSet<session*> resumed;
+
+  if(readable) {
+    resolver.process(&done);
+    if(reactor.arm(resolver.get_fd(), EPOLLIN, &resolver) != 0) {
+      logger.error("Failed to watch the resolver socket!");
+      stats.errors.fetchAndAddRelaxed(1);
+    }
+  }
+
+  resolver.expire(&done);
+
+  // A session waiting for both of its queries may be reported twice:
+  for(void *waiter : done) {
+    if(resumed.contains(static_cast<session*> (waiter)))
+      continue;
+    resumed.insert(static_cast<session*> (waiter));
+    process_session(static_cast<session*> (waiter));
+  }
+
 }
 
 /**
@@ -931,3 +2699,19 @@ void Server::set_running(bool value) {
   running = value;
   run_mutex.unlock();
 }
+
+/**
+ * @fn void Server::unpark_session(session *s)
+ * @brief Method to remove the exchange of a session from the shared Gate.
+ * @param s Address of the session leaving the gate queue.
+ *
+ * This method emits the exchangeUnparked(quint64) signal, so the exchange is
+ * no longer listed to the user.
+ *
+ */
+
+void Server::unpark_session(session *s) {
+  gate->unpark(s->ticket);
+  emit exchangeUnparked(s->ticket);
+  s->ticket = 0;
+}
@@ -0,0 +1,197 @@
+// Slab pool module - Source code.
+
+/**
+ * @file slab_pool.cpp
+ * @brief Slab pool module - Source code.
+ *
+ * The slab pool module contains the implementation of a per-worker pool of
+ * I/O buffers, so each connection only holds the memory its data takes. This
+ * source file contains the class method implementations for this module.
+ *
+ */
+
+// Includes:
+#include "include/slab_pool.h"
+
+// Class methods:
+
+/**
+ * @fn SlabPool::SlabPool()
+ * @brief Class constructor for the SlabPool class.
+ */
+
+SlabPool::SlabPool() : kept(0) {
+  for(int i = 0; i < SLAB_CLASSES; i++)
+    free_blocks[i] = nullptr;
+}
+
+/**
+ * @fn SlabPool::~SlabPool()
+ * @brief Class destructor for the SlabPool class.
+ *
+ * This destructor frees the buffers kept for reuse. Buffers still held by
+ * requests must be released before.
+ *
+ */
+
+SlabPool::~SlabPool() {
+  clear();
+}
+
+// Public methods:
+
+/**
+ * @fn bool SlabPool::grow(request *req, size_t size)
+ * @brief Method to make sure a request buffer holds a number of bytes.
+ * @param req Address of the request.
+ * @param size Number of bytes the buffer must hold.
+ * @return Returns false if no buffer is that large (or memory ran out), in
+ * which case the request is left as it was.
+ *
+ * A request whose buffer is too small moves its contents to a buffer of the
+ * smallest size that holds them, and its old buffer is given back (a parse of
+ * the old buffer no longer applies).
+ *
+ */
+
+bool SlabPool::grow(request *req, size_t size) {
+
+  int index;
+  char *block;
+
+  if(size <= req->capacity)
+    return true;
+
+  if((index = size_class(size)) == -1)
+    return false;
+
+  if((block = free_blocks[index]) != nullptr) {
+    memcpy(&(free_blocks[index]), block, sizeof(char*));
+    kept -= static_cast<size_t> (SLAB_BLOCK_SIZE) << index;
+  }
+
+  else if((block = static_cast<char*> (malloc(static_cast<size_t> (SLAB_BLOCK_SIZE) << index))) == nullptr)
+    return false;
+
+  if(req->size > 0)
+    memcpy(block, req->content, static_cast<size_t> (req->size));
+
+  if(req->content != nullptr)
+    give(req->content, req->capacity);
+
+  req->content = block;
+  req->capacity = static_cast<size_t> (SLAB_BLOCK_SIZE) << index;
+  req->parsed = false;
+
+  return true;
+
+}
+
+/**
+ * @fn size_t SlabPool::room(request *req, size_t limit)
+ * @brief Method to get free space at the end of a request buffer to read into.
+ * @param req Address of the request.
+ * @param limit Size the request may reach.
+ * @return Returns the number of bytes that can be appended to the contents
+ * (0 if the request reached the limit or memory ran out).
+ *
+ * A full buffer grows to the next size, so a request only takes more memory
+ * as its data arrives. The last byte of a buffer is kept for the '\0' that
+ * read_socket() writes after the data.
+ *
+ */
+
+size_t SlabPool::room(request *req, size_t limit) {
+
+  size_t used = static_cast<size_t> (req->size);
+
+  if(used >= limit || (used + 1 >= req->capacity && !grow(req, used + 2)))
+    return 0;
+
+  return (req->capacity - 1 < limit ? req->capacity - 1 : limit) - used;
+
+}
+
+/**
+ * @fn void SlabPool::clear()
+ * @brief Method to free every buffer kept for reuse.
+ */
+
+void SlabPool::clear() {
+
+  char *block;
+
+  for(int i = 0; i < SLAB_CLASSES; i++) {
+    while((block = free_blocks[i]) != nullptr) {
+      memcpy(&(free_blocks[i]), block, sizeof(char*));
+      free(block);
+    }
+  }
+
+  kept = 0;
+
+}
+
+/**
+ * @fn void SlabPool::release(request *req)
+ * @brief Method to give the buffer of a request back to the pool.
+ * @param req Address of the request, which is left empty.
+ */
+
+void SlabPool::release(request *req) {
+
+  if(req->content != nullptr)
+    give(req->content, req->capacity);
+
+  req->content = nullptr;
+  req->size = 0;
+  req->capacity = 0;
+  req->parsed = false;
+
+}
+
+// Private methods:
+
+/**
+ * @fn void SlabPool::give(char *block, size_t capacity)
+ * @brief Method to keep a buffer for reuse (or free it).
+ * @param block Buffer no longer used.
+ * @param capacity Size of the buffer.
+ *
+ * The address of the next free buffer of the same size is stored in the
+ * first bytes of the buffer itself.
+ *
+ */
+
+void SlabPool::give(char *block, size_t capacity) {
+
+  int index = size_class(capacity);
+
+  if(kept + capacity > SLAB_MAX_KEPT) {
+    free(block);
+    return;
+  }
+
+  memcpy(block, &(free_blocks[index]), sizeof(char*));
+  free_blocks[index] = block;
+  kept += capacity;
+
+}
+
+/**
+ * @fn int SlabPool::size_class(size_t size)
+ * @brief Method to find the smallest buffer size that holds a number of bytes.
+ * @param size Number of bytes.
+ * @return Returns the index of the buffer size or -1 if no buffer is that
+ * large.
+ */
+
+int SlabPool::size_class(size_t size) {
+
+  for(int i = 0; i < SLAB_CLASSES; i++)
+    if(size <= static_cast<size_t> (SLAB_BLOCK_SIZE) << i)
+      return i;
+
+  return -1;
+
+}
@@ -73,7 +73,9 @@ int connect_socket (int fd, struct sockaddr *addr, socklen_t len) {
  * occurs.
  *
  * A simple wrapper function for the read function in 'unistd.h'. This
- * function automatically adds a '\0' to the end of the information read.
+ * function automatically adds a '\0' to the end of the information read, so
+ * the buffer must have room for one extra byte. Nothing is written to the
+ * buffer if the read fails.
  *
  */
 
@@ -81,8 +83,12 @@ ssize_t read_socket(int fd, char *buffer, size_t size) {
 
   ssize_t end;
   end = read(fd, buffer, size);
+
+  if(end < 0)
+    return -1;
+
   buffer[end] = '\0';
 
-  return (end >= 0) ? end : -1;
+  return end;
 
 }
@@ -11,15 +11,20 @@
 // Function implementations:
 
 /**
- * @fn SpiderDumper::SpiderDumper()
+ * @fn SpiderDumper::SpiderDumper(QSharedPointer<DNSCache> dns_cache)
  * @brief SpiderDumper constructor
+ * @param dns_cache DNS cache shared with the proxy server
  *
- * Instanciates and connects its logger to mainwindow
+ * Instanciates and connects its logger to mainwindow and creates its resolver
  */
 
-SpiderDumper::SpiderDumper() : logger("SpiderDumper"){
+SpiderDumper::SpiderDumper(QSharedPointer<DNSCache> dns_cache) : logger("SpiderDumper"),
+                                                                 resolver(dns_cache){
     connect(&logger, SIGNAL (sendMessage(QString)), this,
             SIGNAL (updateLog(QString)));
+
+    if(resolver.init() != 0)
+        logger.error("Failed to create the spider resolver: " + string(strerror(errno)));
 }
 
 /**
@@ -362,7 +367,7 @@ void SpiderDumper::saveToFile(QString folder, QString filename, QByteArray conte
  */
 void SpiderDumper::dumpRecursive(SpiderTree node, QString dirPath){
     QString absoluteLink = getAbsoluteLink(node.getLink(), getHost(node.getLink()));
-    QString request_replaced;
+    QByteArray request_replaced;
     QString contentType;
 
     logger.info("Entered SpiderTree dumper builder, absolute link: " + absoluteLink.toStdString());
@@ -389,7 +394,7 @@ void SpiderDumper::dumpRecursive(SpiderTree node, QString dirPath){
         }
         request_replaced = fix_references(node.getData(), getURL(node.getLink()));
 
-        saveToFile(folder, filename, request_replaced.toStdString().c_str());
+        saveToFile(folder, filename, request_replaced);
     }
 
     // Do not fix references if not html file
@@ -485,17 +490,15 @@ QString SpiderDumper::getHost(QString link){
 }
 
 /**
- * @fn QStringList SpiderDumper::extract_links(QString request)
+ * @fn QStringList SpiderDumper::extract_links(QByteArray request)
  * @brief Extract links from raw data answer from website
  * @param request raw data answer from website
  * @return List of links as QStringList
  */
-QStringList SpiderDumper::extract_links(QString request){
+QStringList SpiderDumper::extract_links(QByteArray request){
     QStringList links;
-    QRegularExpression re("<a.+?(?=href)href\\s*=\\s*[\"|']([^\"']*)[\"'][^>]*>");
-    QRegularExpressionMatchIterator match = re.globalMatch(request);
-    while(match.hasNext()){
-        QString link = match.next().captured(1);
+    for(const TextSpan &span : find_references(request, true)){
+        QString link = QString::fromUtf8(span.data, span.size);
         if(!links.contains(link))
             links << link;
     }
@@ -503,25 +506,98 @@ QStringList SpiderDumper::extract_links(QString request){
 }
 
 /**
- * @fn QStringList SpiderDumper::extract_references(QString request)
+ * @fn QStringList SpiderDumper::extract_references(QByteArray request)
  * @brief Extract references from raw data answer from website
  * @param request raw data answer from website
  * @return List of references as QStringList
  *
  * References include javascript files, css files, images.
  */
-QStringList SpiderDumper::extract_references(QString request){
+QStringList SpiderDumper::extract_references(QByteArray request){
     QStringList links;
-    QRegularExpression re("(?:href|src)\\s*=\\s*[\"|']([^\"']*)[\"']");
-    QRegularExpressionMatchIterator match = re.globalMatch(request);
-    while(match.hasNext()){
-        QString link = match.next().captured(1);
+    for(const TextSpan &span : find_references(request, false)){
+        QString link = QString::fromUtf8(span.data, span.size);
         if(!links.contains(link))
             links << link;
     }
     return links;
 }
 
+/**
+ * @fn QList<TextSpan> SpiderDumper::find_references(const QByteArray &request, bool anchors)
+ * @brief Finds the quoted href and src values of raw data answer from website
+ * @param request raw data answer from website
+ * @param anchors Only take the first href of each <a> tag
+ * @return Values found (without their quotes), pointing into the answer
+ *
+ * The answer is walked from one '<' or quote to the next with ByteScan, so
+ * the text in between is skipped a vector at a time. A quote after '=' opens
+ * an attribute value, which ends at the same quote: it is taken if the
+ * attribute is a href (or a src, unless only anchors are wanted).
+ */
+QList<TextSpan> SpiderDumper::find_references(const QByteArray &request, bool anchors){
+    QList<TextSpan> found;
+    const char *begin = request.constData(), *end = begin + request.size();
+    const char *p = begin, *name, *close;
+    bool anchor = false;
+    TextSpan value;
+
+    while((p = ByteScan::find_any(p, static_cast<size_t>(end - p), '<', '"', '\'')) != nullptr){
+
+        // A tag starts, see if it is an anchor
+        if(*p == '<'){
+            anchor = end - p > 2 && (p[1] == 'a' || p[1] == 'A') && isspace(static_cast<unsigned char>(p[2]));
+            p++;
+            continue;
+        }
+
+        // Only a quote after '=' opens a value, the name is before the '='
+        name = p;
+        while(name > begin && isspace(static_cast<unsigned char>(name[-1])))
+            name--;
+        if(name == begin || name[-1] != '='){
+            p++;
+            continue;
+        }
+        name--;
+        while(name > begin && isspace(static_cast<unsigned char>(name[-1])))
+            name--;
+
+        close = static_cast<const char *>(memchr(p + 1, *p, static_cast<size_t>(end - p - 1)));
+        if(close == nullptr)
+            break;
+
+        if((!anchors || anchor) && (isAttribute(begin, name, "href") || (!anchors && isAttribute(begin, name, "src")))){
+            value.data = p + 1;
+            value.size = static_cast<int>(close - p - 1);
+            found.append(value);
+            anchor = false;
+        }
+
+        p = close + 1;
+    }
+
+    return found;
+}
+
+/**
+ * @fn bool SpiderDumper::isAttribute(const char *begin, const char *nameEnd, const char *attribute)
+ * @brief Checks the name of an attribute, ignoring its case
+ * @param begin Start of the answer
+ * @param nameEnd End of the name in the answer
+ * @param attribute Name expected (lower case)
+ * @return Returns true if the name before nameEnd is the attribute
+ */
+bool SpiderDumper::isAttribute(const char *begin, const char *nameEnd, const char *attribute){
+    size_t size = strlen(attribute);
+    const char *name = nameEnd - size;
+
+    if(static_cast<size_t>(nameEnd - begin) < size || strncasecmp(name, attribute, size) != 0)
+        return false;
+
+    return name == begin || !isalnum(static_cast<unsigned char>(name[-1]));
+}
+
 /**
  * @fn QString SpiderDumper::buildBackDir(int backs)
  * @brief Given number of backs, return '../'xbacks
@@ -536,90 +612,98 @@ QString SpiderDumper::buildBackDir(int backs){
 }
 
 /**
- * @fn QString SpiderDumper::fix_references(QString request, QString url)
+ * @fn QByteArray SpiderDumper::fix_references(QByteArray request, QString url)
  * @brief Fix references of website answer given reference url
- * @param request Answer as QString
+ * @param request Raw answer
  * @param url Url of document
  * @return Return reference-fixed answer
  */
-QString SpiderDumper::fix_references(QString request, QString url){
-    QString ret = request;
-    QRegularExpression re("(?:href|src)\\s*=\\s*[\"|']([^\"']*)[\"']");
-    QRegularExpressionMatchIterator match_i = re.globalMatch(request);
-    int offset = 0;
-    while(match_i.hasNext()){
-        QRegularExpressionMatch match = match_i.next();
-        QString link = match.captured(1);
-        QString fixed_link = getURL_relative(link, url);
-        int match_begin = match.capturedStart(1);
-        int match_end = match.capturedEnd(1);
+QByteArray SpiderDumper::fix_references(QByteArray request, QString url){
+    QByteArray ret;
+    const char *begin = request.constData();
+    int from = 0, offset;
 
-        QString prefix = ret.mid(0, match_begin+offset);
-        QString suffix = ret.mid(match_end+offset);
+    ret.reserve(request.size());
 
-        offset += fixed_link.size() - link.size();
+    // Copy the answer, with each reference replaced
+    for(const TextSpan &span : find_references(request, false)){
+        offset = static_cast<int>(span.data - begin);
+        ret.append(begin + from, offset - from);
+        ret.append(getURL_relative(QString::fromUtf8(span.data, span.size), url).toUtf8());
+        from = offset + span.size;
+    }
 
-        ret = prefix + fixed_link + suffix;
+    ret.append(begin + from, request.size() - from);
 
-    }
     return ret;
 }
 
 /**
  * @fn int SpiderDumper::con(QString host, int *website_fd)
- * @brief Find IP address of host, creates socket and connects to website
+ * @brief Find IP addresses of host, creates socket and connects to website
  * @param host Host to connect
  * @return website_fd Socket file descriptor by reference
  * @return Return -1 if some error occurred
+ *
+ * The addresses (IPv6 and IPv4) are tried one after the other, each one for at
+ * most 5 seconds, until a connection is established.
  */
 int SpiderDumper::con(QString host, int *website_fd){
-    struct hostent *website_ip_data;
-    struct sockaddr_in website_addr;
-
-    website_addr.sin_family = AF_INET;
-    website_addr.sin_addr.s_addr = INADDR_ANY;
-    website_addr.sin_port = htons(80);
+    QList<struct sockaddr_storage> addresses;
+    socklen_t addr_size;
 
     // Asserts pointer is valid
     if(website_fd == nullptr) return -1;
 
-    // Create socket
-    *website_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if(*website_fd == -1){
-        logger.error("Failed to create server socket: " + string(strerror(errno)));
+    // Get IP addresses
+    if(resolver.resolve_wait(host, &addresses) != 0) {
+        logger.error("Failed to find an IP address for the server website: " + host.toStdString());
         return -1;
     }
 
-    // Configure timeout
+    // Configure timeout (SO_SNDTIMEO also bounds connect)
     struct timeval tv;
     tv.tv_sec = 5;
     tv.tv_usec = 0;
-    if (setsockopt(*website_fd, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&tv), sizeof tv) != 0) {
-      logger.error("Failed to configure server socket timeout!");
-      return -1;
-    }
 
-    // Get IP address
-    website_ip_data = gethostbyname(host.toStdString().c_str());
-    if(website_ip_data == nullptr) {
-        logger.error("Failed to find an IP address for the server website: " + host.toStdString());
-        close(*website_fd);
-        return -1;
-    }
+    for(struct sockaddr_storage website_addr : addresses){
 
-    memcpy(&(website_addr.sin_addr.s_addr), website_ip_data->h_addr,
-           static_cast<size_t> (website_ip_data->h_length));
+        if(website_addr.ss_family == AF_INET6){
+            reinterpret_cast<struct sockaddr_in6*> (&website_addr)->sin6_port = htons(80);
+            addr_size = sizeof(struct sockaddr_in6);
+        }
+        else{
+            reinterpret_cast<struct sockaddr_in*> (&website_addr)->sin_port = htons(80);
+            addr_size = sizeof(struct sockaddr_in);
+        }
+
+        // Create socket
+        *website_fd = socket(website_addr.ss_family, SOCK_STREAM, 0);
+        if(*website_fd == -1){
+            logger.error("Failed to create server socket: " + string(strerror(errno)));
+            continue;
+        }
+
+        if (setsockopt(*website_fd, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&tv), sizeof tv) != 0 ||
+            setsockopt(*website_fd, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&tv), sizeof tv) != 0) {
+          logger.error("Failed to configure server socket timeout!");
+          close(*website_fd);
+          return -1;
+        }
+
+        // Connect socket
+        if(connect_socket(*website_fd,
+                          reinterpret_cast<struct sockaddr *> (&website_addr),
+                          addr_size) == 0)
+            return 0;
 
-    // Connect socket
-    if((connect_socket(*website_fd,
-                       reinterpret_cast<struct sockaddr *> (&website_addr),
-                       sizeof(website_addr))) < 0){
         logger.error("Failed to connect to the website: " + string(strerror(errno)));
         close(*website_fd);
-        return -1;
+
     }
 
-    return 0;
+    *website_fd = -1;
+    return -1;
 }
 
 /**
@@ -634,11 +718,13 @@ int SpiderDumper::get(QString link, QByteArray *ret, QString *contentType){
     size_t max_size = HTTP_BUFFER_SIZE;
     ssize_t single_read;
     ssize_t size_read;
-    char buffer[HTTP_BUFFER_SIZE+1];
+    // Grown as the answer arrives, with a byte for the '\0' read_socket adds
+    QByteArray buffer(SPIDER_READ_SIZE + 1, '\0');
     int website_fd;
-    int length;
-    HTTPParser parser;
-    HTTPParser finalParser;
+    HTTPParserCore parser;
+    HTTPParserCore finalParser;
+    MessageState message;
+    ParseStatus status;
 
     // Try to connect
     if((con(getHost(link), &website_fd)) < 0){
@@ -654,72 +740,52 @@ int SpiderDumper::get(QString link, QByteArray *ret, QString *contentType){
         return -1;
     }
 
-    // Read first headers:
-    //logger.info("Reading from website");
-    if((size_read = read_socket(website_fd, buffer, max_size)) == -1){
-        logger.error("Error while reading " + link.toStdString() + ": " + strerror(errno));
-        close(website_fd);
-        return -1;
-    }
-    parser.parseRequest(buffer, size_read);
-
-    //logger.info("Received " + parser.getCode().toStdString() + " " + parser.getDescription().toStdString() + " from website");
-
-    // Read content-length:
-    Headers headers = parser.getHeaders();
-    if(headers.contains("Content-Length")){
-        length = headers["Content-Length"].first().toInt();
-        while(size_read < length){
-            logger.info("Reading extra data from website [" + to_string(size_read) + "/" + to_string(length) + "]");
-            single_read = read_socket(website_fd, buffer+size_read,
-                                      max_size - static_cast<size_t> (size_read));
+    // Read until the framing of the answer says it ended (or the website
+    // closes the connection, for answers framed that way):
+    HTTPParserCore::resetMessage(&message);
+    size_read = 0;
+    while((status = parser.feed(&message, buffer.data(), static_cast<size_t> (size_read), true, false)) != PARSE_MESSAGE_COMPLETE){
+        if(status == PARSE_ERROR){
+            logger.error("Could not parse the answer from " + link.toStdString() + ": " + parser.errorMessage());
+            close(website_fd);
+            return -1;
+        }
 
-            if(single_read == -1) {
-                logger.error("Failed to read from website: " + string(strerror(errno)));
-                close(website_fd);
-                return -1;
-            }
+        if(static_cast<size_t> (size_read) == max_size){
+            logger.error("Request is greater than buffer! Giving up");
+            close(website_fd);
+            return -1;
+        }
 
-            if(static_cast<size_t> (size_read) == max_size){
-                logger.error("Request is greater than buffer! Giving up");
-                close(website_fd);
-                return -1;
-            }
+        if(size_read + 1 == buffer.size())
+            buffer.resize(static_cast<int> (qMin(2 * static_cast<size_t> (size_read), max_size)) + 1);
 
-            size_read += single_read;
+        single_read = read_socket(website_fd, buffer.data()+size_read,
+                                  static_cast<size_t> (buffer.size() - 1 - size_read));
 
+        if(single_read == -1){
+            logger.error("Error while reading " + link.toStdString() + ": " + strerror(errno));
+            close(website_fd);
+            return -1;
         }
 
-    }
-
-    else if(headers.contains("Transfer-Encoding")){
-        if(headers["Transfer-Encoding"].first() == "chunked"){
-            while(
-                (single_read = read_socket(website_fd,
-                                           buffer+size_read,
-                                           max_size - static_cast<size_t> (size_read))) > 0
-            ){
-                //logger.info("Reading extra data from website (chunked) [" + to_string(size_read) + "/" + to_string(max_size) + "]");
-                size_read += single_read;
-            }
+        if(single_read == 0){
+            if(message.framing != FRAMING_CLOSE)
+                logger.warning("Website closed the connection before sending the whole answer");
+            break;
         }
-    }
-    else{
-        logger.warning("Website response doesn't contain Content-Length neither Transfer-Encoding");
+
+        size_read += single_read;
     }
 
-    finalParser.parseRequest(buffer, size_read);
+    finalParser.parseRequest(buffer.data(), size_read);
 
-    *ret = QByteArray(finalParser.getData(), finalParser.getDataSize());
+    *ret = finalParser.getDecodedData();
 
     close(website_fd);
 
     if(contentType != nullptr){
-        Headers headers = finalParser.getHeaders();
-        if(headers.contains("Content-Type")){
-            *contentType = finalParser.getHeaders()["Content-Type"].first();
-        }
-        else *contentType = "";
+        *contentType = QString::fromLatin1(finalParser.getHeaders().value(HEADER_CONTENT_TYPE));
     }
 
     return 0;
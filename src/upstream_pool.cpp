@@ -0,0 +1,202 @@
+// Upstream pool module - Source code.
+
+/**
+ * @file upstream_pool.cpp
+ * @brief Upstream pool module - Source code.
+ *
+ * The upstream pool module contains the implementation of a pool of idle
+ * website connections, kept open so later requests to the same website can
+ * skip the connection handshake. This source file contains the class method
+ * implementations for this module.
+ *
+ */
+
+// Includes:
+#include "include/upstream_pool.h"
+
+// Class methods:
+
+/**
+ * @fn UpstreamPool::UpstreamPool(unsigned int max_idle_time, unsigned int max_per_host)
+ * @brief Class constructor for the UpstreamPool class.
+ * @param max_idle_time Time (in seconds) an idle connection is kept open.
+ * @param max_per_host Number of idle connections kept for each website.
+ *
+ * A max_per_host of 0 disables the pool: every connection released to it is
+ * closed.
+ *
+ */
+
+UpstreamPool::UpstreamPool(unsigned int max_idle_time,
+                           unsigned int max_per_host) :
+                           last_sweep(0),
+                           max_idle_time(static_cast<long long> (max_idle_time) * 1000),
+                           max_per_host(static_cast<int> (max_per_host)) {
+
+}
+
+/**
+ * @fn UpstreamPool::~UpstreamPool()
+ * @brief Class destructor for the UpstreamPool class.
+ *
+ * This destructor closes every idle connection still in the pool.
+ *
+ */
+
+UpstreamPool::~UpstreamPool() {
+  clear();
+}
+
+// Public methods:
+
+/**
+ * @fn int UpstreamPool::acquire(QString website)
+ * @brief Method to take an idle connection to a website from the pool.
+ * @param website Key of the website ('address:port').
+ * @return Returns the file descriptor of an open connection to the website or
+ * -1 if the pool has none.
+ *
+ * The most recently used connection is tried first. Connections closed by the
+ * website (or that received unexpected data) while idle are discarded.
+ *
+ */
+
+int UpstreamPool::acquire(QString website) {
+
+  QHash<QString, QList<idle_connection>>::iterator entry = idle.find(website);
+  idle_connection candidate;
+  ssize_t peeked;
+  char byte;
+
+  if(entry == idle.end())
+    return -1;
+
+  while(!entry.value().isEmpty()) {
+
+    candidate = entry.value().takeLast();
+
+    // An idle connection should have nothing to read:
+    peeked = recv(candidate.fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+
+    if(peeked == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      if(entry.value().isEmpty())
+        idle.erase(entry);
+      return candidate.fd;
+    }
+
+    close(candidate.fd);
+
+  }
+
+  idle.erase(entry);
+
+  return -1;
+
+}
+
+/**
+ * @fn void UpstreamPool::clear()
+ * @brief Method to close every idle connection in the pool.
+ */
+
+void UpstreamPool::clear() {
+
+  for(QList<idle_connection> &connections : idle)
+    for(idle_connection &connection : connections)
+      close(connection.fd);
+
+  idle.clear();
+
+}
+
+/**
+ * @fn void UpstreamPool::expire()
+ * @brief Method to close the connections idle for too long.
+ *
+ * This method can be called as often as needed: the pool is only swept once
+ * every POOL_SWEEP_INTERVAL milliseconds.
+ *
+ */
+
+void UpstreamPool::expire() {
+
+  long long now = monotonic_ms();
+  QHash<QString, QList<idle_connection>>::iterator entry;
+
+  if(now - last_sweep < POOL_SWEEP_INTERVAL)
+    return;
+
+  last_sweep = now;
+
+  for(entry = idle.begin(); entry != idle.end();) {
+
+    // Connections are kept from the oldest to the newest:
+    while(!entry.value().isEmpty() &&
+          now - entry.value().first().since >= max_idle_time)
+      close(entry.value().takeFirst().fd);
+
+    if(entry.value().isEmpty())
+      entry = idle.erase(entry);
+    else
+      ++entry;
+
+  }
+
+}
+
+/**
+ * @fn void UpstreamPool::release(QString website, int fd)
+ * @brief Method to give an idle connection to a website back to the pool.
+ * @param website Key of the website ('address:port').
+ * @param fd File descriptor of the connection.
+ *
+ * If the pool already keeps the maximum number of idle connections for the
+ * website, the oldest one is closed to make room for the new one.
+ *
+ */
+
+void UpstreamPool::release(QString website, int fd) {
+
+  idle_connection connection;
+
+  if(max_per_host == 0) {
+    close(fd);
+    return;
+  }
+
+  QList<idle_connection> &connections = idle[website];
+
+  if(connections.size() >= max_per_host)
+    close(connections.takeFirst().fd);
+
+  connection.fd = fd;
+  connection.since = monotonic_ms();
+  connections.append(connection);
+
+}
+
+/**
+ * @fn QString UpstreamPool::key(struct sockaddr_storage *addr)
+ * @brief Method to build the pool key of a website address.
+ * @param addr Address information (IPv4 or IPv6) of the website socket
+ * connection.
+ * @return Returns the key of the website ('address:port' or
+ * '[address]:port').
+ */
+
+QString UpstreamPool::key(struct sockaddr_storage *addr) {
+
+  char address[INET6_ADDRSTRLEN];
+  struct sockaddr_in *addr4 = reinterpret_cast<struct sockaddr_in*> (addr);
+  struct sockaddr_in6 *addr6 = reinterpret_cast<struct sockaddr_in6*> (addr);
+
+  if(addr->ss_family == AF_INET6) {
+    inet_ntop(AF_INET6, &(addr6->sin6_addr), address, sizeof(address));
+    return "[" + QString(address) + "]:" + QString::number(ntohs(addr6->sin6_port));
+  }
+
+  inet_ntop(AF_INET, &(addr4->sin_addr), address, sizeof(address));
+
+  return QString(address) + ":" + QString::number(ntohs(addr4->sin_port));
+
+}
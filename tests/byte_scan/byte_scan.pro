@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# ByteScan tests: every build of the kernels against a plain loop.
+#
+#-------------------------------------------------
+
+QT += testlib
+QT -= gui
+
+TARGET = tst_byte_scan
+TEMPLATE = app
+
+CONFIG += console testcase c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+# File names:
+SOURCES += \
+        tst_byte_scan.cpp \
+        ../../bench/byte_scan/kernels.cpp \
+        ../../bench/byte_scan/kernel_avx2.cpp \
+        ../../bench/byte_scan/kernel_scalar.cpp \
+        ../../bench/byte_scan/kernel_sse2.cpp
+
+HEADERS += \
+        ../../bench/byte_scan/kernels.h
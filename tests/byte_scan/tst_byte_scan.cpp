@@ -0,0 +1,303 @@
+// ProxyGate - ByteScan tests.
+
+/**
+ * @file tst_byte_scan.cpp
+ * @brief ByteScan tests.
+ *
+ * Every build of the ByteScan kernels the processor can run (see
+ * bench/byte_scan/kernels.h) is compared with a plain loop over random data,
+ * at every offset from an aligned address and with the delimiters at the end
+ * of the data, where the vector steps hand over to the byte loop. The data
+ * is also placed right before a page that can not be read, so a kernel
+ * reading past the bytes given crashes the test.
+ *
+ */
+
+// Library includes:
+#include <random>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Qt includes:
+#include <QString>
+#include <QtTest>
+
+// User includes:
+#include "bench/byte_scan/kernels.h"
+
+// Macros:
+
+/**
+ * @def TEST_SIZE
+ * @brief Largest size (in bytes) of the data searched.
+ */
+
+#define TEST_SIZE 256
+
+/**
+ * @def TEST_OFFSETS
+ * @brief Number of offsets from an aligned address tried.
+ */
+
+#define TEST_OFFSETS 32
+
+/**
+ * @def TEST_ROUNDS
+ * @brief Number of random buffers per kernel.
+ */
+
+#define TEST_ROUNDS 20000
+
+// Class headers:
+
+/**
+ * @class TestByteScan
+ * @brief ByteScan tests.
+ */
+
+class TestByteScan : public QObject {
+
+  Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void find_any_matches_loop();
+    void find_any_finds_tail();
+    void find_header_end_matches_loop();
+    void find_header_end_finds_tail();
+    void reads_only_given_bytes();
+
+  private:
+    // Variables:
+    scan_kernel kernels[KERNELS_MAX];   /**< Builds the processor can run. */
+    size_t count;                       /**< Number of builds. */
+    alignas(64) char data[TEST_SIZE + TEST_OFFSETS]; /**< Data searched. */
+
+    // Methods:
+    static const char *find_any_loop(const char*, size_t, char, char, char);
+    static ssize_t find_header_end_loop(const char*, size_t);
+
+};
+
+// Private methods:
+
+/**
+ * @fn const char *TestByteScan::find_any_loop(const char *data, size_t size, char first, char second, char third)
+ * @brief Method to find the first of up to three bytes, as a plain loop.
+ * @param data Data to be searched.
+ * @param size Size (in bytes) of the data.
+ * @param first Byte to look for.
+ * @param second Byte to look for.
+ * @param third Byte to look for.
+ * @return Returns the address of the first byte found, or nullptr.
+ */
+
+const char *TestByteScan::find_any_loop(const char *data, size_t size,
+                                        char first, char second, char third) {
+
+  for(size_t i = 0; i < size; i++)
+    if(data[i] == first || data[i] == second || data[i] == third)
+      return data + i;
+
+  return nullptr;
+
+}
+
+/**
+ * @fn ssize_t TestByteScan::find_header_end_loop(const char *data, size_t size)
+ * @brief Method to find "\r\n\r\n", as a plain loop.
+ * @param data Data to be searched.
+ * @param size Size (in bytes) of the data.
+ * @return Returns the size of the headers or -1.
+ */
+
+ssize_t TestByteScan::find_header_end_loop(const char *data, size_t size) {
+
+  for(size_t i = 0; i + 4 <= size; i++)
+    if(memcmp(data + i, "\r\n\r\n", 4) == 0)
+      return static_cast<ssize_t> (i + 4);
+
+  return -1;
+
+}
+
+// Test cases:
+
+/**
+ * @fn void TestByteScan::initTestCase()
+ * @brief Method to list the builds of the kernels to be tested.
+ */
+
+void TestByteScan::initTestCase() {
+
+  count = scan_kernels(kernels);
+
+  for(size_t k = 0; k < count; k++)
+    qInfo("Testing the %s kernels", kernels[k].name);
+
+}
+
+/**
+ * @fn void TestByteScan::find_any_matches_loop()
+ * @brief Method to compare find_any with the loop over random data.
+ *
+ * Delimiters are rare enough for some buffers to have none, and the three
+ * bytes looked for are sometimes the same one.
+ *
+ */
+
+void TestByteScan::find_any_matches_loop() {
+
+  const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789 \r\n:<\"'";
+  const char sets[][3] = {{'\r', '\n', ':'}, {'\n', '\n', '\n'}, {'<', '"', '\''}};
+  std::mt19937 generator(22);
+  size_t offset, size;
+  const char *set;
+
+  for(size_t k = 0; k < count; k++) {
+    for(int round = 0; round < TEST_ROUNDS; round++) {
+
+      offset = generator() % TEST_OFFSETS;
+      size = generator() % (TEST_SIZE + 1);
+      set = sets[generator() % 3];
+
+      for(size_t i = 0; i < size; i++)
+        data[offset + i] = alphabet[generator() % (sizeof(alphabet) - 1)];
+
+      if(kernels[k].find_any(data + offset, size, set[0], set[1], set[2]) !=
+         find_any_loop(data + offset, size, set[0], set[1], set[2]))
+        QFAIL(qPrintable(QString("%1: offset %2, size %3").arg(kernels[k].name).arg(offset).arg(size)));
+
+    }
+  }
+
+}
+
+/**
+ * @fn void TestByteScan::find_any_finds_tail()
+ * @brief Method to check find_any with a single delimiter, at every position
+ * of the data and at every offset.
+ */
+
+void TestByteScan::find_any_finds_tail() {
+
+  for(size_t k = 0; k < count; k++) {
+    for(size_t offset = 0; offset < TEST_OFFSETS; offset++) {
+      for(size_t size = 0; size <= TEST_SIZE; size++) {
+
+        memset(data + offset, 'x', size);
+        QVERIFY(kernels[k].find_any(data + offset, size, '\r', '\n', ':') == nullptr);
+
+        for(size_t at = 0; at < size; at++) {
+          data[offset + at] = ':';
+          QVERIFY(kernels[k].find_any(data + offset, size, '\r', '\n', ':') == data + offset + at);
+          data[offset + at] = 'x';
+        }
+
+      }
+    }
+  }
+
+}
+
+/**
+ * @fn void TestByteScan::find_header_end_matches_loop()
+ * @brief Method to compare find_header_end with the loop over random data.
+ *
+ * The data is made of '\r', '\n' and another byte, so it is full of partial
+ * matches.
+ *
+ */
+
+void TestByteScan::find_header_end_matches_loop() {
+
+  const char alphabet[] = "\r\n\r\nx";
+  std::mt19937 generator(22);
+  size_t offset, size;
+
+  for(size_t k = 0; k < count; k++) {
+    for(int round = 0; round < TEST_ROUNDS; round++) {
+
+      offset = generator() % TEST_OFFSETS;
+      size = generator() % (TEST_SIZE + 1);
+
+      for(size_t i = 0; i < size; i++)
+        data[offset + i] = generator() % 8 == 0 ? 'x' : alphabet[generator() % 4];
+
+      if(kernels[k].find_header_end(data + offset, size) !=
+         find_header_end_loop(data + offset, size))
+        QFAIL(qPrintable(QString("%1: offset %2, size %3").arg(kernels[k].name).arg(offset).arg(size)));
+
+    }
+  }
+
+}
+
+/**
+ * @fn void TestByteScan::find_header_end_finds_tail()
+ * @brief Method to check find_header_end with a single "\r\n\r\n", at every
+ * position of the data and at every offset.
+ *
+ * The rest of the data is "\r\n\r" repeated, so it nearly matches
+ * everywhere.
+ *
+ */
+
+void TestByteScan::find_header_end_finds_tail() {
+
+  for(size_t k = 0; k < count; k++) {
+    for(size_t offset = 0; offset < TEST_OFFSETS; offset++) {
+      for(size_t size = 0; size <= TEST_SIZE; size++) {
+
+        for(size_t i = 0; i < size; i++)
+          data[offset + i] = "\r\nx"[i % 3];
+
+        QCOMPARE(kernels[k].find_header_end(data + offset, size), static_cast<ssize_t> (-1));
+
+        for(size_t at = 0; at + 4 <= size; at++) {
+          memcpy(data + offset + at, "\r\n\r\n", 4);
+          QCOMPARE(kernels[k].find_header_end(data + offset, size), find_header_end_loop(data + offset, size));
+          for(size_t i = at; i < at + 4; i++)
+            data[offset + i] = "\r\nx"[i % 3];
+        }
+
+      }
+    }
+  }
+
+}
+
+/**
+ * @fn void TestByteScan::reads_only_given_bytes()
+ * @brief Method to search data that ends right before a page that can not
+ * be read.
+ */
+
+void TestByteScan::reads_only_given_bytes() {
+
+  size_t page = static_cast<size_t> (sysconf(_SC_PAGESIZE));
+  char *pages, *end;
+
+  pages = static_cast<char*> (mmap(nullptr, page * 2, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  QVERIFY(pages != MAP_FAILED);
+  QVERIFY(mprotect(pages + page, page, PROT_NONE) == 0);
+
+  end = pages + page;
+  memset(pages, 'x', page);
+
+  for(size_t k = 0; k < count; k++) {
+    for(size_t size = 0; size <= TEST_SIZE; size++) {
+      QVERIFY(kernels[k].find_any(end - size, size, '\r', '\n', ':') == nullptr);
+      QCOMPARE(kernels[k].find_header_end(end - size, size), static_cast<ssize_t> (-1));
+    }
+  }
+
+  munmap(pages, page * 2);
+
+}
+
+QTEST_APPLESS_MAIN(TestByteScan)
+
+#include "tst_byte_scan.moc"
@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# ChunkedCodec tests.
+#
+#-------------------------------------------------
+
+QT += testlib
+QT -= gui
+
+TARGET = tst_chunked_codec
+TEMPLATE = app
+
+CONFIG += console testcase c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+# File names:
+SOURCES += \
+        tst_chunked_codec.cpp \
+        ../../src/byte_scan.cpp \
+        ../../src/chunked_codec.cpp
+
+HEADERS += \
+        ../../include/byte_scan.h \
+        ../../include/chunked_codec.h
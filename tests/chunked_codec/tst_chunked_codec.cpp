@@ -0,0 +1,287 @@
+// ProxyGate - ChunkedCodec tests.
+
+/**
+ * @file tst_chunked_codec.cpp
+ * @brief ChunkedCodec tests.
+ *
+ * The decoder is fed bodies split at every boundary (a body arrives in as
+ * many pieces as the network likes), with extensions, trailer fields and
+ * bare line feeds, and with the framing errors it must stop at.
+ *
+ */
+
+// Qt includes:
+#include <QByteArray>
+#include <QtTest>
+
+// User includes:
+#include "include/chunked_codec.h"
+
+// Class headers:
+
+/**
+ * @class TestChunkedCodec
+ * @brief ChunkedCodec tests.
+ */
+
+class TestChunkedCodec : public QObject {
+
+  Q_OBJECT
+
+  private slots:
+    void decodes_every_split();
+    void decodes_every_piece_size();
+    void accepts_bare_line_feeds();
+    void keeps_trailer_fields();
+    void limits_size_digits();
+    void rejects_bad_framing();
+    void encodes_decodable_body();
+    void finds_last_coding();
+
+  private:
+    // Variables:
+    static const QByteArray sample;         /**< Body with an extension and
+                                                 a trailer field. */
+    static const QByteArray sample_data;    /**< Data of the sample. */
+    static const QByteArray sample_trailer; /**< Trailer of the sample. */
+    static const QByteArray next_message;   /**< Bytes after the sample. */
+
+    // Methods:
+    static ChunkStep decode_pieces(const QByteArray&, const QList<int>&,
+                                   QByteArray*, QByteArray*, size_t*);
+
+};
+
+// Variables:
+
+const QByteArray TestChunkedCodec::sample =
+  "4;name=value\r\nWiki\r\n5\r\npedia\r\nE\r\n in\r\n\r\nchunks.\r\n0\r\nX-Checksum: 1\r\n\r\n";
+
+const QByteArray TestChunkedCodec::sample_data = "Wikipedia in\r\n\r\nchunks.";
+
+const QByteArray TestChunkedCodec::sample_trailer = "X-Checksum: 1\r\n";
+
+const QByteArray TestChunkedCodec::next_message = "GET / HTTP/1.1\r\n";
+
+// Private methods:
+
+/**
+ * @fn ChunkStep TestChunkedCodec::decode_pieces(const QByteArray &bytes, const QList<int> &sizes, QByteArray *data, QByteArray *trailer, size_t *used)
+ * @brief Method to decode a body arriving in pieces.
+ * @param bytes Bytes received.
+ * @param sizes Size of each piece (the rest arrives as the last one, and no
+ * piece goes past the end of the bytes).
+ * @param data Address to store the data of the chunks.
+ * @param trailer Address to store the trailer fields.
+ * @param used Address to store the number of bytes used.
+ * @return Returns the step the decoder stopped at.
+ */
+
+ChunkStep TestChunkedCodec::decode_pieces(const QByteArray &bytes,
+                                          const QList<int> &sizes,
+                                          QByteArray *data, QByteArray *trailer,
+                                          size_t *used) {
+
+  chunk_state state;
+  size_t piece, taken;
+  int start = 0;
+
+  ChunkedCodec::reset(&state);
+  *used = 0;
+
+  for(int i = 0; i <= sizes.size() && start < bytes.size(); i++) {
+    piece = static_cast<size_t> (i < sizes.size() ? qMin(sizes[i], bytes.size() - start) : bytes.size() - start);
+    taken = ChunkedCodec::decode(&state, bytes.constData() + start, piece, data, trailer);
+    *used += taken;
+    if(state.step == CHUNK_DONE || state.step == CHUNK_ERROR)
+      break;
+    start += static_cast<int> (piece);
+  }
+
+  return state.step;
+
+}
+
+// Test cases:
+
+/**
+ * @fn void TestChunkedCodec::decodes_every_split()
+ * @brief Method to decode the sample split in two at every byte.
+ *
+ * The bytes of the next message follow the body, and must be left alone.
+ *
+ */
+
+void TestChunkedCodec::decodes_every_split() {
+
+  QByteArray bytes = sample + next_message, data, trailer;
+  size_t used;
+
+  for(int split = 0; split <= bytes.size(); split++) {
+    data.clear();
+    trailer.clear();
+    QCOMPARE(decode_pieces(bytes, QList<int>() << split, &data, &trailer, &used), CHUNK_DONE);
+    QCOMPARE(used, static_cast<size_t> (sample.size()));
+    QCOMPARE(data, sample_data);
+    QCOMPARE(trailer, sample_trailer);
+  }
+
+}
+
+/**
+ * @fn void TestChunkedCodec::decodes_every_piece_size()
+ * @brief Method to decode the sample arriving in pieces of every size.
+ */
+
+void TestChunkedCodec::decodes_every_piece_size() {
+
+  QByteArray data, trailer;
+  QList<int> sizes;
+  size_t used;
+
+  for(int size = 1; size <= sample.size(); size++) {
+    sizes.clear();
+    for(int i = 0; i < sample.size(); i += size)
+      sizes.append(size);
+    data.clear();
+    trailer.clear();
+    QCOMPARE(decode_pieces(sample, sizes, &data, &trailer, &used), CHUNK_DONE);
+    QCOMPARE(data, sample_data);
+    QCOMPARE(trailer, sample_trailer);
+  }
+
+}
+
+/**
+ * @fn void TestChunkedCodec::accepts_bare_line_feeds()
+ * @brief Method to decode a body whose lines end with a bare line feed.
+ */
+
+void TestChunkedCodec::accepts_bare_line_feeds() {
+
+  QByteArray bytes = "3\nabc\n2;x\r\nde\r\n0\nX-T: 1\n\n", data, trailer;
+  size_t used;
+
+  for(int split = 0; split <= bytes.size(); split++) {
+    data.clear();
+    trailer.clear();
+    QCOMPARE(decode_pieces(bytes, QList<int>() << split, &data, &trailer, &used), CHUNK_DONE);
+    QCOMPARE(used, static_cast<size_t> (bytes.size()));
+    QCOMPARE(data, QByteArray("abcde"));
+    QCOMPARE(trailer, QByteArray("X-T: 1\n"));
+  }
+
+}
+
+/**
+ * @fn void TestChunkedCodec::keeps_trailer_fields()
+ * @brief Method to check the trailer fields, as received.
+ *
+ * A body without trailer fields ends right after the last chunk, and the
+ * fields are only copied when asked for.
+ *
+ */
+
+void TestChunkedCodec::keeps_trailer_fields() {
+
+  QByteArray trailer;
+  chunk_state state;
+  const char *plain = "0\r\n\r\n";
+  const char *fields = "1\r\na\r\n0\r\nA: 1\r\nB-Long: 2, 3\r\n\r\n";
+
+  QCOMPARE(ChunkedCodec::decoded(plain, strlen(plain), &trailer), QByteArray());
+  QVERIFY(trailer.isEmpty());
+
+  QCOMPARE(ChunkedCodec::decoded(fields, strlen(fields), &trailer), QByteArray("a"));
+  QCOMPARE(trailer, QByteArray("A: 1\r\nB-Long: 2, 3\r\n"));
+
+  ChunkedCodec::reset(&state);
+  QCOMPARE(ChunkedCodec::decode(&state, fields, strlen(fields), nullptr, nullptr), strlen(fields));
+  QCOMPARE(state.step, CHUNK_DONE);
+  QCOMPARE(state.data_size, static_cast<uint64_t> (1));
+
+}
+
+/**
+ * @fn void TestChunkedCodec::limits_size_digits()
+ * @brief Method to check sizes of CHUNK_SIZE_DIGITS digits and more.
+ *
+ * Leading zeros count as digits, so sizes never overflow 64 bits.
+ *
+ */
+
+void TestChunkedCodec::limits_size_digits() {
+
+  QByteArray longest = QByteArray(CHUNK_SIZE_DIGITS - 1, '0') + "1\r\na\r\n0\r\n\r\n";
+  QByteArray too_long = QByteArray(CHUNK_SIZE_DIGITS, '0') + "1\r\na\r\n0\r\n\r\n";
+  QByteArray huge = "FFFFFFFFFFFFFFFF\r\n";
+  chunk_state state;
+
+  ChunkedCodec::reset(&state);
+  ChunkedCodec::decode(&state, longest.constData(), static_cast<size_t> (longest.size()), nullptr, nullptr);
+  QCOMPARE(state.step, CHUNK_DONE);
+
+  ChunkedCodec::reset(&state);
+  ChunkedCodec::decode(&state, too_long.constData(), static_cast<size_t> (too_long.size()), nullptr, nullptr);
+  QCOMPARE(state.step, CHUNK_ERROR);
+
+  ChunkedCodec::reset(&state);
+  ChunkedCodec::decode(&state, huge.constData(), static_cast<size_t> (huge.size()), nullptr, nullptr);
+  QCOMPARE(state.step, CHUNK_ERROR);
+
+}
+
+/**
+ * @fn void TestChunkedCodec::rejects_bad_framing()
+ * @brief Method to check that the decoder stops at a framing error, before
+ * the end of the data.
+ */
+
+void TestChunkedCodec::rejects_bad_framing() {
+
+  const char *bad[] = {"zz\r\n", ";x\r\n", "3\r\nabcX\r\n", "3\r\nabc\rX",
+                       "3x\r\nabc\r\n", "0\r\n\rX\r\n"};
+  chunk_state state;
+
+  for(const char *bytes : bad) {
+    ChunkedCodec::reset(&state);
+    ChunkedCodec::decode(&state, bytes, strlen(bytes), nullptr, nullptr);
+    QCOMPARE(state.step, CHUNK_ERROR);
+  }
+
+}
+
+/**
+ * @fn void TestChunkedCodec::encodes_decodable_body()
+ * @brief Method to decode the body framed by the encoder.
+ */
+
+void TestChunkedCodec::encodes_decodable_body() {
+
+  QByteArray framed, trailer;
+
+  framed = ChunkedCodec::encode(sample_data, sample_trailer);
+  QCOMPARE(ChunkedCodec::decoded(framed.constData(), static_cast<size_t> (framed.size()), &trailer), sample_data);
+  QCOMPARE(trailer, sample_trailer);
+
+  QCOMPARE(ChunkedCodec::encode(QByteArray(), QByteArray()), QByteArray("0\r\n\r\n"));
+
+}
+
+/**
+ * @fn void TestChunkedCodec::finds_last_coding()
+ * @brief Method to check that only the last transfer coding frames the body.
+ */
+
+void TestChunkedCodec::finds_last_coding() {
+
+  QVERIFY(ChunkedCodec::chunked("chunked"));
+  QVERIFY(ChunkedCodec::chunked("gzip, Chunked "));
+  QVERIFY(!ChunkedCodec::chunked("chunked, gzip"));
+  QVERIFY(!ChunkedCodec::chunked(""));
+
+}
+
+QTEST_APPLESS_MAIN(TestChunkedCodec)
+
+#include "tst_chunked_codec.moc"
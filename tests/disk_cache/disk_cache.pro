@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# DiskCache tests.
+#
+#-------------------------------------------------
+
+QT += testlib
+QT -= gui
+
+TARGET = tst_disk_cache
+TEMPLATE = app
+
+CONFIG += console testcase c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+# File names:
+SOURCES += \
+        tst_disk_cache.cpp \
+        ../../src/disk_cache.cpp
+
+HEADERS += \
+        ../../include/disk_cache.h
@@ -0,0 +1,320 @@
+// ProxyGate - DiskCache tests.
+
+/**
+ * @file tst_disk_cache.cpp
+ * @brief DiskCache tests.
+ *
+ * Answers are stored in a temporary directory and looked up after the cache
+ * is opened again (closing a cache waits for its writer thread, so every
+ * answer queued was handled by then): the warm start, removed answers, the
+ * oldest segments deleted to stay within the budget and an index filled,
+ * emptied and filled again, so it is rehashed and reaches its limit.
+ *
+ */
+
+// Qt includes:
+#include <QByteArray>
+#include <QDir>
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+// User includes:
+#include "include/disk_cache.h"
+
+// Macros:
+
+/**
+ * @def TEST_LARGE_BODY
+ * @brief Size (in bytes) of the bodies that fill segments.
+ */
+
+#define TEST_LARGE_BODY 4194304
+
+// Class headers:
+
+/**
+ * @class TestDiskCache
+ * @brief DiskCache tests.
+ */
+
+class TestDiskCache : public QObject {
+
+  Q_OBJECT
+
+  private slots:
+    void keeps_answers_across_runs();
+    void removes_answers();
+    void discards_other_budgets();
+    void drops_oldest_segments();
+    void survives_index_churn();
+
+  private:
+    // Methods:
+    static int check(DiskCache*, int, int);
+    static int store(QString, size_t, int, int, int);
+    static QByteArray head(int);
+    static QString key(int);
+
+};
+
+// Private methods:
+
+/**
+ * @fn int TestDiskCache::check(DiskCache *cache, int number, int body_size)
+ * @brief Method to look an answer stored by store() up.
+ * @param cache Cache to be used.
+ * @param number Number of the answer.
+ * @param body_size Size (in bytes) of its body.
+ * @return Returns 1 if the answer is found intact, 0 if it is missing and -1
+ * if it is found with other contents.
+ */
+
+int TestDiskCache::check(DiskCache *cache, int number, int body_size) {
+
+  QByteArray found_head, found_body;
+  disk_slot slot;
+
+  if(!cache->find(key(number), &slot))
+    return 0;
+
+  if(cache->fetch(&slot, &found_head, &found_body, nullptr) != 0 ||
+     slot.lifetime != number || found_head != head(number) ||
+     found_body != QByteArray(body_size, static_cast<char> ('a' + number % 26)))
+    return -1;
+
+  return 1;
+
+}
+
+/**
+ * @fn int TestDiskCache::store(QString path, size_t budget, int first, int count, int body_size)
+ * @brief Method to store numbered answers, then close the cache.
+ * @param path Directory of the cache.
+ * @param budget Disk budget, in bytes.
+ * @param first Number of the first answer.
+ * @param count Number of answers.
+ * @param body_size Size (in bytes) of their bodies.
+ * @return Returns the result of DiskCache::open().
+ */
+
+int TestDiskCache::store(QString path, size_t budget, int first, int count,
+                         int body_size) {
+
+  DiskCache cache;
+  disk_slot meta = {};
+
+  if(cache.open(path, budget) != 0)
+    return -1;
+
+  for(int i = first; i < first + count; i++) {
+    meta.lifetime = i;
+    cache.store(key(i), meta, head(i), QByteArray(body_size, static_cast<char> ('a' + i % 26)));
+  }
+
+  return 0;
+
+}
+
+/**
+ * @fn QByteArray TestDiskCache::head(int number)
+ * @brief Method to build the status line and headers of an answer.
+ * @param number Number of the answer.
+ * @return Returns the status line and headers.
+ */
+
+QByteArray TestDiskCache::head(int number) {
+
+  return "HTTP/1.1 200 OK\r\nX-Answer: " + key(number).toUtf8() + "\r\n\r\n";
+
+}
+
+/**
+ * @fn QString TestDiskCache::key(int number)
+ * @brief Method to build the URL of an answer.
+ * @param number Number of the answer.
+ * @return Returns the URL.
+ */
+
+QString TestDiskCache::key(int number) {
+
+  return "http://example.com/" + QString::number(number);
+
+}
+
+// Test cases:
+
+/**
+ * @fn void TestDiskCache::keeps_answers_across_runs()
+ * @brief Method to look answers up after the cache is opened again.
+ *
+ * An answer stored again replaces the older one, and a body handed out as a
+ * file reads the same.
+ *
+ */
+
+void TestDiskCache::keeps_answers_across_runs() {
+
+  QTemporaryDir directory;
+  DiskCache cache;
+  QByteArray found_head, found_body;
+  disk_body file;
+  disk_slot slot;
+
+  QVERIFY(directory.isValid());
+  QCOMPARE(store(directory.path(), DISK_SEGMENT_SIZE, 0, 100, 1000), 0);
+  QCOMPARE(store(directory.path(), DISK_SEGMENT_SIZE, 5, 1, 2000), 0);
+
+  QCOMPARE(cache.open(directory.path(), DISK_SEGMENT_SIZE), 0);
+
+  for(int i = 0; i < 100; i++)
+    QCOMPARE(check(&cache, i, i == 5 ? 2000 : 1000), 1);
+
+  QCOMPARE(check(&cache, 100, 1000), 0);
+
+  QVERIFY(cache.find(key(7), &slot));
+  QCOMPARE(cache.fetch(&slot, &found_head, nullptr, &file), 0);
+  QCOMPARE(file.size, static_cast<size_t> (1000));
+  QCOMPARE(DiskCache::load(&file, &found_body), 0);
+  QCOMPARE(file.fd, -1);
+  QVERIFY(found_head == head(7));
+  QVERIFY(found_body == QByteArray(1000, 'h'));
+
+}
+
+/**
+ * @fn void TestDiskCache::removes_answers()
+ * @brief Method to remove an answer, for this run and the next ones.
+ */
+
+void TestDiskCache::removes_answers() {
+
+  QTemporaryDir directory;
+
+  QVERIFY(directory.isValid());
+  QCOMPARE(store(directory.path(), DISK_SEGMENT_SIZE, 0, 10, 100), 0);
+
+  {
+    DiskCache cache;
+    QCOMPARE(cache.open(directory.path(), DISK_SEGMENT_SIZE), 0);
+    cache.remove(key(3));
+    cache.remove(key(42));
+    QCOMPARE(check(&cache, 3, 100), 0);
+    QCOMPARE(check(&cache, 4, 100), 1);
+  }
+
+  DiskCache cache;
+  QCOMPARE(cache.open(directory.path(), DISK_SEGMENT_SIZE), 0);
+
+  for(int i = 0; i < 10; i++)
+    QCOMPARE(check(&cache, i, 100), i == 3 ? 0 : 1);
+
+}
+
+/**
+ * @fn void TestDiskCache::discards_other_budgets()
+ * @brief Method to open a cache with another budget, which empties it.
+ */
+
+void TestDiskCache::discards_other_budgets() {
+
+  QTemporaryDir directory;
+  DiskCache cache;
+
+  QVERIFY(directory.isValid());
+  QCOMPARE(store(directory.path(), DISK_SEGMENT_SIZE, 0, 10, 100), 0);
+
+  QCOMPARE(cache.open(directory.path(), 2 * static_cast<size_t> (DISK_SEGMENT_SIZE)), 0);
+
+  for(int i = 0; i < 10; i++)
+    QCOMPARE(check(&cache, i, 100), 0);
+
+}
+
+/**
+ * @fn void TestDiskCache::drops_oldest_segments()
+ * @brief Method to store more answers than the budget holds.
+ *
+ * The answers are stored a few at a time, so none is dropped from a full
+ * queue. The oldest segments are deleted, with their answers, and the
+ * newest answers are kept.
+ *
+ */
+
+void TestDiskCache::drops_oldest_segments() {
+
+  QTemporaryDir directory;
+  size_t budget = 2 * static_cast<size_t> (DISK_SEGMENT_SIZE);
+  int answers = 3 * DISK_SEGMENT_SIZE / TEST_LARGE_BODY, batch = 8, found = 0,
+      result;
+  DiskCache cache;
+
+  QVERIFY(directory.isValid());
+
+  for(int i = 0; i < answers; i += batch)
+    QCOMPARE(store(directory.path(), budget, i, batch, TEST_LARGE_BODY), 0);
+
+  QCOMPARE(cache.open(directory.path(), budget), 0);
+
+  for(int i = 0; i < answers; i++) {
+    QVERIFY((result = check(&cache, i, TEST_LARGE_BODY)) != -1);
+    found += result;
+  }
+
+  QCOMPARE(check(&cache, 0, TEST_LARGE_BODY), 0);
+  QCOMPARE(check(&cache, answers - 1, TEST_LARGE_BODY), 1);
+  QVERIFY(found <= static_cast<int> (budget / TEST_LARGE_BODY));
+  QVERIFY(!QDir(directory.path()).exists("segment.0"));
+
+}
+
+/**
+ * @fn void TestDiskCache::survives_index_churn()
+ * @brief Method to fill the index, remove half of it and fill it again.
+ *
+ * The removed slots pile up until the index is rehashed. Once 3/4 of the
+ * slots are used (with every answer in a single segment, which is never
+ * deleted), new answers are not kept.
+ *
+ */
+
+void TestDiskCache::survives_index_churn() {
+
+  QTemporaryDir directory;
+  int slot_count = DISK_SEGMENT_SIZE / DISK_SLOT_SHARE, found = 0, result;
+  int filled = slot_count * 3 / 4 - 100, total = slot_count + 1000;
+
+  QVERIFY(directory.isValid());
+  QCOMPARE(store(directory.path(), DISK_SEGMENT_SIZE, 0, filled, 10), 0);
+
+  {
+    DiskCache cache;
+    QCOMPARE(cache.open(directory.path(), DISK_SEGMENT_SIZE), 0);
+    for(int i = 0; i < filled / 2; i++)
+      cache.remove(key(i));
+  }
+
+  for(int i = filled; i < total; i += 500)
+    QCOMPARE(store(directory.path(), DISK_SEGMENT_SIZE, i, qMin(500, total - i), 10), 0);
+
+  DiskCache cache;
+  QCOMPARE(cache.open(directory.path(), DISK_SEGMENT_SIZE), 0);
+
+  for(int i = 0; i < total; i++) {
+    QVERIFY((result = check(&cache, i, 10)) != -1);
+    if(i < filled / 2)
+      QCOMPARE(result, 0);
+    else if(i < filled)
+      QCOMPARE(result, 1);
+    found += result;
+  }
+
+  QVERIFY(found > filled - filled / 2);
+  QVERIFY(found <= slot_count * 3 / 4);
+  QCOMPARE(check(&cache, total - 1, 10), 0);
+
+}
+
+QTEST_APPLESS_MAIN(TestDiskCache)
+
+#include "tst_disk_cache.moc"
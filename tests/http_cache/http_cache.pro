@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# HTTPCache tests.
+#
+#-------------------------------------------------
+
+QT += testlib
+QT -= gui
+
+TARGET = tst_http_cache
+TEMPLATE = app
+
+CONFIG += console testcase c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+# File names:
+SOURCES += \
+        tst_http_cache.cpp \
+        ../../src/disk_cache.cpp \
+        ../../src/header_table.cpp \
+        ../../src/http_cache.cpp \
+        ../../src/reactor.cpp
+
+HEADERS += \
+        ../../include/disk_cache.h \
+        ../../include/header_table.h \
+        ../../include/http_cache.h \
+        ../../include/reactor.h
@@ -0,0 +1,408 @@
+// ProxyGate - HTTPCache tests.
+
+/**
+ * @file tst_http_cache.cpp
+ * @brief HTTPCache tests.
+ *
+ * Answers are stored and looked up again through the public methods of the
+ * cache (without a disk tier): which answers a shared cache keeps, when they
+ * are fresh, when the directives of the request make them stale, how
+ * variants are told apart and how a 304 answer refreshes a stale one.
+ *
+ */
+
+// Qt includes:
+#include <QByteArray>
+#include <QString>
+#include <QtTest>
+
+// User includes:
+#include "include/http_cache.h"
+
+// Macros:
+
+/**
+ * @def TEST_BUDGET
+ * @brief Memory budget (in bytes) of the caches tested.
+ */
+
+#define TEST_BUDGET 1048576
+
+// Class headers:
+
+/**
+ * @class TestHTTPCache
+ * @brief HTTPCache tests.
+ */
+
+class TestHTTPCache : public QObject {
+
+  Q_OBJECT
+
+  private slots:
+    void serves_fresh_answer();
+    void revalidates_stale_answer();
+    void honors_request_directives();
+    void skips_uncacheable_answers();
+    void reads_expiration_dates();
+    void keeps_variants();
+    void refreshes_validated_answer();
+    void invalidates_every_variant();
+    void builds_keys();
+
+  private:
+    // Variables:
+    static const QString url;       /**< Key of the answers stored. */
+    static const QByteArray body;   /**< Body of the answers stored. */
+
+    // Methods:
+    static CacheResult lookup(HTTPCache*, const Headers*, QByteArray*,
+                              QString*);
+    static QByteArray answer(QByteArray, QByteArray);
+
+};
+
+// Variables:
+
+const QString TestHTTPCache::url = "http://example.com/index.html";
+
+const QByteArray TestHTTPCache::body = "<html>cached</html>";
+
+// Private methods:
+
+/**
+ * @fn CacheResult TestHTTPCache::lookup(HTTPCache *cache, const Headers *request, QByteArray *found, QString *etag)
+ * @brief Method to look the test URL up.
+ * @param cache Cache to be used.
+ * @param request Headers of the request.
+ * @param found Address to store the answer found.
+ * @param etag Address to store the entity tag of a stale answer.
+ * @return Returns the result of the lookup.
+ */
+
+CacheResult TestHTTPCache::lookup(HTTPCache *cache, const Headers *request,
+                                  QByteArray *found, QString *etag) {
+
+  disk_body rest;
+  QString last_modified;
+
+  found->clear();
+  etag->clear();
+
+  return cache->lookup(url, request, found, &rest, etag, &last_modified);
+
+}
+
+/**
+ * @fn QByteArray TestHTTPCache::answer(QByteArray status, QByteArray headers)
+ * @brief Method to build an answer with the test body.
+ * @param status Status code and reason of the answer.
+ * @param headers Header lines of the answer (each with its line ending).
+ * @return Returns the whole answer.
+ */
+
+QByteArray TestHTTPCache::answer(QByteArray status, QByteArray headers) {
+
+  return "HTTP/1.1 " + status + "\r\n" + headers + "Content-Length: " +
+         QByteArray::number(body.size()) + "\r\n\r\n" + body;
+
+}
+
+// Test cases:
+
+/**
+ * @fn void TestHTTPCache::serves_fresh_answer()
+ * @brief Method to look up an answer within its max-age.
+ *
+ * The answer served carries its current Age.
+ *
+ */
+
+void TestHTTPCache::serves_fresh_answer() {
+
+  HTTPCache cache(TEST_BUDGET);
+  Headers request;
+  QByteArray found;
+  QString etag;
+
+  QCOMPARE(lookup(&cache, &request, &found, &etag), CACHE_MISS);
+
+  cache.store(url, &request, answer("200 OK", "Cache-Control: max-age=60\r\n"));
+
+  QCOMPARE(lookup(&cache, &request, &found, &etag), CACHE_HIT);
+  QVERIFY(found.startsWith("HTTP/1.1 200 OK\r\n"));
+  QVERIFY(found.contains("\r\nAge: "));
+  QVERIFY(found.endsWith("\r\n\r\n" + body));
+
+}
+
+/**
+ * @fn void TestHTTPCache::revalidates_stale_answer()
+ * @brief Method to look up answers older than their max-age.
+ *
+ * An answer with a validator is returned for revalidation, an answer
+ * without one is a miss.
+ *
+ */
+
+void TestHTTPCache::revalidates_stale_answer() {
+
+  HTTPCache cache(TEST_BUDGET);
+  Headers request;
+  QByteArray found;
+  QString etag;
+
+  cache.store(url, &request, answer("200 OK", "Cache-Control: max-age=60\r\nAge: 120\r\n"));
+  QCOMPARE(lookup(&cache, &request, &found, &etag), CACHE_MISS);
+
+  cache.store(url, &request, answer("200 OK", "Cache-Control: max-age=60\r\nAge: 120\r\n"
+                                              "ETag: \"v1\"\r\n"));
+  QCOMPARE(lookup(&cache, &request, &found, &etag), CACHE_STALE);
+  QCOMPARE(etag, QString("\"v1\""));
+  QVERIFY(found.endsWith("\r\n\r\n" + body));
+
+}
+
+/**
+ * @fn void TestHTTPCache::honors_request_directives()
+ * @brief Method to look up a fresh answer with the directives of a client.
+ */
+
+void TestHTTPCache::honors_request_directives() {
+
+  HTTPCache cache(TEST_BUDGET);
+  Headers plain, no_cache, pragma, max_age, min_fresh, no_store;
+  QByteArray found;
+  QString etag;
+
+  no_cache.append("Cache-Control", "no-cache");
+  pragma.append("Pragma", "no-cache");
+  max_age.append("Cache-Control", "max-age=5");
+  min_fresh.append("Cache-Control", "min-fresh=120");
+  no_store.append("Cache-Control", "no-store");
+
+  cache.store(url, &plain, answer("200 OK", "Cache-Control: max-age=60\r\nAge: 10\r\n"
+                                            "ETag: \"v1\"\r\n"));
+
+  QCOMPARE(lookup(&cache, &plain, &found, &etag), CACHE_HIT);
+  QCOMPARE(lookup(&cache, &no_cache, &found, &etag), CACHE_STALE);
+  QCOMPARE(lookup(&cache, &pragma, &found, &etag), CACHE_STALE);
+  QCOMPARE(lookup(&cache, &max_age, &found, &etag), CACHE_STALE);
+  QCOMPARE(lookup(&cache, &min_fresh, &found, &etag), CACHE_STALE);
+  QCOMPARE(lookup(&cache, &no_store, &found, &etag), CACHE_MISS);
+
+  // An answer marked no-cache is revalidated on every use:
+  cache.store(url, &plain, answer("200 OK", "Cache-Control: max-age=60, no-cache\r\n"
+                                            "ETag: \"v2\"\r\n"));
+  QCOMPARE(lookup(&cache, &plain, &found, &etag), CACHE_STALE);
+  QCOMPARE(etag, QString("\"v2\""));
+
+}
+
+/**
+ * @fn void TestHTTPCache::skips_uncacheable_answers()
+ * @brief Method to store answers a shared cache can not keep.
+ */
+
+void TestHTTPCache::skips_uncacheable_answers() {
+
+  QList<QByteArray> statuses = QList<QByteArray>()
+    << "200 OK" << "200 OK" << "200 OK" << "200 OK" << "500 Internal Server Error";
+  QList<QByteArray> headers = QList<QByteArray>()
+    << "Cache-Control: max-age=60, no-store\r\n"
+    << "Cache-Control: max-age=60, private\r\n"
+    << "Cache-Control: max-age=60\r\nSet-Cookie: id=1\r\n"
+    << "Cache-Control: max-age=60\r\nVary: *\r\n"
+    << "Cache-Control: max-age=60\r\n";
+  Headers request, authorized, no_store;
+  QByteArray found;
+  QString etag;
+
+  authorized.append("Authorization", "Basic dXNlcjpwYXNz");
+  no_store.append("Cache-Control", "no-store");
+
+  for(int i = 0; i < statuses.size(); i++) {
+    HTTPCache cache(TEST_BUDGET);
+    cache.store(url, &request, answer(statuses[i], headers[i]));
+    QCOMPARE(lookup(&cache, &request, &found, &etag), CACHE_MISS);
+  }
+
+  HTTPCache cache(TEST_BUDGET);
+
+  // Neither a freshness lifetime nor a validator:
+  cache.store(url, &request, answer("200 OK", ""));
+  QCOMPARE(lookup(&cache, &request, &found, &etag), CACHE_MISS);
+
+  cache.store(url, &no_store, answer("200 OK", "Cache-Control: max-age=60\r\n"));
+  QCOMPARE(lookup(&cache, &request, &found, &etag), CACHE_MISS);
+
+  // Authorized answers are only kept if marked public:
+  cache.store(url, &authorized, answer("200 OK", "Cache-Control: max-age=60\r\n"));
+  QCOMPARE(lookup(&cache, &request, &found, &etag), CACHE_MISS);
+
+  cache.store(url, &authorized, answer("200 OK", "Cache-Control: public, max-age=60\r\n"));
+  QCOMPARE(lookup(&cache, &request, &found, &etag), CACHE_HIT);
+
+  // A disabled cache keeps nothing:
+  HTTPCache disabled(0);
+  disabled.store(url, &request, answer("200 OK", "Cache-Control: max-age=60\r\n"));
+  QCOMPARE(lookup(&disabled, &request, &found, &etag), CACHE_MISS);
+
+}
+
+/**
+ * @fn void TestHTTPCache::reads_expiration_dates()
+ * @brief Method to store answers whose lifetime comes from their dates.
+ *
+ * Expires is read in the formats of RFC 9110 (two digit years before 70
+ * are in this century), an invalid date means the answer already expired,
+ * and an old Last-Modified date only gives a short heuristic lifetime.
+ *
+ */
+
+void TestHTTPCache::reads_expiration_dates() {
+
+  QList<QByteArray> fresh = QList<QByteArray>()
+    << "Expires: Fri, 01 Jan 2100 00:00:00 GMT\r\n"
+    << "Expires: Thursday, 01-Jan-60 00:00:00 GMT\r\n"
+    << "Expires: Fri Jan  1 00:00:00 2100\r\n";
+  QList<QByteArray> stale = QList<QByteArray>()
+    << "Expires: Sunday, 06-Nov-94 08:49:37 GMT\r\n"
+    << "Expires: 0\r\n"
+    << "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\nExpires: Sun, 06 Nov 1994 08:50:37 GMT\r\n"
+    << "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\nLast-Modified: Sat, 06 Nov 1993 08:49:37 GMT\r\n";
+  Headers request;
+  QByteArray found;
+  QString etag;
+
+  for(int i = 0; i < fresh.size(); i++) {
+    HTTPCache cache(TEST_BUDGET);
+    cache.store(url, &request, answer("200 OK", fresh[i] + "ETag: \"v1\"\r\n"));
+    QCOMPARE(lookup(&cache, &request, &found, &etag), CACHE_HIT);
+  }
+
+  for(int i = 0; i < stale.size(); i++) {
+    HTTPCache cache(TEST_BUDGET);
+    cache.store(url, &request, answer("200 OK", stale[i] + "ETag: \"v1\"\r\n"));
+    QCOMPARE(lookup(&cache, &request, &found, &etag), CACHE_STALE);
+  }
+
+}
+
+/**
+ * @fn void TestHTTPCache::keeps_variants()
+ * @brief Method to store answers varying on a request header.
+ *
+ * Each variant is only served to requests with the same value, and storing
+ * a variant again replaces it.
+ *
+ */
+
+void TestHTTPCache::keeps_variants() {
+
+  HTTPCache cache(TEST_BUDGET);
+  Headers gzip, spaced, brotli, plain;
+  QByteArray found;
+  QString etag;
+
+  gzip.append("Accept-Encoding", "gzip");
+  spaced.append("accept-encoding", " gzip ");
+  brotli.append("Accept-Encoding", "br");
+
+  cache.store(url, &gzip, answer("200 OK", "Cache-Control: max-age=60\r\n"
+                                           "Vary: Accept-Encoding\r\nX-Variant: gzip\r\n"));
+
+  QCOMPARE(lookup(&cache, &gzip, &found, &etag), CACHE_HIT);
+  QVERIFY(found.contains("X-Variant: gzip"));
+  QCOMPARE(lookup(&cache, &spaced, &found, &etag), CACHE_HIT);
+  QCOMPARE(lookup(&cache, &brotli, &found, &etag), CACHE_MISS);
+  QCOMPARE(lookup(&cache, &plain, &found, &etag), CACHE_MISS);
+
+  cache.store(url, &brotli, answer("200 OK", "Cache-Control: max-age=60\r\n"
+                                             "Vary: Accept-Encoding\r\nX-Variant: br\r\n"));
+  cache.store(url, &gzip, answer("200 OK", "Cache-Control: max-age=60\r\n"
+                                           "Vary: Accept-Encoding\r\nX-Variant: gzip2\r\n"));
+
+  QCOMPARE(lookup(&cache, &brotli, &found, &etag), CACHE_HIT);
+  QVERIFY(found.contains("X-Variant: br"));
+  QCOMPARE(lookup(&cache, &gzip, &found, &etag), CACHE_HIT);
+  QVERIFY(found.contains("X-Variant: gzip2"));
+
+}
+
+/**
+ * @fn void TestHTTPCache::refreshes_validated_answer()
+ * @brief Method to refresh a stale answer with a 304 answer.
+ *
+ * The headers of the 304 answer replace the stale ones, but the framing of
+ * the cached body is kept, and the refreshed answer is fresh again.
+ *
+ */
+
+void TestHTTPCache::refreshes_validated_answer() {
+
+  HTTPCache cache(TEST_BUDGET);
+  Headers request;
+  QByteArray found, refreshed;
+  QString etag;
+
+  cache.store(url, &request, answer("200 OK", "Cache-Control: max-age=60\r\nAge: 120\r\n"
+                                              "ETag: \"v1\"\r\n"));
+  QCOMPARE(lookup(&cache, &request, &found, &etag), CACHE_STALE);
+
+  refreshed = cache.refresh(url, &request, found,
+                            "HTTP/1.1 304 Not Modified\r\nCache-Control: max-age=300\r\n"
+                            "ETag: \"v1\"\r\nContent-Length: 0\r\n\r\n");
+
+  QVERIFY(refreshed.startsWith("HTTP/1.1 200 OK\r\n"));
+  QVERIFY(refreshed.contains("\r\nCache-Control: max-age=300\r\n"));
+  QVERIFY(refreshed.contains("\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\n"));
+  QVERIFY(!refreshed.contains("Age: 120"));
+  QVERIFY(refreshed.endsWith("\r\n\r\n" + body));
+  QCOMPARE(cache.get_stats()->revalidations.load(), static_cast<quint64> (1));
+
+  QCOMPARE(lookup(&cache, &request, &found, &etag), CACHE_HIT);
+  QVERIFY(found.endsWith("\r\n\r\n" + body));
+
+}
+
+/**
+ * @fn void TestHTTPCache::invalidates_every_variant()
+ * @brief Method to drop the answers of a URL changed by a client.
+ */
+
+void TestHTTPCache::invalidates_every_variant() {
+
+  HTTPCache cache(TEST_BUDGET);
+  Headers gzip, brotli;
+  QByteArray found;
+  QString etag;
+
+  gzip.append("Accept-Encoding", "gzip");
+  brotli.append("Accept-Encoding", "br");
+
+  cache.store(url, &gzip, answer("200 OK", "Cache-Control: max-age=60\r\nVary: Accept-Encoding\r\n"));
+  cache.store(url, &brotli, answer("200 OK", "Cache-Control: max-age=60\r\nVary: Accept-Encoding\r\n"));
+  cache.invalidate(url);
+
+  QCOMPARE(lookup(&cache, &gzip, &found, &etag), CACHE_MISS);
+  QCOMPARE(lookup(&cache, &brotli, &found, &etag), CACHE_MISS);
+
+}
+
+/**
+ * @fn void TestHTTPCache::builds_keys()
+ * @brief Method to find the keys of absolute and relative URLs.
+ */
+
+void TestHTTPCache::builds_keys() {
+
+  QCOMPARE(HTTPCache::key("/Path?q=A", "Example.COM"), QString("http://example.com/Path?q=A"));
+  QCOMPARE(HTTPCache::key("HTTP://Example.COM/Path", "ignored"), QString("http://example.com/Path"));
+  QCOMPARE(HTTPCache::key("http://Example.COM", "ignored"), QString("http://example.com/"));
+
+}
+
+QTEST_APPLESS_MAIN(TestHTTPCache)
+
+#include "tst_http_cache.moc"
@@ -0,0 +1,37 @@
+#-------------------------------------------------
+#
+# HTTP line grammar tests: the scanners of HTTPParserCore against the
+# legacy QRegExp parser of the parser benchmark.
+#
+#-------------------------------------------------
+
+QT += testlib
+QT -= gui
+
+TARGET = tst_http_grammar
+TEMPLATE = app
+
+CONFIG += console testcase c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+DEFINES += TEST_CORPUS=\\\"$$PWD/../../bench/parser/corpus.txt\\\"
+
+# File names:
+SOURCES += \
+        tst_http_grammar.cpp \
+        ../../bench/parser/legacy_parser.cpp \
+        ../../src/byte_scan.cpp \
+        ../../src/chunked_codec.cpp \
+        ../../src/header_table.cpp \
+        ../../src/httpparser.cpp \
+        ../../src/message_logger.cpp
+
+HEADERS += \
+        ../../bench/parser/legacy_parser.h \
+        ../../include/byte_scan.h \
+        ../../include/chunked_codec.h \
+        ../../include/header_table.h \
+        ../../include/httpparser.h \
+        ../../include/message_logger.h
@@ -0,0 +1,305 @@
+// ProxyGate - HTTP line grammar tests.
+
+/**
+ * @file tst_http_grammar.cpp
+ * @brief HTTP line grammar tests.
+ *
+ * The scanners of HTTPParserCore replaced the QRegExp expressions of the
+ * legacy parser (bench/parser/legacy_parser.cpp). Command, answer and header
+ * lines are matched by both: the lines of the parser benchmark corpus and
+ * malformed lines must be split the same way (or rejected by both), apart
+ * from the few lines where the scanners follow RFC 9112 on purpose, which are
+ * checked one by one.
+ *
+ */
+
+// Qt includes:
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QtTest>
+
+// User includes:
+#include "bench/parser/legacy_parser.h"
+#include "include/httpparser.h"
+
+// Type definitions:
+
+/**
+ * @enum LineKind
+ * @brief Kind of line matched.
+ */
+
+typedef enum {
+  LINE_COMMAND, /**< First line of a request. */
+  LINE_ANSWER,  /**< First line of an answer. */
+  LINE_HEADER   /**< Header line. */
+} LineKind;
+
+// Class headers:
+
+/**
+ * @class TestHTTPGrammar
+ * @brief HTTP line grammar tests.
+ */
+
+class TestHTTPGrammar : public QObject {
+
+  Q_OBJECT
+
+  private slots:
+    void agrees_on_corpus();
+    void agrees_on_malformed_lines();
+    void narrows_legacy_grammar();
+    void widens_legacy_grammar();
+
+  private:
+    // Methods:
+    static bool core_match(LineKind, QByteArray, QList<QByteArray>*);
+    static bool legacy_match(LineKind, QByteArray, QList<QByteArray>*);
+
+};
+
+// Private methods:
+
+/**
+ * @fn bool TestHTTPGrammar::core_match(LineKind kind, QByteArray line, QList<QByteArray> *pieces)
+ * @brief Method to match a line with the scanners of HTTPParserCore.
+ * @param kind Kind of line.
+ * @param line Line, without its line break.
+ * @param pieces Address to store the pieces of the line (method, URL and
+ * version, version, code and description or name and value).
+ * @return Returns true if the line matched.
+ */
+
+bool TestHTTPGrammar::core_match(LineKind kind, QByteArray line,
+                                 QList<QByteArray> *pieces) {
+
+  HTTPParserCore parser;
+  QByteArray first, second, third;
+  bool matched;
+
+  if(kind == LINE_COMMAND)
+    matched = parser.parseCommandLine(line, &first, &second, &third);
+  else if(kind == LINE_ANSWER)
+    matched = parser.parseAnswerLine(line, &first, &second, &third);
+  else
+    matched = parser.parseHeaderLine(line, &first, &second);
+
+  pieces->clear();
+
+  if(matched)
+    *pieces << first << second;
+
+  if(matched && kind != LINE_HEADER)
+    *pieces << third;
+
+  return matched;
+
+}
+
+/**
+ * @fn bool TestHTTPGrammar::legacy_match(LineKind kind, QByteArray line, QList<QByteArray> *pieces)
+ * @brief Method to match a line with the expressions of the legacy parser.
+ * @param kind Kind of line.
+ * @param line Line, without its line break.
+ * @param pieces Address to store the pieces of the line (see core_match).
+ * @return Returns true if the line matched.
+ */
+
+bool TestHTTPGrammar::legacy_match(LineKind kind, QByteArray line,
+                                   QList<QByteArray> *pieces) {
+
+  LegacyParser parser;
+  QString text = QString::fromLatin1(line), first, second, third;
+  bool matched;
+
+  if(kind == LINE_COMMAND)
+    matched = parser.parseCommandLine(text, &first, &second, &third);
+  else if(kind == LINE_ANSWER)
+    matched = parser.parseAnswerLine(text, &first, &second, &third);
+  else
+    matched = parser.parseHeaderLine(text, &first, &second);
+
+  pieces->clear();
+
+  if(matched)
+    *pieces << first.toLatin1() << second.toLatin1();
+
+  if(matched && kind != LINE_HEADER)
+    *pieces << third.toLatin1();
+
+  return matched;
+
+}
+
+// Test cases:
+
+/**
+ * @fn void TestHTTPGrammar::agrees_on_corpus()
+ * @brief Method to match every line of the parser benchmark corpus.
+ *
+ * The first line of each paragraph is a command or an answer line, the
+ * others are header lines. Both grammars accept them, with the same pieces.
+ *
+ */
+
+void TestHTTPGrammar::agrees_on_corpus() {
+
+  QFile file(TEST_CORPUS);
+  QList<QByteArray> lines, core_pieces, legacy_pieces;
+  LineKind kind;
+  bool first = true;
+  int matched = 0;
+
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  lines = file.readAll().split('\n');
+
+  for(int i = 0; i < lines.size(); i++) {
+
+    if(lines[i].isEmpty()) {
+      first = true;
+      continue;
+    }
+
+    if(!first)
+      kind = LINE_HEADER;
+    else
+      kind = lines[i].startsWith("HTTP/") ? LINE_ANSWER : LINE_COMMAND;
+
+    first = false;
+
+    QVERIFY(core_match(kind, lines[i], &core_pieces));
+    QVERIFY(legacy_match(kind, lines[i], &legacy_pieces));
+    QVERIFY(core_pieces == legacy_pieces);
+    matched++;
+
+  }
+
+  QVERIFY(matched > 100);
+
+}
+
+/**
+ * @fn void TestHTTPGrammar::agrees_on_malformed_lines()
+ * @brief Method to match lines both grammars reject.
+ *
+ * Among them: methods that are not known tokens, bare CRs at the end of a
+ * line, spaces before the colon and obs-fold continuation lines.
+ *
+ */
+
+void TestHTTPGrammar::agrees_on_malformed_lines() {
+
+  QList<QByteArray> commands = QList<QByteArray>()
+    << "" << "get / HTTP/1.1" << "FETCH / HTTP/1.1" << "G\"ET / HTTP/1.1"
+    << "GE T / HTTP/1.1" << "GET\t/ HTTP/1.1" << "GET  / HTTP/1.1"
+    << "GET HTTP/1.1" << "GET /a b HTTP/1.1" << "GET / HTTP/1.1 "
+    << "GET / HTTP/1.1\r" << "GET / HTTP/1.10" << "GET / HTTP/1."
+    << "GET / http/1.1" << " GET / HTTP/1.1" << "GET /\x01 HTTP/1.1";
+  QList<QByteArray> answers = QList<QByteArray>()
+    << "" << "HTTP/1.1 20 OK" << "HTTP/1.1 2000 OK" << "HTTP/1.1  200 OK"
+    << "HTTP/1.1 abc OK" << "HTTP/11 200 OK" << "http/1.1 200 OK"
+    << " HTTP/1.1 200 OK" << "HTTP/1.1\t200 OK" << "HTTP/1.1 200\tOK";
+  QList<QByteArray> headers = QList<QByteArray>()
+    << "" << "Host" << "Host : example.com" << "Host\t: example.com"
+    << " folded continuation" << "\tfolded: continuation" << "Ho\"st: example.com"
+    << "Ho st: example.com" << "Host\r: example.com";
+  QList<QByteArray> pieces;
+
+  for(int i = 0; i < commands.size(); i++) {
+    QVERIFY(!core_match(LINE_COMMAND, commands[i], &pieces));
+    QVERIFY(!legacy_match(LINE_COMMAND, commands[i], &pieces));
+  }
+
+  for(int i = 0; i < answers.size(); i++) {
+    QVERIFY(!core_match(LINE_ANSWER, answers[i], &pieces));
+    QVERIFY(!legacy_match(LINE_ANSWER, answers[i], &pieces));
+  }
+
+  for(int i = 0; i < headers.size(); i++) {
+    QVERIFY(!core_match(LINE_HEADER, headers[i], &pieces));
+    QVERIFY(!legacy_match(LINE_HEADER, headers[i], &pieces));
+  }
+
+}
+
+/**
+ * @fn void TestHTTPGrammar::narrows_legacy_grammar()
+ * @brief Method to match lines only the legacy grammar accepts.
+ *
+ * The '.' of the expressions took any character: bare CRs and other control
+ * characters inside a value, and any separator in the version. The header
+ * name could also be empty.
+ *
+ */
+
+void TestHTTPGrammar::narrows_legacy_grammar() {
+
+  QList<QByteArray> pieces;
+
+  QVERIFY(legacy_match(LINE_COMMAND, "GET / HTTP/1x1", &pieces));
+  QVERIFY(!core_match(LINE_COMMAND, "GET / HTTP/1x1", &pieces));
+
+  QVERIFY(legacy_match(LINE_ANSWER, "HTTP/1-1 200 OK", &pieces));
+  QVERIFY(!core_match(LINE_ANSWER, "HTTP/1-1 200 OK", &pieces));
+
+  QVERIFY(legacy_match(LINE_ANSWER, "HTTP/1.1 200 O\rK", &pieces));
+  QVERIFY(!core_match(LINE_ANSWER, "HTTP/1.1 200 O\rK", &pieces));
+
+  QVERIFY(legacy_match(LINE_HEADER, "X-Test: a\rb", &pieces));
+  QVERIFY(!core_match(LINE_HEADER, "X-Test: a\rb", &pieces));
+
+  QVERIFY(legacy_match(LINE_HEADER, "X-Test: a\x01" "b", &pieces));
+  QVERIFY(!core_match(LINE_HEADER, "X-Test: a\x01" "b", &pieces));
+
+  QVERIFY(legacy_match(LINE_HEADER, ": value", &pieces));
+  QVERIFY(!core_match(LINE_HEADER, ": value", &pieces));
+
+}
+
+/**
+ * @fn void TestHTTPGrammar::widens_legacy_grammar()
+ * @brief Method to match lines only the scanners accept.
+ *
+ * Header names are any token, the whitespace around a value is optional
+ * (and left out of it) and the description of an answer may be missing.
+ *
+ */
+
+void TestHTTPGrammar::widens_legacy_grammar() {
+
+  QList<QByteArray> pieces;
+
+  QVERIFY(!legacy_match(LINE_HEADER, "Host:example.com", &pieces));
+  QVERIFY(core_match(LINE_HEADER, "Host:example.com", &pieces));
+  QVERIFY(pieces == QList<QByteArray>() << "Host" << "example.com");
+
+  QVERIFY(!legacy_match(LINE_HEADER, "Host:\texample.com", &pieces));
+  QVERIFY(core_match(LINE_HEADER, "Host:\texample.com", &pieces));
+  QVERIFY(pieces == QList<QByteArray>() << "Host" << "example.com");
+
+  QVERIFY(!legacy_match(LINE_HEADER, "X~Token: 1", &pieces));
+  QVERIFY(core_match(LINE_HEADER, "X~Token: 1", &pieces));
+  QVERIFY(pieces == QList<QByteArray>() << "X~Token" << "1");
+
+  QVERIFY(!legacy_match(LINE_ANSWER, "HTTP/1.1 200", &pieces));
+  QVERIFY(core_match(LINE_ANSWER, "HTTP/1.1 200", &pieces));
+  QVERIFY(pieces == QList<QByteArray>() << "HTTP/1.1" << "200" << "");
+
+  // Both accept these, the scanners without the trailing whitespace:
+  QVERIFY(legacy_match(LINE_HEADER, "X-Test: a b \t", &pieces));
+  QVERIFY(pieces == QList<QByteArray>() << "X-Test" << "a b \t");
+  QVERIFY(core_match(LINE_HEADER, "X-Test: a b \t", &pieces));
+  QVERIFY(pieces == QList<QByteArray>() << "X-Test" << "a b");
+
+  QVERIFY(legacy_match(LINE_HEADER, "X-Empty: ", &pieces));
+  QVERIFY(core_match(LINE_HEADER, "X-Empty: ", &pieces));
+  QVERIFY(pieces == QList<QByteArray>() << "X-Empty" << "");
+
+}
+
+QTEST_APPLESS_MAIN(TestHTTPGrammar)
+
+#include "tst_http_grammar.moc"
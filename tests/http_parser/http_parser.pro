@@ -0,0 +1,32 @@
+#-------------------------------------------------
+#
+# HTTPParserCore tests.
+#
+#-------------------------------------------------
+
+QT += testlib
+QT -= gui
+
+TARGET = tst_http_parser
+TEMPLATE = app
+
+CONFIG += console testcase c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+# File names:
+SOURCES += \
+        tst_http_parser.cpp \
+        ../../src/byte_scan.cpp \
+        ../../src/chunked_codec.cpp \
+        ../../src/header_table.cpp \
+        ../../src/httpparser.cpp \
+        ../../src/message_logger.cpp
+
+HEADERS += \
+        ../../include/byte_scan.h \
+        ../../include/chunked_codec.h \
+        ../../include/header_table.h \
+        ../../include/httpparser.h \
+        ../../include/message_logger.h
@@ -0,0 +1,471 @@
+// ProxyGate - HTTPParserCore tests.
+
+/**
+ * @file tst_http_parser.cpp
+ * @brief HTTPParserCore tests.
+ *
+ * Messages are fed to the incremental parser split in two at every byte (and
+ * in pieces of every size), followed by the start of the next message on the
+ * connection: the end of the headers must be found wherever the empty line
+ * is cut, and the end of the message from the framing of its headers, leaving
+ * the next message alone. Invalid framings must stop the parse.
+ *
+ */
+
+// Library includes:
+#include <limits.h>
+
+// Qt includes:
+#include <QByteArray>
+#include <QList>
+#include <QtTest>
+
+// User includes:
+#include "include/httpparser.h"
+
+// Class headers:
+
+/**
+ * @class TestHTTPParser
+ * @brief HTTPParserCore tests.
+ */
+
+class TestHTTPParser : public QObject {
+
+  Q_OBJECT
+
+  private slots:
+    void follows_every_split();
+    void follows_every_piece_size();
+    void keeps_pipelined_requests();
+    void frames_bodiless_answers();
+    void prefers_chunked_framing();
+    void frames_close_delimited_answers();
+    void rejects_request_codings();
+    void rejects_bad_lengths();
+    void limits_lengths();
+
+  private:
+    // Variables:
+    static const QByteArray post_request; /**< Request with a body. */
+    static const QByteArray next_request; /**< Request pipelined after it. */
+    static const QByteArray next_answer;  /**< Answer sent after another. */
+
+    // Methods:
+    static int count_mismatches(const QByteArray&, const QByteArray&, bool,
+                                bool, BodyFraming, ssize_t);
+    static ParserError feed_error(const QByteArray&, bool);
+    static ParseStatus feed_pieces(HTTPParserCore*, MessageState*,
+                                   QByteArray*, const QList<int>&, bool, bool);
+    static QByteArray length_header(bool, QByteArray);
+
+};
+
+// Variables:
+
+const QByteArray TestHTTPParser::post_request =
+  "POST /form HTTP/1.1\r\nHost: example.com\r\nContent-Length: 11\r\n\r\nhello world";
+
+const QByteArray TestHTTPParser::next_request =
+  "GET /next HTTP/1.1\r\nHost: example.com\r\n\r\n";
+
+const QByteArray TestHTTPParser::next_answer =
+  "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+
+// Private methods:
+
+/**
+ * @fn int TestHTTPParser::count_mismatches(const QByteArray &message, const QByteArray &next, bool answer, bool head_request, BodyFraming framing, ssize_t length)
+ * @brief Method to feed a message split in two at every byte.
+ * @param message Bytes of the message.
+ * @param next Bytes received after the message.
+ * @param answer True if the message is an answer.
+ * @param head_request True if the answer is for a HEAD request.
+ * @param framing Framing expected.
+ * @param length Size of the message expected (-1 if it is only known once the
+ * connection closes).
+ * @return Returns the number of splits the parser reported a status, a header
+ * size, a framing or a message size other than the expected for.
+ *
+ * Up to the empty line the parser needs more, then (up to the end of the
+ * message) the headers are complete. Once the whole message arrived, so did
+ * the next bytes, which must not count.
+ *
+ */
+
+int TestHTTPParser::count_mismatches(const QByteArray &message,
+                                     const QByteArray &next, bool answer,
+                                     bool head_request, BodyFraming framing,
+                                     ssize_t length) {
+
+  HTTPParserCore parser;
+  MessageState state;
+  QByteArray bytes = message + next;
+  ssize_t header_end = message.indexOf("\r\n\r\n") + 4;
+  ParseStatus first, last, expected;
+  int mismatches = 0;
+
+  for(int split = 0; split <= bytes.size(); split++) {
+
+    if(split < header_end)
+      expected = PARSE_NEED_MORE;
+    else if(length == -1 || split < length)
+      expected = PARSE_HEADERS_COMPLETE;
+    else
+      expected = PARSE_MESSAGE_COMPLETE;
+
+    HTTPParserCore::resetMessage(&state);
+    first = parser.feed(&state, bytes.data(), static_cast<size_t> (split), answer, head_request);
+    last = parser.feed(&state, bytes.data(), static_cast<size_t> (bytes.size()), answer, head_request);
+
+    if(first != expected || last != (length == -1 ? PARSE_HEADERS_COMPLETE : PARSE_MESSAGE_COMPLETE) ||
+       state.header_end != header_end || state.framing != framing || state.length != length)
+      mismatches++;
+
+  }
+
+  return mismatches;
+
+}
+
+/**
+ * @fn ParserError TestHTTPParser::feed_error(const QByteArray &message, bool answer)
+ * @brief Method to feed a whole message that should be rejected.
+ * @param message Bytes of the message.
+ * @param answer True if the message is an answer.
+ * @return Returns why the parser rejected the message (PARSER_OK if it did
+ * not, or if it took a later call back).
+ */
+
+ParserError TestHTTPParser::feed_error(const QByteArray &message, bool answer) {
+
+  HTTPParserCore parser;
+  MessageState state;
+  QByteArray bytes = message;
+
+  HTTPParserCore::resetMessage(&state);
+
+  if(parser.feed(&state, bytes.data(), static_cast<size_t> (bytes.size()), answer, false) != PARSE_ERROR ||
+     parser.feed(&state, bytes.data(), static_cast<size_t> (bytes.size()), answer, false) != PARSE_ERROR ||
+     parser.errorMessage().empty())
+    return PARSER_OK;
+
+  return parser.getError();
+
+}
+
+/**
+ * @fn ParseStatus TestHTTPParser::feed_pieces(HTTPParserCore *parser, MessageState *state, QByteArray *bytes, const QList<int> &ends, bool answer, bool head_request)
+ * @brief Method to feed a message arriving in pieces.
+ * @param parser Parser to be used.
+ * @param state State of the message (reset here).
+ * @param bytes Bytes received.
+ * @param ends Size received after each piece (the rest arrives as the last
+ * one).
+ * @param answer True if the message is an answer.
+ * @param head_request True if the answer is for a HEAD request.
+ * @return Returns the status after the last piece.
+ */
+
+ParseStatus TestHTTPParser::feed_pieces(HTTPParserCore *parser,
+                                        MessageState *state, QByteArray *bytes,
+                                        const QList<int> &ends, bool answer,
+                                        bool head_request) {
+
+  HTTPParserCore::resetMessage(state);
+
+  for(int i = 0; i < ends.size(); i++)
+    parser->feed(state, bytes->data(), static_cast<size_t> (qMin(ends[i], bytes->size())),
+                 answer, head_request);
+
+  return parser->feed(state, bytes->data(), static_cast<size_t> (bytes->size()),
+                      answer, head_request);
+
+}
+
+/**
+ * @fn QByteArray TestHTTPParser::length_header(bool answer, QByteArray length)
+ * @brief Method to build the headers of a message with a Content-Length.
+ * @param answer True to build an answer, false to build a request.
+ * @param length Value of the Content-Length header.
+ * @return Returns the start line and headers.
+ */
+
+QByteArray TestHTTPParser::length_header(bool answer, QByteArray length) {
+
+  return (answer ? "HTTP/1.1 200 OK\r\n" : "POST / HTTP/1.1\r\n") +
+         ("Content-Length: " + length + "\r\n\r\n");
+
+}
+
+// Test cases:
+
+/**
+ * @fn void TestHTTPParser::follows_every_split()
+ * @brief Method to feed requests and answers split in two at every byte.
+ *
+ * The search for the empty line resumes a few bytes before the end of the
+ * last piece, so a line cut anywhere is found.
+ *
+ */
+
+void TestHTTPParser::follows_every_split() {
+
+  QByteArray answer = "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\nbody";
+  QByteArray bare_answer = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+
+  QCOMPARE(count_mismatches(post_request, next_request, false, false,
+                            FRAMING_LENGTH, post_request.size()), 0);
+  QCOMPARE(count_mismatches(answer, next_answer, true, false, FRAMING_LENGTH,
+                            answer.size()), 0);
+  QCOMPARE(count_mismatches(bare_answer, next_answer, true, false,
+                            FRAMING_LENGTH, bare_answer.size()), 0);
+
+}
+
+/**
+ * @fn void TestHTTPParser::follows_every_piece_size()
+ * @brief Method to feed a request arriving in pieces of every size.
+ */
+
+void TestHTTPParser::follows_every_piece_size() {
+
+  HTTPParserCore parser;
+  MessageState state;
+  QByteArray bytes = post_request + next_request;
+  QList<int> ends;
+
+  for(int size = 1; size <= bytes.size(); size++) {
+    ends.clear();
+    for(int end = size; end < bytes.size(); end += size)
+      ends.append(end);
+    QCOMPARE(feed_pieces(&parser, &state, &bytes, ends, false, false), PARSE_MESSAGE_COMPLETE);
+    QCOMPARE(state.length, static_cast<ssize_t> (post_request.size()));
+    QCOMPARE(parser.getMethodId(), METHOD_POST);
+    QCOMPARE(parser.getHost(), QByteArray("example.com"));
+  }
+
+}
+
+/**
+ * @fn void TestHTTPParser::keeps_pipelined_requests()
+ * @brief Method to follow requests sent one after the other.
+ *
+ * A request without a body ends with its headers. Each request is followed
+ * from where the one before it ended, the way a Server keeps them.
+ *
+ */
+
+void TestHTTPParser::keeps_pipelined_requests() {
+
+  HTTPParserCore parser;
+  MessageState state;
+  QByteArray bytes = next_request + post_request + next_request, rest;
+
+  QCOMPARE(count_mismatches(next_request, post_request, false, false,
+                            FRAMING_NONE, next_request.size()), 0);
+
+  QCOMPARE(feed_pieces(&parser, &state, &bytes, QList<int>(), false, false), PARSE_MESSAGE_COMPLETE);
+  QCOMPARE(state.length, static_cast<ssize_t> (next_request.size()));
+
+  rest = bytes.mid(static_cast<int> (state.length));
+  QCOMPARE(feed_pieces(&parser, &state, &rest, QList<int>(), false, false), PARSE_MESSAGE_COMPLETE);
+  QCOMPARE(state.length, static_cast<ssize_t> (post_request.size()));
+  QCOMPARE(parser.getMethodId(), METHOD_POST);
+
+  rest = rest.mid(static_cast<int> (state.length));
+  QCOMPARE(feed_pieces(&parser, &state, &rest, QList<int>(), false, false), PARSE_MESSAGE_COMPLETE);
+  QCOMPARE(state.length, static_cast<ssize_t> (rest.size()));
+  QCOMPARE(parser.getURL(), QByteArray("/next"));
+
+}
+
+/**
+ * @fn void TestHTTPParser::frames_bodiless_answers()
+ * @brief Method to follow answers that have no body, whatever their headers
+ * say.
+ *
+ * Answers to HEAD requests and answers with a 1xx, 204 or 304 code end with
+ * their headers.
+ *
+ */
+
+void TestHTTPParser::frames_bodiless_answers() {
+
+  QList<QByteArray> answers = QList<QByteArray>()
+    << "HTTP/1.1 100 Continue\r\n\r\n"
+    << "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n\r\n"
+    << "HTTP/1.1 204 No Content\r\nContent-Length: 10\r\n\r\n"
+    << "HTTP/1.1 304 Not Modified\r\nTransfer-Encoding: chunked\r\n\r\n";
+  QByteArray head = "HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\n";
+  QByteArray chunked_head = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+
+  for(int i = 0; i < answers.size(); i++)
+    QCOMPARE(count_mismatches(answers[i], next_answer, true, false,
+                              FRAMING_NONE, answers[i].size()), 0);
+
+  QCOMPARE(count_mismatches(head, next_answer, true, true, FRAMING_NONE,
+                            head.size()), 0);
+  QCOMPARE(count_mismatches(chunked_head, next_answer, true, true,
+                            FRAMING_NONE, chunked_head.size()), 0);
+
+  // The same answer to a GET request has a body:
+  QCOMPARE(count_mismatches(head + QByteArray(100, 'x'), next_answer, true,
+                            false, FRAMING_LENGTH, head.size() + 100), 0);
+
+}
+
+/**
+ * @fn void TestHTTPParser::prefers_chunked_framing()
+ * @brief Method to follow messages with both a chunked transfer coding and a
+ * Content-Length.
+ *
+ * The chunks decide where the body ends, when chunked is the last coding.
+ * Answers with another last coding end when the connection closes.
+ *
+ */
+
+void TestHTTPParser::prefers_chunked_framing() {
+
+  QByteArray body = "5;x=1\r\nhello\r\n0\r\nX-Checksum: 1\r\n\r\n";
+  QByteArray answer = "HTTP/1.1 200 OK\r\nContent-Length: 3\r\n"
+                      "Transfer-Encoding: gzip, chunked\r\n\r\n" + body;
+  QByteArray split_codings = "HTTP/1.1 200 OK\r\nTransfer-Encoding: gzip\r\n"
+                             "Transfer-Encoding: chunked\r\n\r\n" + body;
+  QByteArray request = "POST /upload HTTP/1.1\r\nHost: example.com\r\n"
+                       "Transfer-Encoding: chunked\r\nContent-Length: 100\r\n\r\n" + body;
+  QByteArray gzip_last = "HTTP/1.1 200 OK\r\nContent-Length: 3\r\n"
+                         "Transfer-Encoding: chunked, gzip\r\n\r\n" + body;
+
+  QCOMPARE(count_mismatches(answer, next_answer, true, false,
+                            FRAMING_CHUNKED, answer.size()), 0);
+  QCOMPARE(count_mismatches(split_codings, next_answer, true, false,
+                            FRAMING_CHUNKED, split_codings.size()), 0);
+  QCOMPARE(count_mismatches(request, next_request, false, false,
+                            FRAMING_CHUNKED, request.size()), 0);
+  QCOMPARE(count_mismatches(gzip_last, next_answer, true, false,
+                            FRAMING_CLOSE, -1), 0);
+
+}
+
+/**
+ * @fn void TestHTTPParser::frames_close_delimited_answers()
+ * @brief Method to follow answers without a Content-Length or chunks.
+ *
+ * Their headers are complete, but the parser never finds the end of the
+ * body: the website closing the connection ends it.
+ *
+ */
+
+void TestHTTPParser::frames_close_delimited_answers() {
+
+  QByteArray answer = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n\r\nsome data";
+  QByteArray old_answer = "HTTP/1.0 200 OK\r\n\r\n";
+
+  QCOMPARE(count_mismatches(answer, next_answer, true, false, FRAMING_CLOSE, -1), 0);
+  QCOMPARE(count_mismatches(old_answer, answer, true, false, FRAMING_CLOSE, -1), 0);
+
+}
+
+/**
+ * @fn void TestHTTPParser::rejects_request_codings()
+ * @brief Method to feed requests with a body that is not chunked.
+ *
+ * The size of such a body can not be known, so the request is invalid (an
+ * answer would end when the connection closes). The error is kept for the
+ * next calls.
+ *
+ */
+
+void TestHTTPParser::rejects_request_codings() {
+
+  QByteArray start = "POST / HTTP/1.1\r\nHost: example.com\r\n";
+
+  QCOMPARE(feed_error(start + "Transfer-Encoding: gzip\r\n\r\n", false),
+           PARSER_BAD_TRANSFER_ENCODING);
+  QCOMPARE(feed_error(start + "Transfer-Encoding: chunked, gzip\r\n"
+                      "Content-Length: 5\r\n\r\nhello", false),
+           PARSER_BAD_TRANSFER_ENCODING);
+  QCOMPARE(feed_error(start + "Transfer-Encoding: chunked\r\n\r\nzz\r\n", false),
+           PARSER_BAD_CHUNK);
+
+}
+
+/**
+ * @fn void TestHTTPParser::rejects_bad_lengths()
+ * @brief Method to feed messages whose Content-Length is not a size, or is
+ * repeated with other values.
+ *
+ * Repeating the same value is allowed.
+ *
+ */
+
+void TestHTTPParser::rejects_bad_lengths() {
+
+  QList<QByteArray> lengths = QList<QByteArray>()
+    << "abc" << "-1" << "" << "1 2" << "0x10" << "5, 6" << "5\r\nContent-Length: 6"
+    << "5\r\nContent-Length: 5, 7" << "9223372036854775808" << "99999999999999999999";
+  QByteArray same = length_header(true, "5\r\nContent-Length: 5");
+  QByteArray same_list = length_header(true, "5 , 5");
+
+  for(int i = 0; i < lengths.size(); i++) {
+    QCOMPARE(feed_error(length_header(false, lengths[i]), false), PARSER_BAD_CONTENT_LENGTH);
+    QCOMPARE(feed_error(length_header(true, lengths[i]), true), PARSER_BAD_CONTENT_LENGTH);
+  }
+
+  QCOMPARE(count_mismatches(same + "hello", next_answer, true, false,
+                            FRAMING_LENGTH, same.size() + 5), 0);
+  QCOMPARE(count_mismatches(same_list + "hello", next_answer, true, false,
+                            FRAMING_LENGTH, same_list.size() + 5), 0);
+
+}
+
+/**
+ * @fn void TestHTTPParser::limits_lengths()
+ * @brief Method to feed messages with the largest Content-Length allowed,
+ * and one more.
+ *
+ * The size of a message (headers and body) must fit in a ssize_t, and the
+ * size of a request in HTTP_BUFFER_SIZE. The values tried have as many
+ * digits as the limit, so the headers have the same size.
+ *
+ */
+
+void TestHTTPParser::limits_lengths() {
+
+  HTTPParserCore parser;
+  MessageState state;
+  QByteArray bytes;
+  ssize_t header_size, largest;
+
+  // Answers:
+  header_size = length_header(true, QByteArray::number(static_cast<qlonglong> (SSIZE_MAX))).size();
+  largest = SSIZE_MAX - header_size;
+  bytes = length_header(true, QByteArray::number(static_cast<qlonglong> (largest)));
+
+  QCOMPARE(feed_pieces(&parser, &state, &bytes, QList<int>(), true, false), PARSE_HEADERS_COMPLETE);
+  QCOMPARE(state.length, static_cast<ssize_t> (SSIZE_MAX));
+  QCOMPARE(feed_error(length_header(true, QByteArray::number(static_cast<qlonglong> (largest + 1))), true),
+           PARSER_BAD_CONTENT_LENGTH);
+  QCOMPARE(feed_error(length_header(true, QByteArray::number(static_cast<qlonglong> (SSIZE_MAX))), true),
+           PARSER_BAD_CONTENT_LENGTH);
+
+  // Requests:
+  header_size = length_header(false, QByteArray::number(HTTP_BUFFER_SIZE)).size();
+  largest = HTTP_BUFFER_SIZE - header_size;
+  bytes = length_header(false, QByteArray::number(static_cast<qlonglong> (largest)));
+
+  QCOMPARE(feed_pieces(&parser, &state, &bytes, QList<int>(), false, false), PARSE_HEADERS_COMPLETE);
+  QCOMPARE(state.length, static_cast<ssize_t> (HTTP_BUFFER_SIZE));
+  QCOMPARE(feed_error(length_header(false, QByteArray::number(static_cast<qlonglong> (largest + 1))), false),
+           PARSER_BAD_CONTENT_LENGTH);
+
+  // An answer that large is read through the preview:
+  bytes = length_header(true, QByteArray::number(static_cast<qlonglong> (largest + 1)));
+  QCOMPARE(feed_pieces(&parser, &state, &bytes, QList<int>(), true, false), PARSE_HEADERS_COMPLETE);
+
+}
+
+QTEST_APPLESS_MAIN(TestHTTPParser)
+
+#include "tst_http_parser.moc"
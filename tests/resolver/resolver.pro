@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# Resolver tests.
+#
+#-------------------------------------------------
+
+QT += testlib
+QT -= gui
+
+TARGET = tst_resolver
+TEMPLATE = app
+
+CONFIG += console testcase c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+# File names:
+SOURCES += \
+        tst_resolver.cpp \
+        ../../src/reactor.cpp \
+        ../../src/resolver.cpp
+
+HEADERS += \
+        ../../include/reactor.h \
+        ../../include/resolver.h
@@ -0,0 +1,725 @@
+// ProxyGate - Resolver tests.
+
+/**
+ * @file tst_resolver.cpp
+ * @brief Resolver tests.
+ *
+ * The Resolver asks a stub DNS server, a UDP socket of the test on the loop
+ * back address, which reads the queries and sends back the answers each test
+ * builds: addresses cached for their TTL, missing hosts and server errors
+ * cached as negative entries, lookups of the same host sharing their queries,
+ * queries sent again and given up on, and answers that must be discarded
+ * (other identifiers or hosts, truncated messages, looping names). Static
+ * hosts are loaded from a temporary hosts file.
+ *
+ */
+
+// Library includes:
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Qt includes:
+#include <QByteArray>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <QtTest>
+
+// User includes:
+#include "include/resolver.h"
+
+// Macros:
+
+/**
+ * @def TEST_WAIT
+ * @brief Time (in ms) the stub server and the Resolver wait for a message.
+ */
+
+#define TEST_WAIT 2000
+
+// Class headers:
+
+/**
+ * @class TestResolver
+ * @brief Resolver tests.
+ */
+
+class TestResolver : public QObject {
+
+  Q_OBJECT
+
+  private slots:
+    void init();
+    void uses_hosts_file();
+    void caches_answers();
+    void caches_missing_hosts();
+    void shares_queries();
+    void retries_and_expires();
+    void discards_bad_answers();
+    void cleanup();
+
+  private:
+    // Variables:
+    int server;                     /**< Socket of the stub DNS server. */
+    struct sockaddr_in client;      /**< Address the last query came from. */
+    QSharedPointer<DNSCache> cache; /**< Cache asking the stub server. */
+
+    // Methods:
+    bool quiet();
+    int serve(int, QList<QByteArray>*);
+    void reply(QByteArray);
+    static QStringList addresses(const QList<struct sockaddr_storage>&);
+    static QByteArray answer(const QByteArray&, int, QList<QByteArray>,
+                             QList<QByteArray> = QList<QByteArray>());
+    static QByteArray address_answer(const QByteArray&, quint32);
+    static QByteArray bytes16(unsigned int);
+    static QByteArray bytes32(quint32);
+    static QByteArray encode_name(QByteArray);
+    static quint16 query_id(const QByteArray&);
+    static QByteArray query_host(const QByteArray&);
+    static quint16 query_type(const QByteArray&);
+    static QByteArray record(QByteArray, quint16, quint32, QByteArray);
+    static void settle(Resolver*, QList<void*>*);
+
+};
+
+// Private methods:
+
+/**
+ * @fn bool TestResolver::quiet()
+ * @brief Method to check that no query reached the stub server.
+ * @return Returns true if no query is waiting to be read.
+ */
+
+bool TestResolver::quiet() {
+
+  struct pollfd query = {server, POLLIN, 0};
+
+  return poll(&query, 1, 50) == 0;
+
+}
+
+/**
+ * @fn int TestResolver::serve(int count, QList<QByteArray> *queries)
+ * @brief Method to read queries at the stub server.
+ * @param count Number of queries expected.
+ * @param queries Address of a list to store the queries (cleared first).
+ * @return Returns 0 when every query arrived in time and -1 otherwise.
+ */
+
+int TestResolver::serve(int count, QList<QByteArray> *queries) {
+
+  struct pollfd query = {server, POLLIN, 0};
+  socklen_t size = sizeof(client);
+  char message[RESOLVER_MESSAGE_SIZE];
+  ssize_t received;
+
+  queries->clear();
+
+  while(queries->size() < count) {
+
+    if(poll(&query, 1, TEST_WAIT) != 1 ||
+       (received = recvfrom(server, message, sizeof(message), 0,
+                            reinterpret_cast<struct sockaddr*> (&client), &size)) < 12)
+      return -1;
+
+    queries->append(QByteArray(message, static_cast<int> (received)));
+
+  }
+
+  return 0;
+
+}
+
+/**
+ * @fn void TestResolver::reply(QByteArray message)
+ * @brief Method to send an answer from the stub server.
+ * @param message Answer to be sent to the Resolver that sent the last query.
+ */
+
+void TestResolver::reply(QByteArray message) {
+
+  sendto(server, message.constData(), static_cast<size_t> (message.size()), 0,
+         reinterpret_cast<struct sockaddr*> (&client), sizeof(client));
+
+}
+
+/**
+ * @fn QStringList TestResolver::addresses(const QList<struct sockaddr_storage> &addrs)
+ * @brief Method to write addresses as text.
+ * @param addrs Addresses found by the Resolver.
+ * @return Returns the addresses, in the same order.
+ */
+
+QStringList TestResolver::addresses(const QList<struct sockaddr_storage> &addrs) {
+
+  QStringList text;
+  char buffer[INET6_ADDRSTRLEN];
+
+  for(int i = 0; i < addrs.size(); i++) {
+    if(addrs[i].ss_family == AF_INET)
+      inet_ntop(AF_INET, &(reinterpret_cast<const struct sockaddr_in*> (&addrs[i])->sin_addr),
+                buffer, sizeof(buffer));
+    else
+      inet_ntop(AF_INET6, &(reinterpret_cast<const struct sockaddr_in6*> (&addrs[i])->sin6_addr),
+                buffer, sizeof(buffer));
+    text.append(buffer);
+  }
+
+  return text;
+
+}
+
+/**
+ * @fn QByteArray TestResolver::answer(const QByteArray &query, int rcode, QList<QByteArray> answers, QList<QByteArray> authorities)
+ * @brief Method to build the answer to a query.
+ * @param query Query received.
+ * @param rcode Response code.
+ * @param answers Records of the answer section.
+ * @param authorities Records of the authority section.
+ * @return Returns the answer, with the identifier and the question of the
+ * query.
+ */
+
+QByteArray TestResolver::answer(const QByteArray &query, int rcode,
+                                QList<QByteArray> answers,
+                                QList<QByteArray> authorities) {
+
+  QByteArray message = query.left(2);
+
+  message.append(static_cast<char> (0x81));
+  message.append(static_cast<char> (0x80 | rcode));
+  message.append(bytes16(1) + bytes16(static_cast<unsigned int> (answers.size())));
+  message.append(bytes16(static_cast<unsigned int> (authorities.size())) + bytes16(0));
+  message.append(query.mid(12));
+
+  for(int i = 0; i < answers.size(); i++)
+    message.append(answers[i]);
+
+  for(int i = 0; i < authorities.size(); i++)
+    message.append(authorities[i]);
+
+  return message;
+
+}
+
+/**
+ * @fn QByteArray TestResolver::address_answer(const QByteArray &query, quint32 ttl)
+ * @brief Method to build an answer with one address of the type asked for.
+ * @param query Query received.
+ * @param ttl TTL of the address.
+ * @return Returns the answer: 127.0.0.5 or 2001:db8::1, named by a pointer
+ * to the question.
+ */
+
+QByteArray TestResolver::address_answer(const QByteArray &query, quint32 ttl) {
+
+  QByteArray question_name("\xC0\x0C", 2);
+
+  if(query_type(query) == DNS_TYPE_A)
+    return answer(query, 0, QList<QByteArray>() <<
+                  record(question_name, DNS_TYPE_A, ttl, QByteArray("\x7F\x00\x00\x05", 4)));
+
+  return answer(query, 0, QList<QByteArray>() <<
+                record(question_name, DNS_TYPE_AAAA, ttl,
+                       QByteArray("\x20\x01\x0D\xB8", 4) + QByteArray(11, '\0') + '\x01'));
+
+}
+
+/**
+ * @fn QByteArray TestResolver::bytes16(unsigned int value)
+ * @brief Method to write a 16 bit number in network order.
+ * @param value Number to be written.
+ * @return Returns the two bytes of the number.
+ */
+
+QByteArray TestResolver::bytes16(unsigned int value) {
+
+  QByteArray bytes;
+
+  bytes.append(static_cast<char> ((value >> 8) & 0xFF));
+  bytes.append(static_cast<char> (value & 0xFF));
+
+  return bytes;
+
+}
+
+/**
+ * @fn QByteArray TestResolver::bytes32(quint32 value)
+ * @brief Method to write a 32 bit number in network order.
+ * @param value Number to be written.
+ * @return Returns the four bytes of the number.
+ */
+
+QByteArray TestResolver::bytes32(quint32 value) {
+
+  return bytes16(value >> 16) + bytes16(value & 0xFFFF);
+
+}
+
+/**
+ * @fn QByteArray TestResolver::encode_name(QByteArray host)
+ * @brief Method to write a host name as DNS labels.
+ * @param host Name of the host.
+ * @return Returns the labels, ended by the empty label.
+ */
+
+QByteArray TestResolver::encode_name(QByteArray host) {
+
+  QList<QByteArray> labels = host.split('.');
+  QByteArray name;
+
+  for(int i = 0; i < labels.size(); i++)
+    name.append(static_cast<char> (labels[i].size())).append(labels[i]);
+
+  return name.append('\0');
+
+}
+
+/**
+ * @fn quint16 TestResolver::query_id(const QByteArray &query)
+ * @brief Method to read the identifier of a query.
+ * @param query Query received.
+ * @return Returns the identifier.
+ */
+
+quint16 TestResolver::query_id(const QByteArray &query) {
+
+  return static_cast<quint16> ((static_cast<unsigned char> (query[0]) << 8) |
+                               static_cast<unsigned char> (query[1]));
+
+}
+
+/**
+ * @fn QByteArray TestResolver::query_host(const QByteArray &query)
+ * @brief Method to read the host asked for by a query.
+ * @param query Query received.
+ * @return Returns the name of the host.
+ */
+
+QByteArray TestResolver::query_host(const QByteArray &query) {
+
+  QByteArray host;
+  int position = 12, length;
+
+  while(position < query.size() && (length = query[position]) > 0) {
+    if(!host.isEmpty())
+      host.append('.');
+    host.append(query.mid(position + 1, length));
+    position += 1 + length;
+  }
+
+  return host;
+
+}
+
+/**
+ * @fn quint16 TestResolver::query_type(const QByteArray &query)
+ * @brief Method to read the record type asked for by a query.
+ * @param query Query received.
+ * @return Returns the record type.
+ */
+
+quint16 TestResolver::query_type(const QByteArray &query) {
+
+  return static_cast<quint16> ((static_cast<unsigned char> (query[query.size() - 4]) << 8) |
+                               static_cast<unsigned char> (query[query.size() - 3]));
+
+}
+
+/**
+ * @fn QByteArray TestResolver::record(QByteArray name, quint16 type, quint32 ttl, QByteArray data)
+ * @brief Method to build a resource record of class IN.
+ * @param name Name of the record, as labels or pointers.
+ * @param type Record type.
+ * @param ttl TTL of the record.
+ * @param data Data of the record.
+ * @return Returns the record.
+ */
+
+QByteArray TestResolver::record(QByteArray name, quint16 type, quint32 ttl,
+                                QByteArray data) {
+
+  return name + bytes16(type) + bytes16(1) + bytes32(ttl) +
+         bytes16(static_cast<unsigned int> (data.size())) + data;
+
+}
+
+/**
+ * @fn void TestResolver::settle(Resolver *resolver, QList<void*> *done)
+ * @brief Method to let the Resolver read the answers sent to it.
+ * @param resolver Resolver the answers were sent to.
+ * @param done Address of a list where the finished waiters are appended.
+ */
+
+void TestResolver::settle(Resolver *resolver, QList<void*> *done) {
+
+  struct pollfd ready = {resolver->get_fd(), POLLIN, 0};
+
+  if(poll(&ready, 1, TEST_WAIT) == 1)
+    resolver->process(done);
+
+}
+
+// Test cases:
+
+/**
+ * @fn void TestResolver::init()
+ * @brief Method to start the stub server and a cache that asks it.
+ */
+
+void TestResolver::init() {
+
+  struct sockaddr_in addr;
+  socklen_t size = sizeof(addr);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  QVERIFY((server = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0)) != -1);
+  QCOMPARE(bind(server, reinterpret_cast<struct sockaddr*> (&addr), sizeof(addr)), 0);
+  QCOMPARE(getsockname(server, reinterpret_cast<struct sockaddr*> (&addr), &size), 0);
+
+  cache = QSharedPointer<DNSCache>(new DNSCache());
+  QCOMPARE(cache->set_server("127.0.0.1:" + QString::number(ntohs(addr.sin_port))), 0);
+
+}
+
+/**
+ * @fn void TestResolver::uses_hosts_file()
+ * @brief Method to look up hosts loaded from a hosts file.
+ *
+ * The hosts are found without a socket, whatever their case, with the IPv6
+ * addresses first. A host listed with a single family has no addresses of
+ * the other one. Addresses are not looked up at all.
+ *
+ */
+
+void TestResolver::uses_hosts_file() {
+
+  QTemporaryFile file;
+  QByteArray hosts = "# Static hosts\n"
+                     "127.0.0.2  Local.Test other.test # Comment\n"
+                     "::2 local.test\n"
+                     "\t10.0.0.1 v4only.test\n"
+                     "not-an-address ignored.test\n";
+  Resolver resolver(cache);
+  QList<struct sockaddr_storage> addrs;
+  int waiter;
+
+  QVERIFY(file.open() && file.write(hosts) == hosts.size() && file.flush());
+  QCOMPARE(cache->load_hosts(file.fileName()), 0);
+  QCOMPARE(cache->load_hosts("/nonexistent/hosts"), -1);
+
+  QCOMPARE(resolver.resolve("LOCAL.test", &addrs, &waiter), 0);
+  QCOMPARE(addresses(addrs), QStringList() << "::2" << "127.0.0.2");
+  QCOMPARE(resolver.resolve("other.test", &addrs, &waiter), 0);
+  QCOMPARE(addresses(addrs), QStringList() << "127.0.0.2");
+  QCOMPARE(resolver.resolve("v4only.test", &addrs, &waiter), 0);
+  QCOMPARE(addresses(addrs), QStringList() << "10.0.0.1");
+
+  QCOMPARE(resolver.resolve("192.0.2.1", &addrs, &waiter), 0);
+  QCOMPARE(addresses(addrs), QStringList() << "192.0.2.1");
+  QCOMPARE(resolver.resolve("2001:db8::2", &addrs, &waiter), 0);
+  QCOMPARE(addresses(addrs), QStringList() << "2001:db8::2");
+
+  // Other hosts need the socket, which was not created:
+  QCOMPARE(resolver.resolve("ignored.test", &addrs, &waiter), -1);
+
+}
+
+/**
+ * @fn void TestResolver::caches_answers()
+ * @brief Method to resolve a host and look it up again.
+ *
+ * The answers have a TTL of 0, so they are kept for RESOLVER_MIN_TTL
+ * seconds: the host is found without new queries until then, and asked for
+ * again after that.
+ *
+ */
+
+void TestResolver::caches_answers() {
+
+  Resolver resolver(cache);
+  QList<struct sockaddr_storage> addrs;
+  QList<QByteArray> queries;
+  QList<void*> done;
+  int waiter;
+
+  QCOMPARE(resolver.init(), 0);
+  QCOMPARE(resolver.resolve("Cached.Test", &addrs, &waiter), RESOLVER_PENDING);
+  QCOMPARE(serve(2, &queries), 0);
+  QCOMPARE(query_host(queries[0]), QByteArray("cached.test"));
+  QVERIFY(query_type(queries[0]) != query_type(queries[1]));
+
+  for(int i = 0; i < queries.size(); i++)
+    reply(address_answer(queries[i], 0));
+
+  settle(&resolver, &done);
+  QCOMPARE(done.size(), 2);
+  QVERIFY(done[0] == &waiter && done[1] == &waiter);
+
+  QCOMPARE(resolver.resolve("cached.test", &addrs, &waiter), 0);
+  QCOMPARE(addresses(addrs), QStringList() << "2001:db8::1" << "127.0.0.5");
+  QVERIFY(quiet());
+
+  usleep((RESOLVER_MIN_TTL * 1000 + 100) * 1000);
+  QCOMPARE(resolver.resolve("cached.test", &addrs, &waiter), RESOLVER_PENDING);
+  QCOMPARE(serve(2, &queries), 0);
+
+}
+
+/**
+ * @fn void TestResolver::caches_missing_hosts()
+ * @brief Method to resolve hosts that do not exist, or that the server
+ * fails on.
+ *
+ * A missing host with an SOA record is cached for the SOA minimum TTL (here
+ * 1 second, below the TTL of the SOA record itself), and for
+ * RESOLVER_NEGATIVE_TTL seconds without one. Server errors are cached for
+ * RESOLVER_FAILURE_TTL seconds.
+ *
+ */
+
+void TestResolver::caches_missing_hosts() {
+
+  Resolver resolver(cache);
+  QList<struct sockaddr_storage> addrs;
+  QList<QByteArray> queries;
+  QList<void*> done;
+  QByteArray soa = QByteArray("\xC0\x0C\xC0\x0C", 4) + bytes32(1) + bytes32(3600) +
+                   bytes32(600) + bytes32(86400) + bytes32(1);
+  QByteArray host;
+  int waiter;
+
+  QCOMPARE(resolver.init(), 0);
+  QCOMPARE(resolver.resolve("gone.test", &addrs, &waiter), RESOLVER_PENDING);
+  QCOMPARE(resolver.resolve("empty.test", &addrs, &waiter), RESOLVER_PENDING);
+  QCOMPARE(resolver.resolve("broken.test", &addrs, &waiter), RESOLVER_PENDING);
+  QCOMPARE(serve(6, &queries), 0);
+
+  for(int i = 0; i < queries.size(); i++) {
+    host = query_host(queries[i]);
+    if(host == "gone.test")
+      reply(answer(queries[i], 3, QList<QByteArray>(), QList<QByteArray>() <<
+                   record(QByteArray("\xC0\x0C", 2), 6, 3600, soa)));
+    else if(host == "empty.test")
+      reply(answer(queries[i], 0, QList<QByteArray>()));
+    else
+      reply(answer(queries[i], 2, QList<QByteArray>()));
+  }
+
+  settle(&resolver, &done);
+  QCOMPARE(done.size(), 6);
+
+  QCOMPARE(resolver.resolve("gone.test", &addrs, &waiter), -1);
+  QCOMPARE(resolver.resolve("empty.test", &addrs, &waiter), -1);
+  QCOMPARE(resolver.resolve("broken.test", &addrs, &waiter), -1);
+  QVERIFY(quiet());
+
+  usleep(1100000);
+  QCOMPARE(resolver.resolve("empty.test", &addrs, &waiter), -1);
+  QCOMPARE(resolver.resolve("broken.test", &addrs, &waiter), -1);
+  QCOMPARE(resolver.resolve("gone.test", &addrs, &waiter), RESOLVER_PENDING);
+  QCOMPARE(serve(2, &queries), 0);
+  QCOMPARE(query_host(queries[0]), QByteArray("gone.test"));
+
+}
+
+/**
+ * @fn void TestResolver::shares_queries()
+ * @brief Method to look a host up for several waiters at once.
+ *
+ * Only the first lookup sends queries, and every waiter (once, however many
+ * times it asked) is reported when each answer arrives. A cancelled waiter
+ * is not reported.
+ *
+ */
+
+void TestResolver::shares_queries() {
+
+  Resolver resolver(cache);
+  QList<struct sockaddr_storage> addrs;
+  QList<QByteArray> queries;
+  QList<void*> done;
+  int first, second, cancelled;
+
+  QCOMPARE(resolver.init(), 0);
+  QCOMPARE(resolver.resolve("shared.test", &addrs, &first), RESOLVER_PENDING);
+  QCOMPARE(resolver.resolve("shared.test", &addrs, &second), RESOLVER_PENDING);
+  QCOMPARE(resolver.resolve("SHARED.test", &addrs, &second), RESOLVER_PENDING);
+  QCOMPARE(resolver.resolve("shared.test", &addrs, &cancelled), RESOLVER_PENDING);
+  resolver.cancel(&cancelled);
+
+  QCOMPARE(serve(2, &queries), 0);
+  QVERIFY(quiet());
+
+  for(int i = 0; i < queries.size(); i++)
+    reply(address_answer(queries[i], 60));
+
+  settle(&resolver, &done);
+  QCOMPARE(done.size(), 4);
+  QCOMPARE(done.count(&first), 2);
+  QCOMPARE(done.count(&second), 2);
+
+  QCOMPARE(resolver.resolve("shared.test", &addrs, &first), 0);
+  QCOMPARE(resolver.resolve("shared.test", &addrs, &second), 0);
+  QCOMPARE(addrs.size(), 2);
+
+}
+
+/**
+ * @fn void TestResolver::retries_and_expires()
+ * @brief Method to resolve a host the server never answers.
+ *
+ * Each query is sent again, with a new identifier, every RESOLVER_TIMEOUT
+ * milliseconds (late answers to an earlier attempt are discarded), and after
+ * RESOLVER_ATTEMPTS attempts the failure is cached.
+ *
+ */
+
+void TestResolver::retries_and_expires() {
+
+  Resolver resolver(cache);
+  QList<struct sockaddr_storage> addrs;
+  QList<QByteArray> queries, late;
+  QList<void*> done;
+  int waiter;
+
+  QCOMPARE(resolver.init(), 0);
+  QCOMPARE(resolver.resolve("slow.test", &addrs, &waiter), RESOLVER_PENDING);
+  QCOMPARE(serve(2, &late), 0);
+
+  resolver.expire(&done);
+  QVERIFY(done.isEmpty());
+  QVERIFY(quiet());
+
+  usleep((RESOLVER_TIMEOUT + 50) * 1000);
+  resolver.expire(&done);
+  QVERIFY(done.isEmpty());
+  QCOMPARE(serve(2, &queries), 0);
+
+  // The answers to the first attempt arrive now:
+  for(int i = 0; i < late.size(); i++)
+    for(int j = 0; j < queries.size(); j++)
+      if(query_type(queries[j]) == query_type(late[i]) &&
+         query_id(queries[j]) != query_id(late[i]))
+        reply(address_answer(late[i], 60));
+
+  settle(&resolver, &done);
+  QVERIFY(done.isEmpty());
+
+  for(int attempt = 2; attempt < RESOLVER_ATTEMPTS; attempt++) {
+    usleep((RESOLVER_TIMEOUT + 50) * 1000);
+    resolver.expire(&done);
+    QVERIFY(done.isEmpty());
+    QCOMPARE(serve(2, &queries), 0);
+  }
+
+  usleep((RESOLVER_TIMEOUT + 50) * 1000);
+  resolver.expire(&done);
+  QCOMPARE(done.size(), 2);
+  QVERIFY(quiet());
+
+  QCOMPARE(resolver.resolve("slow.test", &addrs, &waiter), -1);
+  QVERIFY(quiet());
+
+}
+
+/**
+ * @fn void TestResolver::discards_bad_answers()
+ * @brief Method to send answers that must not finish a lookup.
+ *
+ * Answers with another identifier or host, without the answer flag, cut
+ * short, with more records than they hold or with names that loop or point
+ * past the end are discarded, and the query keeps waiting. The answer that
+ * follows reaches its address through a CNAME record, with names compressed
+ * by pointers.
+ *
+ */
+
+void TestResolver::discards_bad_answers() {
+
+  Resolver resolver(cache);
+  QList<struct sockaddr_storage> addrs;
+  QList<QByteArray> queries, bad;
+  QList<void*> done;
+  QByteArray query, valid, other;
+  int waiter;
+
+  QCOMPARE(resolver.init(), 0);
+  QCOMPARE(resolver.resolve("bad.test", &addrs, &waiter), RESOLVER_PENDING);
+  QCOMPARE(serve(2, &queries), 0);
+
+  query = query_type(queries[0]) == DNS_TYPE_A ? queries[0] : queries[1];
+  valid = address_answer(query, 60);
+
+  // Another identifier, another host, not an answer:
+  bad.append(valid);
+  bad.last()[1] = static_cast<char> (bad.last()[1] ^ 1);
+  other = query.left(12) + encode_name("other.test") + query.right(4);
+  bad.append(address_answer(other, 60));
+  bad.append(valid);
+  bad.last()[2] = static_cast<char> (bad.last()[2] & 0x7F);
+
+  // Truncated, in the question name or in the record, and missing records:
+  bad.append(valid.left(16));
+  bad.append(valid.left(valid.size() - 2));
+  bad.append(valid);
+  bad.last()[7] = 2;
+
+  // A record name pointing to itself (the record starts where the query
+  // ends), and one pointing past the end:
+  bad.append(answer(query, 0, QList<QByteArray>() <<
+                    record(bytes16(0xC000 | static_cast<unsigned int> (query.size())),
+                           DNS_TYPE_A, 60, QByteArray("\x7F\x00\x00\x06", 4))));
+  bad.append(answer(query, 0, QList<QByteArray>() <<
+                    record(QByteArray("\xC0\xFF", 2), DNS_TYPE_A, 60,
+                           QByteArray("\x7F\x00\x00\x06", 4))));
+
+  for(int i = 0; i < bad.size(); i++) {
+    reply(bad[i]);
+    settle(&resolver, &done);
+    QVERIFY(done.isEmpty());
+  }
+
+  // bad.test is an alias of alias.test, whose name is the data of the CNAME
+  // (after its 2 byte name and 10 bytes of type, class, TTL and length):
+  reply(answer(query, 0, QList<QByteArray>()
+               << record(QByteArray("\xC0\x0C", 2), 5, 300, encode_name("alias.test"))
+               << record(bytes16(0xC000 | static_cast<unsigned int> (query.size() + 12)),
+                         DNS_TYPE_A, 100, QByteArray("\x7F\x00\x00\x07", 4))));
+
+  for(int i = 0; i < queries.size(); i++)
+    if(queries[i] != query)
+      reply(address_answer(queries[i], 60));
+
+  settle(&resolver, &done);
+  QCOMPARE(done.size(), 2);
+  QCOMPARE(resolver.resolve("bad.test", &addrs, &waiter), 0);
+  QCOMPARE(addresses(addrs), QStringList() << "2001:db8::1" << "127.0.0.7");
+
+}
+
+/**
+ * @fn void TestResolver::cleanup()
+ * @brief Method to stop the stub server.
+ */
+
+void TestResolver::cleanup() {
+
+  close(server);
+  cache.clear();
+
+}
+
+QTEST_APPLESS_MAIN(TestResolver)
+
+#include "tst_resolver.moc"
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# RingBuffer tests.
+#
+#-------------------------------------------------
+
+QT += testlib
+QT -= gui
+
+TARGET = tst_ring_buffer
+TEMPLATE = app
+
+CONFIG += console testcase c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+# File names:
+SOURCES += \
+        tst_ring_buffer.cpp \
+        ../../src/ring_buffer.cpp
+
+HEADERS += \
+        ../../include/ring_buffer.h
@@ -0,0 +1,266 @@
+// ProxyGate - RingBuffer tests.
+
+/**
+ * @file tst_ring_buffer.cpp
+ * @brief RingBuffer tests.
+ *
+ * A random stream is moved from one socket pair to another through a small
+ * RingBuffer, in random amounts on both sides, with a sending socket small
+ * enough for drains to stop halfway: the data then wraps around the end of
+ * the memory, and must still arrive whole and in order. The data each fill
+ * stored is compared with what recent() says it stored.
+ *
+ */
+
+// Library includes:
+#include <random>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Qt includes:
+#include <QByteArray>
+#include <QtTest>
+
+// User includes:
+#include "include/ring_buffer.h"
+
+// Macros:
+
+/**
+ * @def TEST_CAPACITY
+ * @brief Capacity (in bytes) of the user space ring buffers tested.
+ */
+
+#define TEST_CAPACITY 4096
+
+/**
+ * @def TEST_STREAM_SIZE
+ * @brief Size (in bytes) of the stream moved through a ring buffer.
+ */
+
+#define TEST_STREAM_SIZE 4194304
+
+/**
+ * @def TEST_SEND_BUFFER
+ * @brief Send buffer size (in bytes) of the socket a ring buffer drains to.
+ */
+
+#define TEST_SEND_BUFFER 4096
+
+// Class headers:
+
+/**
+ * @class TestRingBuffer
+ * @brief RingBuffer tests.
+ */
+
+class TestRingBuffer : public QObject {
+
+  Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void moves_stream_in_order();
+    void moves_stream_in_kernel();
+    void reports_state();
+    void cleanupTestCase();
+
+  private:
+    // Variables:
+    QByteArray stream;  /**< Data moved through the ring buffers. */
+    int source[2];      /**< Sockets the ring buffers fill from. */
+    int target[2];      /**< Sockets the ring buffers drain to. */
+
+    // Methods:
+    QByteArray pump(RingBuffer*, int*, int*);
+
+};
+
+// Private methods:
+
+/**
+ * @fn QByteArray TestRingBuffer::pump(RingBuffer *buffer, int *wraps, int *mismatches)
+ * @brief Method to move the stream through a ring buffer.
+ * @param buffer Ring buffer to be used (empty).
+ * @param wraps Address to store the number of fills that wrapped around.
+ * @param mismatches Address to store the number of fills whose data was not
+ * the next piece of the stream.
+ * @return Returns the data that came out of the ring buffer (cut short if
+ * the stream stops moving).
+ */
+
+QByteArray TestRingBuffer::pump(RingBuffer *buffer, int *wraps, int *mismatches) {
+
+  std::mt19937 generator(5);
+  std::uniform_int_distribution<int> amount(1, 3 * TEST_CAPACITY / 2);
+  QByteArray received;
+  struct iovec pieces[2];
+  char chunk[3 * TEST_CAPACITY / 2];
+  int sent = 0, filled = 0, idle = 0, count;
+  ssize_t moved;
+
+  *wraps = *mismatches = 0;
+
+  while(received.size() < stream.size() && idle < 1000) {
+
+    idle++;
+
+    if(sent < stream.size() &&
+       (moved = write(source[0], stream.constData() + sent,
+                      static_cast<size_t> (qMin(amount(generator), stream.size() - sent)))) > 0)
+      sent += static_cast<int> (moved);
+
+    if(!buffer->full() &&
+       (moved = buffer->fill(source[1], static_cast<size_t> (amount(generator)))) > 0) {
+
+      idle = 0;
+
+      if((count = buffer->recent(static_cast<size_t> (moved), pieces)) == 2)
+        (*wraps)++;
+
+      for(int i = 0; i < count; i++) {
+        if(memcmp(pieces[i].iov_base, stream.constData() + filled, pieces[i].iov_len) != 0)
+          (*mismatches)++;
+        filled += static_cast<int> (pieces[i].iov_len);
+      }
+
+    }
+
+    if(!buffer->empty() && buffer->drain(target[0]) > 0)
+      idle = 0;
+
+    // The reader lags behind, so the sending socket fills up:
+    if(amount(generator) % 3 != 0 &&
+       (moved = read(target[1], chunk, static_cast<size_t> (amount(generator)))) > 0)
+      received.append(chunk, static_cast<int> (moved));
+
+  }
+
+  return received;
+
+}
+
+// Test cases:
+
+/**
+ * @fn void TestRingBuffer::initTestCase()
+ * @brief Method to create the stream and the sockets.
+ */
+
+void TestRingBuffer::initTestCase() {
+
+  std::mt19937 generator(5);
+  int size = TEST_SEND_BUFFER;
+
+  stream.resize(TEST_STREAM_SIZE);
+
+  for(int i = 0; i < stream.size(); i++)
+    stream[i] = static_cast<char> (generator());
+
+  QCOMPARE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, source), 0);
+  QCOMPARE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, target), 0);
+  QCOMPARE(setsockopt(target[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)), 0);
+
+}
+
+/**
+ * @fn void TestRingBuffer::moves_stream_in_order()
+ * @brief Method to move the stream through a user space ring buffer.
+ */
+
+void TestRingBuffer::moves_stream_in_order() {
+
+  RingBuffer buffer(TEST_CAPACITY, false);
+  int wraps, mismatches;
+
+  QVERIFY(!buffer.in_kernel());
+  QVERIFY(pump(&buffer, &wraps, &mismatches) == stream);
+  QCOMPARE(mismatches, 0);
+  QVERIFY(wraps > 0);
+  QVERIFY(buffer.empty());
+
+}
+
+/**
+ * @fn void TestRingBuffer::moves_stream_in_kernel()
+ * @brief Method to move the stream through a pipe.
+ *
+ * The data of a pipe can not be looked at, only its output is compared.
+ *
+ */
+
+void TestRingBuffer::moves_stream_in_kernel() {
+
+  RingBuffer buffer(TEST_CAPACITY, true);
+  int wraps, mismatches;
+
+  if(!buffer.in_kernel())
+    QSKIP("pipes can not be created");
+
+  QVERIFY(pump(&buffer, &wraps, &mismatches) == stream);
+  QCOMPARE(wraps, 0);
+  QVERIFY(buffer.empty());
+
+}
+
+/**
+ * @fn void TestRingBuffer::reports_state()
+ * @brief Method to check the amount stored, a full buffer and a closed
+ * socket.
+ */
+
+void TestRingBuffer::reports_state() {
+
+  RingBuffer buffer(16, false);
+  struct iovec pieces[2];
+  char chunk[32];
+  int pair[2];
+
+  QCOMPARE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair), 0);
+
+  QCOMPARE(buffer.fill(pair[1], 16), static_cast<ssize_t> (-1));
+  QCOMPARE(errno, EAGAIN);
+  QVERIFY(buffer.empty());
+
+  QCOMPARE(write(pair[0], "0123456789abcdefXYZ", 19), static_cast<ssize_t> (19));
+  QCOMPARE(buffer.fill(pair[1], 10), static_cast<ssize_t> (10));
+  QCOMPARE(buffer.size(), static_cast<size_t> (10));
+  QCOMPARE(buffer.fill(pair[1], 16), static_cast<ssize_t> (6));
+  QVERIFY(buffer.full());
+
+  QCOMPARE(buffer.recent(4, pieces), 1);
+  QCOMPARE(QByteArray(static_cast<char*> (pieces[0].iov_base), 4), QByteArray("cdef"));
+
+  // The bytes left in the socket arrive after the ones drained:
+  QCOMPARE(buffer.drain(pair[1]), static_cast<ssize_t> (16));
+  QVERIFY(buffer.empty());
+  QCOMPARE(read(pair[0], chunk, sizeof(chunk)), static_cast<ssize_t> (16));
+  QCOMPARE(QByteArray(chunk, 16), QByteArray("0123456789abcdef"));
+
+  close(pair[0]);
+  QCOMPARE(buffer.fill(pair[1], 16), static_cast<ssize_t> (3));
+  QCOMPARE(buffer.fill(pair[1], 16), static_cast<ssize_t> (0));
+  QCOMPARE(buffer.size(), static_cast<size_t> (3));
+
+  close(pair[1]);
+
+}
+
+/**
+ * @fn void TestRingBuffer::cleanupTestCase()
+ * @brief Method to close the sockets.
+ */
+
+void TestRingBuffer::cleanupTestCase() {
+
+  close(source[0]);
+  close(source[1]);
+  close(target[0]);
+  close(target[1]);
+
+}
+
+QTEST_APPLESS_MAIN(TestRingBuffer)
+
+#include "tst_ring_buffer.moc"
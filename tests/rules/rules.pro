@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# RuleSet tests.
+#
+#-------------------------------------------------
+
+QT += testlib
+QT -= gui
+
+TARGET = tst_rules
+TEMPLATE = app
+
+CONFIG += console testcase c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+# File names:
+SOURCES += \
+        tst_rules.cpp \
+        ../../src/header_table.cpp \
+        ../../src/rules.cpp
+
+HEADERS += \
+        ../../include/header_table.h \
+        ../../include/rules.h
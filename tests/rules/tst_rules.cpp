@@ -0,0 +1,352 @@
+// ProxyGate - RuleSet tests.
+
+/**
+ * @file tst_rules.cpp
+ * @brief RuleSet tests.
+ *
+ * Rules files are written to temporary files, loaded and matched against
+ * requests and answers: the host trie (exact hosts and '*.domain'), path
+ * prefixes and globs, the other conditions, the order of the rules and the
+ * lines a rules file is rejected for.
+ *
+ */
+
+// Qt includes:
+#include <QByteArray>
+#include <QString>
+#include <QTemporaryFile>
+#include <QtTest>
+
+// User includes:
+#include "include/rules.h"
+
+// Class headers:
+
+/**
+ * @class TestRules
+ * @brief RuleSet tests.
+ */
+
+class TestRules : public QObject {
+
+  Q_OBJECT
+
+  private slots:
+    void intercepts_without_rules();
+    void matches_hosts();
+    void matches_path_globs();
+    void matches_other_conditions();
+    void keeps_rule_order();
+    void samples_exchanges();
+    void rejects_invalid_lines();
+    void describes_requests();
+
+  private:
+    // Methods:
+    static bool gated(RuleSet*, QString, QString, QString = "GET",
+                      RuleStage = RULE_REQUEST, const Headers* = nullptr);
+    static int load(RuleSet*, QByteArray, QString*);
+
+};
+
+// Private methods:
+
+/**
+ * @fn bool TestRules::gated(RuleSet *rules, QString host, QString path, QString method, RuleStage stage, const Headers *headers)
+ * @brief Method to decide whether an exchange stops at the gate.
+ * @param rules Rules to be matched.
+ * @param host Host of the request.
+ * @param path Path of the request.
+ * @param method Method of the request.
+ * @param stage Point of the exchange (request or answer).
+ * @param headers Headers of the message (nullptr for none).
+ * @return Returns true if the exchange is intercepted.
+ */
+
+bool TestRules::gated(RuleSet *rules, QString host, QString path,
+                      QString method, RuleStage stage, const Headers *headers) {
+
+  rule_request request = RuleSet::describe(method, path, host);
+  Headers none;
+
+  return rules->intercept(stage, &request, headers == nullptr ? &none : headers);
+
+}
+
+/**
+ * @fn int TestRules::load(RuleSet *rules, QByteArray text, QString *error)
+ * @brief Method to load rules from a text.
+ * @param rules Rules to be replaced.
+ * @param text Lines of the rules file.
+ * @param error Address to store the reason the file was rejected.
+ * @return Returns the result of RuleSet::load().
+ */
+
+int TestRules::load(RuleSet *rules, QByteArray text, QString *error) {
+
+  QTemporaryFile file;
+
+  if(!file.open() || file.write(text) != text.size() || !file.flush())
+    return -2;
+
+  return rules->load(file.fileName(), error);
+
+}
+
+// Test cases:
+
+/**
+ * @fn void TestRules::intercepts_without_rules()
+ * @brief Method to match exchanges before and after loading empty rules.
+ */
+
+void TestRules::intercepts_without_rules() {
+
+  RuleSet rules;
+  QString error;
+
+  QVERIFY(gated(&rules, "example.com", "/"));
+  QVERIFY(gated(&rules, "example.com", "/", "GET", RULE_ANSWER));
+
+  // Only comments: no rule applies, so the default action decides:
+  QCOMPARE(load(&rules, "# Nothing to gate\n\n   \n", &error), 0);
+  QVERIFY(!gated(&rules, "example.com", "/"));
+
+  QCOMPARE(load(&rules, "default intercept # everything\n", &error), 0);
+  QVERIFY(gated(&rules, "example.com", "/"));
+
+}
+
+/**
+ * @fn void TestRules::matches_hosts()
+ * @brief Method to match exact hosts and the hosts below a domain.
+ *
+ * '*.domain' matches any host below the domain, but not the domain itself
+ * nor a host that merely ends with the same characters.
+ *
+ */
+
+void TestRules::matches_hosts() {
+
+  RuleSet rules;
+  QString error;
+
+  QCOMPARE(load(&rules, "intercept host=Example.com,api.test\n"
+                        "intercept host=*.example.org\n", &error), 0);
+
+  QVERIFY(gated(&rules, "example.com", "/"));
+  QVERIFY(gated(&rules, "EXAMPLE.COM:8080", "/"));
+  QVERIFY(gated(&rules, "api.test", "/"));
+  QVERIFY(!gated(&rules, "www.example.com", "/"));
+  QVERIFY(!gated(&rules, "xample.com", "/"));
+  QVERIFY(!gated(&rules, "test", "/"));
+
+  QVERIFY(gated(&rules, "www.example.org", "/"));
+  QVERIFY(gated(&rules, "a.b.example.org", "/"));
+  QVERIFY(!gated(&rules, "example.org", "/"));
+  QVERIFY(!gated(&rules, ".example.org", "/"));
+  QVERIFY(!gated(&rules, "badexample.org", "/"));
+  QVERIFY(!gated(&rules, "example.org.evil.net", "/"));
+  QVERIFY(!gated(&rules, "", "/"));
+
+}
+
+/**
+ * @fn void TestRules::matches_path_globs()
+ * @brief Method to match path prefixes and globs.
+ */
+
+void TestRules::matches_path_globs() {
+
+  RuleSet rules;
+  QString error;
+
+  QCOMPARE(load(&rules, "intercept path=/api/*\n"
+                        "intercept path=*.js\n"
+                        "intercept path=/v?/users\n"
+                        "intercept path=/a*b*c\n", &error), 0);
+
+  QVERIFY(gated(&rules, "example.com", "/api/"));
+  QVERIFY(gated(&rules, "example.com", "/api/users?id=1"));
+  QVERIFY(!gated(&rules, "example.com", "/api"));
+
+  QVERIFY(gated(&rules, "example.com", "/static/app.js"));
+  QVERIFY(gated(&rules, "example.com", "/app.js?v=2"));
+  QVERIFY(!gated(&rules, "example.com", "/app.json"));
+
+  QVERIFY(gated(&rules, "example.com", "/v1/users"));
+  QVERIFY(!gated(&rules, "example.com", "/v10/users"));
+  QVERIFY(!gated(&rules, "example.com", "/v/users"));
+
+  QVERIFY(gated(&rules, "example.com", "/abc"));
+  QVERIFY(gated(&rules, "example.com", "/axxbyybzzc"));
+  QVERIFY(gated(&rules, "example.com", "/a/b/c/c"));
+  QVERIFY(!gated(&rules, "example.com", "/axxbyy"));
+  QVERIFY(!gated(&rules, "example.com", "/axxbyyc/d"));
+
+}
+
+/**
+ * @fn void TestRules::matches_other_conditions()
+ * @brief Method to match methods, headers, content types and stages.
+ */
+
+void TestRules::matches_other_conditions() {
+
+  RuleSet rules;
+  Headers html, json, image, debug;
+  QString error;
+
+  html.append("Content-Type", "text/HTML; charset=utf-8");
+  json.append("content-type", "application/json");
+  image.append("Content-Type", "image/png");
+  debug.append("x-debug", "1");
+
+  QCOMPARE(load(&rules, "intercept method=post,PUT\n"
+                        "intercept header=X-Debug stage=request\n"
+                        "intercept type=text/html,application/* stage=answer\n", &error), 0);
+
+  QVERIFY(gated(&rules, "example.com", "/", "POST"));
+  QVERIFY(gated(&rules, "example.com", "/", "PUT", RULE_ANSWER));
+  QVERIFY(!gated(&rules, "example.com", "/", "GET"));
+
+  QVERIFY(gated(&rules, "example.com", "/", "GET", RULE_REQUEST, &debug));
+  QVERIFY(!gated(&rules, "example.com", "/", "GET", RULE_ANSWER, &debug));
+
+  QVERIFY(gated(&rules, "example.com", "/", "GET", RULE_ANSWER, &html));
+  QVERIFY(gated(&rules, "example.com", "/", "GET", RULE_ANSWER, &json));
+  QVERIFY(!gated(&rules, "example.com", "/", "GET", RULE_ANSWER, &image));
+  QVERIFY(!gated(&rules, "example.com", "/", "GET", RULE_REQUEST, &html));
+
+}
+
+/**
+ * @fn void TestRules::keeps_rule_order()
+ * @brief Method to check that the first rule that applies decides.
+ *
+ * Rules found through the host trie and rules without a host are checked
+ * in the order of the file, even when there are more candidates than fit
+ * in the array that needs no allocation.
+ *
+ */
+
+void TestRules::keeps_rule_order() {
+
+  RuleSet rules;
+  QByteArray text = "pass path=/health\n"
+                    "pass host=example.com,*.com path=/static/\n"
+                    "intercept host=example.com\n"
+                    "pass host=*.com\n";
+  QString error;
+
+  QCOMPARE(load(&rules, text + "default intercept\n", &error), 0);
+
+  QVERIFY(!gated(&rules, "example.com", "/health"));
+  QVERIFY(!gated(&rules, "example.com", "/static/app.css"));
+  QVERIFY(gated(&rules, "example.com", "/"));
+  QVERIFY(!gated(&rules, "www.example.com", "/"));
+  QVERIFY(gated(&rules, "example.net", "/"));
+
+  for(int i = 0; i < 2 * RULES_CANDIDATES; i++)
+    text = "pass host=example.com,*.com header=X-Rule-" + QByteArray::number(i) + "\n" + text;
+
+  QCOMPARE(load(&rules, text + "default intercept\n", &error), 0);
+
+  QVERIFY(!gated(&rules, "example.com", "/health"));
+  QVERIFY(gated(&rules, "example.com", "/"));
+  QVERIFY(!gated(&rules, "www.example.com", "/"));
+
+}
+
+/**
+ * @fn void TestRules::samples_exchanges()
+ * @brief Method to match a rule that applies to 1 in 3 exchanges.
+ *
+ * The exchanges a sampled rule skips are matched against the next rules.
+ *
+ */
+
+void TestRules::samples_exchanges() {
+
+  RuleSet rules;
+  QString error;
+
+  QCOMPARE(load(&rules, "intercept path=/sampled sample=3\n"
+                        "pass path=/\n"
+                        "default intercept\n", &error), 0);
+
+  for(int i = 0; i < 9; i++)
+    QCOMPARE(gated(&rules, "example.com", "/sampled"), i % 3 == 0);
+
+  // Exchanges the rule does not match are not counted:
+  QVERIFY(!gated(&rules, "example.com", "/other"));
+  QVERIFY(gated(&rules, "example.com", "/sampled"));
+
+}
+
+/**
+ * @fn void TestRules::rejects_invalid_lines()
+ * @brief Method to load rules files with an invalid line.
+ *
+ * The whole file is rejected, naming the line, and no rules stay loaded.
+ *
+ */
+
+void TestRules::rejects_invalid_lines() {
+
+  QList<QByteArray> lines = QList<QByteArray>()
+    << "block host=example.com"
+    << "intercept host="
+    << "intercept host=www.*.com"
+    << "intercept host=*example.com"
+    << "intercept stage=both"
+    << "intercept sample=0"
+    << "intercept sample=many"
+    << "intercept colour=red"
+    << "default maybe"
+    << "default";
+  RuleSet rules;
+  QString error;
+
+  for(int i = 0; i < lines.size(); i++) {
+    error.clear();
+    QCOMPARE(load(&rules, "default pass\n# Valid so far\n" + lines[i] + "\n", &error), -1);
+    QVERIFY(error.startsWith("line 3: "));
+    QVERIFY(gated(&rules, "example.com", "/"));
+  }
+
+  QCOMPARE(rules.load("/nonexistent/rules.txt", &error), -1);
+  QVERIFY(!error.isEmpty());
+
+}
+
+/**
+ * @fn void TestRules::describes_requests()
+ * @brief Method to gather the facts of requests the rules look at.
+ */
+
+void TestRules::describes_requests() {
+
+  rule_request request;
+
+  request = RuleSet::describe("GET", "http://Example.COM:8080/a/b?q=1", "");
+  QCOMPARE(request.host, QString("example.com"));
+  QCOMPARE(request.path, QString("/a/b"));
+  QCOMPARE(request.method, QString("GET"));
+
+  request = RuleSet::describe("GET", "http://example.com", "");
+  QCOMPARE(request.host, QString("example.com"));
+  QCOMPARE(request.path, QString("/"));
+
+  request = RuleSet::describe("GET", "http://ignored.com/x", "Host.Example.com.");
+  QCOMPARE(request.host, QString("host.example.com"));
+
+  request = RuleSet::describe("OPTIONS", "/x?y", "[::1]:8080");
+  QCOMPARE(request.host, QString("::1"));
+  QCOMPARE(request.path, QString("/x"));
+
+}
+
+QTEST_APPLESS_MAIN(TestRules)
+
+#include "tst_rules.moc"
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# SlabPool tests.
+#
+#-------------------------------------------------
+
+QT += testlib
+QT -= gui
+
+TARGET = tst_slab_pool
+TEMPLATE = app
+
+CONFIG += console testcase c++14
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+# File names:
+SOURCES += \
+        tst_slab_pool.cpp \
+        ../../src/slab_pool.cpp
+
+HEADERS += \
+        ../../include/slab_pool.h
@@ -0,0 +1,258 @@
+// ProxyGate - SlabPool tests.
+
+/**
+ * @file tst_slab_pool.cpp
+ * @brief SlabPool tests.
+ *
+ * Requests are grown through every buffer size, the way a Server worker reads
+ * into them, checking that their contents survive each move and that buffers
+ * given back are handed out again.
+ *
+ */
+
+// Library includes:
+#include <string.h>
+
+// Qt includes:
+#include <QtTest>
+
+// User includes:
+#include "include/slab_pool.h"
+
+// Macros:
+
+/**
+ * @def TEST_LARGEST
+ * @brief Size (in bytes) of the largest buffer.
+ */
+
+#define TEST_LARGEST (static_cast<size_t> (SLAB_BLOCK_SIZE) << (SLAB_CLASSES - 1))
+
+// Class headers:
+
+/**
+ * @class TestSlabPool
+ * @brief SlabPool tests.
+ */
+
+class TestSlabPool : public QObject {
+
+  Q_OBJECT
+
+  private slots:
+    void grows_through_every_size();
+    void honors_limit();
+    void rejects_larger_requests();
+    void reuses_released_buffers();
+
+  private:
+    // Methods:
+    static bool holds_pattern(const request*);
+    static request empty_request();
+
+};
+
+// Private methods:
+
+/**
+ * @fn bool TestSlabPool::holds_pattern(const request *req)
+ * @brief Method to check the contents written by the tests.
+ * @param req Address of the request.
+ * @return Returns true if every byte of the contents is the low byte of its
+ * position.
+ */
+
+bool TestSlabPool::holds_pattern(const request *req) {
+
+  for(ssize_t i = 0; i < req->size; i++)
+    if(req->content[i] != static_cast<char> (i))
+      return false;
+
+  return true;
+
+}
+
+/**
+ * @fn request TestSlabPool::empty_request()
+ * @brief Method to create a request without a buffer.
+ * @return Returns the request.
+ */
+
+request TestSlabPool::empty_request() {
+
+  request req;
+
+  req.content = nullptr;
+  req.size = 0;
+  req.capacity = 0;
+  req.parsed = false;
+
+  return req;
+
+}
+
+// Test cases:
+
+/**
+ * @fn void TestSlabPool::grows_through_every_size()
+ * @brief Method to fill a request up to the largest buffer.
+ *
+ * Each full buffer moves to one twice as large, and the parse of the old
+ * one no longer applies. The last byte of every buffer is left for the
+ * '\0' read_socket() writes after the data, so the largest buffer holds one
+ * byte less than its size.
+ *
+ */
+
+void TestSlabPool::grows_through_every_size() {
+
+  SlabPool pool;
+  request req = empty_request();
+  size_t room, expected = SLAB_BLOCK_SIZE;
+  int grown = 0;
+
+  while((room = pool.room(&req, TEST_LARGEST)) > 0) {
+
+    if(req.capacity != expected) {
+      QCOMPARE(req.capacity, expected * 2);
+      QVERIFY(!req.parsed);
+      QVERIFY(holds_pattern(&req));
+      expected = req.capacity;
+      grown++;
+    }
+
+    QCOMPARE(static_cast<size_t> (req.size) + room, req.capacity - 1);
+
+    for(size_t i = 0; i < room; i++)
+      req.content[static_cast<size_t> (req.size) + i] = static_cast<char> (static_cast<size_t> (req.size) + i);
+
+    req.content[static_cast<size_t> (req.size) + room] = '\0';
+
+    req.size += static_cast<ssize_t> (room);
+    req.parsed = true;
+
+  }
+
+  QCOMPARE(grown, SLAB_CLASSES - 1);
+  QCOMPARE(static_cast<size_t> (req.size), TEST_LARGEST - 1);
+  QVERIFY(holds_pattern(&req));
+  QVERIFY(req.parsed);
+
+  pool.release(&req);
+  QVERIFY(req.content == nullptr);
+  QCOMPARE(req.size, static_cast<ssize_t> (0));
+  QCOMPARE(req.capacity, static_cast<size_t> (0));
+
+}
+
+/**
+ * @fn void TestSlabPool::honors_limit()
+ * @brief Method to read into a request that may not reach a whole buffer.
+ */
+
+void TestSlabPool::honors_limit() {
+
+  SlabPool pool;
+  request req = empty_request();
+
+  QCOMPARE(pool.room(&req, 100), static_cast<size_t> (100));
+  QCOMPARE(req.capacity, static_cast<size_t> (SLAB_BLOCK_SIZE));
+
+  req.size = 60;
+  QCOMPARE(pool.room(&req, 100), static_cast<size_t> (40));
+
+  req.size = 100;
+  QCOMPARE(pool.room(&req, 100), static_cast<size_t> (0));
+  QCOMPARE(req.capacity, static_cast<size_t> (SLAB_BLOCK_SIZE));
+
+  pool.release(&req);
+
+}
+
+/**
+ * @fn void TestSlabPool::rejects_larger_requests()
+ * @brief Method to grow a request past the largest buffer.
+ *
+ * The request is left as it was.
+ *
+ */
+
+void TestSlabPool::rejects_larger_requests() {
+
+  SlabPool pool;
+  request req = empty_request();
+  char *content;
+
+  QVERIFY(pool.grow(&req, 3 * SLAB_BLOCK_SIZE));
+  QCOMPARE(req.capacity, static_cast<size_t> (4 * SLAB_BLOCK_SIZE));
+  QVERIFY(pool.grow(&req, 10));
+  QCOMPARE(req.capacity, static_cast<size_t> (4 * SLAB_BLOCK_SIZE));
+
+  memcpy(req.content, "GET / HTTP/1.1\r\n", 16);
+  req.size = 16;
+  req.parsed = true;
+  content = req.content;
+
+  QVERIFY(!pool.grow(&req, TEST_LARGEST + 1));
+  QVERIFY(req.content == content);
+  QCOMPARE(req.size, static_cast<ssize_t> (16));
+  QCOMPARE(req.capacity, static_cast<size_t> (4 * SLAB_BLOCK_SIZE));
+  QVERIFY(req.parsed);
+
+  pool.release(&req);
+
+}
+
+/**
+ * @fn void TestSlabPool::reuses_released_buffers()
+ * @brief Method to take buffers of each size after giving them back.
+ *
+ * The buffer given back last is handed out first, and only to a request of
+ * its size.
+ *
+ */
+
+void TestSlabPool::reuses_released_buffers() {
+
+  SlabPool pool;
+  request first = empty_request(), second = empty_request(),
+          large = empty_request();
+  char *first_content, *second_content, *large_content;
+
+  QVERIFY(pool.grow(&first, 1));
+  QVERIFY(pool.grow(&second, 1));
+  QVERIFY(pool.grow(&large, 2 * SLAB_BLOCK_SIZE));
+  first_content = first.content;
+  second_content = second.content;
+  large_content = large.content;
+
+  pool.release(&first);
+  pool.release(&second);
+  pool.release(&large);
+
+  QVERIFY(pool.grow(&first, SLAB_BLOCK_SIZE));
+  QVERIFY(first.content == second_content);
+  QVERIFY(pool.grow(&second, 1));
+  QVERIFY(second.content == first_content);
+
+  // Growing gives the smaller buffer back:
+  first.size = 1;
+  QVERIFY(pool.grow(&first, SLAB_BLOCK_SIZE + 1));
+  QVERIFY(first.content == large_content);
+  QVERIFY(pool.grow(&large, 1));
+  QVERIFY(large.content == second_content);
+
+  pool.release(&first);
+  pool.release(&second);
+  pool.release(&large);
+
+  // Buffers kept are freed on clear (the sanitizers catch leaks):
+  pool.clear();
+  QVERIFY(pool.grow(&first, 1));
+  pool.release(&first);
+
+}
+
+QTEST_APPLESS_MAIN(TestSlabPool)
+
+#include "tst_slab_pool.moc"
@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# ProxyGate unit tests (built apart from the application, with
+# 'qmake tests/tests.pro', and run with 'make check').
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+        byte_scan \
+        chunked_codec \
+        disk_cache \
+        http_cache \
+        http_grammar \
+        http_parser \
+        resolver \
+        ring_buffer \
+        rules \
+        slab_pool